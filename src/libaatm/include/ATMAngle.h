@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 using std::string;
 
@@ -44,6 +45,14 @@ ATM_NAMESPACE_BEGIN
 class Angle
 {
  public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct rad { typedef Angle quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< radian
+  struct deg { typedef Angle quantity; static constexpr double toIS(double v) { return (v / 360.0) * 6.2831852; } static constexpr double fromIS(double v) { return 360.0 * (v / 6.2831852); } }; //!< degree
+  //@}
+
   /** Default constructor */
   Angle();
   /** A full constructor: Angle value in default units (SI: radians) */
@@ -59,6 +68,18 @@ class Angle
   /** Accessor to the angle value in specified units. Implemented units are: deg [DEG], rad [RAD] [Rad].
    *  If none of these implemented units is given, the SI value will be returned. */
   double get(const string &units) const;
+  /** Accessor to the value in a unit known at compile time, e.g. get<Angle::deg>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, Angle>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** Angle from a value in a unit known at compile time, e.g. Angle::from<Angle::deg>(x) */
+  template<class Unit> static Angle from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, Angle>::value, "unit tag of another quantity");
+    return Angle(Unit::toIS(value));
+  }
 
   /** Operator "equal to a Angle" */
   Angle& operator=(const Angle &rhs) { if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
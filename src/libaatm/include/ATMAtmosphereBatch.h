@@ -0,0 +1,183 @@
+#ifndef _ATM_ATMOSPHEREBATCH_H
+#define _ATM_ATMOSPHEREBATCH_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMAtmosphereBatch.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+#include "ATMHumidity.h"
+#include "ATMLength.h"
+#include "ATMOpacity.h"
+#include "ATMPressure.h"
+#include "ATMProfile.h"
+#include "ATMSkyStatus.h"
+#include "ATMSpectralGrid.h"
+#include "ATMTemperature.h"
+
+#include <vector>
+
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief A set of atmospheric states (weather conditions) evaluated on a single spectral grid.
+ *
+ *   Monte Carlo and site statistics studies need the opacity and the sky brightness temperature
+ *   for many sets of basic atmospheric parameters, all on the same spectral grid. Rather than one
+ *   SkyStatus object (and one SpectralGrid) per state, an AtmosphereBatch holds the spectral grid
+ *   once and the basic parameters of the states as one array per parameter. A single working
+ *   SkyStatus is moved from one state to the next by compute(), which fills the result tables
+ *   through its public accessors: the line catalogues are static tables of RefractiveIndex, shared by
+ *   all the states, and each state is evaluated on the distinct frequencies of the grid only.
+ *
+ *   The results are stored as tables shaped [state][channel], the channel index running over all
+ *   the channels of all the spectral windows of the grid (i.e. the index of the state multiplied
+ *   by getNumChan() plus the channel index).
+ *
+ *   The parameters which are not given per state (pressure step, pressure step factor, top of the
+ *   profile and type of atmosphere) are those of the AtmProfile used to construct the batch.
+ */
+class AtmosphereBatch
+{
+public:
+
+  //@{
+  /** The constructor.
+   * @param spectralGrid the spectral grid shared by all the states
+   * @param atmProfile   the reference atmospheric profile; its basic parameters are used for the
+   *                     parameters not specified when adding a state
+   */
+  AtmosphereBatch(const SpectralGrid &spectralGrid, const AtmProfile &atmProfile);
+
+  virtual ~AtmosphereBatch();
+  //@}
+
+  //@{
+  /** Add an atmospheric state
+   * @return the index of this state
+   */
+  size_t addState(const Length &altitude,
+                  const Pressure &groundPressure,
+                  const Temperature &groundTemperature,
+                  double tropoLapseRate,
+                  const Humidity &relativeHumidity,
+                  const Length &wvScaleHeight);
+  /** Add an atmospheric state which differs from the reference profile by its ground pressure,
+   *  temperature and relative humidity only
+   * @return the index of this state
+   */
+  size_t addState(const Pressure &groundPressure,
+                  const Temperature &groundTemperature,
+                  const Humidity &relativeHumidity);
+  /** Remove all the states and their results */
+  void clearStates();
+
+  /** Setter for the air mass used for the sky brightness temperatures (default 1.0) */
+  void setAirMass(double airMass) { airMass_ = airMass; }
+  /** Accessor to the air mass used for the sky brightness temperatures */
+  double getAirMass() const { return airMass_; }
+  /** Setter for the sky coupling used for the sky brightness temperatures (default 1.0) */
+  void setSkyCoupling(double skyCoupling) { skyCoupling_ = skyCoupling; }
+  /** Accessor to the sky coupling used for the sky brightness temperatures */
+  double getSkyCoupling() const { return skyCoupling_; }
+  /** Setter for the spill over temperature used for the sky brightness temperatures (default 100 K,
+   *  irrelevant with a sky coupling of 1) */
+  void setSpilloverTemperature(const Temperature &spilloverTemperature)
+  {
+    spilloverTemperature_ = spilloverTemperature.get<Temperature::K>();
+  }
+  /** Accessor to the spill over temperature used for the sky brightness temperatures */
+  Temperature getSpilloverTemperature() const { return Temperature::from<Temperature::K>(spilloverTemperature_); }
+  /** Setter for the sky background temperature (default 2.73 K) */
+  void setSkyBackgroundTemperature(const Temperature &skyBackgroundTemperature);
+  //@}
+
+  /** Compute the opacities and sky brightness temperatures of all the states for all the channels
+   *  of the spectral grid.
+   * @post the result tables have getNumState() rows
+   */
+  void compute();
+
+  //@{
+  /** Accessor to the number of states */
+  size_t getNumState() const { return v_groundPressure_.size(); }
+  /** Accessor to the number of channels (all spectral windows) */
+  size_t getNumChan() const { return skyStatus_.getNumIndividualFrequencies(); }
+  /** Accessor to the spectral grid */
+  const SpectralGrid &getSpectralGrid() const { return skyStatus_; }
+
+  /** Accessor to the zenith water vapor column of a state (-999 mm if it has not been computed) */
+  Length getGroundWH2O(size_t state) const;
+  /** Accessor to the zenith dry opacity of a state at channel nc of the grid (-999 np if not computed) */
+  Opacity getDryOpacity(size_t state, size_t nc) const;
+  /** Accessor to the zenith dry opacity of a state at channel nc of spectral window spwid */
+  Opacity getDryOpacity(size_t state, size_t spwid, size_t nc) const;
+  /** Accessor to the zenith wet opacity of a state at channel nc of the grid (-999 np if not computed) */
+  Opacity getWetOpacity(size_t state, size_t nc) const;
+  /** Accessor to the zenith wet opacity of a state at channel nc of spectral window spwid */
+  Opacity getWetOpacity(size_t state, size_t spwid, size_t nc) const;
+  /** Accessor to the sky brightness temperature of a state at channel nc of the grid, for the air mass,
+   *  sky coupling and spill over temperature of the batch (-999 K if not computed) */
+  Temperature getTebbSky(size_t state, size_t nc) const;
+  /** Accessor to the sky brightness temperature of a state at channel nc of spectral window spwid */
+  Temperature getTebbSky(size_t state, size_t spwid, size_t nc) const;
+
+  /** Table of the zenith dry opacities (np), shaped [state][channel] */
+  const vector<double> &getDryOpacityTable() const { return v_dryOpacity_; }
+  /** Table of the zenith wet opacities (np), shaped [state][channel] */
+  const vector<double> &getWetOpacityTable() const { return v_wetOpacity_; }
+  /** Table of the sky brightness temperatures (K), shaped [state][channel] */
+  const vector<double> &getTebbSkyTable() const { return v_tebbSky_; }
+  //@}
+
+protected:
+  SkyStatus skyStatus_;                  //!< the working object, moved from one state to the next
+  double airMass_;                       //!< air mass for the sky brightness temperatures
+  double skyCoupling_;                   //!< sky coupling for the sky brightness temperatures
+  double spilloverTemperature_;          //!< spill over temperature for the sky brightness temperatures (K)
+
+  vector<double> v_altitude_;            //!< altitude of every state (m)
+  vector<double> v_groundPressure_;      //!< ground pressure of every state (mb)
+  vector<double> v_groundTemperature_;   //!< ground temperature of every state (K)
+  vector<double> v_tropoLapseRate_;      //!< tropospheric lapse rate of every state (K/km)
+  vector<double> v_relativeHumidity_;    //!< ground relative humidity of every state (%)
+  vector<double> v_wvScaleHeight_;       //!< water vapor scale height of every state (m)
+
+  size_t numComputed_;                   //!< number of states for which the results are available
+  vector<double> v_groundWH2O_;          //!< zenith water vapor column of every computed state (m)
+  vector<double> v_dryOpacity_;          //!< zenith dry opacities (np) [state][channel]
+  vector<double> v_wetOpacity_;          //!< zenith wet opacities (np) [state][channel]
+  vector<double> v_tebbSky_;             //!< sky brightness temperatures (K) [state][channel]
+
+private:
+  size_t chanIndex(size_t spwid, size_t nc) const; //!< index in the grid of channel nc of spwid, or getNumChan()
+}; // class AtmosphereBatch
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_ATMOSPHEREBATCH_H*/
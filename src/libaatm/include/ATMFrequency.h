@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 
 
@@ -48,6 +49,17 @@ ATM_NAMESPACE_BEGIN
 class Frequency
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct THz { typedef Frequency quantity; static constexpr double toIS(double v) { return 1.0E12 * v; } static constexpr double fromIS(double v) { return 1.0E-12 * v; } }; //!< terahertz
+  struct GHz { typedef Frequency quantity; static constexpr double toIS(double v) { return 1.0E9 * v; } static constexpr double fromIS(double v) { return 1.0E-9 * v; } }; //!< gigahertz
+  struct MHz { typedef Frequency quantity; static constexpr double toIS(double v) { return 1.0E6 * v; } static constexpr double fromIS(double v) { return 1.0E-6 * v; } }; //!< megahertz
+  struct kHz { typedef Frequency quantity; static constexpr double toIS(double v) { return 1.0E3 * v; } static constexpr double fromIS(double v) { return 1.0E-3 * v; } }; //!< kilohertz
+  struct Hz  { typedef Frequency quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< hertz
+  //@}
+
   /** Default constructor: Frequency value set to 0 Hz */
   Frequency();
   /** A full constructor: Frequency value + units. Valid units are THz [THZ] [thz], GHz [GHZ] [ghz], MHz [MHZ] [mhz], Hz [HZ] [hz] */
@@ -65,6 +77,18 @@ public:
   /** Accessor to the frequency value in specified units. Implemented units are THz [THZ] [thz], GHz [GHZ] [ghz], MHz [MHZ] [mhz], Hz [HZ] [hz].
    *  If none of these implemented units is given, the SI value will be returned. */
   inline double get(const std::string &units) const { return sget( valueIS_, units); }
+  /** Accessor to the value in a unit known at compile time, e.g. get<Frequency::GHz>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, Frequency>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** Frequency from a value in a unit known at compile time, e.g. Frequency::from<Frequency::GHz>(x) */
+  template<class Unit> static Frequency from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, Frequency>::value, "unit tag of another quantity");
+    return Frequency(Unit::toIS(value));
+  }
 
   /** Operator "equal to a Frequency" */
   inline Frequency& operator=(const Frequency &rhs) { if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
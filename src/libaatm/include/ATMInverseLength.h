@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 
 
@@ -43,6 +44,17 @@ ATM_NAMESPACE_BEGIN
 class InverseLength
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct per_km     { typedef InverseLength quantity; static constexpr double toIS(double v) { return 1.0E-3 * v; } static constexpr double fromIS(double v) { return 1.0E+3 * v; } }; //!< km**-1
+  struct per_m      { typedef InverseLength quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< m**-1
+  struct per_mm     { typedef InverseLength quantity; static constexpr double toIS(double v) { return 1.0E+3 * v; } static constexpr double fromIS(double v) { return 1.0E-3 * v; } }; //!< mm**-1
+  struct per_micron { typedef InverseLength quantity; static constexpr double toIS(double v) { return 1.0E+6 * v; } static constexpr double fromIS(double v) { return 1.0E-6 * v; } }; //!< micron**-1
+  struct per_nm     { typedef InverseLength quantity; static constexpr double toIS(double v) { return 1.0E+9 * v; } static constexpr double fromIS(double v) { return 1.0E-9 * v; } }; //!< nm**-1
+  //@}
+
   /** Default constructor: Length value set to 0 m^-1 */
   InverseLength();
   /** A full constructor: value in default units (m^-1) */
@@ -60,6 +72,18 @@ public:
   /** Accessor to the inverse length value in specified units. Implemented units are km-1 [KM-1], m-1 [M-1], mm-1 [MM-1], micron-1 [MICRON-1], nm-1 [NM-1].
    *  If none of these implemented units is given, the SI value will be returned. */
   inline double get(const std::string &units) const { return sget(valueIS_, units); }
+  /** Accessor to the value in a unit known at compile time, e.g. get<InverseLength::per_km>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, InverseLength>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** InverseLength from a value in a unit known at compile time, e.g. InverseLength::from<InverseLength::per_km>(x) */
+  template<class Unit> static InverseLength from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, InverseLength>::value, "unit tag of another quantity");
+    return InverseLength(Unit::toIS(value));
+  }
 
   /** Operator "equal to a InverseLength" */
   inline InverseLength& operator=(const InverseLength &rhs) { if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 
 
@@ -44,6 +45,17 @@ ATM_NAMESPACE_BEGIN
 class Length
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct km     { typedef Length quantity; static constexpr double toIS(double v) { return 1.0E+3 * v; } static constexpr double fromIS(double v) { return 1.0E-3 * v; } }; //!< kilometre
+  struct m      { typedef Length quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< metre
+  struct mm     { typedef Length quantity; static constexpr double toIS(double v) { return 1.0E-3 * v; } static constexpr double fromIS(double v) { return 1.0E+3 * v; } }; //!< millimetre
+  struct micron { typedef Length quantity; static constexpr double toIS(double v) { return 1.0E-6 * v; } static constexpr double fromIS(double v) { return 1.0E+6 * v; } }; //!< micron
+  struct nm     { typedef Length quantity; static constexpr double toIS(double v) { return 1.0E-9 * v; } static constexpr double fromIS(double v) { return 1.0E+9 * v; } }; //!< nanometre
+  //@}
+
   /** Default constructor: Length value set to 0 m */
   Length();
   /** A full constructor: value in default units (m) */
@@ -61,6 +73,18 @@ public:
   /** Accessor to the length value in specified units. Implemented units are km [KM], m [M], mm [MM], micron [MICRON], nm [NM].
    *  If none of these implemented units is given, the SI value will be returned. */
   inline double get(const std::string &units) const { return sget(valueIS_, units); }
+  /** Accessor to the value in a unit known at compile time, e.g. get<Length::km>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, Length>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** Length from a value in a unit known at compile time, e.g. Length::from<Length::km>(x) */
+  template<class Unit> static Length from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, Length>::value, "unit tag of another quantity");
+    return Length(Unit::toIS(value));
+  }
   /** Accessor to the length in specified units as a formatted std::string.
    *  Implemented units are km [KM], m [M], mm [MM], micron [MICRON], nm [NM].
    *  If none of these implemented units is given, the SI value will be returned. */
@@ -0,0 +1,166 @@
+#ifndef _ATM_LEVENBERGMARQUARDT_H
+#define _ATM_LEVENBERGMARQUARDT_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMLevenbergMarquardt.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+
+#include <functional>
+#include <vector>
+
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief Levenberg-Marquardt least squares fit of the parameters of a model to a set of data, as used by the
+ *  retrievals of SkyStatus.
+ *
+ *   At each iteration the model and its derivatives at the current parameters give the curvature matrix alpha
+ *   and the gradient beta of the chi square; the step solves (alpha + damping diag(alpha)) step = beta. A
+ *   trial step is rejected, and the damping multiplied by dampingIncrease, as long as it raises the reduced
+ *   chi square by more than chiSquareTolerance; once accepted, the damping is divided by dampingDecrease. The
+ *   fit has converged when the square root of the reduced chi square changes by less than tolerance over an
+ *   iteration.
+ *
+ *   The model is evaluated with its derivatives at every trial point, so that an accepted trial gives the
+ *   model and derivatives of the next iteration without another evaluation. All the storage is allocated
+ *   by the constructor: no allocation is done by the iterations.
+ */
+class LevenbergMarquardt
+{
+public:
+
+  /** Model to fit: for the parameters param, write the numData model values into model and their derivatives
+   *  into jacobian, jacobian[i*numParam+k] being that of model value i with respect to parameter k */
+  typedef std::function<void(const double *param, double *model, double *jacobian)> Model;
+  /** Constraint on the parameters: modify, if needed, the trial parameters trial computed from the current
+   *  ones param (e.g. to keep them in their physical range) */
+  typedef std::function<void(const double *param, double *trial)> Constraint;
+
+  /** Settings of the iterations */
+  struct Settings
+  {
+    size_t maxIteration;        //!< largest number of iterations
+    double initialDamping;      //!< damping of the first step
+    double dampingIncrease;     //!< factor applied to the damping when a trial step is rejected
+    double dampingDecrease;     //!< divisor applied to the damping when a trial step is accepted
+    double chiSquareTolerance;  //!< increase of the reduced chi square accepted for a trial step
+    double tolerance;           //!< change of the rms of the fit under which the fit has converged
+    size_t maxRejection;        //!< largest number of rejected trial steps in an iteration
+    Settings() :
+      maxIteration(20), initialDamping(0.001), dampingIncrease(10.0), dampingDecrease(10.0),
+      chiSquareTolerance(0.001), tolerance(0.01), maxRejection(100) {}
+  };
+
+  /** Convergence statistics of the last fit */
+  struct Statistics
+  {
+    bool converged;          //!< true if the tolerance has been met within the largest number of iterations
+    size_t numIteration;     //!< number of iterations
+    size_t numEvaluation;    //!< number of evaluations of the model (each with its derivatives)
+    size_t numRejection;     //!< number of rejected trial steps
+    double chiSquare;        //!< reduced chi square at the solution
+    double damping;          //!< damping at the end of the fit
+  };
+
+  //@{
+  /** The constructor
+   * @param numParam number of parameters
+   * @param numData number of data points (values of the model)
+   */
+  LevenbergMarquardt(size_t numParam, size_t numData);
+
+  virtual ~LevenbergMarquardt();
+  //@}
+
+  //@{
+  /** Setter to the settings of the iterations */
+  void setSettings(const Settings &settings) { settings_ = settings; }
+  /** Accessor to the settings of the iterations */
+  const Settings &getSettings() const { return settings_; }
+  /** Setter to the data to fit (numData values, copied) */
+  void setData(const double *data);
+  /** Setter to the weights of the data (numData values, copied); all 1 unless set */
+  void setWeight(const double *weight);
+  /** Setter to the number the chi square is divided by; numData-1 (1 for a single data point) unless set */
+  void setDegreesOfFreedom(double degreesOfFreedom) { degreesOfFreedom_ = degreesOfFreedom; }
+  /** Setter to the constraint on the parameters; none unless set */
+  void setConstraint(const Constraint &constraint) { constraint_ = constraint; }
+  //@}
+
+  //@{
+  /** Fit the model, starting from the parameters param, into which the solution is written
+   * @return true if the fit has converged
+   */
+  bool solve(const Model &model, double *param);
+  /** Accessor to the convergence statistics of the last fit */
+  const Statistics &getStatistics() const { return statistics_; }
+  /** Accessor to the rms of the last fit, the square root of its reduced chi square */
+  double getSigma() const;
+  /** Accessor to the model values at the solution of the last fit (numData values) */
+  const double *getModel() const { return &model_[0]; }
+  /** Accessor to the uncertainty of parameter k at the solution of the last fit, from the diagonal of the
+   *  inverse of the damped curvature matrix of the last step, scaled by the rms of the fit */
+  double getParameterError(size_t k) const;
+  //@}
+
+protected:
+  size_t numParam_;             //!< number of parameters
+  size_t numData_;              //!< number of data points
+  double degreesOfFreedom_;     //!< number the chi square is divided by
+  Settings settings_;           //!< settings of the iterations
+  Statistics statistics_;       //!< statistics of the last fit
+  Constraint constraint_;       //!< constraint on the parameters, may be empty
+  vector<double> data_;         //!< data to fit
+  vector<double> weight_;       //!< weights of the data
+  vector<double> model_;        //!< model values at the current parameters
+  vector<double> jacobian_;     //!< derivatives of the model at the current parameters
+  vector<double> trialModel_;   //!< model values at the trial parameters
+  vector<double> trialJacobian_; //!< derivatives of the model at the trial parameters
+  vector<double> trialParam_;   //!< trial parameters
+  vector<double> alpha_;        //!< curvature matrix (numParam*numParam)
+  vector<double> beta_;         //!< gradient of the chi square (numParam)
+  vector<double> system_;       //!< damped curvature matrix, factorized by the step
+  vector<double> step_;         //!< step of the parameters (numParam)
+  vector<double> error_;        //!< diagonal of the inverse of the damped curvature matrix of the last step
+  double dampingFactor_;        //!< damping factor 1/(1+damping) of the last step
+
+  /** Reduced chi square of model values */
+  double chiSquare(const double *model) const;
+  /** Curvature matrix and gradient at the current parameters */
+  void mkCurvature();
+  /** Trial parameters for a damping factor 1/(1+damping) */
+  void mkTrial(const double *param, double dampingFactor);
+  /** Solve the damped curvature system for the right hand side rhs, overwritten by the solution */
+  void solveDamped(double dampingFactor, double *rhs);
+}; // class LevenbergMarquardt
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_LEVENBERGMARQUARDT_H*/
@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 using std::string;
 
@@ -44,6 +45,15 @@ ATM_NAMESPACE_BEGIN
 class MassDensity
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct kg_m3 { typedef MassDensity quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< kg m**-3
+  struct g_m3  { typedef MassDensity quantity; static constexpr double toIS(double v) { return 1.0E-3 * v; } static constexpr double fromIS(double v) { return 1.0E+3 * v; } }; //!< g m**-3
+  struct g_cm3 { typedef MassDensity quantity; static constexpr double toIS(double v) { return 1.0E+3 * v; } static constexpr double fromIS(double v) { return 1.0E-3 * v; } }; //!< g cm**-3
+  //@}
+
   /** Default constructor */
   MassDensity();
   /** A full constructor: Mass Density value assumed by default to be in kgm**-3 (International System) */
@@ -61,6 +71,18 @@ public:
   /** Accessor to the massdensity value in specified units.
    *  Valid units are kgm**-3 [kg m**-3, KGM**-3, KG M**-3], gcm**-3 [g cm**-3, GCM**-3, G CM**-3]. */
   double get(const string &units) const;
+  /** Accessor to the value in a unit known at compile time, e.g. get<MassDensity::g_m3>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, MassDensity>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** MassDensity from a value in a unit known at compile time, e.g. MassDensity::from<MassDensity::g_m3>(x) */
+  template<class Unit> static MassDensity from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, MassDensity>::value, "unit tag of another quantity");
+    return MassDensity(Unit::toIS(value));
+  }
 
   MassDensity& operator=(const MassDensity &rhs) { if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
   MassDensity& operator=(double rhs) { valueIS_ = rhs; return *this; }
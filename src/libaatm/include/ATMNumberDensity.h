@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 using std::string;
 
@@ -45,6 +46,14 @@ ATM_NAMESPACE_BEGIN
 class NumberDensity
 {
  public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct per_m3  { typedef NumberDensity quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< m**-3
+  struct per_cm3 { typedef NumberDensity quantity; static constexpr double toIS(double v) { return 1.0E+6 * v; } static constexpr double fromIS(double v) { return 1.0E-6 * v; } }; //!< cm**-3
+  //@}
+
   /** Default constructor */
   NumberDensity();
   /** A full constructor: Number Density value assumed by default to be in m**-3 (International System) */
@@ -60,6 +69,18 @@ class NumberDensity
   double get() const { return valueIS_; }
   /** Accessor to the numberdensity value in specified units. Valid units are K [k], mK [mk], and C [c] */
   double get(const string &units) const;
+  /** Accessor to the value in a unit known at compile time, e.g. get<NumberDensity::per_cm3>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, NumberDensity>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** NumberDensity from a value in a unit known at compile time, e.g. NumberDensity::from<NumberDensity::per_cm3>(x) */
+  template<class Unit> static NumberDensity from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, NumberDensity>::value, "unit tag of another quantity");
+    return NumberDensity(Unit::toIS(value));
+  }
 
   NumberDensity& operator=(const NumberDensity &rhs) { if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
   NumberDensity& operator=(const double &rhs) { valueIS_ = rhs; return *this; }
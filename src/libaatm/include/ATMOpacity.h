@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 
 
@@ -44,6 +45,14 @@ ATM_NAMESPACE_BEGIN
 class Opacity
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct np { typedef Opacity quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< neper
+  struct db { typedef Opacity quantity; static constexpr double toIS(double v) { return v / 4.34294482; } static constexpr double fromIS(double v) { return v * 4.34294482; } }; //!< decibel
+  //@}
+
   /** Default constructor: Opacity value set to 0 np */
   Opacity();
   /** A full constructor: value in default units (np) */
@@ -61,6 +70,18 @@ public:
   /** Accessor to the opacity value in specified units. Implemented units are np [neper] [NP] [NEPER], db [DB].
    *  If none of these implemented units is given, the value in neper will be returned. */
   inline double get(const std::string &units) const { return sget(valueIS_, units); }
+  /** Accessor to the value in a unit known at compile time, e.g. get<Opacity::db>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, Opacity>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** Opacity from a value in a unit known at compile time, e.g. Opacity::from<Opacity::db>(x) */
+  template<class Unit> static Opacity from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, Opacity>::value, "unit tag of another quantity");
+    return Opacity(Unit::toIS(value));
+  }
 
   /** Operator "equal to a Opacity" */
   inline Opacity& operator=(const Opacity &rhs) { if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 
 
@@ -44,6 +45,13 @@ ATM_NAMESPACE_BEGIN
 class Percent
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct percent { typedef Percent quantity; static constexpr double toIS(double v) { return v / 100.0; } static constexpr double fromIS(double v) { return v * 100.0; } }; //!< percent
+  //@}
+
   /** Default constructor */
   Percent();
   /** A full constructor: Amount in default units (relative to 1) */
@@ -58,6 +66,21 @@ public:
   double get()const;
   /** Accessor to the percent value in specified units.  */
    double get(const std::string &units)const;
+  /** Accessor to the value in a unit known at compile time, e.g. get<Percent::percent>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, Percent>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** Percent from a value in a unit known at compile time, e.g. Percent::from<Percent::percent>(x) */
+  template<class Unit> static Percent from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, Percent>::value, "unit tag of another quantity");
+    Percent percent;
+    percent.valueIS_ = Unit::toIS(value);
+    if(percent.valueIS_ <= 0.0) percent.valueIS_ = 0.001;
+    return percent;
+  }
   //@}
 
   /** Operator "equal to a Percent" */
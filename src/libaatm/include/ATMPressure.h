@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 using std::string;
 
@@ -43,6 +44,18 @@ ATM_NAMESPACE_BEGIN
 class Pressure
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct Pa         { typedef Pressure quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< pascal
+  struct hPa        { typedef Pressure quantity; static constexpr double toIS(double v) { return v * 100.0; } static constexpr double fromIS(double v) { return 1.0E-2 * v; } }; //!< hectopascal
+  struct bar        { typedef Pressure quantity; static constexpr double toIS(double v) { return 1.0E+5 * v; } static constexpr double fromIS(double v) { return 1.0E-5 * v; } }; //!< bar
+  struct mb         { typedef Pressure quantity; static constexpr double toIS(double v) { return 1.0E+2 * v; } static constexpr double fromIS(double v) { return 1.0E-2 * v; } }; //!< millibar
+  struct mbar       { typedef Pressure quantity; static constexpr double toIS(double v) { return 1.0E+2 * v; } static constexpr double fromIS(double v) { return 1.0E-2 * v; } }; //!< millibar
+  struct atmosphere { typedef Pressure quantity; static constexpr double toIS(double v) { return v * 101325.; } static constexpr double fromIS(double v) { return v / 101325.; } }; //!< standard atmosphere
+  //@}
+
 
   /** Default constructor */
   Pressure();
@@ -59,6 +72,18 @@ public:
   /** Accessor to get the value in the following (implemented) units: hPa [HPA] [hpa], bar [BAR], mb [MB], mbar [MBAR], atm [ATM].
    * If none of these implemented units is given, the SI value will be returned. */
   double get(const string &units) const;
+  /** Accessor to the value in a unit known at compile time, e.g. get<Pressure::mb>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, Pressure>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** Pressure from a value in a unit known at compile time, e.g. Pressure::from<Pressure::mb>(x) */
+  template<class Unit> static Pressure from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, Pressure>::value, "unit tag of another quantity");
+    return Pressure(Unit::toIS(value));
+  }
 
    Pressure& operator=(const Pressure &rhs) { if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
    Pressure& operator=(double rhs) { valueIS_ = rhs; return *this; }
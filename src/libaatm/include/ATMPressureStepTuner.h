@@ -0,0 +1,165 @@
+#ifndef _ATM_PRESSURESTEPTUNER_H
+#define _ATM_PRESSURESTEPTUNER_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMPressureStepTuner.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+#include "ATMProfile.h"
+#include "ATMSpectralGrid.h"
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief Choice of the pressure step parameters of the AtmProfile of a site for an accuracy goal in a band.
+ *
+ *   The layering of an AtmProfile, up to the 100 mb level, is set by the primary pressure step and the
+ *   pressure step factor; above it follows the levels of the reference atmosphere. A PressureStepTuner looks,
+ *   among a set of candidate parameters, for the coarsest layering (the fewest layers) for which the zenith
+ *   sky brightness temperatures and path lengths in a band stay within a goal of those of a fine reference
+ *   layering (primary step of 0.5 mb, factor 1.02). The errors do not decrease steadily with the number of
+ *   layers: the levels above the 100 mb level are those of the reference atmosphere, placed from the last
+ *   tropospheric level, and where the pressure steps end shifts them. The candidates are thus all tried, from
+ *   the fewest layers up, and the errors of the site profile itself are reported for comparison.
+ *
+ *   The evaluations are done on a proxy of the band: at most maxProxyChan_ channels, evenly spread over it,
+ *   computed by SkyStatus::streamSpectrum() without storing any absorption profile, for the ground
+ *   conditions of the site profile and the water vapor column of the reference layering.
+ *
+ *   The choice can be saved in a cache file, with one entry per site profile (altitude, type of atmosphere,
+ *   top of the profile, ground conditions, lapse rate, water vapor scale height and pressure step
+ *   parameters), band (number of channels and frequency range) and goals, and loaded back instead of being
+ *   searched again.
+ */
+class PressureStepTuner
+{
+public:
+
+  //@{
+  /** The constructor; nothing is computed until tune() or load() is called.
+   * @param atmProfile   the profile of the site, with the ground conditions for which the layering is tuned
+   * @param spectralGrid the band, all its spectral windows
+   */
+  PressureStepTuner(const AtmProfile &atmProfile, const SpectralGrid &spectralGrid);
+
+  virtual ~PressureStepTuner();
+  //@}
+
+  //@{
+  /** Search the coarsest layering meeting both goals
+   * @param tebbGoal largest difference accepted on the sky brightness temperature of a channel
+   * @param pathLengthGoal largest difference accepted on the zenith path length of a channel
+   * @return false if no candidate meets the goals (the reference layering is then kept)
+   */
+  bool tune(const Temperature &tebbGoal, const Length &pathLengthGoal);
+  /** Search the coarsest layering meeting a goal on the sky brightness temperatures only */
+  bool tune(const Temperature &tebbGoal);
+  /** Search the coarsest layering meeting a goal on the path lengths only */
+  bool tune(const Length &pathLengthGoal);
+  //@}
+
+  //@{
+  /** Accessor telling whether a layering has been chosen, by tune() or load() */
+  bool isTuned() const { return numLayer_ > 0; }
+  /** Accessor to the chosen primary pressure step */
+  Pressure getPressureStep() const { return Pressure::from<Pressure::mb>(pressureStep_); }
+  /** Accessor to the chosen pressure step factor */
+  double getPressureStepFactor() const { return pressureStepFactor_; }
+  /** Accessor to the number of layers of the chosen layering */
+  size_t getNumLayer() const { return numLayer_; }
+  /** Accessor to the number of layers of the site profile, with its own pressure step parameters */
+  size_t getSiteNumLayer() const { return siteNumLayer_; }
+  /** Accessor to the number of layers of the reference layering */
+  size_t getReferenceNumLayer() const { return referenceNumLayer_; }
+  /** Accessor to the largest difference on the sky brightness temperatures of the proxy channels */
+  Temperature getTebbError() const { return Temperature::from<Temperature::K>(tebbError_); }
+  /** Accessor to the largest difference on the zenith path lengths of the proxy channels */
+  Length getPathLengthError() const { return Length::from<Length::m>(pathLengthError_); }
+  /** Accessor to the largest difference on the sky brightness temperatures for the site profile layering */
+  Temperature getSiteTebbError() const { return Temperature::from<Temperature::K>(siteTebbError_); }
+  /** Accessor to the largest difference on the zenith path lengths for the site profile layering */
+  Length getSitePathLengthError() const { return Length::from<Length::m>(sitePathLengthError_); }
+  /** Accessor to the cost of the chosen layering relative to that of the site profile (ratio of the
+   *  numbers of layers, to which the line sums and the radiative transfer are proportional) */
+  double getCostRatio() const { return siteNumLayer_ == 0 ? 0.0 : (double) numLayer_ / siteNumLayer_; }
+  /** Accessor to the site profile rebuilt with the chosen pressure step parameters (the site profile if
+   *  no layering has been chosen) */
+  AtmProfile getAtmProfile() const;
+  //@}
+
+  //@{
+  /** Save the chosen layering in a cache file, replacing the entry of the same site profile, band and goals
+   * @return false if no layering has been chosen or the file could not be written
+   */
+  bool save(const string &fileName) const;
+  /** Look for the entry of this site profile, band and goals in a cache file (a negative goal stands for no goal,
+   *  as set by tune() with a single goal)
+   * @return false (and nothing is changed) if there is no such entry or the file could not be read
+   */
+  bool load(const string &fileName, const Temperature &tebbGoal, const Length &pathLengthGoal);
+  //@}
+
+protected:
+  static const size_t maxProxyChan_ = 32; //!< largest number of channels of the proxy band
+
+  AtmProfile atmProfile_;          //!< profile of the site
+  vector<double> v_proxyFreq_;     //!< frequencies of the proxy channels (Hz)
+  size_t numChan_;                 //!< number of channels of the band
+  double minFreq_;                 //!< lowest frequency of the band (Hz)
+  double maxFreq_;                 //!< highest frequency of the band (Hz)
+
+  double tebbGoal_;                //!< goal on the sky brightness temperatures (K)
+  double pathLengthGoal_;          //!< goal on the path lengths (m)
+  double pressureStep_;            //!< chosen primary pressure step (mb)
+  double pressureStepFactor_;      //!< chosen pressure step factor
+  size_t numLayer_;                //!< number of layers of the chosen layering, 0 if none
+  size_t siteNumLayer_;            //!< number of layers of the site profile
+  size_t referenceNumLayer_;       //!< number of layers of the reference layering
+  double tebbError_;               //!< largest difference on the sky brightness temperatures (K)
+  double pathLengthError_;         //!< largest difference on the path lengths (m)
+  double siteTebbError_;           //!< largest difference on the sky brightness temperatures for the site layering (K)
+  double sitePathLengthError_;     //!< largest difference on the path lengths for the site layering (m)
+
+  /** Profile of the site for a pair of pressure step parameters */
+  AtmProfile mkAtmProfile(double pressureStep, double pressureStepFactor) const;
+  /** Zenith sky brightness temperatures (K) and path lengths (m) of the proxy channels for a profile,
+   *  with the water vapor column wh2o */
+  void mkProxySpectrum(const AtmProfile &atmProfile, const Length &wh2o,
+                       vector<double> &tebbSky, vector<double> &pathLength) const;
+  /** Key of the site profile, band and goals in a cache file */
+  string mkCacheKey(double tebbGoal, double pathLengthGoal) const;
+}; // class PressureStepTuner
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_PRESSURESTEPTUNER_H*/
@@ -38,6 +38,7 @@
 #include "ATMTemperature.h"
 #include "ATMEnumerations.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -213,8 +214,41 @@ public:
              const vector<NumberDensity> &v_layerNO2,
              const vector<NumberDensity> &v_layerSO2);
 
+  /** Levels of a profile given as raw arrays, for instance a radiosonde ascent or a column of a
+   *  reanalysis, in SI units. The arrays are read in place, at the time the layers are built from them;
+   *  the layers are the intervals between consecutive levels. */
+  struct UserLevels
+  {
+    size_t numLevel;           //!< number of levels (number of layers + 1), from the ground up
+    const double *altitude;    //!< altitudes above sea level (m), strictly increasing
+    const double *pressure;    //!< pressures (Pa), decreasing
+    const double *temperature; //!< temperatures (K)
+    const double *waterVapor;  //!< water vapor mass densities (kg m**-3)
+    const double *o3;          //!< O3 number densities (m**-3); null to take those of the reference atmosphere
+    const double *co;          //!< CO number densities (m**-3); null to take those of the reference atmosphere
+    const double *n2o;         //!< N2O number densities (m**-3); null to take those of the reference atmosphere
+    const double *no2;         //!< NO2 number densities (m**-3); null to take those of the reference atmosphere
+    const double *so2;         //!< SO2 number densities (m**-3); null to take those of the reference atmosphere
+
+    UserLevels() :
+      numLevel(0), altitude(0), pressure(0), temperature(0), waterVapor(0), o3(0), co(0), n2o(0), no2(0), so2(0) {}
+  };
+
+  /** The user provides his own atmospheric profile as raw level arrays (see UserLevels and setUserLevels()).
+   *  If the levels are not valid an error is printed and the profile has no layer.
+   * @param levels  the levels of the profile
+   * @param typeAtm type of the reference atmosphere for the minor gases which are not given (1 to 6)
+   */
+  AtmProfile(const UserLevels &levels, size_t typeAtm);
+
   AtmProfile(const AtmProfile &a); // copy constructor
 
+  AtmProfile(AtmProfile &&a) = default; // move constructor
+
+  AtmProfile &operator=(const AtmProfile &a) = default;
+
+  AtmProfile &operator=(AtmProfile &&a) = default;
+
   virtual ~AtmProfile() {}
 
   /** Setter to update the AtmProfile if some basic atmospheric parameter has changed.
@@ -245,6 +279,9 @@ public:
   /** Accessor to the type of atmosphere specified by the number**/
   static string getAtmosphereType(size_t typeAtm);
 
+  /** Accessor to the number of the type of current atmosphere (1 to 6, see getAtmosphereType(size_t)) **/
+  size_t getTypeAtm() const { return typeAtm_; }
+
   /** Accessor to the current Ground Temperature used in the object */
   Temperature getGroundTemperature() const { return groundTemperature_; }
 
@@ -298,6 +335,10 @@ public:
   /** Accessor to the number of layers of the atmospheric profile */
   size_t getNumLayer() const { return numLayer_; }
 
+  /** Accessor to the version of the layers, which changes whenever they do (what is derived from them can
+   *  compare it to the version it was derived from) */
+  size_t getProfileVersion() const { return profileVersion_; }
+
   /** Method to access the Temperature Profile  */
   vector<Temperature> getTemperatureProfile() const;
 
@@ -401,47 +442,47 @@ public:
 
   /** Setter for the average Pressure in layer i (allows to touch one layer each
    *  time once a profile has been defined) */
-  void setLayerPressure(size_t i, const Pressure &layerPressure) { v_layerPressure_[i] = layerPressure.get("mb"); }
+  void setLayerPressure(size_t i, const Pressure &layerPressure) { clearLayerPartials(); v_layerPressure_[i] = layerPressure.get<Pressure::mb>(); }
   //void setLayerPressure(const Pressure &layerPressure, size_t i) { setLayerPressure(i, layerPressure); }
 
   /** Function to retrieve CO density in a given layer (thickness of layers
    *  in ThicknessProfile)  */
-  NumberDensity getLayerCO(size_t i) const { return NumberDensity(v_layerCO_[i], "m**-3"); }
+  NumberDensity getLayerCO(size_t i) const { return NumberDensity::from<NumberDensity::per_m3>(v_layerCO_[i]); }
   /** Setter for the average number density of CO in layer i in molecules/m**3 (allows to touch one layer each
    *  time once a profile has been defined) */
-  void setLayerCO(size_t i, const NumberDensity &layerCO) { v_layerCO_[i] = layerCO.get("m**-3"); }
+  void setLayerCO(size_t i, const NumberDensity &layerCO) { clearLayerPartials(); v_layerCO_[i] = layerCO.get<NumberDensity::per_m3>(); }
   //void setLayerCO(const NumberDensity &layerCO, size_t i) { setLayerCO(i, layerCO); }
 
   /** Function to retrieve O3 density in a given layer (thickness of layers
    *  in ThicknessProfile) */
-  NumberDensity getLayerO3(size_t i) const { return NumberDensity(v_layerO3_[i], "m**-3"); }
+  NumberDensity getLayerO3(size_t i) const { return NumberDensity::from<NumberDensity::per_m3>(v_layerO3_[i]); }
   /** Setter for the average number density of O3 in layer i in molecules/m**3 (allows to touch one layer each
    *  time once a profile has been defined) */
-  void setLayerO3(size_t i, const NumberDensity &layerO3) { v_layerO3_[i] = layerO3.get("m**-3"); }
+  void setLayerO3(size_t i, const NumberDensity &layerO3) { clearLayerPartials(); v_layerO3_[i] = layerO3.get<NumberDensity::per_m3>(); }
   //void setLayerO3(const NumberDensity &layerO3, size_t i) { setLayerO3(i, layerO3); }
 
   /** Function to retrieve N2O density in a given layer (thickness of layers
    *  in ThicknessProfile)   */
-  NumberDensity getLayerN2O(size_t i) const { return NumberDensity(v_layerN2O_[i], "m**-3"); }
+  NumberDensity getLayerN2O(size_t i) const { return NumberDensity::from<NumberDensity::per_m3>(v_layerN2O_[i]); }
   /** Setter for the average number density of N2O in layer i in molecules/m**3 (allows to touch one layer each
    *  time once a profile has been defined) */
-  void setLayerN2O(size_t i, const NumberDensity &layerN2O) { v_layerN2O_[i] = layerN2O.get("m**-3"); }
+  void setLayerN2O(size_t i, const NumberDensity &layerN2O) { clearLayerPartials(); v_layerN2O_[i] = layerN2O.get<NumberDensity::per_m3>(); }
   //void setLayerN2O(const NumberDensity &layerN2O, size_t i) { setLayerN2O(i, layerN2O); }
 
   /** Function to retrieve NO2 density in a given layer (thickness of layers
    *  in ThicknessProfile)   */
-  NumberDensity getLayerNO2(size_t i) const { return NumberDensity(v_layerNO2_[i], "m**-3"); }
+  NumberDensity getLayerNO2(size_t i) const { return NumberDensity::from<NumberDensity::per_m3>(v_layerNO2_[i]); }
   /** Setter for the average number density of NO2 in layer i in molecules/m**3 (allows to touch one layer each
    *  time once a profile has been defined) */
-  void setLayerNO2(size_t i, const NumberDensity &layerNO2) { v_layerNO2_[i] = layerNO2.get("m**-3"); }
+  void setLayerNO2(size_t i, const NumberDensity &layerNO2) { clearLayerPartials(); v_layerNO2_[i] = layerNO2.get<NumberDensity::per_m3>(); }
   //void setLayerNO2(const NumberDensity &layerNO2, size_t i) { setLayerNO2(i, layerNO2); }
 
   /** Function to retrieve SO2 density in a given layer (thickness of layers
    *  in ThicknessProfile)   */
-  NumberDensity getLayerSO2(size_t i) const { return NumberDensity(v_layerSO2_[i], "m**-3"); }
+  NumberDensity getLayerSO2(size_t i) const { return NumberDensity::from<NumberDensity::per_m3>(v_layerSO2_[i]); }
   /** Setter for the average number density of SO2 in layer i in molecules/m**3 (allows to touch one layer each
    *  time once a profile has been defined) */
-  void setLayerSO2(size_t i, const NumberDensity &layerSO2) { v_layerSO2_[i] = layerSO2.get("m**-3"); }
+  void setLayerSO2(size_t i, const NumberDensity &layerSO2) { clearLayerPartials(); v_layerSO2_[i] = layerSO2.get<NumberDensity::per_m3>(); }
   //void setLayerSO2(const NumberDensity &layerSO2, size_t i) { setLayerSO2(i, layerSO2); }
 
   void setBasicAtmosphericParameterThresholds(const Length &altitudeThreshold,
@@ -458,6 +499,99 @@ public:
    */
   Length getGroundWH2O() const;
 
+  /** Setter to pin the layer boundaries. From now on every profile built from the basic parameters
+   *  keeps these layers, whatever the ground pressure and the pressure step parameters: the levels
+   *  of the adaptive profile are interpolated (linearly in height for the temperature, log-linearly
+   *  for the pressure and the water vapor) at the fixed boundaries, and only the layer values change
+   *  from one update to the next. Tolerance: with the grid of the adaptive layering at given ground
+   *  conditions (see fixLayerGrid()), and ground pressures within 30 mb, ground temperatures within
+   *  20 K of those conditions and any humidity, the zenith water vapor column and the dry path
+   *  lengths stay within 0.3%, the sky brightness temperatures within 0.1 K and the opacities within
+   *  3% of those obtained with the adaptive layering. The profile is rebuilt at once; a
+   *  RefractiveIndexProfile or a SkyStatus should be built from the AtmProfile after this call.
+   * @param v_layerTop heights above the ground of the tops of the layers, strictly increasing
+   * @return false (and the layering is left unchanged) if the heights are not valid
+   */
+  bool setFixedLayerGrid(const vector<Length> &v_layerTop);
+  /** Setter to pin the layer boundaries to those of the current profile (see setFixedLayerGrid()) */
+  bool fixLayerGrid();
+  /** Setter to go back to the adaptive layering, derived from the ground pressure and the pressure
+   *  step parameters. The profile is rebuilt at once. */
+  void releaseLayerGrid();
+  /** Accessor telling whether the layer boundaries are pinned */
+  bool isLayerGridFixed() const { return !v_fixedLayerTop_.empty(); }
+  /** Setter to merge groups of consecutive layers of the current profile into single layers. The layers
+   *  are pinned as by fixLayerGrid(), and each merged layer keeps the columns of dry air and water
+   *  vapor of the layers it is made of, with their dry-air weighted mean temperature: the layers are
+   *  still built individually from the basic parameters, then merged, on every update. Merging layers
+   *  which are already merged combines them.
+   * @param v_numMerged number of layers of each group, from the ground up; their sum must be getNumLayer()
+   * @return false (and the layering is left unchanged) if the group sizes are not valid
+   */
+  bool mergeLayers(const vector<size_t> &v_numMerged);
+
+  /** Setter to start the altitude sliding mode, for an observer moving through the atmosphere (balloon,
+   *  aircraft). The current profile, built for the lowest altitude of the flight, becomes the reference:
+   *  the profile at a higher observer altitude is then this reference cut at that altitude (see
+   *  setObserverAltitude()) instead of a new profile built from the basic parameters. The mode ends
+   *  with stopAltitudeSliding() or as soon as the profile is rebuilt (basic parameters changed beyond
+   *  the thresholds, new layer grid).
+   */
+  void startAltitudeSliding();
+  /** Setter to the altitude of the observer in the altitude sliding mode. The layers of the reference
+   *  profile above the observer are kept as they are; the layer in which the observer is is cut at the
+   *  observer altitude, its mean values being interpolated at its new middle between those of the layer
+   *  and of the layer above (linearly for the temperature, log-linearly for the pressure and the gas
+   *  densities). The ground altitude, pressure and temperature become those of the observer.
+   * @param altitude altitude of the observer, from the altitude of the reference profile to its top
+   * @return false (and the profile is left unchanged) if the mode is not on or the altitude is out of range
+   */
+  bool setObserverAltitude(const Length &altitude);
+  /** Setter to end the altitude sliding mode, going back to the reference profile */
+  void stopAltitudeSliding();
+  /** Accessor telling whether the altitude sliding mode is on */
+  bool isAltitudeSliding() const { return slidingReference_.get() != 0; }
+  /** Accessor to the altitude of the reference profile in the altitude sliding mode (else the ground altitude) */
+  Length getReferenceAltitude() const { return isAltitudeSliding() ? slidingReference_->altitude_ : altitude_; }
+
+  /** Setter to replace the whole profile by user levels. The layer values are the arithmetic mean of
+   *  the temperatures and the geometric means of the pressures and gas densities of their bottom and top
+   *  levels (as for the constructors from vectors of levels); the minor gases which are not given are
+   *  those of the reference atmosphere (see getAtmosphereType()) at the layer middles. The ground altitude,
+   *  pressure and temperature become those of the first level, and the relative humidity and water vapor
+   *  scale height are derived from the water vapor densities. The storage of the layers is reused: a
+   *  single AtmProfile may ingest a stream of profiles without any allocation once it has held the
+   *  largest of them. A pinned layer grid and the altitude sliding mode are cleared.
+   * @param levels the levels of the profile, all checked in one pass before anything is changed (see
+   *        checkUserLevels())
+   * @return false (and the profile is left unchanged) if the levels are not valid
+   */
+  bool setUserLevels(const UserLevels &levels);
+  /** Check of a set of user levels: at least two levels, all the mandatory arrays given, finite values,
+   *  strictly increasing altitudes, positive and decreasing pressures, positive temperatures, and water
+   *  vapor and minor gas densities not negative.
+   * @return an empty string if the levels are valid, else the first problem found
+   */
+  static string checkUserLevels(const UserLevels &levels);
+
+  /** Number densities of the minor gases of a reference atmosphere at a set of altitudes, the densities used
+   *  for the layers of the profiles built from the basic parameters. The interpolation coefficients of the
+   *  reference tables are computed once for all, so that this may also be used to fill the minor gases of a
+   *  user-supplied layer grid at little cost.
+   * @param typeAtm  type of the reference atmosphere (1 to 6, see getAtmosphereType(size_t))
+   * @param num      number of altitudes
+   * @param altitude the altitudes above sea level (km); outside 0 to 120 km the densities are 0
+   * @param o3, co, n2o, no2, so2 buffers of num values receiving the number densities (m**-3)
+   */
+  static void getMinorGasDensities(size_t typeAtm,
+                                   size_t num,
+                                   const double *altitude,
+                                   double *o3,
+                                   double *co,
+                                   double *n2o,
+                                   double *no2,
+                                   double *so2);
+
   // Thresholds
   Length      getAltitudeThreshold()   const {return altitudeThreshold_;};
   Pressure    getGroundPressureThreshold() const {return groundPressureThreshold_;};
@@ -497,6 +631,7 @@ protected:
   size_t numLayer_; //!< Total number of layers in the output	atmospheric profiles
   double fractionLast_;  //!< Fraction of last layer needed for some calculations
   bool newBasicParam_;
+  size_t profileVersion_ = 0; //!< Incremented whenever the layers change, so that what is derived from them can tell it is stale
   vector<double> v_layerThickness_; //!< Thickness of layer (m)
   vector<double> v_layerTemperature_; //!< Temp. of layers (K)
   vector<double> v_layerTemperature0_; //!< Temp. at bottom of layers (K)
@@ -521,6 +656,55 @@ protected:
 
   size_t ier_;
 
+  vector<double> v_workPressure_;    //!< Pressure levels under construction in mkAtmProfile() (mb)
+  vector<double> v_workTemperature_; //!< Temperature levels under construction in mkAtmProfile() (K)
+  vector<double> v_workThickness_;   //!< Level heights under construction in mkAtmProfile() (m)
+  vector<double> v_workWaterVapor_;  //!< Water vapor levels under construction in mkAtmProfile() (gr/m**3)
+  vector<double> v_workAltitude_;    //!< Altitudes of the layer middles in mkAtmProfile() (km)
+  vector<double> v_fixedLayerTop_;   //!< Heights above ground of the pinned layer tops (m); empty for the adaptive layering
+  vector<size_t> v_fixedLayerMerged_; //!< Number of pinned layers merged into each layer of the profile (see mergeLayers())
+  std::shared_ptr<const AtmProfile> slidingReference_; //!< Reference profile of the altitude sliding mode, null out of it
+
+  /** Derivatives of the layers with respect to one of the basic parameters, the number of layers and
+   *  the level at which the troposphere ends being held fixed */
+  struct LayerPartials
+  {
+    void resize(size_t n)
+    {
+      vector<double> *v[9] = { &thickness, &temperature, &pressure, &waterVapor, &o3, &co, &n2o, &no2, &so2 };
+      for(size_t k = 0; k < 9; k++) v[k]->resize(n);
+    }
+
+    vector<double> thickness;   //!< m
+    vector<double> temperature; //!< K
+    vector<double> pressure;    //!< mb
+    vector<double> waterVapor;  //!< kg/m**3
+    vector<double> o3;          //!< molecules per m**3, as the other minor gases
+    vector<double> co;
+    vector<double> n2o;
+    vector<double> no2;
+    vector<double> so2;
+  };
+  /** Derivatives of the levels under construction in mkAtmProfile() with respect to the four basic parameters */
+  struct LevelPartials
+  {
+    double pressure[4];    //!< mb
+    double temperature[4]; //!< K
+    double height[4];      //!< m
+    double waterVapor[4];  //!< gr/m**3
+  };
+  /** Derivatives of the layers built by mkAtmProfile(), computed with them, with respect to the ground
+   *  pressure (per mb), the ground temperature at constant lapse rate (per K), the relative humidity
+   *  (per %) and the tropospheric lapse rate (per K/km), in this order; empty once the layers have
+   *  been changed in another way */
+  LayerPartials layerPartials_[4];
+  vector<LevelPartials> v_workPartials_; //!< Derivatives of the levels under construction in mkAtmProfile()
+
+  /** The derivatives in layerPartials_ are those of the current layers */
+  bool hasLayerPartials() const { return numLayer_ > 0 && layerPartials_[0].thickness.size() == numLayer_; }
+  /** Method to forget the derivatives of the layers, when they are changed otherwise than by mkAtmProfile() */
+  void clearLayerPartials();
+
   /** Default constructor (required if copy constructor in derived classes) */
   AtmProfile() {}
 
@@ -528,6 +712,23 @@ protected:
    * \fn Method to build the profile,
    */
   size_t mkAtmProfile(); /** returns error code: <0 unsuccessful           */
+  /** Method to build the layers on the pinned grid from the levels 0 to npp+1 of the adaptive profile
+   *  left in the work storage by mkAtmProfile(), then to merge them as given by v_fixedLayerMerged_
+   * @return the number of layers
+   */
+  size_t mkFixedGridLayers(size_t npp);
+  /** Method to set the layers to those of the reference profile of the altitude sliding mode cut at
+   *  the observer altitude (see setObserverAltitude())
+   * @param firstLayer layer of the reference profile in which the observer is, the first layer kept
+   * @param weight     interpolation weight of the layer above firstLayer for the mean values of the cut layer
+   * @return false (and the profile is left unchanged) if the mode is not on or the altitude is out of range
+   */
+  bool mkObserverLayers(const Length &altitude, size_t &firstLayer, double &weight);
+  /** Interpolation between the mean values of two consecutive layers, log-linear if both are positive
+   *  and linear otherwise
+   * @param weight weight of the upper layer, from 0 to 1
+   */
+  static double interpolateLayers(double lower, double upper, double weight);
 
   /** Method to update an atmospheric profile based on one or more new basic parameter(s)
    * @param altitude          the new altitude, a Length
@@ -548,9 +749,19 @@ protected:
   void initBasicAtmosphericParameterThresholds();
 
 private:
+  friend class AtmProfileBatch; //!< builds its profiles directly with mkAtmProfile()
+
+  static const double referenceHeight_[20];         //!< Levels of the reference atmospheres above the troposphere (km)
+  static const double referencePressure_[6][20];    //!< Pressure of these levels for the 6 types of atmosphere (mb)
+  static const double referenceTemperature_[6][20]; //!< Temperature of these levels for the 6 types of atmosphere (K)
+
   MassDensity rwat(const Temperature &t, const Humidity &rh, const Pressure &p) const;
+  /** Derivatives of rwat() (gr/m**3) with respect to the pressure (per mb), the temperature (per K) and
+   *  the relative humidity (per %), in partials[0], [1] and [2] */
+  void rwatPartials(double t, double rh, double p, double *partials) const;
   Humidity rwat_inv(const Temperature &tt, const MassDensity &dd, const Pressure &pp) const;
   vector<NumberDensity> st76(const Length &ha, size_t tip) const;
+  void st76(const Length &ha, size_t tip, vector<NumberDensity> &minorden) const; //!< same, into minorden
   double poli2(double ha,
                double x1,
                double x2,
@@ -580,9 +791,9 @@ private:
 
 ATM_NAMESPACE_END
 /*
-  Pressure AtmProfile::pressureStep_default_(Pressure(1.2,"mb"));
+  Pressure AtmProfile::pressureStep_default_(Pressure::from<Pressure::mb>(1.2));
   double AtmProfile::pressureStepFactor_default_(1.2);
-  Length AtmProfile::topAtmProfile_default_(Length(48,"km"));
+  Length AtmProfile::topAtmProfile_default_(Length::from<Length::km>(48));
 */
 
 /** \page AtmProfile_example Example with the AtmProfile class.
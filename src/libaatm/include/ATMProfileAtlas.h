@@ -0,0 +1,172 @@
+#ifndef _ATM_PROFILEATLAS_H
+#define _ATM_PROFILEATLAS_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMProfileAtlas.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+#include "ATMProfile.h"
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief Precomputed atmospheric profiles of a site, interpolated in the ground conditions.
+ *
+ *   For a given site the layer temperatures, pressures and water vapor densities of an AtmProfile are smooth
+ *   functions of the ground pressure, ground temperature, relative humidity, tropospheric lapse rate and water
+ *   vapor scale height. An AtmProfileAtlas tabulates them once, on a grid of these five parameters (an axis may
+ *   have a single node, the parameter being then fixed), with the layer boundaries pinned (see
+ *   AtmProfile::setFixedLayerGrid()). A profile is then obtained by multilinear interpolation in the table,
+ *   written into caller buffers without any allocation.
+ *
+ *   The accuracy of the interpolation is given by getInterpolationError(), which compares, at the centre of
+ *   every cell of the grid, the interpolated profile with the one built by the AtmProfile. The profile of
+ *   the AtmProfile is not continuous everywhere: where a change of the ground conditions moves the
+ *   tropopause from one level of the reference atmosphere to the next, the temperatures and pressures
+ *   around the tropopause jump, and the largest errors reported come from the cells containing such a
+ *   jump. An atlas can be saved in a text file and loaded back.
+ *
+ *   Units: ground pressure in mb, temperatures in K, relative humidity in %, lapse rate in K/km, water vapor
+ *   scale height in km, layer tops and thicknesses in m, water vapor in kg/m**3.
+ */
+class AtmProfileAtlas
+{
+public:
+
+  /** Largest differences between the interpolated profiles and those built by the AtmProfile */
+  struct InterpolationError
+  {
+    double temperature;  //!< largest error on a layer temperature (K)
+    double pressure;     //!< largest relative error on a layer pressure
+    double waterVapor;   //!< largest error on a layer water vapor density (kg/m**3)
+    double groundWH2O;   //!< largest relative error on the zenith water vapor column
+    size_t numTest;      //!< number of tested profiles
+  };
+
+  //@{
+  /** Empty atlas, to be loaded from a file */
+  AtmProfileAtlas();
+  /** The constructor. An axis must not be empty and its nodes must be strictly increasing.
+   * @param atmProfile        the profile of the site: altitude, pressure step parameters, top of the profile,
+   *                          type of atmosphere and, if pinned, layer grid (else its current layers are pinned)
+   * @param groundPressure    nodes of the ground pressure (mb)
+   * @param groundTemperature nodes of the ground temperature (K)
+   * @param relativeHumidity  nodes of the relative humidity (%)
+   * @param tropoLapseRate    nodes of the tropospheric lapse rate (K/km)
+   * @param wvScaleHeight     nodes of the water vapor scale height (km)
+   */
+  AtmProfileAtlas(const AtmProfile &atmProfile,
+                  const vector<double> &groundPressure,
+                  const vector<double> &groundTemperature,
+                  const vector<double> &relativeHumidity,
+                  const vector<double> &tropoLapseRate,
+                  const vector<double> &wvScaleHeight);
+  /** The constructor for a lapse rate and a water vapor scale height fixed to those of atmProfile */
+  AtmProfileAtlas(const AtmProfile &atmProfile,
+                  const vector<double> &groundPressure,
+                  const vector<double> &groundTemperature,
+                  const vector<double> &relativeHumidity);
+
+  virtual ~AtmProfileAtlas();
+  //@}
+
+  //@{
+  /** Accessor to the number of layers of the profiles (0 for an empty atlas) */
+  size_t getNumLayer() const { return v_layerThickness_.size(); }
+  /** Accessor to the number of tabulated profiles */
+  size_t getNumNode() const;
+  /** Accessor to the nodes of an axis: 0 ground pressure, 1 ground temperature, 2 relative humidity,
+   *  3 tropospheric lapse rate, 4 water vapor scale height */
+  const vector<double> &getAxis(size_t axis) const { return v_axis_[axis]; }
+  /** Accessor to the layer thicknesses (m), the same for all the profiles */
+  const vector<double> &getLayerThickness() const { return v_layerThickness_; }
+  /** Accessor to the profile of the site used to build the atlas, with the pinned layer grid */
+  const AtmProfile &getAtmProfile() const { return atmProfile_; }
+  //@}
+
+  //@{
+  /** Interpolate the profile for a set of ground conditions; parameters outside an axis are clamped to it.
+   * @param layerTemperature buffer of getNumLayer() values receiving the layer temperatures (K)
+   * @param layerPressure    buffer of getNumLayer() values receiving the layer pressures (mb)
+   * @param layerWaterVapor  buffer of getNumLayer() values receiving the layer water vapor densities (kg/m**3)
+   * @return false if a parameter was outside its axis (or the atlas is empty)
+   */
+  bool getProfile(double groundPressure,
+                  double groundTemperature,
+                  double relativeHumidity,
+                  double tropoLapseRate,
+                  double wvScaleHeight,
+                  double *layerTemperature,
+                  double *layerPressure,
+                  double *layerWaterVapor) const;
+  /** Same as above, with the lapse rate and the scale height at their first node (for an atlas with fixed values) */
+  bool getProfile(double groundPressure,
+                  double groundTemperature,
+                  double relativeHumidity,
+                  double *layerTemperature,
+                  double *layerPressure,
+                  double *layerWaterVapor) const;
+
+  /** Compare, at the centre of every cell of the grid, the interpolated profile with the one built by the AtmProfile */
+  InterpolationError getInterpolationError() const;
+  //@}
+
+  //@{
+  /** Save the atlas in a text file
+   * @return false if the file could not be written
+   */
+  bool save(const string &fileName) const;
+  /** Load an atlas saved by save(), replacing the content of this one
+   * @return false (and the atlas is left unchanged) if the file could not be read
+   */
+  bool load(const string &fileName);
+  //@}
+
+protected:
+  static const size_t numAxis_ = 5;       //!< number of the interpolation axes
+
+  AtmProfile atmProfile_;                 //!< profile of the site, with the pinned layer grid
+  vector<double> v_axis_[numAxis_];       //!< nodes of the axes
+  vector<double> v_layerThickness_;       //!< thickness of the layers (m)
+  vector<double> v_table_;                //!< profiles [node][T, P, water vapor][layer], node index with the last axis fastest
+
+  /** Build the table; returns false if an axis is not valid */
+  bool mkAtlas();
+  /** Profile of the AtmProfile for a set of ground conditions, into the same buffers as getProfile() */
+  void mkProfile(AtmProfile &workProfile, const double *param,
+                 double *layerTemperature, double *layerPressure, double *layerWaterVapor) const;
+}; // class AtmProfileAtlas
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_PROFILEATLAS_H*/
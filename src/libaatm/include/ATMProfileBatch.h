@@ -0,0 +1,187 @@
+#ifndef _ATM_PROFILEBATCH_H
+#define _ATM_PROFILEBATCH_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMProfileBatch.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+#include "ATMHumidity.h"
+#include "ATMLength.h"
+#include "ATMPressure.h"
+#include "ATMProfile.h"
+#include "ATMTemperature.h"
+
+#include <vector>
+
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief The atmospheric profiles of a time series of ground weather records.
+ *
+ *   A weather station delivers the ground pressure, temperature and relative humidity every few
+ *   seconds; the profiles of a whole night are wanted at once. An AtmProfileBatch takes these records
+ *   as one array per parameter and builds all their profiles together: the hydrostatic integration of
+ *   AtmProfile is carried out level by level for all the records, the records being the inner loop
+ *   (the levels of the records are stored level by level, and a record leaves the loop when it has
+ *   reached the top of the profile), and the minor gases of all the layers are taken from the
+ *   reference atmosphere in a single call. The storage is kept from one call to the next, so that no
+ *   allocation takes place once the tables have reached their size. The profile of each record is
+ *   the one an AtmProfile constructed with the same basic parameters would have.
+ *
+ *   The profiles are stored as a structure of arrays: one flat table per layer quantity, the layers of
+ *   record r being the entries getLayerOffset(r) to getLayerOffset(r+1)-1 of every table. The number of
+ *   layers may differ from one record to another.
+ *
+ *   The parameters which are not given per record (altitude, tropospheric lapse rate, water vapor scale
+ *   height, pressure step, pressure step factor, top of the profile and type of atmosphere) are those of
+ *   the AtmProfile used to construct the batch. If that profile has a fixed layer grid (see
+ *   AtmProfile::setFixedLayerGrid()), the records are profiled one by one with a working AtmProfile.
+ */
+class AtmProfileBatch
+{
+public:
+
+  //@{
+  /** The constructor.
+   * @param atmProfile the reference atmospheric profile; it provides the parameters common to all the records
+   */
+  AtmProfileBatch(const AtmProfile &atmProfile);
+
+  virtual ~AtmProfileBatch();
+  //@}
+
+  //@{
+  /** Add a ground weather record
+   * @return the index of this record
+   */
+  size_t addRecord(const Pressure &groundPressure,
+                   const Temperature &groundTemperature,
+                   const Humidity &relativeHumidity);
+  /** Add a series of ground weather records given as arrays of the same size
+   * @param groundPressure    the ground pressures (mb)
+   * @param groundTemperature the ground temperatures (K)
+   * @param relativeHumidity  the ground relative humidities (%)
+   * @return the number of records added (0 if the arrays do not have the same size)
+   */
+  size_t addRecords(const vector<double> &groundPressure,
+                    const vector<double> &groundTemperature,
+                    const vector<double> &relativeHumidity);
+  /** Remove all the records and their profiles */
+  void clearRecords();
+  //@}
+
+  /** Build the atmospheric profiles of all the records.
+   * @post the tables hold getNumRecord() profiles
+   */
+  void compute();
+
+  //@{
+  /** Accessor to the number of records */
+  size_t getNumRecord() const { return v_groundPressure_.size(); }
+  /** Accessor to the number of records whose profile has been built */
+  size_t getNumComputed() const { return numComputed_; }
+  /** Accessor to the reference profile (it is not modified by compute()) */
+  const AtmProfile &getAtmProfile() const { return atmProfile_; }
+
+  /** Accessor to the number of layers of the profile of a record (0 if it has not been built) */
+  size_t getNumLayer(size_t record) const;
+  /** Accessor to the index, in the layer tables, of the first layer of a record; getLayerOffset(getNumComputed())
+   *  is the total number of layers */
+  size_t getLayerOffset(size_t record) const;
+  /** Accessor to the zenith water vapor column of a record (-999 mm if its profile has not been built) */
+  Length getGroundWH2O(size_t record) const;
+
+  /** Table of the first layer of every record, with a last entry equal to the total number of layers */
+  const vector<size_t> &getLayerOffsetTable() const { return v_layerOffset_; }
+  /** Table of the zenith water vapor columns (m) [record] */
+  const vector<double> &getGroundWH2OTable() const { return v_groundWH2O_; }
+  /** Table of the layer thicknesses (m) [layer] */
+  const vector<double> &getLayerThicknessTable() const { return v_layerThickness_; }
+  /** Table of the layer average temperatures (K) [layer] */
+  const vector<double> &getLayerTemperatureTable() const { return v_layerTemperature_; }
+  /** Table of the layer average pressures (mb) [layer] */
+  const vector<double> &getLayerPressureTable() const { return v_layerPressure_; }
+  /** Table of the layer average water vapor mass densities (kg/m**3) [layer] */
+  const vector<double> &getLayerWaterVaporTable() const { return v_layerWaterVapor_; }
+  /** Table of the layer O3 number densities (m**-3) [layer] */
+  const vector<double> &getLayerO3Table() const { return v_layerO3_; }
+  /** Table of the layer CO number densities (m**-3) [layer] */
+  const vector<double> &getLayerCOTable() const { return v_layerCO_; }
+  /** Table of the layer N2O number densities (m**-3) [layer] */
+  const vector<double> &getLayerN2OTable() const { return v_layerN2O_; }
+  /** Table of the layer NO2 number densities (m**-3) [layer] */
+  const vector<double> &getLayerNO2Table() const { return v_layerNO2_; }
+  /** Table of the layer SO2 number densities (m**-3) [layer] */
+  const vector<double> &getLayerSO2Table() const { return v_layerSO2_; }
+  //@}
+
+protected:
+  AtmProfile atmProfile_;                //!< the reference profile
+  AtmProfile workProfile_;               //!< the working profile, for the constants of the integration (and the fixed layer grids)
+
+  vector<double> v_groundPressure_;      //!< ground pressure of every record (mb)
+  vector<double> v_groundTemperature_;   //!< ground temperature of every record (K)
+  vector<double> v_relativeHumidity_;    //!< ground relative humidity of every record (%)
+
+  size_t numComputed_;                   //!< number of records whose profile is in the tables
+  vector<size_t> v_layerOffset_;         //!< first layer of every computed record, plus the total
+  vector<double> v_groundWH2O_;          //!< zenith water vapor column of every computed record (m)
+  vector<double> v_layerThickness_;      //!< thickness of the layers (m)
+  vector<double> v_layerTemperature_;    //!< average temperature of the layers (K)
+  vector<double> v_layerPressure_;       //!< average pressure of the layers (mb)
+  vector<double> v_layerWaterVapor_;     //!< average water vapor of the layers (kg/m**3)
+  vector<double> v_layerO3_;             //!< O3 in the layers (m**-3)
+  vector<double> v_layerCO_;             //!< CO in the layers (m**-3)
+  vector<double> v_layerN2O_;            //!< N2O in the layers (m**-3)
+  vector<double> v_layerNO2_;            //!< NO2 in the layers (m**-3)
+  vector<double> v_layerSO2_;            //!< SO2 in the layers (m**-3)
+
+  // working storage of the level integration, the levels being stored level by level: [level][record]
+  vector<double> v_levelPressure_;       //!< pressure of the levels (mb)
+  vector<double> v_levelTemperature_;    //!< temperature of the levels (K)
+  vector<double> v_levelHeight_;         //!< height of the levels above sea level (m)
+  vector<double> v_levelWaterVapor_;     //!< water vapor of the levels (gr/m**3)
+  vector<double> v_wgr0_;                //!< water vapor extrapolated to sea level of every record (gr/m**3)
+  vector<double> v_gravity_;             //!< gravity of the last tropospheric step of every record (m/s**2)
+  vector<double> v_prLimit_;             //!< pressure below which a record leaves the troposphere (mb)
+  vector<size_t> v_refLevel_;            //!< level of the reference atmosphere reached by every record
+  vector<char> v_tropospheric_;          //!< true while a record is in the troposphere
+  vector<size_t> v_numLayerRecord_;      //!< number of layers of every record
+  vector<size_t> v_active_;              //!< records still integrated
+  vector<double> v_layerAltitude_;       //!< altitude of the middle of the layers (km)
+
+private:
+  void mkLevels();        //!< integrates the levels of all the records together
+  void mkLayers();        //!< averages the levels of every record into its layers, appended to the tables
+  void mkRecordProfiles(); //!< profiles the records one by one with workProfile_ (fixed layer grids)
+}; // class AtmProfileBatch
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_PROFILEBATCH_H*/
@@ -0,0 +1,129 @@
+#ifndef _ATM_PROFILEREADER_H
+#define _ATM_PROFILEREADER_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMProfileReader.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+#include "ATMProfile.h"
+
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief Streaming reader of a columnar file of atmospheric profiles, such as radiosonde ascents or the
+ *   columns of a reanalysis.
+ *
+ *   The file is a text file with one line per level, from the ground up, and one column per quantity, in
+ *   SI units:
+ *   \verbatim
+     # comment
+     profile <label>
+     <altitude (m)> <pressure (Pa)> <temperature (K)> <water vapor (kg m**-3)> [<O3> <CO> <N2O> <NO2> <SO2> (m**-3)]
+     ...
+     \endverbatim
+ *   Each profile starts with a line "profile", followed by a free label (a date, a position,...); the header
+ *   may be omitted for a file of a single profile. The levels of a profile have either 4 columns, the minor
+ *   gases being then those of the reference atmosphere of the AtmProfile, or 9. Blank lines and lines
+ *   starting with '#' are skipped.
+ *
+ *   The profiles are read one at a time into buffers which are reused from one profile to the next, and
+ *   handed over as AtmProfile::UserLevels pointing into these buffers: a single AtmProfile may then ingest
+ *   them all with AtmProfile::setUserLevels(), without any copy besides that into its layers. Each profile is
+ *   checked as a whole (AtmProfile::checkUserLevels()) as it is read; a profile which is not valid is
+ *   reported, not fatal, and the reading goes on with the next one.
+ */
+class AtmProfileReader
+{
+public:
+
+  //@{
+  /** The constructor reading a file */
+  AtmProfileReader(const string &fileName);
+  /** The constructor reading a stream, which must outlive the reader */
+  AtmProfileReader(std::istream &stream);
+
+  virtual ~AtmProfileReader();
+  //@}
+
+  //@{
+  /** Accessor telling whether the file could be opened */
+  bool isOpen() const { return stream_ != 0 && !stream_->bad(); }
+  /** Read the next profile
+   * @return false at the end of the file (then there is no profile)
+   */
+  bool next();
+  //@}
+
+  //@{
+  /** Accessor telling whether the profile read last is valid; if not, getError() tells why */
+  bool isValid() const { return error_.empty(); }
+  /** Accessor to the problem found in the profile read last (empty if it is valid), with its line */
+  const string &getError() const { return error_; }
+  /** Accessor to the label of the profile read last */
+  const string &getLabel() const { return label_; }
+  /** Accessor to the number of levels of the profile read last */
+  size_t getNumLevel() const { return v_column_[0].size(); }
+  /** Accessor telling whether the profile read last has minor gas columns */
+  bool hasMinorGases() const { return numColumn_ == maxColumn_; }
+  /** Accessor to the number of profiles read so far, valid or not */
+  size_t getNumProfile() const { return numProfile_; }
+  /** Accessor to the levels of the profile read last, valid until the next call to next() */
+  AtmProfile::UserLevels getLevels() const;
+  //@}
+
+protected:
+  static const size_t minColumn_ = 4; //!< number of columns without the minor gases
+  static const size_t maxColumn_ = 9; //!< number of columns with the minor gases
+
+  std::ifstream file_;                //!< file read, if the reader was given a file name
+  std::istream *stream_;              //!< stream read
+  string line_;                       //!< line being parsed
+  size_t lineNumber_;                 //!< number of the last line read
+  bool pendingHeader_;                //!< whether the header of the next profile has already been read
+  string pendingLabel_;               //!< label of that header
+  string label_;                      //!< label of the profile read last
+  string error_;                      //!< problem found in the profile read last
+  size_t numColumn_;                  //!< number of columns of the profile read last
+  size_t numProfile_;                 //!< number of profiles read so far
+  vector<double> v_column_[maxColumn_]; //!< columns of the profile read last, one value per level
+
+  /** Parse the level in line_, appending its values to the columns; false (error_ set) if it is not valid */
+  bool parseLevel();
+}; // class AtmProfileReader
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_PROFILEREADER_H*/
@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <complex>
+#include <vector>
 
 
 
@@ -86,6 +87,12 @@ ATM_NAMESPACE_BEGIN
  *       -# \f$^{16}O^{16}O^{17}O   \f$
  *       -# \f$^{16}O^{18}O^{16}O  \f$
  *       -# \f$^{16}O^{17}O^{16}O \f$
+ *
+ *  The parameters of the lines which depend on the layer only (broadening, interference,
+ *  Boltzmann and stimulated emission factors) are kept, per species, from one call to the next
+ *  made for the same temperature, pressure and water vapor pressure. Sweeping many frequencies
+ *  across one layer before moving to the next one therefore computes them once per layer.
+ *  An object must not be shared between threads.
  */
 class RefractiveIndex
 {
@@ -100,6 +107,16 @@ public:
 
   //@}
 
+  /** Derivatives of a refractivity (or of a specific refractivity) with respect to the parameters of the layer,
+      with the units of the refractivity per K for the temperature and per hPa for the pressures */
+  struct Partials
+  {
+    Partials() : temperature(0.0, 0.0), pressure(0.0, 0.0), wvpressure(0.0, 0.0) {}
+    std::complex<double> temperature;   //!< derivative with respect to the temperature
+    std::complex<double> pressure;      //!< derivative with respect to the pressure
+    std::complex<double> wvpressure;    //!< derivative with respect to the water vapor partial pressure
+  };
+
   //@{
 
 
@@ -116,6 +133,11 @@ public:
   std::complex<double> getRefractivity_o2(double temperature,double pressure,double wvpressure,
 				     double frequency,double width,size_t n);
 
+  /** Same as getRefractivity_o2(temperature,pressure,wvpressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b>, <b>pressure</b> and <b>wvpressure</b>. */
+  std::complex<double> getRefractivity_o2(double temperature,double pressure,double wvpressure,double frequency,
+				     Partials &partials);
+
 
 
   /** It returns \f$(2\pi\nu/c)\cdot(N_{rg}+iN_{ig})\f$ with units \f$(rad\cdot m^{-1},m^{-1})\f$ for \f$g=H_2O\f$ (see \ref definitions) <br>
@@ -130,6 +152,11 @@ public:
   std::complex<double> getRefractivity_h2o(double temperature,double pressure,double wvpressure,
 				      double frequency,double width,size_t n);
 
+  /** Same as getRefractivity_h2o(temperature,pressure,wvpressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b>, <b>pressure</b> and <b>wvpressure</b>. */
+  std::complex<double> getRefractivity_h2o(double temperature,double pressure,double wvpressure,double frequency,
+				      Partials &partials);
+
 
 
 
@@ -146,6 +173,11 @@ public:
   std::complex<double> getSpecificRefractivity_o3(double temperature,double pressure,double frequency,
 					     double width,size_t n);
 
+  /** Same as getSpecificRefractivity_o3(temperature,pressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b> and <b>pressure</b>. */
+  std::complex<double> getSpecificRefractivity_o3(double temperature,double pressure,double frequency,
+					     Partials &partials);
+
 
   /** It returns \f$(2\pi\nu/c)\cdot(N_{rg}+iN_{ig})\f$ with units \f$(rad\cdot m^{-1},m^{-1})\f$ for \f$g=O_3\f$ (see \ref definitions) <br>
       The parameters are <b>temperature</b> in K, <b>pressure</b> in hPa, <b>frequency</b> in GHz,
@@ -311,6 +343,11 @@ public:
   std::complex<double> getSpecificRefractivity_co(double temperature,double pressure,double frequency,double width,size_t n)
     {size_t species=5; return mkSpecificRefractivity(species, temperature, pressure, frequency, width, n);}
 
+  /** Same as getSpecificRefractivity_co(temperature,pressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b> and <b>pressure</b>. */
+  std::complex<double> getSpecificRefractivity_co(double temperature,double pressure,double frequency,Partials &partials)
+    {size_t species=5; return mkSpecificRefractivity(species, temperature, pressure, 0.0, frequency, partials);}
+
 
 
     /** It returns \f$(2\pi\nu/c)\cdot(N_{rg}+iN_{ig})\f$ with units \f$(rad\cdot m^{-1},m^{-1})\f$ for \f$CO\f$ (see \ref definitions) <br>
@@ -344,6 +381,11 @@ public:
  std::complex<double> getSpecificRefractivity_n2o(double temperature,double pressure,double frequency,double width,size_t n)
     {size_t species=6; return mkSpecificRefractivity(species, temperature, pressure, frequency, width, n);}
 
+  /** Same as getSpecificRefractivity_n2o(temperature,pressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b> and <b>pressure</b>. */
+  std::complex<double> getSpecificRefractivity_n2o(double temperature,double pressure,double frequency,Partials &partials)
+    {size_t species=6; return mkSpecificRefractivity(species, temperature, pressure, 0.0, frequency, partials);}
+
 
     /** It returns \f$(2\pi\nu/c)\cdot(N_{rg}+iN_{ig})\f$ with units \f$(rad\cdot m^{-1},m^{-1})\f$ for \f$N_2O\f$ (see \ref definitions) <br>
       The parameters are <b>temperature</b> in K, <b>pressure</b> in hPa, <b>frequency</b> in GHz,
@@ -376,6 +418,11 @@ public:
  std::complex<double> getSpecificRefractivity_no2(double temperature,double pressure,double frequency,double width,size_t n)
     {size_t species=7; return mkSpecificRefractivity(species, temperature, pressure, frequency, width, n);}
 
+  /** Same as getSpecificRefractivity_no2(temperature,pressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b> and <b>pressure</b>. */
+  std::complex<double> getSpecificRefractivity_no2(double temperature,double pressure,double frequency,Partials &partials)
+    {size_t species=7; return mkSpecificRefractivity(species, temperature, pressure, 0.0, frequency, partials);}
+
 
 
      /** It returns \f$(2\pi\nu/c)\cdot(N_{rg}+iN_{ig})\f$ with units \f$(rad\cdot m^{-1},m^{-1})\f$ for \f$NO_2\f$ (see \ref definitions) <br>
@@ -408,6 +455,11 @@ public:
   std::complex<double> getSpecificRefractivity_so2(double temperature,double pressure,double frequency,double width,size_t n)
     {size_t species=8; return mkSpecificRefractivity(species, temperature, pressure, frequency, width, n);}
 
+  /** Same as getSpecificRefractivity_so2(temperature,pressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b> and <b>pressure</b>. */
+  std::complex<double> getSpecificRefractivity_so2(double temperature,double pressure,double frequency,Partials &partials)
+    {size_t species=8; return mkSpecificRefractivity(species, temperature, pressure, 0.0, frequency, partials);}
+
 
      /** It returns \f$(2\pi\nu/c)\cdot(N_{rg}+iN_{ig})\f$ with units \f$(rad\cdot m^{-1},m^{-1})\f$ for \f$SO_2\f$ (see \ref definitions) <br>
       The parameters are <b>temperature</b> in K, <b>pressure</b> in hPa, <b>frequency</b> in GHz,
@@ -441,6 +493,11 @@ public:
   std::complex<double> getSpecificRefractivity_cnth2o(double temperature,double pressure,double wvpressure,double frequency,double width,size_t n)
     {size_t species=9; return mkSpecificRefractivity(species, temperature, pressure, wvpressure, frequency, width, n);}
 
+  /** Same as getSpecificRefractivity_cnth2o(temperature,pressure,wvpressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b>, <b>pressure</b> and <b>wvpressure</b>. */
+  std::complex<double> getSpecificRefractivity_cnth2o(double temperature,double pressure,double wvpressure,double frequency,Partials &partials)
+    {size_t species=9; return mkSpecificRefractivity(species, temperature, pressure, wvpressure, frequency, partials);}
+
   /*************************************************************************************************************/
 
 
@@ -461,6 +518,11 @@ public:
   std::complex<double> getSpecificRefractivity_cntdry(double temperature,double pressure,double wvpressure,double frequency,double width,size_t n)
     {size_t species=10; return mkSpecificRefractivity(species, temperature, pressure, wvpressure, frequency, width, n);}
 
+  /** Same as getSpecificRefractivity_cntdry(temperature,pressure,wvpressure,frequency), also returning in <b>partials</b>
+      the derivatives of the result with respect to <b>temperature</b>, <b>pressure</b> and <b>wvpressure</b>. */
+  std::complex<double> getSpecificRefractivity_cntdry(double temperature,double pressure,double wvpressure,double frequency,Partials &partials)
+    {size_t species=10; return mkSpecificRefractivity(species, temperature, pressure, wvpressure, frequency, partials);}
+
   /*************************************************************************************************************/
 
 
@@ -847,6 +909,46 @@ public:
 
 private:
 
+  /** Layer-dependent parameters of the lines of one species */
+  struct LineCache
+  {
+    LineCache() : tt(-1.0), pp(-1.0), eh2o(-1.0), partials(false) {}
+    double tt;                          //!< temperature (K) of the layer the parameters are for
+    double pp;                          //!< pressure (mb) of the layer
+    double eh2o;                        //!< water vapor partial pressure (mb) of the layer
+    std::vector<double> dv;             //!< line broadening (GHz)
+    std::vector<double> itf;            //!< line interference (GHz)
+    std::vector<double> boltz;          //!< Boltzmann factor of the lower level
+    std::vector<double> stim;           //!< stimulated emission factor
+    std::vector<char> ready;            //!< the parameters of the line have been computed
+    bool partials;                      //!< the derivatives of dv and itf are computed with them
+    std::vector<double> ddv;            //!< derivatives of dv with respect to (tt,pp,eh2o), 3 per line
+    std::vector<double> ditf;           //!< derivatives of itf with respect to (tt,pp,eh2o), 3 per line
+    double *dvPartials(size_t i) { return partials ? &ddv[3*i] : 0; }
+    double *itfPartials(size_t i) { return partials ? &ditf[3*i] : 0; }
+  };
+
+  LineCache lineCache_[24];             //!< line parameters, indexed by the species code
+  Partials *partials_;                  //!< derivatives of the kernel being evaluated, 0 when they are not requested
+
+  /** Cache of the line parameters of a species for the layer (tt,pp,eh2o), emptied when the
+   *  layer differs from that of the previous call, or when derivatives are requested and the
+   *  cache has been filled without them */
+  LineCache &lineCache(size_t species, double tt, double pp, double eh2o, size_t numLines);
+
+  /** Adds to <b>sum</b> the derivatives of the contribution <b>term</b> = strength * lineshape(v,vl,dv,itf) of a line,
+   *  given the derivatives of dv and itf (itf may be 0) and the derivative of ln(strength) with respect to the temperature */
+  void addLinePartials(Partials &sum, double v, double vl, double dv, double itf,
+                       const double *ddv, const double *ditf,
+                       double strength, double dlnStrength, const std::complex<double> &term);
+  /** Same for the line i of a cache */
+  void addLinePartials(Partials &sum, const LineCache &c, size_t i, double v, double vl,
+                       double strength, double dlnStrength, const std::complex<double> &term)
+  { addLinePartials(sum, v, vl, c.dv[i], c.itf[i], &c.ddv[3*i], &c.ditf[3*i], strength, dlnStrength, term); }
+  /** Scales the derivatives of a sum of lines by the factor applied to the sum, <b>value</b> being the scaled sum
+   *  and <b>dlnScale</b> the derivative of ln(scale) with respect to the temperature */
+  void scalePartials(Partials &sum, double scale, const std::complex<double> &value, double dlnScale);
+
   std::complex<double> mkSpecificRefractivity(size_t species,    // species --> 1 to 23
 					 double temperature,
 					 double pressure,
@@ -865,6 +967,13 @@ private:
 
   std::complex<double> mkSpecificRefractivity(size_t species, double temperature, double pressure, double frequency, double width, size_t n){return mkSpecificRefractivity(species, temperature, pressure, double(0.0), frequency, width, n);}
 
+  std::complex<double> mkSpecificRefractivity(size_t species,    // species --> 1 to 23
+					 double temperature,
+					 double pressure,
+					 double wvpressure,
+					 double frequency,
+                                         Partials &partials);
+
   std::complex<double> mkSpecificRefractivity_16o16o(double temperature,          /// 1
                                                 double pressure,
                                                 double wvpressure,
@@ -947,12 +1056,15 @@ private:
                                                    double frequency);
 
   size_t vpIndex(double nu);
+  // The broadening and interference helpers also store, when partials is not 0, the derivatives of
+  // their result with respect to (temperature, pressure, wvpressure) in partials[0], [1] and [2].
   double linebroadening(double frequency,
                         double temperature,
                         double pressure,
                         double mmol,
                         double dv0_lines,
-                        double texp_lines);
+                        double texp_lines,
+                        double *partials=0);
   double linebroadening_water(double frequency,
                               double temperature,
                               double pressure,
@@ -960,24 +1072,28 @@ private:
                               double ensanche1,
                               double ensanche2,
                               double ensanche3,
-                              double ensanche4);
+                              double ensanche4,
+                              double *partials=0);
   double linebroadening_hh18o_hh17o(double temperature,
                                     double pressure,
                                     double ph2o,
                                     double dv0,
                                     double dvlm,
-                                    double temp_exp);
+                                    double temp_exp,
+                                    double *partials=0);
   double linebroadening_o2(double frequency,
                            double temperature,
                            double pressure,
                            double ph2o,
                            double mmol,
                            double ensanche1,
-                           double ensanche2);
+                           double ensanche2,
+                           double *partials=0);
   double interf_o2(double temperature,
                    double pressure,
                    double ensanche3,
-                   double ensanche4);
+                   double ensanche4,
+                   double *partials=0);
   std::complex<double> lineshape(double frequency,
                             double linefreq,
                             double linebroad,
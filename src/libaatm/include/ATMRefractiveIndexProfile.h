@@ -37,10 +37,95 @@
 #include "ATMSpectralGrid.h"
 #include "ATMRefractiveIndex.h"
 
+#include <atomic>
 #include <complex>
+#include <memory>
+#include <mutex>
+#include <utility>
 
 ATM_NAMESPACE_BEGIN
 
+/** \brief Bookkeeping of the spectral windows and distinct frequencies of a RefractiveIndexProfile
+ *  for which the absorption profiles have already been computed.
+ *
+ *  The readiness flags are atomic so that they can be tested without locking by concurrent readers;
+ *  the computation itself is serialized by the mutex. Copying a guard yields an empty one: the
+ *  owner of the copy is responsible for restoring its state.
+ */
+class LazyProfileGuard
+{
+public:
+  LazyProfileGuard(): numSpw_(0), numFreq_(0) {}
+  LazyProfileGuard(const LazyProfileGuard &): numSpw_(0), numFreq_(0) {}
+  LazyProfileGuard &operator=(const LazyProfileGuard &) { return *this; }
+  LazyProfileGuard(LazyProfileGuard &&a):
+    numSpw_(a.numSpw_), numFreq_(a.numFreq_), spwReady_(std::move(a.spwReady_)), freqReady_(std::move(a.freqReady_))
+  {
+    a.numSpw_ = 0;
+    a.numFreq_ = 0;
+  }
+  /** Take over the flags of a; the mutex is not transferred. This method is not thread-safe. */
+  LazyProfileGuard &operator=(LazyProfileGuard &&a)
+  {
+    if(this != &a) {
+      numSpw_ = a.numSpw_;
+      numFreq_ = a.numFreq_;
+      spwReady_ = std::move(a.spwReady_);
+      freqReady_ = std::move(a.freqReady_);
+      a.numSpw_ = 0;
+      a.numFreq_ = 0;
+    }
+    return *this;
+  }
+
+  /** Resize the tables, keeping the flags of the existing entries; the new entries are not ready.
+   *  This method is not thread-safe. */
+  void resize(size_t numSpw, size_t numFreq)
+  {
+    if(numSpw == numSpw_ && numFreq == numFreq_) return;
+    spwReady_ = resizeFlags(spwReady_, numSpw_, numSpw);
+    freqReady_ = resizeFlags(freqReady_, numFreq_, numFreq);
+    numSpw_ = numSpw;
+    numFreq_ = numFreq;
+  }
+  /** Forget all the entries. This method is not thread-safe. */
+  void clear() { resize(0, 0); }
+  /** Mark all the entries as not ready, keeping the tables. This method is not thread-safe. */
+  void reset()
+  {
+    for(size_t n = 0; n < numSpw_; n++) spwReady_[n].store(false);
+    for(size_t n = 0; n < numFreq_; n++) freqReady_[n].store(false);
+  }
+
+  size_t numSpw() const { return numSpw_; }
+  size_t numFreq() const { return numFreq_; }
+
+  bool spwIsReady(size_t spwid) const { return spwReady_[spwid].load(std::memory_order_acquire); }
+  void setSpwReady(size_t spwid) { spwReady_[spwid].store(true, std::memory_order_release); }
+  bool freqIsReady(size_t nf) const { return freqReady_[nf].load(std::memory_order_acquire); }
+  void setFreqReady(size_t nf) { freqReady_[nf].store(true, std::memory_order_release); }
+
+  std::mutex &mutex() { return mutex_; }
+
+private:
+  static std::unique_ptr<std::atomic<bool>[]> resizeFlags(const std::unique_ptr<std::atomic<bool>[]> &flags,
+                                                          size_t oldSize,
+                                                          size_t newSize)
+  {
+    std::unique_ptr<std::atomic<bool>[]> newFlags(new std::atomic<bool>[newSize]);
+    for(size_t n = 0; n < newSize; n++) {
+      newFlags[n].store(n < oldSize ? flags[n].load() : false);
+    }
+    return newFlags;
+  }
+
+  size_t numSpw_;                                  //!< number of spectral windows
+  size_t numFreq_;                                 //!< number of distinct frequencies
+  std::unique_ptr<std::atomic<bool>[]> spwReady_;  //!< true when all the channels of the spectral window are computed
+  std::unique_ptr<std::atomic<bool>[]> freqReady_; //!< true when the profiles of the distinct frequency are computed
+  std::mutex mutex_;                               //!< serializes the computation of the profiles
+};
+
 /**  \brief Profile of the absorption and Phase coefficient(s) at given frequency(ies) for an
  *   atmospheric profile (P/T/gas densities).
  *
@@ -68,14 +153,24 @@ public:
 
   /** A full constructor for the case of a profile of absorption coefficients
    *  for a set of frequency points.
+   *  @param lazy if true the profiles of a spectral window are computed only when first needed
+   *         (see setLazyMode())
    */
   RefractiveIndexProfile(const SpectralGrid &spectralGrid,
-                         const AtmProfile &atmProfile);
+                         const AtmProfile &atmProfile,
+                         bool lazy = false);
 
   /** A copy constructor for deep copy
    */
   RefractiveIndexProfile(const RefractiveIndexProfile &);
 
+  /** A move constructor: the layer profiles are taken over, not copied */
+  RefractiveIndexProfile(RefractiveIndexProfile &&);
+
+  RefractiveIndexProfile &operator=(const RefractiveIndexProfile &);
+
+  RefractiveIndexProfile &operator=(RefractiveIndexProfile &&);
+
   RefractiveIndexProfile();
 
   virtual ~RefractiveIndexProfile();
@@ -174,6 +269,14 @@ public:
     return v_chanFreq_.size();
   }
 
+  /** Accessor to the number of distinct frequencies in the SpectralGrid object, i.e. the number of
+   *  absorption profiles actually computed and stored (channels of overlapping spectral windows
+   *  or of image sidebands which fall at the same frequency share a single profile) */
+  inline size_t getNumUniqueFrequencies() const
+  {
+    return v_uniqueFreq_.size();
+  }
+
   /** Accessor to the single frequency (or the frequency of the first grid point
    *  in case of a spectrum) in Hz (SI default unit)*/
   inline double getFrequency() const
@@ -194,12 +297,12 @@ public:
   /** Accessor to get H2O lines Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsH2OLines(size_t nl) const
   {
-    return InverseLength(imag((vv_N_H2OLinesPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_H2OLinesPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Accessor to get H2O lines Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsH2OLines(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_H2OLinesPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_H2OLinesPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Accessor to get H2O Continuum Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsH2OLines(size_t spwid,
@@ -207,18 +310,18 @@ public:
                                size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_H2OLinesPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_H2OLinesPtr_[readyFreqId(j)]->at(nl))));
   }
 
   /** Accessor to get H2O Continuum Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsH2OCont(size_t nl) const
   {
-    return InverseLength(imag((vv_N_H2OContPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_H2OContPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Accessor to get H2O Continuum Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsH2OCont(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_H2OContPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_H2OContPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Accessor to get H2O Continuum Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsH2OCont(size_t spwid,
@@ -226,18 +329,18 @@ public:
                               size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_H2OContPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_H2OContPtr_[readyFreqId(j)]->at(nl))));
   }
 
   /** Function to retrieve O2 lines Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsO2Lines(size_t nl) const
   {
-    return InverseLength(imag((vv_N_O2LinesPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_O2LinesPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Function to retrieve O2 lines Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsO2Lines(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_O2LinesPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_O2LinesPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Function to retrieve O2 lines Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsO2Lines(size_t spwid,
@@ -245,18 +348,18 @@ public:
                               size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_O2LinesPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_O2LinesPtr_[readyFreqId(j)]->at(nl))));
   }
 
   /** Function to retrieve Dry continuum Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsDryCont(size_t nl) const
   {
-    return InverseLength(imag((vv_N_DryContPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_DryContPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Function to retrieve Dry continuum Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsDryCont(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_DryContPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_DryContPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Function to retrieve Dry continuum Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsDryCont(size_t spwid,
@@ -264,18 +367,18 @@ public:
                               size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_DryContPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_DryContPtr_[readyFreqId(j)]->at(nl))));
   }
 
   /** Function to retrieve O3 lines Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsO3Lines(size_t nl) const
   {
-    return InverseLength(imag((vv_N_O3LinesPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_O3LinesPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Function to retrieve O3 lines Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsO3Lines(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_O3LinesPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_O3LinesPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Function to retrieve O3 lines Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsO3Lines(size_t spwid,
@@ -283,18 +386,18 @@ public:
                               size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_O3LinesPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_O3LinesPtr_[readyFreqId(j)]->at(nl))));
   }
 
   /** Function to retrieve CO lines Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsCOLines(size_t nl) const
   {
-    return InverseLength(imag((vv_N_COLinesPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_COLinesPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Function to retrieve CO lines Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsCOLines(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_COLinesPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_COLinesPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Function to retrieve CO lines Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsCOLines(size_t spwid,
@@ -302,7 +405,7 @@ public:
                               size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_COLinesPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_COLinesPtr_[readyFreqId(j)]->at(nl))));
   }
 
 
@@ -310,12 +413,12 @@ public:
   /** Function to retrieve N2O lines Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsN2OLines(size_t nl) const
   {
-    return InverseLength(imag((vv_N_N2OLinesPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_N2OLinesPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Function to retrieve N2O lines Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsN2OLines(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_N2OLinesPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_N2OLinesPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Function to retrieve N2O lines Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsN2OLines(size_t spwid,
@@ -323,18 +426,18 @@ public:
                                size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_N2OLinesPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_N2OLinesPtr_[readyFreqId(j)]->at(nl))));
   }
 
   /** Function to retrieve NO2 lines Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsNO2Lines(size_t nl) const
   {
-    return InverseLength(imag((vv_N_NO2LinesPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_NO2LinesPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Function to retrieve NO2 lines Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsNO2Lines(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_NO2LinesPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_NO2LinesPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Function to retrieve NO2 lines Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsNO2Lines(size_t spwid,
@@ -342,19 +445,19 @@ public:
                                size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_NO2LinesPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_NO2LinesPtr_[readyFreqId(j)]->at(nl))));
   }
 
 
   /** Function to retrieve SO2 lines Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
   InverseLength getAbsSO2Lines(size_t nl) const
   {
-    return InverseLength(imag((vv_N_SO2LinesPtr_[0]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_SO2LinesPtr_[readyFreqId(0)]->at(nl))));
   }
   /** Function to retrieve SO2 lines Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsSO2Lines(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_SO2LinesPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_SO2LinesPtr_[readyFreqId(nf)]->at(nl))));
   }
   /** Function to retrieve SO2 lines Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsSO2Lines(size_t spwid,
@@ -362,7 +465,7 @@ public:
                                size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_SO2LinesPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(imag((vv_N_SO2LinesPtr_[readyFreqId(j)]->at(nl))));
   }
 
 
@@ -377,11 +480,7 @@ public:
   /** Function to retrieve total Dry Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsTotalDry(size_t nf, size_t nl) const
   {
-    return InverseLength(imag(
-			      vv_N_O2LinesPtr_[nf]->at(nl)
-			      + vv_N_DryContPtr_[nf]->at(nl) + vv_N_O3LinesPtr_[nf]->at(nl)
-			      + vv_N_COLinesPtr_[nf]->at(nl) + vv_N_N2OLinesPtr_[nf]->at(nl)
-			      + vv_N_NO2LinesPtr_[nf]->at(nl) + vv_N_SO2LinesPtr_[nf]->at(nl)), "m-1");
+    return InverseLength::from<InverseLength::per_m>(vv_absTotalDryPtr_[readyFreqId(nf)]->at(nl));
   }
   /** Function to retrieve total Dry Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsTotalDry(size_t spwid,
@@ -389,11 +488,7 @@ public:
                                size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag(
-			      vv_N_O2LinesPtr_[j]->at(nl)
-			      + vv_N_DryContPtr_[j]->at(nl) + vv_N_O3LinesPtr_[j]->at(nl)
-			      + vv_N_COLinesPtr_[j]->at(nl) + vv_N_N2OLinesPtr_[j]->at(nl)
-			      + vv_N_NO2LinesPtr_[j]->at(nl) + vv_N_SO2LinesPtr_[j]->at(nl)), "m-1");
+    return InverseLength::from<InverseLength::per_m>(vv_absTotalDryPtr_[readyFreqId(j)]->at(nl));
   }
 
   /** Function to retrieve total Wet Absorption Coefficient at layer nl, for single frequency RefractiveIndexProfile object */
@@ -404,8 +499,7 @@ public:
   /** Function to retrieve total Wet Absorption Coefficient at layer nl and frequency channel nf, for RefractiveIndexProfile object with a spectral grid */
   InverseLength getAbsTotalWet(size_t nf, size_t nl) const
   {
-    return InverseLength(imag((vv_N_H2OLinesPtr_[nf]->at(nl)
-        + vv_N_H2OContPtr_[nf]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(vv_absTotalWetPtr_[readyFreqId(nf)]->at(nl));
   }
   /** Function to retrieve total Wet Absorption Coefficient at layer nl, spectral window spwid and channel nf */
   InverseLength getAbsTotalWet(size_t spwid,
@@ -413,8 +507,52 @@ public:
                                size_t nl) const
   {
     size_t j = v_transfertId_[spwid] + nf;
-    return InverseLength(imag((vv_N_H2OLinesPtr_[j]->at(nl)
-        + vv_N_H2OContPtr_[j]->at(nl))), "m-1");
+    return InverseLength::from<InverseLength::per_m>(vv_absTotalWetPtr_[readyFreqId(j)]->at(nl));
+  }
+
+  /** Raw access to the layer profile (getNumLayer() values, bottom layer first) of the total dry
+   *  absorption coefficient (m^-1) at channel nc of the spectral grid. The pointer stays valid until
+   *  the profile is rebuilt (new basic parameters or new spectral window). */
+  const double *getAbsTotalDryData(size_t nc) const
+  {
+    return vv_absTotalDryPtr_[readyFreqId(nc)]->data();
+  }
+  /** Raw access to the layer profile of the total dry absorption coefficient (m^-1) at channel nc of spectral window spwid */
+  const double *getAbsTotalDryData(size_t spwid, size_t nc) const
+  {
+    return getAbsTotalDryData(v_transfertId_[spwid] + nc);
+  }
+  /** Raw access to the layer profile of the total wet absorption coefficient (m^-1) at channel nc of the
+   *  spectral grid, for the water vapor profile of the object */
+  const double *getAbsTotalWetData(size_t nc) const
+  {
+    return vv_absTotalWetPtr_[readyFreqId(nc)]->data();
+  }
+  /** Raw access to the layer profile of the total wet absorption coefficient (m^-1) at channel nc of spectral window spwid */
+  const double *getAbsTotalWetData(size_t spwid, size_t nc) const
+  {
+    return getAbsTotalWetData(v_transfertId_[spwid] + nc);
+  }
+  /** Raw access to the layer profile of the total dry delay term (rad m^-1) at channel nc of the spectral grid */
+  const double *getDelayTotalDryData(size_t nc) const
+  {
+    return vv_delayTotalDryPtr_[readyFreqId(nc)]->data();
+  }
+  /** Raw access to the layer profile of the total dry delay term (rad m^-1) at channel nc of spectral window spwid */
+  const double *getDelayTotalDryData(size_t spwid, size_t nc) const
+  {
+    return getDelayTotalDryData(v_transfertId_[spwid] + nc);
+  }
+  /** Raw access to the layer profile of the total wet delay term (rad m^-1) at channel nc of the spectral grid,
+   *  for the water vapor profile of the object */
+  const double *getDelayTotalWetData(size_t nc) const
+  {
+    return vv_delayTotalWetPtr_[readyFreqId(nc)]->data();
+  }
+  /** Raw access to the layer profile of the total wet delay term (rad m^-1) at channel nc of spectral window spwid */
+  const double *getDelayTotalWetData(size_t spwid, size_t nc) const
+  {
+    return getDelayTotalWetData(v_transfertId_[spwid] + nc);
   }
 
   Opacity getAverageO2LinesOpacity(size_t spwid);
@@ -862,25 +1000,164 @@ public:
 
   //@}
 
+  //@{
+  /** Setter for the lazy mode. In lazy mode the absorption profiles of a spectral window are computed
+   *  by the first accessor which needs them instead of being computed for all the spectral windows
+   *  each time the spectral grid or the basic atmospheric parameters change. The accessors may then be
+   *  called concurrently: every spectral window is computed once, by a single thread.
+   *  @param lazy true to enable the lazy mode, false to return to the eager mode (in which case the
+   *         spectral windows not yet computed are computed right away)
+   */
+  void setLazyMode(bool lazy);
+  /** Accessor to the lazy mode */
+  bool isLazyMode() const { return lazyMode_; }
+  /** Compute the absorption profiles of a set of spectral windows now, so that their later access
+   *  does not pay for it. Useful in lazy mode for latency-sensitive callers; no effect for the
+   *  spectral windows already computed.
+   *  @param spwIds the spectral window identifiers (invalid identifiers are ignored)
+   */
+  void prefetch(const vector<size_t> &spwIds) const;
+  //@}
+
+  //@{
+  /** Setter to start the altitude sliding mode (see AtmProfile::startAltitudeSliding()). The absorption
+   *  profiles of all the spectral windows are computed for the reference profile, whatever the lazy
+   *  mode, and kept with it. */
+  void startAltitudeSliding();
+  /** Setter to the altitude of the observer in the altitude sliding mode (see
+   *  AtmProfile::setObserverAltitude()). No absorption coefficient is computed: the absorption profiles
+   *  are cut with the layers, those of the cut layer being interpolated like its gas densities.
+   * @return false (and the profile is left unchanged) if the mode is not on or the altitude is out of range
+   */
+  bool setObserverAltitude(const Length &altitude);
+  /** Setter to end the altitude sliding mode, going back to the reference profile and its absorption profiles */
+  void stopAltitudeSliding();
+  /** Accessor telling whether the altitude sliding mode is on */
+  bool isAltitudeSliding() const { return AtmProfile::isAltitudeSliding() && referenceAbsorption_.get() != 0; }
+  //@}
+
+  //@{
+  /** Zenith opacities and path lengths of every channel of a spectral window (for the water vapor
+   *  column of the profile), or their derivatives with respect to one basic parameter */
+  struct ZenithSpectrum
+  {
+    vector<double> dryOpacity;                 //!< dry opacity (np)
+    vector<double> wetOpacity;                 //!< wet opacity (np)
+    vector<double> nonDispersiveDryPathLength; //!< non-dispersive dry path length (m)
+    vector<double> dispersiveDryPathLength;    //!< dispersive dry path length (m)
+    vector<double> nonDispersiveH2OPathLength; //!< non-dispersive wet path length (m)
+    vector<double> dispersiveH2OPathLength;    //!< dispersive wet path length (m)
+  };
+  /** Derivatives of the zenith spectrum with respect to each of the ground basic parameters */
+  struct GroundSensitivity
+  {
+    ZenithSpectrum groundPressure;    //!< per mb
+    ZenithSpectrum groundTemperature; //!< per K, at constant tropospheric lapse rate
+    ZenithSpectrum relativeHumidity;  //!< per %
+    ZenithSpectrum tropoLapseRate;    //!< per K/km
+  };
+  /** Accessor to the zenith opacities and path lengths of all the channels of a spectral window
+   *  @return false if spwid is not a valid spectral window identifier
+   */
+  bool getZenithSpectrum(size_t spwid, ZenithSpectrum &zenithSpectrum) const;
+  /** Accessor to the derivatives of the zenith opacities and path lengths of all the channels of
+   *  a spectral window with respect to the ground pressure, ground temperature, relative humidity
+   *  and tropospheric lapse rate. The derivatives are analytic: those of the layers, carried through
+   *  the hydrostatic integration when the profile is built, are chained with those of the
+   *  refractivities in a single pass over the layers (the number of layers and the level where the
+   *  troposphere ends are held fixed). This object is left untouched.
+   *  @return false if spwid is not a valid spectral window identifier, or if the layers have been
+   *  changed otherwise than from the basic parameters (setters of the layers, user levels, altitude
+   *  sliding)
+   */
+  bool getGroundSensitivity(size_t spwid, GroundSensitivity &groundSensitivity) const;
+  //@}
+
 protected:
 
-  vector<vector<std::complex<double> >*> vv_N_H2OLinesPtr_; //!< H2O lines absorption coefficient and delay term (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_H2OContPtr_; //!< H2O continuum absorption coefficient and delay term  (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_O2LinesPtr_; //!< O2 lines absorption coefficient and delay term (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_DryContPtr_; //!< Dry continuum absorption coefficient and delay term  (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_O3LinesPtr_; //!< O3 lines absorption coefficient and delay term  (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_COLinesPtr_; //!< CO lines absorption coefficient and delay term  (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_N2OLinesPtr_; //!< N2O lines absorption coefficient and delay term  (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_NO2LinesPtr_; //!< NO2 lines absorption coefficient and delay term  (rad m^-1,m^-1)
-  vector<vector<std::complex<double> >*> vv_N_SO2LinesPtr_; //!< SO2 lines absorption coefficient and delay term  (rad m^-1,m^-1)
+  /** Refractivity of the absorbing species in one layer at one frequency (rad m^-1,m^-1) */
+  struct LayerRefractivity
+  {
+    std::complex<double> h2oLines;
+    std::complex<double> h2oCont;
+    std::complex<double> o2Lines;
+    std::complex<double> dryCont;
+    std::complex<double> o3Lines;
+    std::complex<double> coLines;
+    std::complex<double> n2oLines;
+    std::complex<double> no2Lines;
+    std::complex<double> so2Lines;
+  };
+
+  // the profiles of a distinct frequency are allocated by mkAbsorptionProfile(); until then the
+  // pointers are null
+  mutable vector<vector<std::complex<double> >*> vv_N_H2OLinesPtr_; //!< H2O lines absorption coefficient and delay term (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_H2OContPtr_; //!< H2O continuum absorption coefficient and delay term  (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_O2LinesPtr_; //!< O2 lines absorption coefficient and delay term (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_DryContPtr_; //!< Dry continuum absorption coefficient and delay term  (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_O3LinesPtr_; //!< O3 lines absorption coefficient and delay term  (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_COLinesPtr_; //!< CO lines absorption coefficient and delay term  (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_N2OLinesPtr_; //!< N2O lines absorption coefficient and delay term  (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_NO2LinesPtr_; //!< NO2 lines absorption coefficient and delay term  (rad m^-1,m^-1)
+  mutable vector<vector<std::complex<double> >*> vv_N_SO2LinesPtr_; //!< SO2 lines absorption coefficient and delay term  (rad m^-1,m^-1)
+
+  // sums of the above, imaginary (absorption) and real (delay) parts, for the radiative transfer
+  mutable vector<vector<double>*> vv_absTotalDryPtr_;   //!< total dry absorption coefficient (m^-1)
+  mutable vector<vector<double>*> vv_absTotalWetPtr_;   //!< total wet absorption coefficient (m^-1)
+  mutable vector<vector<double>*> vv_delayTotalDryPtr_; //!< total dry delay term (rad m^-1)
+  mutable vector<vector<double>*> vv_delayTotalWetPtr_; //!< total wet delay term (rad m^-1)
 
   /* vecteur de vecteurs ???? */
 
+  vector<double> v_uniqueFreq_;    //!< Distinct frequencies (Hz) for which the absorption profiles above are stored
+  vector<size_t> v_uniqueFreqId_;  //!< For every channel of the spectral grid, the index of its frequency in v_uniqueFreq_
+
+  static const double uniqueFreqTolerance_; //!< Two channels closer than this (Hz) share the same absorption profile
+  static const size_t chanBlockSize_; //!< Number of frequencies evaluated together, layer by layer
+
+  bool lazyMode_;                     //!< true if the spectral windows are computed on first access
+  mutable LazyProfileGuard lazyGuard_; //!< spectral windows and distinct frequencies already computed
+
+  /** Absorption profiles of the reference profile of the altitude sliding mode, for every distinct frequency */
+  struct ReferenceAbsorption
+  {
+    vector<vector<std::complex<double> > > refractivity[9]; //!< the species, in the order of getAbsorptionTables()
+    vector<vector<double> > total[4];                        //!< the sums, in the order of getAbsorptionTables()
+  };
+  std::shared_ptr<const ReferenceAbsorption> referenceAbsorption_; //!< null out of the altitude sliding mode
+
+  /** The tables of the absorption profiles: refractivity receives those of the nine species (H2O lines
+   *  and continuum, O2 lines, dry continuum, O3, CO, N2O, NO2 and SO2 lines), total those of the total
+   *  dry and wet absorption coefficients and delay terms */
+  void getAbsorptionTables(vector<vector<std::complex<double> >*> *refractivity[9],
+                           vector<vector<double>*> *total[4]) const;
+
   /**
    * Method to build the profile of the absorption coefficients,
    */
   void mkRefractiveIndexProfile(); //!<  builds the absorption profiles, returns error code: <0 unsuccessful
   void rmRefractiveIndexProfile(); //!<  deletes all the layer profiles for all the frequencies
+  void mkUniqueFreqTable(); //!<  indexes the channels not yet in the table of distinct frequencies
+  /** Compute the layer profiles of the distinct frequencies nfs, in blocks of chanBlockSize_
+   *  frequencies swept layer by layer */
+  void mkAbsorptionProfile(const vector<size_t> &nfs) const;
+  /** Compute the refractivity of every species in layer j at the frequency nu (GHz) */
+  void mkLayerRefractivity(RefractiveIndex &atm, double nu, size_t j, LayerRefractivity &n) const;
+  /** Same, also returning in partials the derivatives of the refractivities with respect to the four
+   *  basic parameters of AtmProfile::layerPartials_ (the layers must have their derivatives) */
+  void mkLayerRefractivity(RefractiveIndex &atm, double nu, size_t j, LayerRefractivity &n,
+                           LayerRefractivity partials[4]) const;
+  void mkSpectralWindow(size_t spwid) const; //!<  computes, once, the layer profiles of a spectral window
+  void mkChanSpectralWindow(size_t nc) const; //!<  computes, once, the spectral window of channel nc
+
+  /** Index in the table of distinct frequencies of the channel nc of the spectral grid, making sure
+   *  that its absorption profiles have been computed */
+  size_t readyFreqId(size_t nc) const
+  {
+    size_t nf = v_uniqueFreqId_[nc];
+    if(!lazyGuard_.freqIsReady(nf)) mkChanSpectralWindow(nc);
+    return nf;
+  }
 
   bool updateRefractiveIndexProfile(const Length &altitude,
                                     const Pressure &groundPressure,
@@ -35,6 +35,7 @@
 #include "ATMWVRMeasurement.h"
 
 //#include <math.h>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -72,6 +73,8 @@ public:
    *  values. See documentation ef particular methods for more information.
    */
   SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile);
+  /** The basic constructor, taking over the layer profiles of refractiveIndexProfile instead of copying them */
+  SkyStatus(RefractiveIndexProfile &&refractiveIndexProfile);
   /** Class constructor with additional inputs */
   SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile,
             double airMass);
@@ -139,6 +142,13 @@ public:
   /** A copy constructor for deep copy   */
   SkyStatus(const SkyStatus &);
 
+  /** A move constructor: the layer profiles are taken over, not copied */
+  SkyStatus(SkyStatus &&) = default;
+
+  SkyStatus &operator=(const SkyStatus &) = default;
+
+  SkyStatus &operator=(SkyStatus &&) = default;
+
   virtual ~SkyStatus();
 
   //@}
@@ -187,10 +197,10 @@ public:
    performing water vapor retrieval */
   void setSkyBackgroundTemperature(const Temperature &skyBackgroundTemperature)
   {
-    if(skyBackgroundTemperature.get("K") == skyBackgroundTemperature_.get("K")) {
+    if(skyBackgroundTemperature.get<Temperature::K>() == skyBackgroundTemperature_.get<Temperature::K>()) {
     } else {
       skyBackgroundTemperature_
-          = Temperature(skyBackgroundTemperature.get("K"), "K");
+          = Temperature::from<Temperature::K>(skyBackgroundTemperature.get<Temperature::K>());
     }
   }
 
@@ -332,7 +342,7 @@ public:
                       getUserWH2O(),
                       getAirMass(),
                       1.0,
-                      Temperature(100, "K"));
+                      Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Equivalent Blackbody Temperature in spectral window 0 and channel 0, for the currnet
    (user) Water Vapor Column, Air Mass airmass, and perfect Sky Coupling to the sky */
@@ -352,8 +362,7 @@ public:
    (user) Water Vapor Column, Air Mass airmass, and perfect Sky Coupling to the sky */
   Temperature getTebbSky(size_t spwid, size_t nc, double airmass)
   {
-    return getTebbSky(spwid, nc, getUserWH2O(), airmass, 1.0, Temperature(100,
-                                                                          "K"));
+    return getTebbSky(spwid, nc, getUserWH2O(), airmass, 1.0, Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Equivalent Blackbody Temperature in spectral window 0 and channel 0, for Water
    Vapor Column wh2o, the current Air Mass, and perfect Sky Coupling to the sky */
@@ -373,7 +382,7 @@ public:
    Vapor Column wh2o, the current Air Mass, and perfect Sky Coupling to the sky */
   Temperature getTebbSky(size_t spwid, size_t nc, const Length &wh2o)
   {
-    return getTebbSky(spwid, nc, wh2o, getAirMass(), 1.0, Temperature(100, "K"));
+    return getTebbSky(spwid, nc, wh2o, getAirMass(), 1.0, Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Equivalent Blackbody Temperature in spectral window 0 and channel nc, for the current
    (user) Water Vapor Column and Air Mass, Sky Coupling skycoupling, and Spill Over Temperature Tspill */
@@ -412,7 +421,7 @@ public:
                          const Length &wh2o,
                          double airmass)
   {
-    return getTebbSky(spwid, nc, wh2o, airmass, 1.0, Temperature(100, "K"));
+    return getTebbSky(spwid, nc, wh2o, airmass, 1.0, Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Equivalent Blackbody Temperature in spectral window 0 and channel nc, for Water
    Vapor Column wh2o, the current Air Mass, Sky Coupling skycoupling, and Spill Over Temperature Tspill */
@@ -473,6 +482,22 @@ public:
                          double airmass,
                          double skycoupling,
                          const Temperature &Tspill);
+  /** Accesor to the Equivalent Blackbody Temperature in spectral window spwid and channel nc, as getTebbSky(),
+   *  together with its exact derivatives, obtained in the same pass over the layers
+   * @param dTebb_dWH2O output, derivative with respect to the water vapor column (K/mm)
+   * @param dTebb_dSkyCoupling output, derivative with respect to the sky coupling (K)
+   * @param dTebb_dTspill output, derivative with respect to the spill over temperature (K/K)
+   * @return the Equivalent Blackbody Temperature (-999 K, and the derivatives unset, if an argument is out of range)
+   */
+  Temperature getTebbSkyDerivatives(size_t spwid,
+                                    size_t nc,
+                                    const Length &wh2o,
+                                    double airmass,
+                                    double skycoupling,
+                                    const Temperature &Tspill,
+                                    double &dTebb_dWH2O,
+                                    double &dTebb_dSkyCoupling,
+                                    double &dTebb_dTspill);
 
 
    /** Accesor to the average Rayleigh-Jeans Temperature in spectral window 0, for the current conditions
@@ -613,7 +638,7 @@ public:
                       getUserWH2O(),
                       getAirMass(),
                       1.0,
-                      Temperature(100, "K"));
+                      Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Rayleigh-Jeans Temperature in spectral window 0 and channel 0, for the currnet
    (user) Water Vapor Column, Air Mass airmass, and perfect Sky Coupling to the sky */
@@ -633,8 +658,7 @@ public:
    (user) Water Vapor Column, Air Mass airmass, and perfect Sky Coupling to the sky */
   Temperature getTrjSky(size_t spwid, size_t nc, double airmass)
   {
-    return getTrjSky(spwid, nc, getUserWH2O(), airmass, 1.0, Temperature(100,
-                                                                          "K"));
+    return getTrjSky(spwid, nc, getUserWH2O(), airmass, 1.0, Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Rayleigh-Jeans Temperature in spectral window 0 and channel 0, for Water
    Vapor Column wh2o, the current Air Mass, and perfect Sky Coupling to the sky */
@@ -654,7 +678,7 @@ public:
    Vapor Column wh2o, the current Air Mass, and perfect Sky Coupling to the sky */
   Temperature getTrjSky(size_t spwid, size_t nc, const Length &wh2o)
   {
-    return getTrjSky(spwid, nc, wh2o, getAirMass(), 1.0, Temperature(100, "K"));
+    return getTrjSky(spwid, nc, wh2o, getAirMass(), 1.0, Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Rayleigh-Jeans Temperature in spectral window 0 and channel nc, for the current
    (user) Water Vapor Column and Air Mass, Sky Coupling skycoupling, and Spill Over Temperature Tspill */
@@ -693,7 +717,7 @@ public:
                          const Length &wh2o,
                          double airmass)
   {
-    return getTrjSky(spwid, nc, wh2o, airmass, 1.0, Temperature(100, "K"));
+    return getTrjSky(spwid, nc, wh2o, airmass, 1.0, Temperature::from<Temperature::K>(100));
   }
   /** Accesor to the Rayleigh-Jeans Temperature in spectral window 0 and channel nc, for Water
    Vapor Column wh2o, the current Air Mass, Sky Coupling skycoupling, and Spill Over Temperature Tspill */
@@ -877,7 +901,7 @@ public:
   }
   Opacity getTotalOpacityUpTo(size_t spwid, size_t nc, Length refalti)
   {
-    Opacity wrongOp(-999.0,"np");
+    Opacity wrongOp = Opacity::from<Opacity::np>(-999.0);
     if(!spwidAndIndexAreValid(spwid, nc)) return wrongOp;
     return getTotalOpacityUpTo(v_transfertId_[spwid] + nc, refalti);
   }
@@ -1081,8 +1105,8 @@ public:
   }
   double getAverageH2OPathLengthDerivative(size_t spwid)
   {
-    return getAverageH2OPathLength(spwid).get("microns")
-        / getUserWH2O().get("microns");
+    return getAverageH2OPathLength(spwid).get<Length::micron>()
+        / getUserWH2O().get<Length::micron>();
   } // in microns/micron_H2O
   double getAverageH2OPathLengthDerivative()
   {
@@ -1306,8 +1330,8 @@ public:
   Length WaterVaporRetrieval_fromFTS(const vector<double> &v_transmission)
   {
     size_t spwId = 0;
-    Frequency f1(-999, "GHz");
-    Frequency f2(-999, "GHz");
+    Frequency f1 = Frequency::from<Frequency::GHz>(-999);
+    Frequency f2 = Frequency::from<Frequency::GHz>(-999);
     return WaterVaporRetrieval_fromFTS(spwId, v_transmission, f1, f2);
   }
   /** Same as above but using for the retrieval only the measurements between frequencies f1 and f2>f1 */
@@ -1326,8 +1350,8 @@ public:
   Length WaterVaporRetrieval_fromFTS(size_t spwId,
                                      const vector<double> &v_transmission)
   {
-    Frequency f1(-999, "GHz");
-    Frequency f2(-999, "GHz");
+    Frequency f1 = Frequency::from<Frequency::GHz>(-999);
+    Frequency f2 = Frequency::from<Frequency::GHz>(-999);
     return WaterVaporRetrieval_fromFTS(spwId, v_transmission, f1, f2);
   }
   /** Same as above but using for the retrieval only the measurements between frequencies f1 and f2>f1 */
@@ -1654,6 +1678,18 @@ public:
   }
   /** Performs water vapor retrieval for one WVR measurement */
   void WaterVaporRetrieval_fromWVR(WVRMeasurement &RadiometerData);
+  /** Performs water vapor retrieval for WVR measurement sets between n and m on numThread threads (all
+   *  the hardware threads for 0). The measurement sets are retrieved by blocks of wvrRetrievalBlock_, shared
+   *  out to the threads as they become free; the first retrieval of a block starts from the water vapor column
+   *  at the call, the next ones from the previous retrieval of the block as WaterVaporRetrieval_fromWVR() does,
+   *  so that the results do not depend on the number of threads. The threads only read the RT-ready data of
+   *  the WVR channels, built beforehand, and have their own fit storage; the results are written in place.
+   *  As after the serial retrievals, the water vapor column is left at the last one retrieved.
+   */
+  void WaterVaporRetrieval_fromWVR(vector<WVRMeasurement> &RadiometerData,
+                                   size_t n,
+                                   size_t m,
+                                   unsigned int numThread);
   /** Accessor to get or check the water vapor radiometer channels */
   WaterVaporRadiometer getWaterVaporRadiometer() const
   {
@@ -1751,13 +1787,189 @@ public:
 
   //@}
 
+  //@{
+  /** Equivalent Blackbody Temperatures of all the channels of spectral window spwid, computed together: the
+   *  radiative transfer is run layer by layer over the channels of the window, and gives the same values as
+   *  getTebbSky() channel by channel.
+   * @param spwid spectral window
+   * @param wh2o water vapor column
+   * @param airmass air mass
+   * @param skycoupling sky couplings of the channels (getNumChan(spwid) values), or 0 for a perfect coupling
+   * @param tspill spill over temperatures of the channels (K, getNumChan(spwid) values), or 0 for the ground
+   *        temperature
+   * @param tebbSky output, getNumChan(spwid) values (K)
+   * @return false (and nothing is written) if an argument is out of range
+   */
+  bool getTebbSkySpectrum(size_t spwid,
+                          const Length &wh2o,
+                          double airmass,
+                          const double *skycoupling,
+                          const double *tspill,
+                          double *tebbSky);
+  /** Equivalent Blackbody Temperatures of all the channels of spectral window spwid, for the current
+   *  conditions and a perfect sky coupling */
+  bool getTebbSkySpectrum(size_t spwid, double *tebbSky)
+  {
+    return getTebbSkySpectrum(spwid, getUserWH2O(), getAirMass(), 0, 0, tebbSky);
+  }
+  /** Equivalent Blackbody Temperatures of all the channels of several spectral windows, one window after
+   *  the other in the order of spwids; skycoupling, tspill (when not 0) and tebbSky hold as many values as
+   *  the channels of these windows. */
+  bool getTebbSkySpectrum(const vector<size_t> &spwids,
+                          const Length &wh2o,
+                          double airmass,
+                          const double *skycoupling,
+                          const double *tspill,
+                          double *tebbSky);
+  /** Rayleigh-Jeans Temperatures of all the channels of spectral window spwid, computed together (same
+   *  arguments as getTebbSkySpectrum()); the same values as getTrjSky() channel by channel */
+  bool getTrjSkySpectrum(size_t spwid,
+                         const Length &wh2o,
+                         double airmass,
+                         const double *skycoupling,
+                         const double *tspill,
+                         double *trjSky);
+  /** Rayleigh-Jeans Temperatures of all the channels of spectral window spwid, for the current conditions
+   *  and a perfect sky coupling */
+  bool getTrjSkySpectrum(size_t spwid, double *trjSky)
+  {
+    return getTrjSkySpectrum(spwid, getUserWH2O(), getAirMass(), 0, 0, trjSky);
+  }
+  /** Rayleigh-Jeans Temperatures of all the channels of several spectral windows, one window after the
+   *  other in the order of spwids */
+  bool getTrjSkySpectrum(const vector<size_t> &spwids,
+                         const Length &wh2o,
+                         double airmass,
+                         const double *skycoupling,
+                         const double *tspill,
+                         double *trjSky);
+  /** Equivalent Blackbody Temperatures of all the channels of spectral window spwid for a batch of water vapor
+   *  columns and air masses, as used by skydip fits: the layer Planck terms and absorption coefficients are
+   *  shared by the whole batch and the layer opacities by all the air masses of a water vapor column. The
+   *  values are those of getTebbSky() for each water vapor column, air mass and channel.
+   * @param spwid spectral window
+   * @param wh2o water vapor columns
+   * @param airmass air masses
+   * @param skycoupling sky couplings of the channels (getNumChan(spwid) values), or 0 for a perfect coupling
+   * @param tspill spill over temperatures of the channels (K, getNumChan(spwid) values), or 0 for the ground
+   *        temperature
+   * @param tebbSky output cube, wh2o.size()*airmass.size()*getNumChan(spwid) values (K), the channel running
+   *        fastest then the air mass: tebbSky[(i*airmass.size()+j)*getNumChan(spwid)+nc]
+   * @return false (and nothing is written) if an argument is out of range
+   */
+  bool getTebbSkyCube(size_t spwid,
+                      const vector<Length> &wh2o,
+                      const vector<double> &airmass,
+                      const double *skycoupling,
+                      const double *tspill,
+                      double *tebbSky);
+  /** Average Equivalent Blackbody Temperatures of spectral window spwid for a batch of water vapor columns and
+   *  air masses, with a sky coupling and a spill over temperature common to all the channels: the values of
+   *  getAverageTebbSky(), into averageTebbSky (wh2o.size()*airmass.size() values, K, the air mass running
+   *  fastest) */
+  bool getAverageTebbSkyCube(size_t spwid,
+                             const vector<Length> &wh2o,
+                             const vector<double> &airmass,
+                             double skycoupling,
+                             const Temperature &Tspill,
+                             double *averageTebbSky);
+  //@}
+
+  //@{
+  /** Reduced products of a block of consecutive channels of the spectral grid, handed out by
+   *  streamSpectrum(). The arrays hold numChan values and are only valid during the call. */
+  struct SpectrumChunk
+  {
+    size_t firstChan;         //!< index in the spectral grid of the first channel of the block
+    size_t numChan;           //!< number of channels in the block
+    const double *frequency;  //!< channel frequencies (Hz)
+    const double *opacity;    //!< total (dry + wet) zenith opacities (np)
+    const double *tebbSky;    //!< sky brightness temperatures along the air mass, perfect sky coupling (K)
+    const double *pathLength; //!< total (dry + wet, dispersive + non-dispersive) zenith path lengths (m)
+  };
+
+  /** Streaming evaluation of the whole spectral grid, intended for grids with a very large number of
+   *  channels (e.g. FTS spectra). The channels are processed in blocks of chunkSize channels, layer
+   *  by layer, and only the reduced products of each block are kept, for the time of the call to
+   *  sink. The layer profiles of the absorption coefficients are never stored: combined with the
+   *  lazy mode of RefractiveIndexProfile (and no other accessor called), the memory used does not
+   *  grow with the number of channels beyond the spectral grid itself.
+   *
+   *  The user water vapor column, the air mass and the sky background temperature of the object
+   *  are used.
+   *  @param sink function called once per block, in the order of the channels
+   *  @param chunkSize number of channels per block
+   *  @return false (and sink is never called) if the air mass is lower than 1
+   */
+  bool streamSpectrum(const std::function<void(const SpectrumChunk &)> &sink,
+                      size_t chunkSize = 4096) const;
+  /** Streaming evaluation of the whole spectral grid into arrays provided by the caller, each of
+   *  getNumIndividualFrequencies() values. A null pointer skips the corresponding product.
+   *  @param opacity total zenith opacities (np), or 0
+   *  @param tebbSky sky brightness temperatures (K), or 0
+   *  @param pathLength total zenith path lengths (m), or 0
+   *  @param chunkSize number of channels processed at once
+   *  @return false (and nothing is written) if the air mass is lower than 1
+   */
+  bool streamSpectrum(double *opacity,
+                      double *tebbSky,
+                      double *pathLength,
+                      size_t chunkSize = 4096) const;
+  //@}
+
+  //@{
+  /** Result of mergeThinLayers(): layer counts, and largest differences over the channels of the spectral
+   *  grid between the merged and the original layers (user water vapor column, air mass of the object) */
+  struct LayerMerging
+  {
+    size_t numLayerBefore;     //!< number of layers before the merging
+    size_t numLayerAfter;      //!< number of layers after the merging (numLayerBefore if no merging was accepted)
+    double errorThreshold;     //!< largest estimated error of a group of merged layers (K); 0 if no merging was accepted
+    double tebbError;          //!< largest error on the sky brightness temperature (K)
+    double pathLengthError;    //!< largest error on the total zenith path length (m)
+    double opacityError;       //!< largest error on the total zenith opacity (np)
+  };
+
+  /** Merge adjacent layers which are optically thin at all the frequencies of the spectral grid. Groups of
+   *  consecutive layers are formed, from the ground up, as long as their opacity times the spread of their
+   *  temperatures and pressures (an estimate of the error on the brightness temperatures) stays below a
+   *  threshold at every frequency; the threshold is lowered, from 4 times down to 1/50 of tebbTolerance,
+   *  until the sky brightness temperatures and the path lengths obtained with the merged layers are within
+   *  the tolerances. The layers are merged by AtmProfile::mergeLayers(): the merged layers are used by all
+   *  the accessors of the object, and kept when the basic parameters are later updated. If no threshold
+   *  meets the tolerances the layers are left as they were.
+   *  @param tebbTolerance largest error accepted on the sky brightness temperature of a channel
+   *  @param pathLengthTolerance largest error accepted on the zenith path length of a channel
+   */
+  LayerMerging mergeThinLayers(const Temperature &tebbTolerance, const Length &pathLengthTolerance);
+  /** Go back from merged (or pinned) layers to the adaptive layering of AtmProfile */
+  void releaseMergedLayers();
+  //@}
+
+  //@{
+  /** Setter to the altitude of the observer in the altitude sliding mode (see
+   *  RefractiveIndexProfile::setObserverAltitude()). The user water vapor column is scaled with the
+   *  water vapor column of the profile, so that it stays the column above the observer.
+   * @return false (and nothing is changed) if the mode is not on or the altitude is out of range
+   */
+  bool setObserverAltitude(const Length &altitude);
+  /** Setter to end the altitude sliding mode, going back to the reference profile (the user water vapor
+   *  column being scaled back as well) */
+  void stopAltitudeSliding();
+  //@}
+
 protected:
+  friend class WVRStreamRetriever; //!< copies the RT-ready data of the WVR channels with mkRTCache() and uses RT()
 
   double airMass_; //!< Air Mass used for the radiative transfer
   Temperature skyBackgroundTemperature_; //!< Blackbody temperature of the sky background
   Length wh2o_user_; //!< Water vapor column used for radiative transfer calculations. If not provided,
   //!< the one retrieved from the water vapor radiometer channels will be used.
   WaterVaporRadiometer waterVaporRadiometer_; // !< Identifiers, sky coupling, and sideband gain of channels corresponding to the water vapor radiometer.
+  vector<vector<double> > vv_rtCache_; //!< RT-ready data of the channels, in the layout of getRTCache(); empty until first used
+  size_t rtCacheVersion_ = 0;           //!< version of the profile for which vv_rtCache_ was built
+  vector<vector<double> > vv_rtSpwCache_; //!< RT-ready data of the spectral windows, in the layout of getRTSpwCache(); empty until first used
+  static const size_t wvrRetrievalBlock_ = 64; //!< number of WVR measurement sets per block of the threaded retrievals
 
 
   void iniSkyStatus(); //!< Basic Method initialize the class when using the constructors.
@@ -1827,6 +2039,66 @@ protected:
                                     const Temperature &spilloverTemperature,
                                     const Angle &elevation);
 
+  /** RT-ready data of a channel for RT() and RTRJ(), built at the first call and kept until the layers of
+   *  the profile change (new basic parameters, observer altitude, layer setters): the frequency (GHz),
+   *  the sky background temperature and spill over temperature with their Planck terms
+   *  1/(exp(h nu/k T)-1), then, for each layer, the total wet and dry absorption coefficients (m^-1), the
+   *  thickness (m) and the Planck term of the layer temperature, packed together. The absorption
+   *  coefficients are kept apart from the thickness so that the layer opacities are summed as before.
+   *  The Planck terms of the background and spill over are refreshed when these temperatures change.
+   */
+  const double *getRTCache(size_t spwid, size_t nc, double tspill);
+  /** Build the RT-ready data of channel nc of spectral window spwid, as kept by getRTCache(), into cache; the
+   *  sky background and spill over terms are left to setRTCacheTemperatures() */
+  void mkRTCache(size_t spwid, size_t nc, vector<double> &cache) const;
+  /** Refresh the sky background and spill over terms of RT-ready data if these temperatures (K) have changed */
+  static void setRTCacheTemperatures(double tbgr, double tspill, double *cache);
+  static const size_t rtCacheHeader_ = 5; //!< number of values of getRTCache() before those of the layers
+  static const size_t rtCacheStride_ = 4; //!< number of values of getRTCache() per layer
+  /** RT-ready data of all the channels of spectral window spwid, for RTSpectrum(), kept as the data of
+   *  getRTCache() but layer by layer across the channels: the frequencies (GHz) of the numChan channels,
+   *  then, for each layer, the numChan total wet absorption coefficients, the numChan total dry ones and
+   *  the numChan Planck terms of the layer temperature. The layer thicknesses are those of the profile. */
+  const double *getRTSpwCache(size_t spwid);
+  /** Clear the RT caches if the layers of the profile have changed since they were built */
+  void checkRTCacheVersion();
+  /** Radiative transfer of all the channels of spectral window spwid at once, the layer recursion of RT()
+   *  running over the channels of the window in the inner loop, with the same operations as RT() for each
+   *  channel. skycoupling and tspill hold one value per channel (tspill in K); the Equivalent Blackbody
+   *  Temperatures, or with rayleighJeans the Rayleigh-Jeans Temperatures, are written into out. */
+  void RTSpectrum(double pfit_wh2o,
+                  const double *skycoupling,
+                  const double *tspill,
+                  double airmass,
+                  size_t spwid,
+                  bool rayleighJeans,
+                  double *out);
+  /** RTSpectrum() for numWH2O water vapor scale factors pfit_wh2o and numAirmass air masses, the layer opacities
+   *  of a water vapor scale factor being computed once for all the air masses; out is filled as the output of
+   *  getTebbSkyCube() */
+  void RTCube(const double *pfit_wh2o,
+              size_t numWH2O,
+              const double *airmass,
+              size_t numAirmass,
+              const double *skycoupling,
+              const double *tspill,
+              size_t spwid,
+              double *out);
+  /** getTebbSkySpectrum() and getTrjSkySpectrum() (with rayleighJeans) for the windows spwids */
+  bool mkSkySpectrum(const vector<size_t> &spwids,
+                     const Length &wh2o,
+                     double airmass,
+                     const double *skycoupling,
+                     const double *tspill,
+                     bool rayleighJeans,
+                     double *out);
+  /** Checks of the arguments of getTebbSkySpectrum() and getTrjSkySpectrum() for spectral window spwid */
+  bool spectrumArgumentsAreValid(size_t spwid,
+                                 const Length &wh2o,
+                                 double airmass,
+                                 const double *skycoupling,
+                                 const double *tspill);
+
   double RT(double pfit_wh2o,
             double skycoupling,
             double tspill,
@@ -1853,19 +2125,7 @@ protected:
             double skycoupling,
             double tspill,
             double airmass,
-            size_t spwid)
-  {
-    double tebb_channel = 0.0;
-    for(size_t n = 0; n < v_numChan_[spwid]; n++) {
-      tebb_channel = tebb_channel + RT(pfit_wh2o,
-                                       skycoupling,
-                                       tspill,
-                                       airmass,
-                                       spwid,
-                                       n) / (v_numChan_[spwid]);
-    }
-    return tebb_channel;
-  }
+            size_t spwid);
 
   double RT(double pfit_wh2o,
             double skycoupling,
@@ -1918,7 +2178,7 @@ protected:
               airMass_,
               spwid,
               spwId_filter,
-              Percent(100.0, "%"));
+              Percent::from<Percent::percent>(100.0));
   }
 
   double RT(double pfit_wh2o,
@@ -1945,6 +2205,64 @@ protected:
             const vector<double> &spwId_filter,
             const Percent &signalgain);
 
+  /** RT() of channel nc of spectral window spwid together with its exact derivatives, in jacobian[0..2], with
+   *  respect to the water vapor scale factor pfit_wh2o, the sky coupling and the spill over temperature (K) */
+  double RT(double pfit_wh2o,
+            double skycoupling,
+            double tspill,
+            double airmass,
+            size_t spwid,
+            size_t nc,
+            double *jacobian);
+  /** RT() with its derivatives, as above, from the RT-ready data cache of a channel (numLayer layers), as
+   *  returned by getRTCache() for the spill over temperature tspill. The cache is only read: once it is
+   *  built, this can be called from several threads. */
+  static double RT(const double *cache,
+                   size_t numLayer,
+                   double pfit_wh2o,
+                   double skycoupling,
+                   double tspill,
+                   double airmass,
+                   double *jacobian);
+  /** RT() averaged over the channels of spectral window spwid selected by spwId_filter, with the image side
+   *  band for a signal gain below 1, together with its exact derivatives in jacobian[0..2] */
+  double RT(double pfit_wh2o,
+            double skycoupling,
+            double tspill,
+            double airmass,
+            size_t spwid,
+            const vector<double> &spwId_filter,
+            const Percent &signalgain,
+            double *jacobian);
+  double RT(double pfit_wh2o,
+            double skycoupling,
+            double tspill,
+            double airmass,
+            size_t spwid,
+            const Percent &signalgain,
+            double *jacobian)
+  {
+    vector<double> spwId_filter(v_numChan_[spwid], 1.0);
+    return RT(pfit_wh2o,
+              skycoupling,
+              tspill,
+              airmass,
+              spwid,
+              spwId_filter,
+              signalgain,
+              jacobian);
+  }
+
+  /** Compute, layer by layer, the reduced products of the channels firstChan to
+   *  firstChan+numChan-1 of the grid into opacity, tebbSky and pathLength (numChan values each);
+   *  they are computed once for every distinct frequency of the chunk, in blocks of chanBlockSize_ */
+  void mkSpectrumChunk(size_t firstChan,
+                       size_t numChan,
+                       double ratioWater,
+                       double *opacity,
+                       double *tebbSky,
+                       double *pathLength) const;
+
 
   double RTRJ(double pfit_wh2o,
             double skycoupling,
@@ -1972,19 +2290,7 @@ protected:
             double skycoupling,
             double tspill,
             double airmass,
-            size_t spwid)
-  {
-    double trj_channel = 0.0;
-    for(size_t n = 0; n < v_numChan_[spwid]; n++) {
-      trj_channel = trj_channel + RTRJ(pfit_wh2o,
-                                       skycoupling,
-                                       tspill,
-                                       airmass,
-                                       spwid,
-                                       n) / (v_numChan_[spwid]);
-    }
-    return trj_channel;
-  }
+            size_t spwid);
 
   double RTRJ(double pfit_wh2o,
             double skycoupling,
@@ -2037,7 +2343,7 @@ protected:
               airMass_,
               spwid,
               spwId_filter,
-              Percent(100.0, "%"));
+              Percent::from<Percent::percent>(100.0));
   }
 
   double RTRJ(double pfit_wh2o,
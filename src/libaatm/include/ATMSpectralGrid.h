@@ -158,6 +158,12 @@ public:
 
   SpectralGrid(const SpectralGrid &);
 
+  SpectralGrid(SpectralGrid &&) = default;
+
+  SpectralGrid &operator=(const SpectralGrid &) = default;
+
+  SpectralGrid &operator=(SpectralGrid &&) = default;
+
   ~SpectralGrid();
 
   /** Add a new spectral window, uniformly sampled, this spectral window having no sideband.
@@ -213,9 +219,9 @@ public:
     size_t spwid;
     std::vector<double> v;
     for(size_t i = 0; i < chanFreq.size(); i++) {
-      v.push_back(chanFreq[i].get("GHz"));
+      v.push_back(chanFreq[i].get<Frequency::GHz>());
     }
-    spwid = add(chanFreq.size(), chanFreq[0].get("GHz"), v, "GHz");
+    spwid = add(chanFreq.size(), chanFreq[0].get<Frequency::GHz>(), v, "GHz");
     return spwid;
   }
   /** Add two new spectral windows, one spectral window per sideband.
@@ -31,6 +31,7 @@
 
 #include "ATMCommon.h"
 #include <string>
+#include <type_traits>
 
 using std::string;
 
@@ -46,6 +47,16 @@ ATM_NAMESPACE_BEGIN
 class Temperature
 {
 public:
+  //@{
+  /** Units known at compile time, for get<Unit>() and from<Unit>(): the conversion is resolved by the
+   *  compiler instead of comparing unit strings. Each unit names its quantity, so that the unit of
+   *  another quantity does not compile */
+  struct K  { typedef Temperature quantity; static constexpr double toIS(double v) { return v; } static constexpr double fromIS(double v) { return v; } }; //!< kelvin
+  struct mK { typedef Temperature quantity; static constexpr double toIS(double v) { return 1.0E-3 * v; } static constexpr double fromIS(double v) { return 1.0E3 * v; } }; //!< millikelvin
+  struct C  { typedef Temperature quantity; static constexpr double toIS(double v) { return v + 273.16; } static constexpr double fromIS(double v) { return v - 273.16; } }; //!< degree Celsius
+  struct F  { typedef Temperature quantity; static constexpr double toIS(double v) { return (v - 32.0) * (5. / 9.) + 273.16; } static constexpr double fromIS(double v) { return (v - 273.16) * (9. / 5.) + 32.0; } }; //!< degree Fahrenheit
+  //@}
+
   /** Default constructor */
   Temperature();
   /** A full constructor: Temperature value assumed by default to be in K (International System) */
@@ -62,6 +73,18 @@ public:
   double get() const { return valueIS_; }
   /** Accessor to the temperature value in specified units. Valid units are K [k], mK [mk], and C [c] */
   double get(const string &units) const;
+  /** Accessor to the value in a unit known at compile time, e.g. get<Temperature::K>() */
+  template<class Unit> double get() const
+  {
+    static_assert(std::is_same<typename Unit::quantity, Temperature>::value, "unit tag of another quantity");
+    return Unit::fromIS(valueIS_);
+  }
+  /** Temperature from a value in a unit known at compile time, e.g. Temperature::from<Temperature::K>(x) */
+  template<class Unit> static Temperature from(double value)
+  {
+    static_assert(std::is_same<typename Unit::quantity, Temperature>::value, "unit tag of another quantity");
+    return Temperature(Unit::toIS(value));
+  }
   //@}
 
   Temperature& operator=(const Temperature &rhs){ if(&rhs != this) valueIS_ = rhs.valueIS_; return *this; }
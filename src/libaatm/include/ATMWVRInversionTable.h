@@ -0,0 +1,213 @@
+#ifndef _ATM_WVRINVERSIONTABLE_H
+#define _ATM_WVRINVERSIONTABLE_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMWVRInversionTable.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+#include "ATMAngle.h"
+#include "ATMHumidity.h"
+#include "ATMLength.h"
+#include "ATMPressure.h"
+#include "ATMSkyStatus.h"
+#include "ATMTemperature.h"
+#include "ATMWaterVaporRadiometer.h"
+#include "ATMWVRMeasurement.h"
+#include "ATMWVRStreamRetriever.h"
+
+#include <vector>
+
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief Table of the sky brightness temperatures of the channels of a water vapor radiometer, inverted
+ *  without running the radiative transfer.
+ *
+ *   The sky brightness temperatures of the WVR channels, as fitted by SkyStatus::mkWaterVaporRetrieval_fromWVR(),
+ *   and their derivatives with respect to the water vapor column are tabulated on a grid of water vapor columns
+ *   (0 to the largest column, by a constant step) and air masses (1 to that of the lowest elevation, by a
+ *   constant step). For a measurement set, the table is interpolated to its air mass (Lagrange polynomial on
+ *   four air masses), then the water vapor column minimizing the squared residuals of the channels is searched:
+ *   first among the columns of the grid, then by Gauss-Newton steps on the cubic Hermite spline of the columns,
+ *   which has the tabulated derivatives. This takes a few microseconds, and no storage.
+ *
+ *   The table is built for the profile of a SkyStatus. update() builds it again when the SkyStatus has moved
+ *   away from it: a change of the ground pressure, temperature or relative humidity beyond thresholds, any
+ *   change of the other basic parameters or of the layers, and, for a table of the WaterVaporRadiometer of the
+ *   SkyStatus, any change of its channels, sky couplings, signal gains or spill over temperature.
+ *   retrieve(skyStatus, measurement) calls update() before each retrieval, so that the table follows the
+ *   SkyStatus by itself; the other retrievals use the table as it is, and update() must then be called
+ *   whenever the SkyStatus may have changed (e.g. before each batch of measurement sets).
+ *
+ *   At each build, the accuracy of the table is checked against the fit of SkyStatus::mkWaterVaporRetrieval_fromWVR()
+ *   (started from the water vapor column of the SkyStatus) at points between those of the grid: the sky
+ *   brightness temperatures computed for these points are retrieved both ways.
+ */
+class WVRInversionTable
+{
+public:
+
+  //@{
+  /** The constructor, for the WaterVaporRadiometer of the SkyStatus
+   * @param skyStatus    the SkyStatus, with the profile of the table
+   * @param maxWH2O      the largest water vapor column of the table
+   * @param wh2oStep     the step of the water vapor columns of the table
+   * @param minElevation the lowest elevation of the table
+   * @param airMassStep  the step of the air masses of the table
+   */
+  WVRInversionTable(const SkyStatus &skyStatus,
+                    const Length &maxWH2O,
+                    const Length &wh2oStep,
+                    const Angle &minElevation,
+                    double airMassStep);
+  /** The constructor, for another WaterVaporRadiometer; its channels are spectral windows of the SkyStatus */
+  WVRInversionTable(const SkyStatus &skyStatus,
+                    const WaterVaporRadiometer &waterVaporRadiometer,
+                    const Length &maxWH2O,
+                    const Length &wh2oStep,
+                    const Angle &minElevation,
+                    double airMassStep);
+
+  virtual ~WVRInversionTable();
+  //@}
+
+  //@{
+  /** Setter to the changes of the ground pressure, temperature and relative humidity of the SkyStatus beyond
+   *  which update() builds the table again (1 mb, 1 K and 5 % unless set) */
+  void setThresholds(const Pressure &groundPressureThreshold,
+                     const Temperature &groundTemperatureThreshold,
+                     const Humidity &relativeHumidityThreshold);
+  /** Build the table again if the SkyStatus has moved away from the one it has been built for
+   * @return true if the table has been built again
+   */
+  bool update(const SkyStatus &skyStatus);
+  //@}
+
+  //@{
+  /** Water vapor column (mm) of the sky brightness temperatures of the WVR channels tebbSky (K) at the air
+   *  mass airmass; -999 if the air mass is out of the table, -888 if the fit ends on an edge of the table (a
+   *  column out of the table). If tebbFit is not null and the column is found, the sky brightness
+   *  temperatures of the WVR channels for this column are written into it.
+   */
+  double getWH2O(const double *tebbSky, double airmass, double *tebbFit) const;
+  double getWH2O(const double *tebbSky, double airmass) const { return getWH2O(tebbSky, airmass, 0); }
+  /** Water vapor column of the sky brightness temperatures of the WVR channels at the elevation (-999 mm
+   *  for an elevation, -888 mm for a column, out of the table) */
+  Length getWH2O(const vector<Temperature> &tebbSky, const Angle &elevation) const;
+  /** Retrieve the water vapor column of a measurement set: the column (-999 mm for an elevation, -888 mm
+   *  for a column, out of the table), the fitted sky brightness temperatures and the rms of the fit are
+   *  written into it, as by SkyStatus::WaterVaporRetrieval_fromWVR(). The table is not updated.
+   * @return false if the elevation or the column is out of the table
+   */
+  bool retrieve(WVRMeasurement &measurement) const;
+  /** Retrieve the water vapor column of a measurement set, after building the table again if the SkyStatus
+   *  has moved away from the one it has been built for (see update())
+   * @return false if the elevation or the column is out of the table
+   */
+  bool retrieve(const SkyStatus &skyStatus, WVRMeasurement &measurement);
+  //@}
+
+  //@{
+  /** Accessor to the number of water vapor columns of the table */
+  size_t getNumWH2O() const { return numWH2O_; }
+  /** Accessor to the number of air masses of the table */
+  size_t getNumAirMass() const { return numAirMass_; }
+  /** Accessor to the largest air mass of the table */
+  double getMaxAirMass() const { return 1.0 + (numAirMass_ - 1) * airMassStep_; }
+  /** Accessor to the number of times the table has been built */
+  size_t getNumBuild() const { return numBuild_; }
+  /** Accessor to the number of points at which the accuracy has been checked */
+  size_t getNumCheck() const { return numCheck_; }
+  /** Accessor to the largest difference of the water vapor columns of the table with those of the fit */
+  Length getMaxError() const { return Length::from<Length::mm>(maxError_); }
+  /** Accessor to the rms difference of the water vapor columns of the table with those of the fit */
+  Length getRmsError() const { return Length::from<Length::mm>(rmsError_); }
+  /** Accessor to the largest error of the interpolated sky brightness temperatures at the check points */
+  Temperature getMaxTebbError() const { return Temperature::from<Temperature::K>(maxTebbError_); }
+  //@}
+
+protected:
+  bool ownRadiometer_;             //!< true for the WaterVaporRadiometer of the SkyStatus
+  WaterVaporRadiometer waterVaporRadiometer_; //!< WaterVaporRadiometer of the table
+  WVRStreamRetriever retriever_;   //!< model of the WVR channels and fit of the accuracy checks
+
+  double maxWH2O_;                 //!< largest water vapor column asked for (mm)
+  double wh2oStep_;                //!< step of the water vapor columns (mm)
+  double maxAirMass_;              //!< largest air mass asked for
+  double airMassStep_;             //!< step of the air masses
+  size_t numChan_;                 //!< number of WVR channels
+  size_t numWH2O_;                 //!< number of water vapor columns
+  size_t numAirMass_;              //!< number of air masses (at least 4)
+  vector<double> v_tebb_;          //!< sky brightness temperatures (K), [air mass][water vapor column][channel]
+  vector<double> v_dTebb_;         //!< their derivatives with respect to the water vapor column (K/mm), same layout
+
+  size_t profileVersion_;          //!< version of the layers the table has been built for
+  size_t numLayer_;                //!< number of layers the table has been built for
+  double altitude_;                //!< altitude of the site (m) the table has been built for
+  double groundPressure_;          //!< ground pressure (mb) the table has been built for
+  double groundTemperature_;       //!< ground temperature (K) the table has been built for
+  double relativeHumidity_;        //!< ground relative humidity (%) the table has been built for
+  double tropoLapseRate_;          //!< tropospheric lapse rate (K/km) the table has been built for
+  double wvScaleHeight_;           //!< water vapor scale height (m) the table has been built for
+  double skyBackgroundTemperature_; //!< sky background temperature (K) the table has been built for
+  double groundPressureThreshold_;    //!< change of the ground pressure beyond which the table is built again (mb)
+  double groundTemperatureThreshold_; //!< change of the ground temperature beyond which the table is built again (K)
+  double relativeHumidityThreshold_;  //!< change of the relative humidity beyond which the table is built again (%)
+
+  size_t numBuild_;                //!< number of times the table has been built
+  size_t numCheck_;                //!< number of accuracy check points
+  double maxError_;                //!< largest difference of the water vapor columns with those of the fit (mm)
+  double rmsError_;                //!< rms difference of the water vapor columns with those of the fit (mm)
+  double maxTebbError_;            //!< largest error of the interpolated sky brightness temperatures (K)
+
+  /** Set the grid and build the table */
+  void init(const SkyStatus &skyStatus,
+            const Length &maxWH2O,
+            const Length &wh2oStep,
+            const Angle &minElevation,
+            double airMassStep);
+  /** Tabulate the sky brightness temperatures for the SkyStatus and the WaterVaporRadiometer of the table,
+   *  and check the accuracy of the table */
+  void build(const SkyStatus &skyStatus);
+  /** Check the accuracy of the table at points between those of the grid */
+  void mkAccuracy();
+  /** true if the SkyStatus has moved away from the one the table has been built for */
+  bool isStale(const SkyStatus &skyStatus) const;
+  /** Weights of the four air masses first to first+3 of the table for the air mass airmass
+   * @return false if airmass is out of the table
+   */
+  bool getAirMassWeights(double airmass, size_t &first, double *weight) const;
+  /** Sky brightness temperature (K) of WVR channel chan, and its derivative (K/mm) in deriv, for the water
+   *  vapor column wh2o (mm), interpolated with the air mass weights */
+  double mkTebb(size_t chan, double wh2o, size_t first, const double *weight, double &deriv) const;
+}; // class WVRInversionTable
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_WVRINVERSIONTABLE_H*/
@@ -69,7 +69,7 @@ public:
   /** Accessor to air mass */
    double getAirMass() const { return 1.0 / sin(elevation_.get()); }
   /** Accessor to measured sky brightness temperature */
-   vector<Temperature> getmeasuredSkyBrightness() const { return v_measuredSkyBrightness_; }
+   const vector<Temperature> &getmeasuredSkyBrightness() const { return v_measuredSkyBrightness_; }
   /** Accessor to fitted sky brightness temperatures */
    vector<Temperature> getfittedSkyBrightness() const { return v_fittedSkyBrightness_; }
   /** Setter of fitted sky brightness temperatures */
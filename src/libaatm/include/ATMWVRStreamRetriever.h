@@ -0,0 +1,163 @@
+#ifndef _ATM_WVRSTREAMRETRIEVER_H
+#define _ATM_WVRSTREAMRETRIEVER_H
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMWVRStreamRetriever.h Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#ifndef __cplusplus
+#error This is a C++ include file and cannot be used from plain C
+#endif
+
+#include "ATMCommon.h"
+#include "ATMLevenbergMarquardt.h"
+#include "ATMSkyStatus.h"
+#include "ATMWaterVaporRadiometer.h"
+#include "ATMWVRMeasurement.h"
+
+#include <vector>
+
+using std::vector;
+
+ATM_NAMESPACE_BEGIN
+
+/*! \brief Water vapor retrieval of a time ordered stream of WVR measurement sets.
+ *
+ *   The retrieval of each measurement set is that of SkyStatus::mkWaterVaporRetrieval_fromWVR(), the fit of
+ *   the water vapor column to the sky brightness temperatures of the WVR channels, but:
+ *         - the fit starts from the previous solution of the stream, or, with the linear predictor, from its
+ *           linear extrapolation, its rate of change being smoothed over about ten solutions; after a gap
+ *           longer than getMaxGap(), a time going backwards or reset(), it starts again from the water vapor
+ *           column of the SkyStatus;
+ *         - the damping of the fit starts from the one with which the previous fit ended, kept within
+ *           [minDamping_, maxDamping_], rather than from the same value every time;
+ *         - the SkyStatus is not modified: the RT-ready data of the WVR channels are copied once by the
+ *           constructor, and the water vapor column of the SkyStatus is left as it is.
+ *
+ *   The water vapor column changes little from one sample to the next at 1 Hz: most fits then meet the
+ *   tolerance of the retrieval after two evaluations of the model (the starting point and one step), against
+ *   three or more for a cold start. The retriever does not follow later changes of the SkyStatus: it must be
+ *   built again when its profile or the WVR configuration changes.
+ */
+class WVRStreamRetriever
+{
+public:
+
+  //@{
+  /** The constructor, for the WaterVaporRadiometer of the SkyStatus */
+  WVRStreamRetriever(const SkyStatus &skyStatus);
+  /** The constructor, for another WaterVaporRadiometer; its channels are spectral windows of the SkyStatus */
+  WVRStreamRetriever(const SkyStatus &skyStatus, const WaterVaporRadiometer &waterVaporRadiometer);
+
+  virtual ~WVRStreamRetriever();
+  //@}
+
+  //@{
+  /** Setter to the use of the linear predictor (not used unless set) */
+  void setLinearPredictor(bool linearPredictor) { linearPredictor_ = linearPredictor; }
+  /** Accessor to the use of the linear predictor */
+  bool getLinearPredictor() const { return linearPredictor_; }
+  /** Setter to the largest time between two measurement sets (s) over which the retrieval starts from
+   *  the previous one (10 s unless set) */
+  void setMaxGap(double maxGap) { maxGap_ = maxGap; }
+  /** Accessor to the largest time between two measurement sets (s) over which the retrieval starts from
+   *  the previous one */
+  double getMaxGap() const { return maxGap_; }
+  /** Forget the previous retrievals: the next one starts from the water vapor column of the SkyStatus */
+  void reset();
+  //@}
+
+  //@{
+  /** Retrieve the water vapor column of the next measurement set of the stream, taken at time (s). The
+   *  retrieved column (-888 mm if the fit has not converged), the fitted sky brightness temperatures and
+   *  the rms of the fit are written into the measurement set, as by SkyStatus::WaterVaporRetrieval_fromWVR().
+   * @return true if the fit has converged
+   */
+  bool retrieve(double time, WVRMeasurement &measurement);
+  //@}
+
+  //@{
+  /** Sky brightness temperatures (K) of the WVR channels, as fitted by the retrievals, for the water vapor
+   *  column wh2o and the air mass airmass, and, if dTebb_dWH2O is not null, their derivatives with respect to
+   *  the water vapor column (K/mm)
+   */
+  void getTebbSky(const Length &wh2o, double airmass, double *tebbSky, double *dTebb_dWH2O) const;
+  //@}
+
+  //@{
+  /** Accessor to the water vapor column of the last converged retrieval (the starting one if none) */
+  Length getWaterVaporColumn() const { return Length::from<Length::mm>(pfit_ * groundWH2O_); }
+  /** Accessor to the number of evaluations of the model by the last retrieval */
+  size_t getNumEvaluation() const { return fit_.getStatistics().numEvaluation; }
+  /** Accessor to the number of measurement sets retrieved */
+  size_t getNumSample() const { return numSample_; }
+  /** Accessor to the number of measurement sets whose fit has not converged */
+  size_t getNumFailure() const { return numFailure_; }
+  /** Accessor to the number of evaluations of the model by all the retrievals */
+  size_t getTotalNumEvaluation() const { return totalNumEvaluation_; }
+  /** Accessor to the damping the next fit will start from */
+  double getDamping() const { return settings_.initialDamping; }
+  //@}
+
+protected:
+  static constexpr double minDamping_ = 1.0e-6; //!< smallest damping a fit starts from
+  static constexpr double maxDamping_ = 1.0;    //!< largest damping a fit starts from
+
+  size_t numChan_;                 //!< number of WVR channels
+  size_t numLayer_;                //!< number of layers of the profile
+  double groundWH2O_;              //!< water vapor column of the profile (mm), that of a scale factor 1
+  double startPfit_;               //!< scale factor of the water vapor column of the SkyStatus
+  double tspill_;                  //!< spill over temperature of the WVR (K)
+  vector<double> v_skyCoupling_;   //!< sky couplings of the WVR channels
+  vector<double> v_signalGain_;    //!< signal side band gains of the WVR channels (fraction)
+  vector<size_t> v_firstCache_;    //!< first RT-ready data of each WVR channel (numChan_+1 values)
+  vector<vector<double> > vv_signalCache_; //!< RT-ready data of the channels of the signal side bands
+  vector<vector<double> > vv_imageCache_;  //!< RT-ready data of the channels of the image side bands (empty
+                                           //!< for a signal gain of 1)
+
+  bool linearPredictor_;           //!< true if the starting point is extrapolated from the previous solutions
+  double maxGap_;                  //!< largest time between two measurement sets over which the previous solution is used (s)
+  size_t numSolution_;             //!< number of consecutive converged retrievals of the stream, 0 after a reset
+  double time_;                    //!< time of the last converged retrieval (s)
+  double pfit_;                    //!< scale factor of the water vapor column of the last converged retrieval
+  double slope_;                   //!< rate of change of pfit_ (1/s), smoothed over about 10 converged retrievals
+  size_t numSample_;               //!< number of measurement sets retrieved
+  size_t numFailure_;              //!< number of measurement sets whose fit has not converged
+  size_t totalNumEvaluation_;      //!< number of evaluations of the model by all the retrievals
+
+  LevenbergMarquardt fit_;                //!< fit of the water vapor column, reused by all the retrievals
+  LevenbergMarquardt::Settings settings_; //!< settings of the next fit
+  vector<double> v_measured_;      //!< measured sky brightness temperatures of the current measurement set (K)
+  vector<Temperature> v_fitted_;   //!< fitted sky brightness temperatures of the current measurement set
+  double airm_;                    //!< air mass of the current measurement set
+
+  /** Copy the RT-ready data of the WVR channels and set up the fit */
+  void init(const SkyStatus &skyStatus, const WaterVaporRadiometer &waterVaporRadiometer);
+  /** Sky brightness temperatures of the WVR channels (K) for the scale factor pfit of the water vapor
+   *  column and the air mass airm, with their derivatives */
+  void mkModel(const double *pfit, double airm, double *tebb, double *deriv) const;
+}; // class WVRStreamRetriever
+
+ATM_NAMESPACE_END
+
+#endif /*!_ATM_WVRSTREAMRETRIEVER_H*/
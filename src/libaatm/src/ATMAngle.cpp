@@ -42,9 +42,9 @@ Angle::Angle(double angle) :
 Angle::Angle(double angle, const std::string &units)
 {
   if(units == "Rad" || units == "RAD" || units == "rad") {
-    valueIS_ = angle;
+    valueIS_ = rad::toIS(angle);
   } else if(units == "deg" || units == "DEG") {
-    valueIS_ = (angle / 360.0) * 6.2831852;
+    valueIS_ = deg::toIS(angle);
   } else {
     valueIS_ = angle;
   }
@@ -57,9 +57,9 @@ Angle::~Angle()
 double Angle::get(const std::string &units) const
 {
   if(units == "Rad" || units == "RAD" || units == "rad") {
-    return valueIS_;
+    return rad::fromIS(valueIS_);
   } else if(units == "deg" || units == "DEG") {
-    return 360.0 * (valueIS_ / 6.2831852);
+    return deg::fromIS(valueIS_);
   } else {
     return valueIS_;
   }
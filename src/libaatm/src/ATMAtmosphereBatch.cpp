@@ -0,0 +1,186 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMAtmosphereBatch.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMAtmosphereBatch.h"
+
+#include <iostream>
+#include <vector>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+AtmosphereBatch::AtmosphereBatch(const SpectralGrid &spectralGrid,
+                                 const AtmProfile &atmProfile) :
+  skyStatus_(RefractiveIndexProfile(spectralGrid, atmProfile, true)), airMass_(1.0), skyCoupling_(1.0),
+  spilloverTemperature_(100.0), numComputed_(0)
+{
+  // every state, however close to the previous one, gets its own profile
+  skyStatus_.setBasicAtmosphericParameterThresholds(Length::from<Length::m>(0.0),
+                                                    Pressure::from<Pressure::mb>(0.0),
+                                                    Temperature::from<Temperature::K>(0.0),
+                                                    0.0,
+                                                    Humidity::from<Humidity::percent>(0.0),
+                                                    Length::from<Length::m>(0.0));
+}
+
+AtmosphereBatch::~AtmosphereBatch()
+{
+}
+
+size_t AtmosphereBatch::addState(const Length &altitude,
+                                 const Pressure &groundPressure,
+                                 const Temperature &groundTemperature,
+                                 double tropoLapseRate,
+                                 const Humidity &relativeHumidity,
+                                 const Length &wvScaleHeight)
+{
+  v_altitude_.push_back(altitude.get<Length::m>());
+  v_groundPressure_.push_back(groundPressure.get<Pressure::mb>());
+  v_groundTemperature_.push_back(groundTemperature.get<Temperature::K>());
+  v_tropoLapseRate_.push_back(tropoLapseRate);
+  v_relativeHumidity_.push_back(relativeHumidity.get<Humidity::percent>());
+  v_wvScaleHeight_.push_back(wvScaleHeight.get<Length::m>());
+  return v_groundPressure_.size() - 1;
+}
+
+size_t AtmosphereBatch::addState(const Pressure &groundPressure,
+                                 const Temperature &groundTemperature,
+                                 const Humidity &relativeHumidity)
+{
+  return addState(skyStatus_.getAltitude(),
+                  groundPressure,
+                  groundTemperature,
+                  skyStatus_.getTropoLapseRate(),
+                  relativeHumidity,
+                  skyStatus_.getWvScaleHeight());
+}
+
+void AtmosphereBatch::clearStates()
+{
+  v_altitude_.clear();
+  v_groundPressure_.clear();
+  v_groundTemperature_.clear();
+  v_tropoLapseRate_.clear();
+  v_relativeHumidity_.clear();
+  v_wvScaleHeight_.clear();
+  numComputed_ = 0;
+  v_groundWH2O_.clear();
+  v_dryOpacity_.clear();
+  v_wetOpacity_.clear();
+  v_tebbSky_.clear();
+}
+
+void AtmosphereBatch::setSkyBackgroundTemperature(const Temperature &skyBackgroundTemperature)
+{
+  skyStatus_.setSkyBackgroundTemperature(skyBackgroundTemperature);
+}
+
+void AtmosphereBatch::compute()
+{
+  size_t numState = getNumState();
+  size_t numChan = getNumChan();
+  Temperature tspill = Temperature::from<Temperature::K>(spilloverTemperature_);
+
+  v_groundWH2O_.resize(numState);
+  v_dryOpacity_.resize(numState * numChan);
+  v_wetOpacity_.resize(numState * numChan);
+  v_tebbSky_.resize(numState * numChan);
+
+  for(size_t state = 0; state < numState; state++) {
+    skyStatus_.setBasicAtmosphericParameters(Length::from<Length::m>(v_altitude_[state]),
+                                             Pressure::from<Pressure::mb>(v_groundPressure_[state]),
+                                             Temperature::from<Temperature::K>(v_groundTemperature_[state]),
+                                             v_tropoLapseRate_[state],
+                                             Humidity::from<Humidity::percent>(v_relativeHumidity_[state]),
+                                             Length::from<Length::m>(v_wvScaleHeight_[state]));
+    Length wh2o = skyStatus_.getGroundWH2O();
+    v_groundWH2O_[state] = wh2o.get<Length::m>();
+
+    size_t row = state * numChan;
+    size_t nc = 0;
+    for(size_t spwid = 0; spwid < skyStatus_.getNumSpectralWindow(); spwid++) {
+      for(size_t n = 0; n < skyStatus_.getNumChan(spwid); n++, nc++) {
+        v_dryOpacity_[row + nc] = skyStatus_.RefractiveIndexProfile::getDryOpacity(nc).get<Opacity::np>();
+        v_wetOpacity_[row + nc] = skyStatus_.RefractiveIndexProfile::getWetOpacity(wh2o, nc).get<Opacity::np>();
+        v_tebbSky_[row + nc] = skyStatus_.getTebbSky(spwid, n, wh2o, airMass_, skyCoupling_, tspill).get<Temperature::K>();
+      }
+    }
+  }
+  numComputed_ = numState;
+}
+
+Length AtmosphereBatch::getGroundWH2O(size_t state) const
+{
+  if(state >= numComputed_) return Length::from<Length::mm>(-999.0);
+  return Length::from<Length::m>(v_groundWH2O_[state]);
+}
+
+Opacity AtmosphereBatch::getDryOpacity(size_t state, size_t nc) const
+{
+  if(state >= numComputed_ || nc >= getNumChan()) return Opacity(-999.0);
+  return Opacity::from<Opacity::np>(v_dryOpacity_[state * getNumChan() + nc]);
+}
+
+Opacity AtmosphereBatch::getDryOpacity(size_t state, size_t spwid, size_t nc) const
+{
+  return getDryOpacity(state, chanIndex(spwid, nc));
+}
+
+Opacity AtmosphereBatch::getWetOpacity(size_t state, size_t nc) const
+{
+  if(state >= numComputed_ || nc >= getNumChan()) return Opacity(-999.0);
+  return Opacity::from<Opacity::np>(v_wetOpacity_[state * getNumChan() + nc]);
+}
+
+Opacity AtmosphereBatch::getWetOpacity(size_t state, size_t spwid, size_t nc) const
+{
+  return getWetOpacity(state, chanIndex(spwid, nc));
+}
+
+Temperature AtmosphereBatch::getTebbSky(size_t state, size_t nc) const
+{
+  if(state >= numComputed_ || nc >= getNumChan()) return Temperature::from<Temperature::K>(-999.0);
+  return Temperature::from<Temperature::K>(v_tebbSky_[state * getNumChan() + nc]);
+}
+
+Temperature AtmosphereBatch::getTebbSky(size_t state, size_t spwid, size_t nc) const
+{
+  return getTebbSky(state, chanIndex(spwid, nc));
+}
+
+size_t AtmosphereBatch::chanIndex(size_t spwid, size_t nc) const
+{
+  if(spwid >= skyStatus_.getNumSpectralWindow() || nc >= skyStatus_.getNumChan(spwid)) {
+    std::cout << " AtmosphereBatch: ERROR: spectral window identifier or channel index out of range"
+        << std::endl;
+    return getNumChan();
+  }
+  size_t offset = 0;
+  for(size_t n = 0; n < spwid; n++) offset = offset + skyStatus_.getNumChan(n);
+  return offset + nc;
+}
+
+ATM_NAMESPACE_END
@@ -58,15 +58,15 @@ Frequency::~Frequency()
 double Frequency::sget(double value, const std::string &units)
 {
   if(units == "THz" || units == "THZ") {
-    return 1.0E-12 * value;
+    return THz::fromIS(value);
   } else if(units == "GHz" || units == "GHz" || units == "ghz") {
-    return 1.0E-9 * value;
+    return GHz::fromIS(value);
   } else if(units == "MHz" || units == "MHZ" || units == "mhz") {
-    return 1.0E-6 * value;
+    return MHz::fromIS(value);
   } else if(units == "kHz" || units == "KHZ" || units == "khz") {
-    return 1.0E-3 * value;
+    return kHz::fromIS(value);
   } else if(units == "Hz" || units == "HZ" || units == "hz") {
-    return value;
+    return Hz::fromIS(value);
   } else {
     return value;
   }
@@ -74,15 +74,15 @@ double Frequency::sget(double value, const std::string &units)
 double Frequency::sput(double freq, const std::string &units)
 {
   if(units == "THz" || units == "THZ") {
-    return 1.0E12 * freq;
+    return THz::toIS(freq);
   } else if(units == "GHz" || units == "GHZ" || units == "ghz") {
-    return 1.0E9 * freq;
+    return GHz::toIS(freq);
   } else if(units == "MHz" || units == "MHZ" || units == "mhz") {
-    return 1.0E6 * freq;
+    return MHz::toIS(freq);
   } else if(units == "kHz" || units == "KHZ" || units == "khz") {
-    return 1.0E3 * freq;
+    return kHz::toIS(freq);
   } else if(units == "Hz" || units == "HZ" || units == "hz") {
-    return freq;
+    return Hz::toIS(freq);
   } else {
     return freq;
   }
@@ -57,15 +57,15 @@ InverseLength::~InverseLength()
 double InverseLength::sget(double value, const std::string &units)
 {
   if(units == "km-1" || units == "KM-1") {
-    return 1.0E+3 * value;
+    return per_km::fromIS(value);
   } else if(units == "m-1" || units == "M-1") {
-    return value;
+    return per_m::fromIS(value);
   } else if(units == "mm-1" || units == "MM-1") {
-    return 1.0E-3 * value;
+    return per_mm::fromIS(value);
   } else if(units == "micron-1" || units == "MICRON-1") {
-    return 1.0E-6 * value;
+    return per_micron::fromIS(value);
   } else if(units == "nm-1" || units == "NM-1") {
-    return 1.0E-9 * value;
+    return per_nm::fromIS(value);
   } else {
     return value;
   }
@@ -74,15 +74,15 @@ double InverseLength::sget(double value, const std::string &units)
 double InverseLength::sput(double value, const std::string &units)
 {
   if(units == "km-1" || units == "KM-1") {
-    return 1.0E-3 * value;
+    return per_km::toIS(value);
   } else if(units == "m-1" || units == "M-1") {
-    return value;
+    return per_m::toIS(value);
   } else if(units == "mm-1" || units == "MM-1") {
-    return 1.0E+3 * value;
+    return per_mm::toIS(value);
   } else if(units == "micron-1" || units == "MICRON-1") {
-    return 1.0E+6 * value;
+    return per_micron::toIS(value);
   } else if(units == "nm-1" || units == "NM-1") {
-    return 1.0E+9 * value;
+    return per_nm::toIS(value);
   } else {
     return value;
   }
@@ -58,17 +58,17 @@ Length::~Length()
 double Length::sget(double value, const std::string &units)
 {
   if(units == "km" || units == "KM") {
-    return 1.0E-3 * value;
+    return km::fromIS(value);
   } else if(units == "m" || units == "M") {
-    return value;
+    return m::fromIS(value);
   } else if(units == "mm" || units == "MM") {
-    return 1.0E+3 * value;
+    return mm::fromIS(value);
   } else if(units == "micron" || units == "MICRON") {
-    return 1.0E+6 * value;
+    return micron::fromIS(value);
   } else if(units == "microns" || units == "MICRONS") {
-    return 1.0E+6 * value;
+    return micron::fromIS(value);
   } else if(units == "nm" || units == "NM") {
-    return 1.0E+9 * value;
+    return nm::fromIS(value);
   } else {
     return value;
   }
@@ -77,15 +77,15 @@ double Length::sget(double value, const std::string &units)
 double Length::sput(double value, const std::string &units)
 {
   if(units == "km" || units == "KM") {
-    return 1.0E+3 * value;
+    return km::toIS(value);
   } else if(units == "m" || units == "M") {
-    return value;
+    return m::toIS(value);
   } else if(units == "mm" || units == "MM") {
-    return 1.0E-3 * value;
+    return mm::toIS(value);
   } else if(units == "micron" || units == "MICRON") {
-    return 1.0E-6 * value;
+    return micron::toIS(value);
   } else if(units == "nm" || units == "NM") {
-    return 1.0E-9 * value;
+    return nm::toIS(value);
   } else {
     return value;
   }
@@ -0,0 +1,209 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMLevenbergMarquardt.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMLevenbergMarquardt.h"
+
+#include <algorithm>
+#include <math.h>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+LevenbergMarquardt::LevenbergMarquardt(size_t numParam, size_t numData) :
+  numParam_(numParam), numData_(numData), degreesOfFreedom_(numData > 1 ? numData - 1.0 : 1.0),
+  data_(numData, 0.0), weight_(numData, 1.0), model_(numData, 0.0), jacobian_(numData * numParam, 0.0),
+  trialModel_(numData, 0.0), trialJacobian_(numData * numParam, 0.0), trialParam_(numParam, 0.0),
+  alpha_(numParam * numParam, 0.0), beta_(numParam, 0.0), system_(numParam * numParam, 0.0),
+  step_(numParam, 0.0), error_(numParam, 0.0), dampingFactor_(1.0)
+{
+  statistics_.converged = false;
+  statistics_.numIteration = 0;
+  statistics_.numEvaluation = 0;
+  statistics_.numRejection = 0;
+  statistics_.chiSquare = 0.0;
+  statistics_.damping = settings_.initialDamping;
+}
+
+LevenbergMarquardt::~LevenbergMarquardt()
+{
+}
+
+void LevenbergMarquardt::setData(const double *data)
+{
+  std::copy(data, data + numData_, data_.begin());
+}
+
+void LevenbergMarquardt::setWeight(const double *weight)
+{
+  std::copy(weight, weight + numData_, weight_.begin());
+}
+
+double LevenbergMarquardt::getSigma() const
+{
+  return sqrt(statistics_.chiSquare);
+}
+
+double LevenbergMarquardt::getParameterError(size_t k) const
+{
+  return sqrt(error_[k]) * getSigma();
+}
+
+double LevenbergMarquardt::chiSquare(const double *model) const
+{
+  double chisq = 0.0;
+  for(size_t i = 0; i < numData_; i++) {
+    double res = (data_[i] - model[i]) * weight_[i];
+    chisq = chisq + res * res;
+  }
+  return chisq / degreesOfFreedom_;
+}
+
+void LevenbergMarquardt::mkCurvature()
+{
+  for(size_t k = 0; k < numParam_; k++) {
+    beta_[k] = 0.0;
+    for(size_t l = 0; l < numParam_; l++) alpha_[k * numParam_ + l] = 0.0;
+  }
+  for(size_t i = 0; i < numData_; i++) {
+    double w2 = weight_[i] * weight_[i];
+    const double *deriv = &jacobian_[i * numParam_];
+    for(size_t k = 0; k < numParam_; k++) {
+      beta_[k] = beta_[k] + (data_[i] - model_[i]) * w2 * deriv[k];
+      for(size_t l = 0; l < numParam_; l++) {
+        alpha_[k * numParam_ + l] = alpha_[k * numParam_ + l] + w2 * deriv[k] * deriv[l];
+      }
+    }
+  }
+}
+
+void LevenbergMarquardt::solveDamped(double dampingFactor, double *rhs)
+{
+  // a single parameter: the step of the original retrievals, beta*array/alpha with array = 1/(1+damping)
+  if(numParam_ == 1) {
+    rhs[0] = rhs[0] * dampingFactor / alpha_[0];
+    return;
+  }
+
+  // Gauss elimination with partial pivoting of (alpha + damping diag(alpha)) x = rhs
+  size_t n = numParam_;
+  std::copy(alpha_.begin(), alpha_.end(), system_.begin());
+  for(size_t k = 0; k < n; k++) system_[k * n + k] = system_[k * n + k] / dampingFactor;
+  for(size_t k = 0; k < n; k++) {
+    size_t pivot = k;
+    for(size_t i = k + 1; i < n; i++) {
+      if(fabs(system_[i * n + k]) > fabs(system_[pivot * n + k])) pivot = i;
+    }
+    if(pivot != k) {
+      for(size_t l = 0; l < n; l++) std::swap(system_[k * n + l], system_[pivot * n + l]);
+      std::swap(rhs[k], rhs[pivot]);
+    }
+    for(size_t i = k + 1; i < n; i++) {
+      double factor = system_[i * n + k] / system_[k * n + k];
+      for(size_t l = k; l < n; l++) system_[i * n + l] = system_[i * n + l] - factor * system_[k * n + l];
+      rhs[i] = rhs[i] - factor * rhs[k];
+    }
+  }
+  for(size_t k = n; k-- > 0;) {
+    double sum = rhs[k];
+    for(size_t l = k + 1; l < n; l++) sum = sum - system_[k * n + l] * rhs[l];
+    rhs[k] = sum / system_[k * n + k];
+  }
+}
+
+void LevenbergMarquardt::mkTrial(const double *param, double dampingFactor)
+{
+  std::copy(beta_.begin(), beta_.end(), step_.begin());
+  solveDamped(dampingFactor, &step_[0]);
+  for(size_t k = 0; k < numParam_; k++) {
+    trialParam_[k] = param[k];
+    trialParam_[k] = trialParam_[k] + step_[k];
+  }
+  if(constraint_) constraint_(param, &trialParam_[0]);
+}
+
+bool LevenbergMarquardt::solve(const Model &model, double *param)
+{
+  double damping = settings_.initialDamping;
+  double chisq1;
+  double chisqr;
+
+  statistics_.converged = false;
+  statistics_.numIteration = 0;
+  statistics_.numEvaluation = 1;
+  statistics_.numRejection = 0;
+
+  model(param, &model_[0], &jacobian_[0]);
+  statistics_.chiSquare = chiSquare(&model_[0]);
+
+  for(size_t kite = 0; kite < settings_.maxIteration; kite++) {
+
+    statistics_.numIteration = statistics_.numIteration + 1;
+
+    mkCurvature();
+    chisq1 = statistics_.chiSquare;
+
+    // trial steps, the damping being raised until the chi square does not get (significantly) worse
+    for(size_t rejection = 0; ; rejection++) {
+      dampingFactor_ = 1.0 / (1.0 + damping);
+      mkTrial(param, dampingFactor_);
+      model(&trialParam_[0], &trialModel_[0], &trialJacobian_[0]);
+      statistics_.numEvaluation = statistics_.numEvaluation + 1;
+      chisqr = chiSquare(&trialModel_[0]);
+      if(fabs(chisq1 - chisqr) > settings_.chiSquareTolerance && chisq1 < chisqr
+         && rejection < settings_.maxRejection) {
+        damping = damping * settings_.dampingIncrease;
+        statistics_.numRejection = statistics_.numRejection + 1;
+        continue;
+      }
+      break;
+    }
+
+    damping = damping / settings_.dampingDecrease;
+    std::copy(trialParam_.begin(), trialParam_.end(), param);
+    model_.swap(trialModel_);
+    jacobian_.swap(trialJacobian_);
+    statistics_.chiSquare = chisqr;
+
+    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < settings_.tolerance) {
+      statistics_.converged = true;
+      break;
+    }
+
+  }
+  statistics_.damping = damping;
+
+  // uncertainties from the damped curvature matrix of the last step
+  for(size_t k = 0; k < numParam_; k++) {
+    std::fill(step_.begin(), step_.end(), 0.0);
+    step_[k] = 1.0;
+    solveDamped(dampingFactor_, &step_[0]);
+    error_[k] = step_[k];
+  }
+
+  return statistics_.converged;
+}
+
+ATM_NAMESPACE_END
@@ -41,13 +41,13 @@ MassDensity::MassDensity(double massdensity, const std::string &units)
 {
   if(units == "gcm**-3" || units == "g cm**-3" || units == "GCM**-3" ||
      units == "G CM**-3" || units == "g/cm^3") {
-    valueIS_ = 1.0E+3 * massdensity;
+    valueIS_ = g_cm3::toIS(massdensity);
   } else if(units == "gm**-3" || units == "g m**-3" || units == "GM**-3" ||
       units == "G M**-3" || units == "g/m^3") {
-    valueIS_ = 1.0E-3 * massdensity;
+    valueIS_ = g_m3::toIS(massdensity);
   } else if(units == "kgm**-3" || units == "kg m**-3" || units == "KGM**-3" ||
       units == "KG M**-3" || units == "kg/m^3") {
-    valueIS_ = massdensity;
+    valueIS_ = kg_m3::toIS(massdensity);
   } else {
     // Exception: unknown number density unit. S.I. unit (kg m**-3) used by default.
     valueIS_ = massdensity;
@@ -60,13 +60,13 @@ double MassDensity::get(const std::string &units) const
 {
   if(units == "gcm**-3" || units == "g cm**-3" || units == "GCM**-3" ||
       units == "G CM**-3" || units == "g/cm^3") {
-    return 1.0E-3 * valueIS_;
+    return g_cm3::fromIS(valueIS_);
   } else if(units == "gm**-3" || units == "g m**-3" || units == "GM**-3" ||
       units == "G M**-3" || units == "g/m^3") {
-    return 1.0E+3 * valueIS_;
+    return g_m3::fromIS(valueIS_);
   } else if(units == "kgm**-3" || units == "kg m**-3" || units == "KGM**-3" ||
       units == "KG M**-3" || units == "kg/m^3") {
-    return valueIS_;
+    return kg_m3::fromIS(valueIS_);
   } else {
     // Exception: unknown number density unit. S.I. unit (kg m**-3) used by default.
     return valueIS_;
@@ -42,9 +42,9 @@ NumberDensity::NumberDensity(double numberdensity) :
 NumberDensity::NumberDensity(double numberdensity, const std::string &units)
 {
   if(units == "cm**-3" || units == "CM**-3") {
-    valueIS_ = 1.0E+6 * numberdensity;
+    valueIS_ = per_cm3::toIS(numberdensity);
   } else if(units == "m**-3" || units == "M**-3") {
-    valueIS_ = numberdensity;
+    valueIS_ = per_m3::toIS(numberdensity);
   } else {
     // Exception: unknown number density unit. S.I. unit (m**-3) used by default.
     valueIS_ = numberdensity;
@@ -58,9 +58,9 @@ NumberDensity::~NumberDensity()
 double NumberDensity::get(const std::string &units) const
 {
   if(units == "cm**-3" || units == "CM**-3") {
-    return 1.0E-6 * valueIS_;
+    return per_cm3::fromIS(valueIS_);
   } else if(units == "m**-3" || units == "M**-3") {
-    return valueIS_;
+    return per_m3::fromIS(valueIS_);
   } else {
     // Exception: unknown number density unit. S.I. unit (m**-3) used by default.
     return valueIS_;
@@ -58,9 +58,9 @@ Opacity::~Opacity()
 double Opacity::sget(double value, const std::string &units)
 {
   if(units == "db" || units == "DB") {
-    return value * 4.34294482;
+    return db::fromIS(value);
   } else if(units == "np" || units == "NP" || units == "neper" || units == "NEPER"){
-    return value;
+    return np::fromIS(value);
   } else {
     // Exception: Unknown unit, neper (np) used by default)
     return value;
@@ -70,9 +70,9 @@ double Opacity::sget(double value, const std::string &units)
 double Opacity::sput(double value, const std::string &units)
 {
   if(units == "db" || units == "DB") {
-    return value / 4.34294482;
+    return db::toIS(value);
   } else if(units == "np" || units == "NP" || units == "neper" || units == "NEPER") {
-    return value;
+    return np::toIS(value);
   } else {
     // Exception: Unknown unit, neper (np) used by default)
     return value;
@@ -45,7 +45,7 @@ ATM_NAMESPACE_BEGIN
 
   Percent::Percent(double percent, const std::string &units){
     if(units == "%" || units == "percent" || units == "PERCENT"){
-      valueIS_ = percent / 100.0;
+      valueIS_ = Percent::percent::toIS(percent);
     } else {
       // Exception: Unknown percent unit
       valueIS_ = percent;
@@ -62,7 +62,7 @@ ATM_NAMESPACE_BEGIN
   double Percent::get()const{return valueIS_;}
   double Percent::get(const std::string &units)const{
     if(units == "%" || units == "percent" || units == "PERCENT"){
-      return valueIS_ * 100.0;
+      return percent::fromIS(valueIS_);
     } else {
       // Exception: Unknown percent unit
       return valueIS_;
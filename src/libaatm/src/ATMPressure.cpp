@@ -40,17 +40,17 @@ Pressure::Pressure(double pressure) :
 Pressure::Pressure(double pressure, const std::string &units)
 {
   if(units == "Pa" || units == "PA") {
-    valueIS_ = pressure;
+    valueIS_ = Pa::toIS(pressure);
   } else if(units == "hPa" || units == "HPA") {
-    valueIS_ = pressure * 100.0;
+    valueIS_ = hPa::toIS(pressure);
   } else if(units == "bar" || units == "BAR") {
-    valueIS_ = 1.0E+5 * pressure;
+    valueIS_ = bar::toIS(pressure);
   } else if(units == "mb" || units == "MB") {
-    valueIS_ = 1.0E+2 * pressure;
+    valueIS_ = mb::toIS(pressure);
   } else if(units == "mbar" || units == "MBAR") {
-    valueIS_ = 1.0E+2 * pressure;
+    valueIS_ = mbar::toIS(pressure);
   } else if(units == "atm" || units == "ATM") {
-    valueIS_ = pressure * 101325.;
+    valueIS_ = atmosphere::toIS(pressure);
   } else {
     valueIS_ = pressure;
   }
@@ -64,17 +64,17 @@ Pressure::~Pressure()
 double Pressure::get(std::string const &units) const
 {
   if(units == "Pa" || units == "PA") {
-    return valueIS_;
+    return Pa::fromIS(valueIS_);
   } else if(units == "hPa" || units == "HPA" || units == "hpa") {
-    return 1.0E-2 * valueIS_;
+    return hPa::fromIS(valueIS_);
   } else if(units == "bar" || units == "BAR") {
-    return 1.0E-5 * valueIS_;
+    return bar::fromIS(valueIS_);
   } else if(units == "mb" || units == "MB") {
-    return 1.0E-2 * valueIS_;
+    return mb::fromIS(valueIS_);
   } else if(units == "mbar" || units == "MBAR") {
-    return 1.0E-2 * valueIS_;
+    return mbar::fromIS(valueIS_);
   } else if(units == "atm" || units == "ATM") {
-    return valueIS_ / 101325.;
+    return atmosphere::fromIS(valueIS_);
   } else {
     return valueIS_;
   }
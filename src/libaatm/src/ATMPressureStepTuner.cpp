@@ -0,0 +1,282 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMPressureStepTuner.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMPressureStepTuner.h"
+#include "ATMRefractiveIndexProfile.h"
+#include "ATMSkyStatus.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <math.h>
+#include <sstream>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+namespace {
+  // candidate primary pressure steps (mb) and pressure step factors, and the reference layering
+  const double candidateStep[] = { 1.0, 2.0, 5.0, 10.0, 20.0, 50.0 };
+  const double candidateFactor[] = { 1.0, 1.05, 1.1, 1.2, 1.3, 1.5, 2.0 };
+  const double referenceStep = 0.5;
+  const double referenceFactor = 1.02;
+
+  struct Candidate
+  {
+    double pressureStep;
+    double pressureStepFactor;
+    size_t numLayer;
+    bool operator<(const Candidate &c) const
+    {
+      if(numLayer != c.numLayer) return numLayer < c.numLayer;
+      return pressureStep > c.pressureStep;
+    }
+  };
+}
+
+PressureStepTuner::PressureStepTuner(const AtmProfile &atmProfile, const SpectralGrid &spectralGrid) :
+  atmProfile_(atmProfile), numChan_(0), minFreq_(0.0), maxFreq_(0.0), tebbGoal_(-1.0), pathLengthGoal_(-1.0),
+  pressureStep_(0.0), pressureStepFactor_(0.0), numLayer_(0), siteNumLayer_(atmProfile.getNumLayer()),
+  referenceNumLayer_(0), tebbError_(0.0), pathLengthError_(0.0), siteTebbError_(0.0), sitePathLengthError_(0.0)
+{
+  vector<double> v_freq;
+  for(size_t spwid = 0; spwid < spectralGrid.getNumSpectralWindow(); spwid++) {
+    for(size_t n = 0; n < spectralGrid.getNumChan(spwid); n++) {
+      v_freq.push_back(spectralGrid.getChanFreq(spwid, n).get<Frequency::Hz>());
+    }
+  }
+  std::sort(v_freq.begin(), v_freq.end());
+  numChan_ = v_freq.size();
+  if(numChan_ == 0) return;
+  minFreq_ = v_freq.front();
+  maxFreq_ = v_freq.back();
+
+  // proxy channels evenly spread over the sorted frequencies of the band, both ends included
+  if(numChan_ <= maxProxyChan_) {
+    v_proxyFreq_ = v_freq;
+  } else {
+    for(size_t k = 0; k < maxProxyChan_; k++) {
+      v_proxyFreq_.push_back(v_freq[(k * (numChan_ - 1)) / (maxProxyChan_ - 1)]);
+    }
+  }
+}
+
+PressureStepTuner::~PressureStepTuner()
+{
+}
+
+bool PressureStepTuner::tune(const Temperature &tebbGoal, const Length &pathLengthGoal)
+{
+  if(v_proxyFreq_.empty()) {
+    std::cout << " PressureStepTuner: ERROR: the band has no channel" << std::endl;
+    return false;
+  }
+  tebbGoal_ = tebbGoal.get<Temperature::K>();
+  pathLengthGoal_ = pathLengthGoal.get<Length::m>();
+
+  // reference spectrum
+  AtmProfile reference = mkAtmProfile(referenceStep, referenceFactor);
+  referenceNumLayer_ = reference.getNumLayer();
+  Length wh2o = reference.getGroundWH2O();
+  vector<double> tebbSky0, pathLength0, tebbSky, pathLength;
+  mkProxySpectrum(reference, wh2o, tebbSky0, pathLength0);
+
+  AtmProfile site = mkAtmProfile(atmProfile_.getPressureStep().get<Pressure::mb>(), atmProfile_.getPressureStepFactor().get());
+  mkProxySpectrum(site, wh2o, tebbSky, pathLength);
+  siteTebbError_ = 0.0;
+  sitePathLengthError_ = 0.0;
+  for(size_t n = 0; n < tebbSky.size(); n++) {
+    siteTebbError_ = std::max(siteTebbError_, fabs(tebbSky[n] - tebbSky0[n]));
+    sitePathLengthError_ = std::max(sitePathLengthError_, fabs(pathLength[n] - pathLength0[n]));
+  }
+
+  // the candidates, from the fewest layers to the most; building a profile costs nothing compared to
+  // the evaluation of a spectrum
+  vector<Candidate> v_candidate;
+  for(size_t i = 0; i < sizeof(candidateStep) / sizeof(candidateStep[0]); i++) {
+    for(size_t j = 0; j < sizeof(candidateFactor) / sizeof(candidateFactor[0]); j++) {
+      Candidate c;
+      c.pressureStep = candidateStep[i];
+      c.pressureStepFactor = candidateFactor[j];
+      c.numLayer = mkAtmProfile(c.pressureStep, c.pressureStepFactor).getNumLayer();
+      v_candidate.push_back(c);
+    }
+  }
+  std::sort(v_candidate.begin(), v_candidate.end());
+
+  for(size_t k = 0; k < v_candidate.size(); k++) {
+    const Candidate &c = v_candidate[k];
+    if(c.numLayer >= referenceNumLayer_) break;
+    AtmProfile candidate = mkAtmProfile(c.pressureStep, c.pressureStepFactor);
+    mkProxySpectrum(candidate, wh2o, tebbSky, pathLength);
+    double tebbError = 0.0, pathLengthError = 0.0;
+    for(size_t n = 0; n < tebbSky.size(); n++) {
+      tebbError = std::max(tebbError, fabs(tebbSky[n] - tebbSky0[n]));
+      pathLengthError = std::max(pathLengthError, fabs(pathLength[n] - pathLength0[n]));
+    }
+    if((tebbGoal_ < 0.0 || tebbError <= tebbGoal_) && (pathLengthGoal_ < 0.0 || pathLengthError <= pathLengthGoal_)) {
+      pressureStep_ = c.pressureStep;
+      pressureStepFactor_ = c.pressureStepFactor;
+      numLayer_ = c.numLayer;
+      tebbError_ = tebbError;
+      pathLengthError_ = pathLengthError;
+      return true;
+    }
+  }
+
+  // no candidate is good enough: the reference layering is kept
+  pressureStep_ = referenceStep;
+  pressureStepFactor_ = referenceFactor;
+  numLayer_ = referenceNumLayer_;
+  tebbError_ = 0.0;
+  pathLengthError_ = 0.0;
+  return false;
+}
+
+bool PressureStepTuner::tune(const Temperature &tebbGoal)
+{
+  return tune(tebbGoal, Length::from<Length::m>(-1.0));
+}
+
+bool PressureStepTuner::tune(const Length &pathLengthGoal)
+{
+  return tune(Temperature::from<Temperature::K>(-1.0), pathLengthGoal);
+}
+
+AtmProfile PressureStepTuner::getAtmProfile() const
+{
+  if(!isTuned()) return atmProfile_;
+  return mkAtmProfile(pressureStep_, pressureStepFactor_);
+}
+
+AtmProfile PressureStepTuner::mkAtmProfile(double pressureStep, double pressureStepFactor) const
+{
+  return AtmProfile(atmProfile_.getAltitude(),
+                    atmProfile_.getGroundPressure(),
+                    atmProfile_.getGroundTemperature(),
+                    atmProfile_.getTropoLapseRate(),
+                    atmProfile_.getRelativeHumidity(),
+                    atmProfile_.getWvScaleHeight(),
+                    Pressure::from<Pressure::mb>(pressureStep),
+                    pressureStepFactor,
+                    atmProfile_.getTopAtmProfile(),
+                    atmProfile_.getTypeAtm());
+}
+
+void PressureStepTuner::mkProxySpectrum(const AtmProfile &atmProfile, const Length &wh2o,
+                                        vector<double> &tebbSky, vector<double> &pathLength) const
+{
+  SkyStatus skyStatus(RefractiveIndexProfile(SpectralGrid(v_proxyFreq_, "Hz"), atmProfile, true));
+  skyStatus.setUserWH2O(wh2o);
+  skyStatus.setAirMass(1.0);
+  tebbSky.resize(v_proxyFreq_.size());
+  pathLength.resize(v_proxyFreq_.size());
+  skyStatus.streamSpectrum(0, &tebbSky[0], &pathLength[0]);
+}
+
+string PressureStepTuner::mkCacheKey(double tebbGoal, double pathLengthGoal) const
+{
+  std::ostringstream key;
+  key << std::setprecision(10) << atmProfile_.getAltitude().get<Length::m>() << " " << atmProfile_.getTypeAtm() << " "
+      << atmProfile_.getTopAtmProfile().get<Length::m>() << " " << atmProfile_.getGroundPressure().get<Pressure::mb>() << " "
+      << atmProfile_.getGroundTemperature().get<Temperature::K>() << " " << atmProfile_.getTropoLapseRate() << " "
+      << atmProfile_.getRelativeHumidity().get<Humidity::percent>() << " " << atmProfile_.getWvScaleHeight().get<Length::m>() << " "
+      << atmProfile_.getPressureStep().get<Pressure::mb>() << " " << atmProfile_.getPressureStepFactor().get() << " "
+      << numChan_ << " " << minFreq_ << " " << maxFreq_ << " " << tebbGoal << " " << pathLengthGoal;
+  return key.str();
+}
+
+bool PressureStepTuner::save(const string &fileName) const
+{
+  if(!isTuned()) {
+    std::cout << " PressureStepTuner: ERROR: no layering to save" << std::endl;
+    return false;
+  }
+  string key = mkCacheKey(tebbGoal_, pathLengthGoal_);
+
+  // the other entries of the cache are kept
+  vector<string> v_line;
+  std::ifstream in(fileName.c_str());
+  string line;
+  while(std::getline(in, line)) {
+    if(line.empty() || line.compare(0, key.size() + 3, key + " : ") == 0) continue;
+    v_line.push_back(line);
+  }
+  in.close();
+
+  std::ostringstream entry;
+  entry << std::setprecision(10) << key << " : " << pressureStep_ << " " << pressureStepFactor_ << " " << numLayer_
+        << " " << siteNumLayer_ << " " << referenceNumLayer_ << " " << tebbError_ << " " << pathLengthError_
+        << " " << siteTebbError_ << " " << sitePathLengthError_;
+  v_line.push_back(entry.str());
+
+  std::ofstream out(fileName.c_str());
+  if(!out) {
+    std::cout << " PressureStepTuner: ERROR: cannot open " << fileName << " for writing" << std::endl;
+    return false;
+  }
+  for(size_t n = 0; n < v_line.size(); n++) out << v_line[n] << std::endl;
+  if(!out) {
+    std::cout << " PressureStepTuner: ERROR: failed to write " << fileName << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool PressureStepTuner::load(const string &fileName, const Temperature &tebbGoal, const Length &pathLengthGoal)
+{
+  std::ifstream in(fileName.c_str());
+  if(!in) return false;
+  string key = mkCacheKey(tebbGoal.get<Temperature::K>(), pathLengthGoal.get<Length::m>());
+  string line;
+  while(std::getline(in, line)) {
+    if(line.compare(0, key.size() + 3, key + " : ") != 0) continue;
+    std::istringstream entry(line.substr(key.size() + 3));
+    double pressureStep, pressureStepFactor, tebbError, pathLengthError, siteTebbError, sitePathLengthError;
+    size_t numLayer, siteNumLayer, referenceNumLayer;
+    if(!(entry >> pressureStep >> pressureStepFactor >> numLayer >> siteNumLayer >> referenceNumLayer
+         >> tebbError >> pathLengthError >> siteTebbError >> sitePathLengthError)) {
+      std::cout << " PressureStepTuner: ERROR: invalid entry in " << fileName << std::endl;
+      return false;
+    }
+    tebbGoal_ = tebbGoal.get<Temperature::K>();
+    pathLengthGoal_ = pathLengthGoal.get<Length::m>();
+    pressureStep_ = pressureStep;
+    pressureStepFactor_ = pressureStepFactor;
+    numLayer_ = numLayer;
+    siteNumLayer_ = siteNumLayer;
+    referenceNumLayer_ = referenceNumLayer;
+    tebbError_ = tebbError;
+    pathLengthError_ = pathLengthError;
+    siteTebbError_ = siteTebbError;
+    sitePathLengthError_ = sitePathLengthError;
+    return true;
+  }
+  return false;
+}
+
+ATM_NAMESPACE_END
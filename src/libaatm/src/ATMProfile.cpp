@@ -25,6 +25,8 @@
 
 #include "ATMProfile.h"
 #include "ATMException.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <math.h>
 #include <sstream>
@@ -107,7 +109,7 @@ AtmProfile::AtmProfile(const Length &altitude,
   size_t nL1 = v_layerBoundaries.size();
   size_t nL2 = v_layerTemperature.size();
   if(nL1 == nL2 ) {
-    double h=altitude_.get("m");
+    double h=altitude_.get<Length::m>();
     double h0;
     double h1;
     double counter;
@@ -118,9 +120,9 @@ AtmProfile::AtmProfile(const Length &altitude,
       counter = 0.0;
       avT = 0.0;
       for(size_t m = 0; m < nL1; m++) {
-	if( h0 <= v_layerBoundaries[m].get("m") && h1 >= v_layerBoundaries[m].get("m") ){
-	  //	  std::cout << "n=" << n << " h0=" << h0 << " h1=" << h1 << " v_layerBoundaries[" << m << "]=" <<  v_layerBoundaries[m].get("m") << std::endl;
-	  avT = avT + v_layerTemperature[m].get("K");
+	if( h0 <= v_layerBoundaries[m].get<Length::m>() && h1 >= v_layerBoundaries[m].get<Length::m>() ){
+	  //	  std::cout << "n=" << n << " h0=" << h0 << " h1=" << h1 << " v_layerBoundaries[" << m << "]=" <<  v_layerBoundaries[m].get<Length::m>() << std::endl;
+	  avT = avT + v_layerTemperature[m].get<Temperature::K>();
 	  counter = counter + 1.0;
 	}
       }
@@ -145,8 +147,8 @@ AtmProfile::AtmProfile(const Length &altitude,
       typeAtm_(atmType), groundTemperature_(groundTemperature),
       tropoLapseRate_(tropoLapseRate), groundPressure_(groundPressure),
       relativeHumidity_(relativeHumidity), wvScaleHeight_(wvScaleHeight),
-      pressureStep_(10.0, "mb"), pressureStepFactor_(1.2), altitude_(altitude),
-      topAtmProfile_(48.0, "km")
+      pressureStep_(Pressure::from<Pressure::mb>(10.0)), pressureStepFactor_(1.2), altitude_(altitude),
+      topAtmProfile_(Length::from<Length::km>(48.0))
 {
   numLayer_ = 0;
   numLayer_ = mkAtmProfile();
@@ -174,16 +176,16 @@ AtmProfile::AtmProfile(const Length &altitude,
       v_layerN2O_.push_back(0.0);
       v_layerNO2_.push_back(0.0);
       v_layerSO2_.push_back(0.0);
-      v_layerThickness_.push_back(v_layerThickness[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get("kgm**-3"))+ log(v_layerWaterVapor[n + 1].get("kgm**-3")))/2.0));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("kgm**-3"));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("kgm**-3"));
+      v_layerThickness_.push_back(v_layerThickness[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get<MassDensity::kg_m3>())+ log(v_layerWaterVapor[n + 1].get<MassDensity::kg_m3>()))/2.0));
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<MassDensity::kg_m3>());
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<MassDensity::kg_m3>());
     }
   } else {
     numLayer_ = 0;
@@ -211,16 +213,16 @@ AtmProfile::AtmProfile(const vector<Length> &v_layerBoundaries,
       v_layerN2O_.push_back(0.0);
       v_layerNO2_.push_back(0.0);
       v_layerSO2_.push_back(0.0);
-      v_layerThickness_.push_back(v_layerBoundaries[n+1].get("m") - v_layerBoundaries[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get("kgm**-3"))+ log(v_layerWaterVapor[n + 1].get("kgm**-3")))/2.0));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("kgm**-3"));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("kgm**-3"));
+      v_layerThickness_.push_back(v_layerBoundaries[n+1].get<Length::m>() - v_layerBoundaries[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get<MassDensity::kg_m3>())+ log(v_layerWaterVapor[n + 1].get<MassDensity::kg_m3>()))/2.0));
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<MassDensity::kg_m3>());
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<MassDensity::kg_m3>());
     }
   } else {
     numLayer_ = 0;
@@ -248,18 +250,18 @@ AtmProfile::AtmProfile(const Length &altitude,
       v_layerN2O_.push_back(0.0);
       v_layerNO2_.push_back(0.0);
       v_layerSO2_.push_back(0.0);
-      v_layerThickness_.push_back(v_layerThickness[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get("m**-3"))+ log(v_layerWaterVapor[n + 1].get("m**-3")))/2.0))* 18.0
+      v_layerThickness_.push_back(v_layerThickness[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get<NumberDensity::per_m3>())+ log(v_layerWaterVapor[n + 1].get<NumberDensity::per_m3>()))/2.0))* 18.0
 				    / (1000.0 * 6.023e23));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("m**-3") * 18.0
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("m**-3") * 18.0
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
     }
   } else {
@@ -288,18 +290,18 @@ AtmProfile::AtmProfile(const vector<Length> &v_layerBoundaries,
       v_layerN2O_.push_back(0.0);
       v_layerNO2_.push_back(0.0);
       v_layerSO2_.push_back(0.0);
-      v_layerThickness_.push_back(v_layerBoundaries[n+1].get("m") - v_layerBoundaries[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get("m**-3"))+ log(v_layerWaterVapor[n + 1].get("m**-3")))/2.0))* 18.0
+      v_layerThickness_.push_back(v_layerBoundaries[n+1].get<Length::m>() - v_layerBoundaries[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get<NumberDensity::per_m3>())+ log(v_layerWaterVapor[n + 1].get<NumberDensity::per_m3>()))/2.0))* 18.0
 				     / (1000.0 * 6.023e23));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("m**-3") * 18.0
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("m**-3") * 18.0
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
     }
   } else {
@@ -325,21 +327,21 @@ AtmProfile::AtmProfile(const Length &altitude,
   if(nL1 * 1 == nL2 && nL2 == nL3 && nL3 == nL4 && nL4 == nL5) {
     numLayer_ = nL1;
     for(size_t n = 0; n < numLayer_; n++) {
-      v_layerO3_.push_back(v_layerO3[n].get("m**-3"));
+      v_layerO3_.push_back(v_layerO3[n].get<NumberDensity::per_m3>());
       v_layerCO_.push_back(0.0);
       v_layerN2O_.push_back(0.0);
       v_layerNO2_.push_back(0.0);
       v_layerSO2_.push_back(0.0);
-      v_layerThickness_.push_back(v_layerThickness[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get("kgm**-3"))+ log(v_layerWaterVapor[n + 1].get("kgm**-3")))/2.0));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("kgm**-3"));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("kgm**-3"));
+      v_layerThickness_.push_back(v_layerThickness[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get<MassDensity::kg_m3>())+ log(v_layerWaterVapor[n + 1].get<MassDensity::kg_m3>()))/2.0));
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<MassDensity::kg_m3>());
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<MassDensity::kg_m3>());
     }
   } else {
     numLayer_ = 0;
@@ -364,23 +366,23 @@ AtmProfile::AtmProfile(const Length &altitude,
   if(nL1 + 1 == nL2 && nL2 == nL3 && nL3 == nL4 && nL4 == nL5) {
     numLayer_ = nL1;
     for(size_t n = 0; n < numLayer_; n++) {
-      v_layerO3_.push_back(v_layerO3[n].get("m**-3"));
+      v_layerO3_.push_back(v_layerO3[n].get<NumberDensity::per_m3>());
       v_layerCO_.push_back(0.0);
       v_layerN2O_.push_back(0.0);
       v_layerNO2_.push_back(0.0);
       v_layerSO2_.push_back(0.0);
-      v_layerThickness_.push_back(v_layerThickness[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get("m**-3"))+ log(v_layerWaterVapor[n + 1].get("m**-3")))/2.0))* 18.0
+      v_layerThickness_.push_back(v_layerThickness[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get<NumberDensity::per_m3>())+ log(v_layerWaterVapor[n + 1].get<NumberDensity::per_m3>()))/2.0))* 18.0
 				    / (1000.0 * 6.023e23));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("m**-3") * 18.0
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("m**-3") * 18.0
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
     }
   } else {
@@ -415,21 +417,21 @@ AtmProfile::AtmProfile(const Length &altitude,
       == nL7 && nL7 == nL8 && nL8 == nL9) {
     numLayer_ = nL1;
     for(size_t n = 0; n < numLayer_; n++) {
-      v_layerO3_.push_back(v_layerO3[n].get("m**-3"));
-      v_layerCO_.push_back(v_layerCO[n].get("m**-3"));
-      v_layerN2O_.push_back(v_layerN2O[n].get("m**-3"));
-      v_layerNO2_.push_back(v_layerNO2[n].get("m**-3"));
-      v_layerSO2_.push_back(v_layerSO2[n].get("m**-3"));
-      v_layerThickness_.push_back(v_layerThickness[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get("kgm**-3"))+ log(v_layerWaterVapor[n + 1].get("kgm**-3")))/2.0));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("kgm**-3"));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("kgm**-3"));
+      v_layerO3_.push_back(v_layerO3[n].get<NumberDensity::per_m3>());
+      v_layerCO_.push_back(v_layerCO[n].get<NumberDensity::per_m3>());
+      v_layerN2O_.push_back(v_layerN2O[n].get<NumberDensity::per_m3>());
+      v_layerNO2_.push_back(v_layerNO2[n].get<NumberDensity::per_m3>());
+      v_layerSO2_.push_back(v_layerSO2[n].get<NumberDensity::per_m3>());
+      v_layerThickness_.push_back(v_layerThickness[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back(exp((log(v_layerWaterVapor[n].get<MassDensity::kg_m3>())+ log(v_layerWaterVapor[n + 1].get<MassDensity::kg_m3>()))/2.0));
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<MassDensity::kg_m3>());
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<MassDensity::kg_m3>());
     }
   } else {
     numLayer_ = 0;
@@ -463,23 +465,23 @@ AtmProfile::AtmProfile(const Length &altitude,
       == nL7 && nL7 == nL8 && nL8 == nL9) {
     numLayer_ = nL1;
     for(size_t n = 0; n < numLayer_; n++) {
-      v_layerO3_.push_back(v_layerO3[n].get("m**-3"));
-      v_layerCO_.push_back(v_layerCO[n].get("m**-3"));
-      v_layerN2O_.push_back(v_layerN2O[n].get("m**-3"));
-      v_layerNO2_.push_back(v_layerNO2[n].get("m**-3"));
-      v_layerSO2_.push_back(v_layerSO2[n].get("m**-3"));
-      v_layerThickness_.push_back(v_layerThickness[n].get("m"));
-      v_layerTemperature_.push_back((v_layerTemperature[n].get("K") + v_layerTemperature[n+1].get("K"))/2.0);
-      v_layerTemperature0_.push_back(v_layerTemperature[n].get("K"));
-      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get("K"));
-      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get("mb"))+ log(v_layerPressure[n + 1].get("mb")))/2.0));
-      v_layerPressure0_.push_back(v_layerPressure[n].get("mb"));
-      v_layerPressure1_.push_back(v_layerPressure[n+1].get("mb"));
-      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get("m**-3"))+ log(v_layerWaterVapor[n + 1].get("m**-3")))/2.0))* 18.0
+      v_layerO3_.push_back(v_layerO3[n].get<NumberDensity::per_m3>());
+      v_layerCO_.push_back(v_layerCO[n].get<NumberDensity::per_m3>());
+      v_layerN2O_.push_back(v_layerN2O[n].get<NumberDensity::per_m3>());
+      v_layerNO2_.push_back(v_layerNO2[n].get<NumberDensity::per_m3>());
+      v_layerSO2_.push_back(v_layerSO2[n].get<NumberDensity::per_m3>());
+      v_layerThickness_.push_back(v_layerThickness[n].get<Length::m>());
+      v_layerTemperature_.push_back((v_layerTemperature[n].get<Temperature::K>() + v_layerTemperature[n+1].get<Temperature::K>())/2.0);
+      v_layerTemperature0_.push_back(v_layerTemperature[n].get<Temperature::K>());
+      v_layerTemperature1_.push_back(v_layerTemperature[n+1].get<Temperature::K>());
+      v_layerPressure_.push_back(exp((log(v_layerPressure[n].get<Pressure::mb>())+ log(v_layerPressure[n + 1].get<Pressure::mb>()))/2.0));
+      v_layerPressure0_.push_back(v_layerPressure[n].get<Pressure::mb>());
+      v_layerPressure1_.push_back(v_layerPressure[n+1].get<Pressure::mb>());
+      v_layerWaterVapor_.push_back( (exp((log(v_layerWaterVapor[n].get<NumberDensity::per_m3>())+ log(v_layerWaterVapor[n + 1].get<NumberDensity::per_m3>()))/2.0))* 18.0
 				    / (1000.0 * 6.023e23));
-      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get("m**-3") * 18.0
+      v_layerWaterVapor0_.push_back(v_layerWaterVapor[n].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
-      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get("m**-3") * 18.0
+      v_layerWaterVapor1_.push_back(v_layerWaterVapor[n+1].get<NumberDensity::per_m3>() * 18.0
           / (1000.0 * 6.023e23));
     }
   } else {
@@ -488,12 +490,27 @@ AtmProfile::AtmProfile(const Length &altitude,
   initBasicAtmosphericParameterThresholds();
 }
 
+AtmProfile::AtmProfile(const UserLevels &levels, size_t typeAtm)
+{
+  typeAtm_ = typeAtm;
+  numLayer_ = 0;
+  fractionLast_ = 1.0;
+  pressureStep_ = Pressure::from<Pressure::mb>(10.0);
+  pressureStepFactor_ = 1.2;
+  initBasicAtmosphericParameterThresholds();
+  setUserLevels(levels);
+  newBasicParam_ = true;
+}
+
 AtmProfile::AtmProfile(const AtmProfile &a)
 { //:AtmType(a.type_){
   // std::cout<<"AtmProfile copy constructor"<<endl;  COMMENTED OUT BY JUAN MAY/16/2005
   typeAtm_ = a.typeAtm_;
   groundTemperature_ = a.groundTemperature_;
   tropoLapseRate_ = a.tropoLapseRate_;
+  tropoTemperature_ = a.tropoTemperature_;
+  tropoAltitude_ = a.tropoAltitude_;
+  tropoLayer_ = a.tropoLayer_;
   groundPressure_ = a.groundPressure_;
   relativeHumidity_ = a.relativeHumidity_;
   wvScaleHeight_ = a.wvScaleHeight_;
@@ -502,7 +519,13 @@ AtmProfile::AtmProfile(const AtmProfile &a)
   altitude_ = a.altitude_;
   topAtmProfile_ = a.topAtmProfile_;
   numLayer_ = a.numLayer_;
+  fractionLast_ = a.fractionLast_;
   newBasicParam_ = a.newBasicParam_;
+  v_fixedLayerTop_ = a.v_fixedLayerTop_;
+  v_fixedLayerMerged_ = a.v_fixedLayerMerged_;
+  slidingReference_ = a.slidingReference_;
+  profileVersion_ = a.profileVersion_;
+  for(size_t q = 0; q < 4; q++) layerPartials_[q] = a.layerPartials_[q];
   v_layerThickness_.reserve(numLayer_);
   v_layerPressure_.reserve(numLayer_);
   v_layerPressure0_.reserve(numLayer_);
@@ -529,7 +552,7 @@ AtmProfile::AtmProfile(const AtmProfile &a)
     v_layerWaterVapor0_.push_back(a.v_layerWaterVapor0_[n]);
     v_layerWaterVapor1_.push_back(a.v_layerWaterVapor1_[n]);
     v_layerPressure_.push_back(a.v_layerPressure_[n]);
-    v_layerPressure0_.push_back(a.v_layerPressure1_[n]);
+    v_layerPressure0_.push_back(a.v_layerPressure0_[n]);
     v_layerPressure1_.push_back(a.v_layerPressure1_[n]);
     v_layerCO_.push_back(a.v_layerCO_[n]);
     v_layerO3_.push_back(a.v_layerO3_[n]);
@@ -561,12 +584,12 @@ void AtmProfile::setBasicAtmosphericParameterThresholds(const Length &altitudeTh
 
 void AtmProfile::initBasicAtmosphericParameterThresholds()
 {
-  altitudeThreshold_ = Length(1.0,"m");
-  groundPressureThreshold_ =  Pressure(99.,"Pa");  // DB 2014-03-06 : Choose 99 Pascal instead of 100 Pascal because the threshold must be lower than the value of delta_pressure used in getAverageDispersiveDryPathLength_GroundPressureDerivative()
-  groundTemperatureThreshold_ =  Temperature(0.3,"K");
+  altitudeThreshold_ = Length::from<Length::m>(1.0);
+  groundPressureThreshold_ =  Pressure::from<Pressure::Pa>(99.);  // DB 2014-03-06 : Choose 99 Pascal instead of 100 Pascal because the threshold must be lower than the value of delta_pressure used in getAverageDispersiveDryPathLength_GroundPressureDerivative()
+  groundTemperatureThreshold_ =  Temperature::from<Temperature::K>(0.3);
   tropoLapseRateThreshold_ = 0.01;
-  relativeHumidityThreshold_ = Humidity(100.,"%");
-  wvScaleHeightThreshold_ = Length(20.,"m");
+  relativeHumidityThreshold_ = Humidity::from<Humidity::percent>(100.);
+  wvScaleHeightThreshold_ = Length::from<Length::m>(20.);
 }
 
 bool AtmProfile::updateAtmProfile(const Length &altitude,
@@ -591,19 +614,19 @@ bool AtmProfile::updateAtmProfile(const Length &altitude,
 //   if(tropoLapseRate_ != tropoLapseRate) mkNewProfile = true; //if(mkNewProfile)cout<<"tropo lapse rate has changed"  <<endl;
 //   if(relativeHumidity_.get() != relativeHumidity.get()) mkNewProfile = true; //if(mkNewProfile)cout<<"relative humidity has changed" <<endl;
   //! all these thresholds shoudl be parametrized.
-  if(fabs(altitude_.get()-altitude.get())> altitudeThreshold_.get()) { // Length(0.1,"m").get())  {
+  if(fabs(altitude_.get()-altitude.get())> altitudeThreshold_.get()) { // Length::from<Length::m>(0.1).get())  {
     mkNewProfile = true;
     //cout<<"altitude has changed"          <<endl;
   }
-  if(fabs(groundPressure_.get()-groundPressure.get())> groundPressureThreshold_.get()) { // Pressure(100.,"Pa").get()) {
+  if(fabs(groundPressure_.get()-groundPressure.get())> groundPressureThreshold_.get()) { // Pressure::from<Pressure::Pa>(100.).get()) {
     mkNewProfile = true;
     //cout<<"ground pressure has changed"   <<endl;
   }
-  if(fabs(groundTemperature_.get()-groundTemperature.get()) > groundTemperatureThreshold_.get()) { //  Temperature(0.3,"K").get()) {
+  if(fabs(groundTemperature_.get()-groundTemperature.get()) > groundTemperatureThreshold_.get()) { //  Temperature::from<Temperature::K>(0.3).get()) {
     mkNewProfile = true;
     //cout<<"ground temperature has changed"<<endl;
   }
-  if(fabs(wvScaleHeight_.get()-wvScaleHeight.get()) > wvScaleHeightThreshold_.get()) { // Length(20.,"m").get() ) {
+  if(fabs(wvScaleHeight_.get()-wvScaleHeight.get()) > wvScaleHeightThreshold_.get()) { // Length::from<Length::m>(20.).get() ) {
     mkNewProfile = true;
     //cout<<"wv scale height has changed"   <<endl;
   }
@@ -612,7 +635,7 @@ bool AtmProfile::updateAtmProfile(const Length &altitude,
     //cout<<"tropo lapse rate has changed"  <<endl;
   }
   // we use WVR...
-  if(fabs(relativeHumidity_.get()-relativeHumidity.get())> relativeHumidityThreshold_.get()) { // Humidity(100.,"%").get()) {
+  if(fabs(relativeHumidity_.get()-relativeHumidity.get())> relativeHumidityThreshold_.get()) { // Humidity::from<Humidity::percent>(100.).get()) {
     mkNewProfile = true;
     //cout<<"relative humidity has changed" <<endl;
   }
@@ -675,7 +698,7 @@ vector<Temperature> AtmProfile::getTemperatureProfile() const
   vector<Temperature> t;
   t.reserve(v_layerTemperature_.size());
   for(size_t i = 0; i < v_layerTemperature_.size(); i++) {
-    Temperature tt(v_layerTemperature_[i], "K");
+    Temperature tt = Temperature::from<Temperature::K>(v_layerTemperature_[i]);
     t.push_back(tt);
   }
   return t;
@@ -684,10 +707,10 @@ vector<Temperature> AtmProfile::getTemperatureProfile() const
 Temperature AtmProfile::getLayerTemperature(size_t i) const
 {
   /*if(i > v_layerTemperature_.size() - 1) {
-    Temperature t(-999.0, "K");
+    Temperature t = Temperature::from<Temperature::K>(-999.0);
     return t;
   } else {
-    Temperature t(v_layerTemperature_[i], "K");
+    Temperature t = Temperature::from<Temperature::K>(v_layerTemperature_[i]);
     return t;
   }*/
   if(i > v_layerTemperature_.size() - 1) {
@@ -695,7 +718,7 @@ Temperature AtmProfile::getLayerTemperature(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return Temperature(v_layerTemperature_[i], "K");
+  return Temperature::from<Temperature::K>(v_layerTemperature_[i]);
 }
 
 Temperature AtmProfile::getLayerBottomTemperature(size_t i) const
@@ -705,7 +728,7 @@ Temperature AtmProfile::getLayerBottomTemperature(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return Temperature(v_layerTemperature0_[i], "K");
+  return Temperature::from<Temperature::K>(v_layerTemperature0_[i]);
 }
 
 Temperature AtmProfile::getLayerTopTemperature(size_t i) const
@@ -715,21 +738,23 @@ Temperature AtmProfile::getLayerTopTemperature(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return Temperature(v_layerTemperature1_[i], "K");
+  return Temperature::from<Temperature::K>(v_layerTemperature1_[i]);
 }
 
 
 void AtmProfile::setAltitude(const Length &groundaltitude)
 {
+  profileVersion_++;
+  clearLayerPartials();
 
   if (groundaltitude <= altitude_){
 
     // std::cout << "extrapolar para abajo" << std::endl;
 
-    int nextralayers = int( 0.50001+(altitude_-groundaltitude).get("m")/v_layerThickness_[0]);
+    int nextralayers = int( 0.50001+(altitude_-groundaltitude).get<Length::m>()/v_layerThickness_[0]);
     if (nextralayers == 0) {nextralayers=1;}
-    //    std::cout << "aaa=" << ( 0.50001+(altitude_-groundaltitude).get("m")/v_layerThickness_[0]) << std::endl;
-    double newThickness = (altitude_-groundaltitude).get("m") / nextralayers;
+    //    std::cout << "aaa=" << ( 0.50001+(altitude_-groundaltitude).get<Length::m>()/v_layerThickness_[0]) << std::endl;
+    double newThickness = (altitude_-groundaltitude).get<Length::m>() / nextralayers;
 
     //  std::cout << "Number of extra layers: " << nextralayers << " of thickness = " <<  newThickness << " m"  << std::endl;
     //  std::cout << "nextralayers-1 " << nextralayers-1 << std::endl;
@@ -801,7 +826,7 @@ void AtmProfile::setAltitude(const Length &groundaltitude)
 
   }else{
     //    std::cout << "extrapolar para arriba" << std::endl;
-    double extraheight = fabs(groundaltitude.get("m")-altitude_.get("m"));
+    double extraheight = fabs(groundaltitude.get<Length::m>()-altitude_.get<Length::m>());
     double cumulheight = 0.0;
 
     // std::cout << "before v_layerTemperature_.size()=" << v_layerTemperature_.size() << std::endl;
@@ -862,11 +887,12 @@ void AtmProfile::setAltitude(const Length &groundaltitude)
   groundPressure_ = v_layerPressure0_[0]*100.0;  // default units for Pressure are Pascals
 
   /*
-  const Temperature Tdif(((true_antenna_altitude.get("km")-altitude.get("km"))*tropoLapseRate),"K");
+  const Temperature Tdif =
+    Temperature::from<Temperature::K>((true_antenna_altitude.get<Length::km>()-altitude.get<Length::km>())*tropoLapseRate);
   groundTemperature_ = groundTemperature+Tdif;
-  groundPressure_ = groundPressure * exp(-0.0341695 * pow((6.371/(6.371+altitude.get("km"))),2.0)
-					 * (true_antenna_altitude.get("m")-altitude.get("m"))
-					 / ((groundTemperature.get("K")+Tdif.get("K"))/2.0) );
+  groundPressure_ = groundPressure * exp(-0.0341695 * pow((6.371/(6.371+altitude.get<Length::km>())),2.0)
+					 * (true_antenna_altitude.get<Length::m>()-altitude.get<Length::m>())
+					 / ((groundTemperature.get<Temperature::K>()+Tdif.get<Temperature::K>())/2.0) );
   */
 
 
@@ -875,8 +901,10 @@ void AtmProfile::setAltitude(const Length &groundaltitude)
 
 void AtmProfile::setLayerTemperature(size_t i, const Temperature &layerTemperature)
 {
+  profileVersion_++;
+  clearLayerPartials();
   if(i < v_layerTemperature_.size()) {
-    v_layerTemperature_[i] = layerTemperature.get("K");
+    v_layerTemperature_[i] = layerTemperature.get<Temperature::K>();
   }
 }
 
@@ -885,7 +913,7 @@ vector<Length> AtmProfile::getThicknessProfile() const
   vector<Length> l;
   l.reserve(v_layerThickness_.size());
   for(size_t i = 0; i < v_layerThickness_.size(); i++) {
-    Length ll(v_layerThickness_[i], "m");
+    Length ll = Length::from<Length::m>(v_layerThickness_[i]);
     l.push_back(ll);
   }
   return l;
@@ -894,10 +922,10 @@ vector<Length> AtmProfile::getThicknessProfile() const
 Length AtmProfile::getLayerThickness(size_t i) const
 {
   /*if(i > v_layerThickness_.size() - 1) {
-    Length l(-999.0, "m");
+    Length l = Length::from<Length::m>(-999.0);
     return l;
   } else {
-    Length l(v_layerThickness_[i], "m");
+    Length l = Length::from<Length::m>(v_layerThickness_[i]);
     return l;
   }*/
   if(i > v_layerThickness_.size() - 1) {
@@ -905,7 +933,7 @@ Length AtmProfile::getLayerThickness(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return Length(v_layerThickness_[i], "m");
+  return Length::from<Length::m>(v_layerThickness_[i]);
 }
 
 Length AtmProfile::getLayerBottomHeightAboveGround(size_t i) const
@@ -919,7 +947,7 @@ Length AtmProfile::getLayerBottomHeightAboveGround(size_t i) const
   for(size_t j = 0; j < i; j++) {
     h = h + v_layerThickness_[j];
   }
-  return Length(h, "m");
+  return Length::from<Length::m>(h);
 }
 
 Length AtmProfile::getLayerTopHeightAboveGround(size_t i) const
@@ -933,7 +961,7 @@ Length AtmProfile::getLayerTopHeightAboveGround(size_t i) const
   for(size_t j = 0; j < i+1; j++) {
     h = h + v_layerThickness_[j];
   }
-  return Length(h, "m");
+  return Length::from<Length::m>(h);
 }
 
 Length AtmProfile::getLayerBottomHeightAboveSeaLevel(size_t i) const
@@ -943,11 +971,11 @@ Length AtmProfile::getLayerBottomHeightAboveSeaLevel(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  double h=altitude_.get("m");
+  double h=altitude_.get<Length::m>();
   for(size_t j = 0; j < i; j++) {
     h = h + v_layerThickness_[j];
   }
-  return Length(h, "m");
+  return Length::from<Length::m>(h);
 }
 
 Length AtmProfile::getLayerTopHeightAboveSeaLevel(size_t i) const
@@ -957,28 +985,30 @@ Length AtmProfile::getLayerTopHeightAboveSeaLevel(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  double h=altitude_.get("m");
+  double h=altitude_.get<Length::m>();
   for(size_t j = 0; j < i+1; j++) {
     h = h + v_layerThickness_[j];
   }
-  return Length(h, "m");
+  return Length::from<Length::m>(h);
 }
 
 
 void AtmProfile::setLayerThickness(size_t i, const Length &layerThickness)
 {
+  profileVersion_++;
+  clearLayerPartials();
   if(i < v_layerThickness_.size()) {
-    v_layerThickness_[i] = layerThickness.get("m");
+    v_layerThickness_[i] = layerThickness.get<Length::m>();
   }
 }
 
 MassDensity AtmProfile::getLayerWaterVaporMassDensity(size_t i) const
 {
   /*if(i > v_layerWaterVapor_.size() - 1) {
-    MassDensity m(-999.0, "kgm**-3");
+    MassDensity m = MassDensity::from<MassDensity::kg_m3>(-999.0);
     return m;
   } else {
-    MassDensity m(v_layerWaterVapor_[i], "kgm**-3");
+    MassDensity m = MassDensity::from<MassDensity::kg_m3>(v_layerWaterVapor_[i]);
     return m;
   }*/
   if(i > v_layerWaterVapor_.size() - 1) {
@@ -986,7 +1016,7 @@ MassDensity AtmProfile::getLayerWaterVaporMassDensity(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return MassDensity(v_layerWaterVapor_[i], "kgm**-3");
+  return MassDensity::from<MassDensity::kg_m3>(v_layerWaterVapor_[i]);
 }
 MassDensity AtmProfile::getLayerBottomWaterVaporMassDensity(size_t i) const
 {
@@ -995,7 +1025,7 @@ MassDensity AtmProfile::getLayerBottomWaterVaporMassDensity(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return MassDensity(v_layerWaterVapor0_[i], "kgm**-3");
+  return MassDensity::from<MassDensity::kg_m3>(v_layerWaterVapor0_[i]);
 }
 MassDensity AtmProfile::getLayerTopWaterVaporMassDensity(size_t i) const
 {
@@ -1004,17 +1034,16 @@ MassDensity AtmProfile::getLayerTopWaterVaporMassDensity(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return MassDensity(v_layerWaterVapor1_[i], "kgm**-3");
+  return MassDensity::from<MassDensity::kg_m3>(v_layerWaterVapor1_[i]);
 }
 
 NumberDensity AtmProfile::getLayerWaterVaporNumberDensity(size_t i) const
 {
   /*if(i > v_layerWaterVapor_.size() - 1) {
-    NumberDensity m(-999.0, "m**-3");
+    NumberDensity m = NumberDensity::from<NumberDensity::per_m3>(-999.0);
     return m;
   } else {
-    NumberDensity
-        m(v_layerWaterVapor_[i] * 6.023e23 * 1000.0 / 18.0, "m**-3");
+    NumberDensity m = NumberDensity::from<NumberDensity::per_m3>(v_layerWaterVapor_[i] * 6.023e23 * 1000.0 / 18.0);
     return m;
   }*/
   if(i > v_layerWaterVapor_.size() - 1) {
@@ -1022,7 +1051,7 @@ NumberDensity AtmProfile::getLayerWaterVaporNumberDensity(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return NumberDensity(v_layerWaterVapor_[i] * 6.023e23 * 1000.0 / 18.0, "m**-3");
+  return NumberDensity::from<NumberDensity::per_m3>(v_layerWaterVapor_[i] * 6.023e23 * 1000.0 / 18.0);
 }
 NumberDensity AtmProfile::getLayerBottomWaterVaporNumberDensity(size_t i) const
 {
@@ -1031,7 +1060,7 @@ NumberDensity AtmProfile::getLayerBottomWaterVaporNumberDensity(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return NumberDensity(v_layerWaterVapor0_[i] * 6.023e23 * 1000.0 / 18.0, "m**-3");
+  return NumberDensity::from<NumberDensity::per_m3>(v_layerWaterVapor0_[i] * 6.023e23 * 1000.0 / 18.0);
 }
 NumberDensity AtmProfile::getLayerTopWaterVaporNumberDensity(size_t i) const
 {
@@ -1040,20 +1069,24 @@ NumberDensity AtmProfile::getLayerTopWaterVaporNumberDensity(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return NumberDensity(v_layerWaterVapor1_[i] * 6.023e23 * 1000.0 / 18.0, "m**-3");
+  return NumberDensity::from<NumberDensity::per_m3>(v_layerWaterVapor1_[i] * 6.023e23 * 1000.0 / 18.0);
 }
 
 void AtmProfile::setLayerWaterVaporMassDensity(size_t i, const MassDensity &layerWaterVapor)
 {
+  profileVersion_++;
+  clearLayerPartials();
   if(i <= v_layerWaterVapor_.size() - 1) {
-    v_layerWaterVapor_[i] = layerWaterVapor.get("kgm**-3");
+    v_layerWaterVapor_[i] = layerWaterVapor.get<MassDensity::kg_m3>();
   }
 }
 
 void AtmProfile::setLayerWaterVaporNumberDensity(size_t i, const NumberDensity &layerWaterVapor)
 {
+  profileVersion_++;
+  clearLayerPartials();
   if(i <= v_layerWaterVapor_.size() - 1) {
-    v_layerWaterVapor_[i] = layerWaterVapor.get("m**-3") * 18.0 / (6.023e23 * 1000.0);
+    v_layerWaterVapor_[i] = layerWaterVapor.get<NumberDensity::per_m3>() * 18.0 / (6.023e23 * 1000.0);
   }
 }
 
@@ -1062,7 +1095,7 @@ vector<Pressure> AtmProfile::getPressureProfile() const
   vector<Pressure> p;
   p.reserve(v_layerPressure_.size());
   for(size_t i = 0; i < v_layerPressure_.size(); i++) {
-    Pressure pp(v_layerPressure_[i], "mb");
+    Pressure pp = Pressure::from<Pressure::mb>(v_layerPressure_[i]);
     p.push_back(pp);
   }
   return p;
@@ -1071,10 +1104,10 @@ vector<Pressure> AtmProfile::getPressureProfile() const
 Pressure AtmProfile::getLayerPressure(size_t i) const
 {
   /*if(i > v_layerPressure_.size() - 1) {
-    Pressure p(-999.0, "mb");
+    Pressure p = Pressure::from<Pressure::mb>(-999.0);
     return p;
   } else {
-    Pressure p(v_layerPressure_[i], "mb");
+    Pressure p = Pressure::from<Pressure::mb>(v_layerPressure_[i]);
     return p;
   }*/
   if(i > v_layerPressure_.size() - 1) {
@@ -1082,7 +1115,7 @@ Pressure AtmProfile::getLayerPressure(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return Pressure(v_layerPressure_[i], "mb");
+  return Pressure::from<Pressure::mb>(v_layerPressure_[i]);
 }
 
 Pressure AtmProfile::getLayerBottomPressure(size_t i) const
@@ -1092,7 +1125,7 @@ Pressure AtmProfile::getLayerBottomPressure(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return Pressure(v_layerPressure0_[i], "mb");
+  return Pressure::from<Pressure::mb>(v_layerPressure0_[i]);
 }
 
 Pressure AtmProfile::getLayerTopPressure(size_t i) const
@@ -1102,10 +1135,318 @@ Pressure AtmProfile::getLayerTopPressure(size_t i) const
     oss << "Not a valid layer: " << i;
     throw AtmException(ATM_EXCEPTION_ARGS(oss.str().c_str()));
   }
-  return Pressure(v_layerPressure1_[i], "mb");
+  return Pressure::from<Pressure::mb>(v_layerPressure1_[i]);
 }
 
 
+bool AtmProfile::setFixedLayerGrid(const vector<Length> &v_layerTop)
+{
+  vector<double> v_top;
+  v_top.reserve(v_layerTop.size());
+  for(size_t n = 0; n < v_layerTop.size(); n++) {
+    v_top.push_back(v_layerTop[n].get<Length::m>());
+    if(v_top[n] <= (n == 0 ? 0.0 : v_top[n - 1])) {
+      std::cout << " AtmProfile: ERROR: the layer tops of a fixed grid must be strictly increasing heights above ground"
+          << std::endl;
+      return false;
+    }
+  }
+  if(v_top.empty()) {
+    std::cout << " AtmProfile: ERROR: a fixed layer grid needs at least one layer" << std::endl;
+    return false;
+  }
+  v_fixedLayerTop_ = v_top;
+  v_fixedLayerMerged_.assign(v_top.size(), 1);
+  numLayer_ = mkAtmProfile();
+  newBasicParam_ = true;
+  return true;
+}
+
+bool AtmProfile::fixLayerGrid()
+{
+  vector<Length> v_layerTop;
+  v_layerTop.reserve(numLayer_);
+  double h = 0.0;
+  for(size_t n = 0; n < numLayer_; n++) {
+    h = h + v_layerThickness_[n];
+    v_layerTop.push_back(Length::from<Length::m>(h));
+  }
+  return setFixedLayerGrid(v_layerTop);
+}
+
+void AtmProfile::releaseLayerGrid()
+{
+  if(v_fixedLayerTop_.empty()) return;
+  v_fixedLayerTop_.clear();
+  v_fixedLayerMerged_.clear();
+  numLayer_ = mkAtmProfile();
+  newBasicParam_ = true;
+}
+
+bool AtmProfile::mergeLayers(const vector<size_t> &v_numMerged)
+{
+  size_t sum = 0;
+  for(size_t n = 0; n < v_numMerged.size(); n++) {
+    if(v_numMerged[n] == 0) {
+      std::cout << " AtmProfile: ERROR: a group of merged layers must not be empty" << std::endl;
+      return false;
+    }
+    sum = sum + v_numMerged[n];
+  }
+  if(sum != numLayer_ || numLayer_ == 0) {
+    std::cout << " AtmProfile: ERROR: the groups of merged layers do not cover the " << numLayer_ << " layers"
+        << std::endl;
+    return false;
+  }
+
+  if(v_fixedLayerTop_.empty()) {
+    double h = 0.0;
+    v_fixedLayerTop_.resize(numLayer_);
+    for(size_t n = 0; n < numLayer_; n++) {
+      h = h + v_layerThickness_[n];
+      v_fixedLayerTop_[n] = h;
+    }
+    v_fixedLayerMerged_.assign(numLayer_, 1);
+  }
+
+  // the groups are given in layers of the profile, which may themselves be merged pinned layers
+  vector<size_t> v_merged;
+  v_merged.reserve(v_numMerged.size());
+  size_t n = 0;
+  for(size_t g = 0; g < v_numMerged.size(); g++) {
+    size_t numPinned = 0;
+    for(size_t m = 0; m < v_numMerged[g]; m++, n++) {
+      numPinned = numPinned + v_fixedLayerMerged_[n];
+    }
+    v_merged.push_back(numPinned);
+  }
+  v_fixedLayerMerged_ = v_merged;
+  numLayer_ = mkAtmProfile();
+  newBasicParam_ = true;
+  return true;
+}
+
+void AtmProfile::startAltitudeSliding()
+{
+  slidingReference_.reset();
+  std::shared_ptr<AtmProfile> reference(new AtmProfile());
+  *reference = *this;
+  slidingReference_ = reference;
+}
+
+bool AtmProfile::setObserverAltitude(const Length &altitude)
+{
+  size_t firstLayer;
+  double weight;
+  return mkObserverLayers(altitude, firstLayer, weight);
+}
+
+void AtmProfile::stopAltitudeSliding()
+{
+  if(!slidingReference_) return;
+  size_t firstLayer;
+  double weight;
+  mkObserverLayers(slidingReference_->altitude_, firstLayer, weight);
+  slidingReference_.reset();
+}
+
+double AtmProfile::interpolateLayers(double lower, double upper, double weight)
+{
+  if(weight == 0.0) return lower;
+  if(lower > 0.0 && upper > 0.0) return lower * pow(upper / lower, weight);
+  return lower + weight * (upper - lower);
+}
+
+bool AtmProfile::mkObserverLayers(const Length &altitude, size_t &firstLayer, double &weight)
+{
+  if(!slidingReference_) {
+    std::cout << " AtmProfile: ERROR: the altitude sliding mode is not on" << std::endl;
+    return false;
+  }
+  const AtmProfile &r = *slidingReference_;
+
+  // layer of the reference profile in which the observer is
+  double height = altitude.get<Length::m>() - r.altitude_.get<Length::m>();
+  double bottom = 0.0;
+  size_t k = 0;
+  while(k < r.numLayer_ && bottom + r.v_layerThickness_[k] <= height) {
+    bottom = bottom + r.v_layerThickness_[k];
+    k++;
+  }
+  if(height < 0.0 || k == r.numLayer_) {
+    std::cout << " AtmProfile: ERROR: the observer altitude " << altitude.get<Length::m>()
+        << " m is out of the reference profile" << std::endl;
+    return false;
+  }
+  clearLayerPartials();
+
+  size_t numLayer = r.numLayer_ - k;
+  v_layerThickness_.assign(r.v_layerThickness_.begin() + k, r.v_layerThickness_.begin() + r.numLayer_);
+  v_layerTemperature_.assign(r.v_layerTemperature_.begin() + k, r.v_layerTemperature_.begin() + r.numLayer_);
+  v_layerTemperature0_.assign(r.v_layerTemperature0_.begin() + k, r.v_layerTemperature0_.begin() + r.numLayer_);
+  v_layerTemperature1_.assign(r.v_layerTemperature1_.begin() + k, r.v_layerTemperature1_.begin() + r.numLayer_);
+  v_layerWaterVapor_.assign(r.v_layerWaterVapor_.begin() + k, r.v_layerWaterVapor_.begin() + r.numLayer_);
+  v_layerWaterVapor0_.assign(r.v_layerWaterVapor0_.begin() + k, r.v_layerWaterVapor0_.begin() + r.numLayer_);
+  v_layerWaterVapor1_.assign(r.v_layerWaterVapor1_.begin() + k, r.v_layerWaterVapor1_.begin() + r.numLayer_);
+  v_layerPressure_.assign(r.v_layerPressure_.begin() + k, r.v_layerPressure_.begin() + r.numLayer_);
+  v_layerPressure0_.assign(r.v_layerPressure0_.begin() + k, r.v_layerPressure0_.begin() + r.numLayer_);
+  v_layerPressure1_.assign(r.v_layerPressure1_.begin() + k, r.v_layerPressure1_.begin() + r.numLayer_);
+  v_layerCO_.assign(r.v_layerCO_.begin() + k, r.v_layerCO_.begin() + r.numLayer_);
+  v_layerO3_.assign(r.v_layerO3_.begin() + k, r.v_layerO3_.begin() + r.numLayer_);
+  v_layerN2O_.assign(r.v_layerN2O_.begin() + k, r.v_layerN2O_.begin() + r.numLayer_);
+  v_layerNO2_.assign(r.v_layerNO2_.begin() + k, r.v_layerNO2_.begin() + r.numLayer_);
+  v_layerSO2_.assign(r.v_layerSO2_.begin() + k, r.v_layerSO2_.begin() + r.numLayer_);
+
+  // the cut layer: its bottom values at the observer, its mean values at its new middle, between the
+  // middles of the layer and of the layer above
+  double cut = height - bottom;
+  double fraction = cut / r.v_layerThickness_[k];
+  double w = (k + 1 < r.numLayer_) ? cut / (r.v_layerThickness_[k] + r.v_layerThickness_[k + 1]) : 0.0;
+  v_layerThickness_[0] = r.v_layerThickness_[k] - cut;
+  v_layerTemperature0_[0] = r.v_layerTemperature0_[k] + fraction * (r.v_layerTemperature1_[k] - r.v_layerTemperature0_[k]);
+  v_layerPressure0_[0] = interpolateLayers(r.v_layerPressure0_[k], r.v_layerPressure1_[k], fraction);
+  v_layerWaterVapor0_[0] = interpolateLayers(r.v_layerWaterVapor0_[k], r.v_layerWaterVapor1_[k], fraction);
+  if(w > 0.0) {
+    v_layerTemperature_[0] = r.v_layerTemperature_[k] + w * (r.v_layerTemperature_[k + 1] - r.v_layerTemperature_[k]);
+    v_layerPressure_[0] = interpolateLayers(r.v_layerPressure_[k], r.v_layerPressure_[k + 1], w);
+    v_layerWaterVapor_[0] = interpolateLayers(r.v_layerWaterVapor_[k], r.v_layerWaterVapor_[k + 1], w);
+    v_layerCO_[0] = interpolateLayers(r.v_layerCO_[k], r.v_layerCO_[k + 1], w);
+    v_layerO3_[0] = interpolateLayers(r.v_layerO3_[k], r.v_layerO3_[k + 1], w);
+    v_layerN2O_[0] = interpolateLayers(r.v_layerN2O_[k], r.v_layerN2O_[k + 1], w);
+    v_layerNO2_[0] = interpolateLayers(r.v_layerNO2_[k], r.v_layerNO2_[k + 1], w);
+    v_layerSO2_[0] = interpolateLayers(r.v_layerSO2_[k], r.v_layerSO2_[k + 1], w);
+  }
+
+  altitude_ = altitude;
+  if(k == 0 && cut == 0.0) {
+    groundTemperature_ = r.groundTemperature_;
+    groundPressure_ = r.groundPressure_;
+  } else {
+    groundTemperature_ = Temperature::from<Temperature::K>(v_layerTemperature0_[0]);
+    groundPressure_ = Pressure::from<Pressure::mb>(v_layerPressure0_[0]);
+  }
+  tropoLayer_ = r.tropoLayer_ > k ? r.tropoLayer_ - k : 0;
+  numLayer_ = numLayer;
+  profileVersion_++;
+  firstLayer = k;
+  weight = w;
+  return true;
+}
+
+string AtmProfile::checkUserLevels(const UserLevels &levels)
+{
+  std::ostringstream problem;
+  if(levels.numLevel < 2) {
+    problem << "fewer than 2 levels";
+    return problem.str();
+  }
+  if(!levels.altitude || !levels.pressure || !levels.temperature || !levels.waterVapor) {
+    problem << "missing altitude, pressure, temperature or water vapor array";
+    return problem.str();
+  }
+  const double *gas[] = { levels.o3, levels.co, levels.n2o, levels.no2, levels.so2 };
+  const char *gasName[] = { "O3", "CO", "N2O", "NO2", "SO2" };
+  for(size_t n = 0; n < levels.numLevel; n++) {
+    double z = levels.altitude[n], p = levels.pressure[n], t = levels.temperature[n], w = levels.waterVapor[n];
+    if(!std::isfinite(z) || !std::isfinite(p) || !std::isfinite(t) || !std::isfinite(w)) {
+      problem << "level " << n << ": value not finite";
+    } else if(p <= 0.0 || t <= 0.0 || w < 0.0) {
+      problem << "level " << n << ": pressure or temperature not positive, or negative water vapor";
+    } else if(n > 0 && z <= levels.altitude[n - 1]) {
+      problem << "level " << n << ": altitude not above that of the level below";
+    } else if(n > 0 && p > levels.pressure[n - 1]) {
+      problem << "level " << n << ": pressure higher than that of the level below";
+    } else {
+      for(size_t g = 0; g < 5; g++) {
+        if(gas[g] && !(gas[g][n] >= 0.0 && std::isfinite(gas[g][n]))) {
+          problem << "level " << n << ": " << gasName[g] << " density negative or not finite";
+          break;
+        }
+      }
+    }
+    if(problem.tellp() > 0) return problem.str();
+  }
+  return "";
+}
+
+bool AtmProfile::setUserLevels(const UserLevels &levels)
+{
+  string problem = checkUserLevels(levels);
+  if(!problem.empty()) {
+    std::cout << " AtmProfile: ERROR: invalid user levels: " << problem << std::endl;
+    return false;
+  }
+  slidingReference_.reset();
+  v_fixedLayerTop_.clear();
+  v_fixedLayerMerged_.clear();
+  clearLayerPartials();
+
+  size_t numLayer = levels.numLevel - 1;
+  const double *z = levels.altitude, *p = levels.pressure, *t = levels.temperature, *w = levels.waterVapor;
+  v_layerThickness_.resize(numLayer);
+  v_layerTemperature_.resize(numLayer);
+  v_layerTemperature0_.resize(numLayer);
+  v_layerTemperature1_.resize(numLayer);
+  v_layerPressure_.resize(numLayer);
+  v_layerPressure0_.resize(numLayer);
+  v_layerPressure1_.resize(numLayer);
+  v_layerWaterVapor_.resize(numLayer);
+  v_layerWaterVapor0_.resize(numLayer);
+  v_layerWaterVapor1_.resize(numLayer);
+  v_layerO3_.resize(numLayer);
+  v_layerCO_.resize(numLayer);
+  v_layerN2O_.resize(numLayer);
+  v_layerNO2_.resize(numLayer);
+  v_layerSO2_.resize(numLayer);
+  for(size_t n = 0; n < numLayer; n++) {
+    v_layerThickness_[n] = z[n + 1] - z[n];
+    v_layerTemperature_[n] = (t[n] + t[n + 1]) / 2.0;
+    v_layerTemperature0_[n] = t[n];
+    v_layerTemperature1_[n] = t[n + 1];
+    v_layerPressure_[n] = sqrt(p[n] * p[n + 1]) * 0.01; // Pa -> mb
+    v_layerPressure0_[n] = p[n] * 0.01;
+    v_layerPressure1_[n] = p[n + 1] * 0.01;
+    v_layerWaterVapor_[n] = sqrt(w[n] * w[n + 1]);
+    v_layerWaterVapor0_[n] = w[n];
+    v_layerWaterVapor1_[n] = w[n + 1];
+  }
+
+  // minor gases: the reference atmosphere at the layer middles for those which are not given
+  if(!levels.o3 || !levels.co || !levels.n2o || !levels.no2 || !levels.so2) {
+    v_workAltitude_.resize(numLayer);
+    for(size_t n = 0; n < numLayer; n++) v_workAltitude_[n] = (z[n] + z[n + 1]) * 0.5e-3;
+    getMinorGasDensities(typeAtm_, numLayer, &v_workAltitude_[0], &v_layerO3_[0], &v_layerCO_[0],
+                         &v_layerN2O_[0], &v_layerNO2_[0], &v_layerSO2_[0]);
+  }
+  const double *gas[] = { levels.o3, levels.co, levels.n2o, levels.no2, levels.so2 };
+  vector<double> *v_gas[] = { &v_layerO3_, &v_layerCO_, &v_layerN2O_, &v_layerNO2_, &v_layerSO2_ };
+  for(size_t g = 0; g < 5; g++) {
+    if(!gas[g]) continue;
+    for(size_t n = 0; n < numLayer; n++) (*v_gas[g])[n] = sqrt(gas[g][n] * gas[g][n + 1]);
+  }
+
+  // basic parameters describing the levels: the tropopause is taken at the coldest level below 20 km
+  size_t tropoLevel = 0;
+  for(size_t n = 1; n < levels.numLevel && z[n] - z[0] <= 20000.0; n++) {
+    if(t[n] < t[tropoLevel]) tropoLevel = n;
+  }
+  altitude_ = Length::from<Length::m>(z[0]);
+  topAtmProfile_ = Length::from<Length::m>(z[numLayer]);
+  groundPressure_ = Pressure::from<Pressure::Pa>(p[0]);
+  groundTemperature_ = Temperature::from<Temperature::K>(t[0]);
+  tropoLayer_ = std::min(tropoLevel, numLayer - 1);
+  tropoAltitude_ = Length::from<Length::m>(z[tropoLevel]);
+  tropoTemperature_ = Temperature::from<Temperature::K>(t[tropoLevel]);
+  tropoLapseRate_ = tropoLevel == 0 ? 0.0 : (t[tropoLevel] - t[0]) / ((z[tropoLevel] - z[0]) * 1e-3);
+  numLayer_ = numLayer;
+  profileVersion_++;
+  relativeHumidity_ = rwat_inv(groundTemperature_, MassDensity::from<MassDensity::kg_m3>(w[0]), groundPressure_);
+  // scale height of an exponential distribution with the same ground density and column
+  wvScaleHeight_ = w[0] > 0.0 ? Length::from<Length::m>(getGroundWH2O().get<Length::mm>() / w[0]) : Length::from<Length::km>(2.0);
+  newBasicParam_ = true;
+  return true;
+}
+
 Length AtmProfile::getGroundWH2O() const
 {
   double wm = 0;
@@ -1119,27 +1460,47 @@ Length AtmProfile::getGroundWH2O() const
 
 MassDensity AtmProfile::rwat(const Temperature &tt, const Humidity &rh, const Pressure &pp) const
 {
-  double t = tt.get("K");
-  double p = pp.get("mb");
-  double u = rh.get("%");
+  double t = tt.get<Temperature::K>();
+  double p = pp.get<Pressure::mb>();
+  double u = rh.get<Humidity::percent>();
   double e, es, rwat0;
 
   if(p <= 0 || t <= 0 || u <= 0) {
-    return MassDensity(0.0, "gm**-3");
+    return MassDensity::from<MassDensity::g_m3>(0.0);
   } else {
     es = 6.105 * exp(25.22 / t * (t - 273.0) - 5.31 * log(t / 273.0));
     e = 1.0 - (1.0 - u / 100.0) * es / p;
     e = es * u / 100.0 / e;
     rwat0 = e * 216.502 / t; //(en g/m*3)
   }
-  return MassDensity(rwat0, "gm**-3");
+  return MassDensity::from<MassDensity::g_m3>(rwat0);
+}
+
+void AtmProfile::rwatPartials(double t, double u, double p, double *partials) const
+{
+  partials[0] = 0.0;
+  partials[1] = 0.0;
+  partials[2] = 0.0;
+  if(p <= 0 || t <= 0) return;
+  if(u < 0) u = 0.0; // derivative with respect to u taken on the side of the humid air
+
+  double es = 6.105 * exp(25.22 / t * (t - 273.0) - 5.31 * log(t / 273.0));
+  double des = es * (25.22 * 273.0 / (t * t) - 5.31 / t);
+  double d = 1.0 - (1.0 - u / 100.0) * es / p;
+  double e = es * u / 100.0 / d;
+  double dep = -e * (1.0 - u / 100.0) * es / (p * p) / d;
+  double det = e * des / es + e * (1.0 - u / 100.0) * des / p / d;
+  double deu = (es / 100.0 - e * es / (100.0 * p)) / d;
+  partials[0] = dep * 216.502 / t;
+  partials[1] = det * 216.502 / t - e * 216.502 / (t * t);
+  partials[2] = deu * 216.502 / t;
 }
 
 Humidity AtmProfile::rwat_inv(const Temperature &tt, const MassDensity &dd, const Pressure &pp) const
 {
-  double p = pp.get("mb");
-  double t = tt.get("K");
-  double r = dd.get("gm**-3");
+  double p = pp.get<Pressure::mb>();
+  double t = tt.get<Temperature::K>();
+  double r = dd.get<MassDensity::g_m3>();
   double es, e, rinv;
 
   if(p <= 0 || t <= 0 || r <= 0) {
@@ -1150,28 +1511,45 @@ Humidity AtmProfile::rwat_inv(const Temperature &tt, const MassDensity &dd, cons
     rinv = 100 * (e * (p - es) / (es * (p - e)));
     if(rinv < 0 && p < 3) rinv = 0.0;
   }
-  return Humidity(rinv, "%");
+  return Humidity::from<Humidity::percent>(rinv);
 }
 
-vector<NumberDensity> AtmProfile::st76(const Length &h, size_t tip) const
-{
-  size_t i1, i2, i3, i_layer;
-  double x1, x2, x3, d;
-  vector<NumberDensity> minorden;
-  NumberDensity o3den, n2oden, coden, no2den, so2den;
-  static const double avogad = 6.022045E+23;
-  static const double airmwt = 28.964;
-  //    static const double h2omwt=18.015;
-  double ha = h.get("km");
-
+namespace {
 
-  static const double
-      alt[50] = { 0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0,
+const double st76Alt[50] = { 0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0,
 		  13.0, 14.0, 15.0, 16.0, 17.0, 18.0, 19.0, 20.0, 21.0, 22.0, 23.0,
 		  24.0, 25.0, 27.5, 30.0, 32.5, 35.0, 37.5, 40.0, 42.5, 45.0, 47.5,
 		  50.0, 55.0, 60.0, 65.0, 70.0, 75.0, 80.0, 85.0, 90.0, 95.0, 100.0,
 		  105.0, 110.0, 115.0, 120.0 };     // REFERENCE LEVELS IN KM
 
+/** Quadratic through three points, a+b*x+c*x**2, with the arithmetic of AtmProfile::poli2() */
+void mkPoli2Coefficients(double x1, double x2, double x3, double y1, double y2, double y3, double *abc)
+{
+  double a, b, c;
+
+  c = (y3 - y2) * (x2 - x1) - (y2 - y1) * (x3 - x2);
+  b = (x2 - x1) * (x3 * x3 - x2 * x2) - (x2 * x2 - x1 * x1) * (x3 - x2);
+  c = c / b;
+  b = (y2 - y1) - c * (x2 * x2 - x1 * x1);
+  b = b / (x2 - x1);
+  a = y1 - c * x1 * x1 - b * x1;
+
+  abc[0] = a;
+  abc[1] = b;
+  abc[2] = c;
+}
+
+/** Interpolation coefficients of the reference atmospheres used for the minor gases: for every type of
+ *  atmosphere and every segment (index of the first reference level above the altitude), the quadratics
+ *  through the three nearest reference levels of the air density, O3, N2O, CO, NO2 and SO2 */
+struct St76Coefficients
+{
+  double coef[6][50][6][3]; //!< [type][segment][density, O3, N2O, CO, NO2, SO2][a, b, c] (h in km)
+  St76Coefficients();
+};
+
+St76Coefficients::St76Coefficients()
+{
   static const double
       ozone[6][50] = { { 2.869E-02, 3.150E-02, 3.342E-02, 3.504E-02, 3.561E-02, 3.767E-02, 3.989E-02, 4.223E-02,
 			 4.471E-02, 5.000E-02, 5.595E-02, 6.613E-02, 7.815E-02, 9.289E-02, 1.050E-01, 1.256E-01,
@@ -1370,124 +1748,133 @@ vector<NumberDensity> AtmProfile::st76(const Length &h, size_t tip) const
 				 2.15E-04,  2.02E-04,  1.92E-04,  1.83E-04,  1.76E-04,
 				 1.70E-04,  1.64E-04,  1.59E-04,  1.55E-04,  1.51E-04};
 
- //   --------------------------------------------[ altitude for interpolation ]
-
-  if((ha < 0.0) || (ha > 120.0)) {
-
-    o3den = NumberDensity(0.0, "m**-3");
-    n2oden = NumberDensity(0.0, "m**-3");
-    coden = NumberDensity(0.0, "m**-3");
-    no2den = NumberDensity(0.0, "m**-3");
-    so2den = NumberDensity(0.0, "m**-3");
-
-  } else {
-
-    i1 = 0; i2 = 0; i3 = 0;
-    x1 = 0.0; x2 = 0.0; x3 = 0.0;
-
-    for(i_layer = 0; i_layer < 50; i_layer++) {
-
-      if(ha < alt[i_layer]) {
-
-        if(i_layer == 49) {
-
-          i1 = i_layer - 2; i2 = i_layer - 1; i3 = i_layer;
-
-        } else {
-
-          if(i_layer == 0) {
-
-            i1 = i_layer; i2 = i_layer + 1; i3 = i_layer + 2;
-
-          } else {
-
-            i1 = i_layer - 1; i2 = i_layer; i3 = i_layer + 1;
-
-          }
-
-        }
-
-        x1 = alt[i1]; x2 = alt[i2]; x3 = alt[i3];
-        goto calc;
+  for(size_t tip = 0; tip < 6; tip++) {
+    for(size_t i_layer = 0; i_layer < 50; i_layer++) {
+      size_t i1, i2, i3;
+      if(i_layer == 49) {
+        i1 = i_layer - 2; i2 = i_layer - 1; i3 = i_layer;
+      } else if(i_layer == 0) {
+        i1 = i_layer; i2 = i_layer + 1; i3 = i_layer + 2;
+      } else {
+        i1 = i_layer - 1; i2 = i_layer; i3 = i_layer + 1;
       }
+      double x1 = st76Alt[i1], x2 = st76Alt[i2], x3 = st76Alt[i3];
+      double (*c)[3] = coef[tip][i_layer];
+      mkPoli2Coefficients(x1, x2, x3, den[tip][i1], den[tip][i2], den[tip][i3], c[0]);
+      mkPoli2Coefficients(x1, x2, x3, ozone[tip][i1], ozone[tip][i2], ozone[tip][i3], c[1]);
+      mkPoli2Coefficients(x1, x2, x3, n2o[tip][i1], n2o[tip][i2], n2o[tip][i3], c[2]);
+      mkPoli2Coefficients(x1, x2, x3, co[tip][i1], co[tip][i2], co[tip][i3], c[3]);
+      mkPoli2Coefficients(x1, x2, x3, no2[i1], no2[i2], no2[i3], c[4]);
+      mkPoli2Coefficients(x1, x2, x3, no2[i1], so2[i2], so2[i3], c[5]); // (sic) as in the original SO2 fit
     }
+  }
+}
 
-    calc:
-
-    if(x1 == 0.0 && x2 == 0.0 && x3 == 0.0) {
-
-      o3den = NumberDensity(0.0, "m**-3");
-      n2oden = NumberDensity(0.0, "m**-3");
-      coden = NumberDensity(0.0, "m**-3");
-      no2den = NumberDensity(0.0, "m**-3");
-      so2den = NumberDensity(0.0, "m**-3");
-
-    } else {
-
-      //     ----- ---------------------------------------[ pressure ]
-
-      //	p=poli2(ha,x1,x2,x3,p[tip][i1],p[tip][i2],p[tip][i3]);
-
-      //     --------------------------------------------[ TEMPERATURE ]
-
-      //	t=poli2(ha,x1,x2,x3,t[tip][i1],t[tip][i2],t[tip][i3]);
-
-      //     --------------------------------------------[ DENSITY ]
-
-      d = poli2(ha,x1,x2,x3,den[tip - 1][i1],den[tip - 1][i2],den[tip - 1][i3])
-	* airmwt * 1e6 / avogad; // en g/m**3
-
-      //   D=A+B*HA+C*HA2    en cm**-3, pero dividido por 1E19   D=D*airmwt*1e6/avogad  // en g/m**3
-
-      //     --------------------------------------------[ H2O ]
-
-      //    rr=poli2(ha,x1,x2,x3,agua[tip][i1],agua[tip][i2],agua[tip][i3]);   // RR=A+B*HA+C*HA2  en ppmv
-      //    rr=rr*1e-6*(h2omwt/airmwt)*d;  // en g/m**3
-
-      //     --------------------------------------------[ OZONE ]
-
-      o3den= NumberDensity(poli2(ha, x1, x2, x3, ozone[tip - 1][i1], ozone[tip- 1][i2], ozone[tip - 1][i3])
-			   * 1e-12 * d * avogad / airmwt,"cm**-3");
-      if(i2 < 30){         // FIX 15/11/2018
-	o3den=o3den*0.82;  // FIX 15/11/2018
-      }else{               // FIX 15/11/2018
-	o3den=o3den*1.65;  // FIX 15/11/2018
-      }                    // FIX 15/11/2018
-
-      //   std::cout << "ha o3den " << ha << " " << o3den.get() << std::endl;
-
-      //  OZONO=A+B*HA+C*HA2     // en ppmv
-
-      //     --------------------------------------------[ N2O ]
-
-      n2oden = NumberDensity(poli2(ha, x1, x2, x3, n2o[tip - 1][i1], n2o[tip - 1][i2], n2o[tip - 1][i3])
-			     * 1e-12 * d * avogad / airmwt, "cm**-3");
-      //  N2O=A+B*HA+C*HA2       // en ppmv
-
-      //    --------------------------------------------[ NO2 ]
+const St76Coefficients &st76Coefficients()
+{
+  static const St76Coefficients coefficients;
+  return coefficients;
+}
 
-      no2den = NumberDensity(poli2(ha, x1, x2, x3, no2[i1], no2[i2], no2[i3]) * 1e-12 * d * avogad / airmwt, "cm**-3");
+} // namespace
 
-      //    --------------------------------------------[ SO2 ]
+vector<NumberDensity> AtmProfile::st76(const Length &h, size_t tip) const
+{
+  vector<NumberDensity> minorden;
+  st76(h, tip, minorden);
+  return minorden;
+}
 
-      so2den = NumberDensity(poli2(ha, x1, x2, x3, no2[i1], so2[i2], so2[i3]) * 1e-12 * d * avogad / airmwt, "cm**-3");
+void AtmProfile::st76(const Length &h, size_t tip, vector<NumberDensity> &minorden) const
+{
+  double ha = h.get<Length::km>();
+  double o3den, coden, n2oden, no2den, so2den;
 
-      //    --------------------------------------------[ CO ]
+  getMinorGasDensities(tip, 1, &ha, &o3den, &coden, &n2oden, &no2den, &so2den);
 
-      coden = NumberDensity(poli2(ha,x1,x2,x3,co[tip-1][i1],co[tip-1][i2],co[tip-1][i3])
-			    * 1e-12 * d * avogad / airmwt,"cm**-3");
+  minorden.clear();
+  minorden.push_back(NumberDensity::from<NumberDensity::per_m3>(o3den));
+  minorden.push_back(NumberDensity::from<NumberDensity::per_m3>(n2oden));
+  minorden.push_back(NumberDensity::from<NumberDensity::per_m3>(coden));
+  minorden.push_back(NumberDensity::from<NumberDensity::per_m3>(no2den));
+  minorden.push_back(NumberDensity::from<NumberDensity::per_m3>(so2den));
+}
 
+void AtmProfile::getMinorGasDensities(size_t typeAtm,
+                                      size_t num,
+                                      const double *altitude,
+                                      double *o3,
+                                      double *co,
+                                      double *n2o,
+                                      double *no2,
+                                      double *so2)
+{
+  static const double avogad = 6.022045E+23;
+  static const double airmwt = 28.964;
+  const St76Coefficients &table = st76Coefficients();
+  size_t tip = (typeAtm >= 1 && typeAtm <= 6) ? typeAtm - 1 : 5; // Default: US St76 Atm.
+
+  for(size_t n = 0; n < num; n++) {
+    double ha = altitude[n];
+    if(!(ha >= 0.0 && ha < st76Alt[49])) {
+      o3[n] = 0.0;
+      co[n] = 0.0;
+      n2o[n] = 0.0;
+      no2[n] = 0.0;
+      so2[n] = 0.0;
+      continue;
     }
+    // first reference level above ha; its segment holds the quadratics through the three nearest levels
+    size_t segment = std::upper_bound(st76Alt, st76Alt + 50, ha) - st76Alt;
+    const double (*c)[3] = table.coef[tip][segment];
+    double ha2 = ha * ha;
+
+    double d = (c[0][0] + c[0][1] * ha + c[0][2] * ha2) * airmwt * 1e6 / avogad; // en g/m**3
+    double ppmv = 1e-6 * d * avogad / airmwt; // density in m**-3 of 1 ppmv
+
+    o3[n] = (c[1][0] + c[1][1] * ha + c[1][2] * ha2) * ppmv;
+    o3[n] = o3[n] * (segment < 30 ? 0.82 : 1.65); // FIX 15/11/2018
+    n2o[n] = (c[2][0] + c[2][1] * ha + c[2][2] * ha2) * ppmv;
+    co[n] = (c[3][0] + c[3][1] * ha + c[3][2] * ha2) * ppmv;
+    no2[n] = (c[4][0] + c[4][1] * ha + c[4][2] * ha2) * ppmv;
+    so2[n] = (c[5][0] + c[5][1] * ha + c[5][2] * ha2) * ppmv;
+  }
+}
 
+// derivatives of the minor gas densities of getMinorGasDensities() at the altitude ha (km) with respect to
+// the altitude, in m**-3 per km: slopes[0..4] for o3, co, n2o, no2 and so2
+static void getMinorGasDensitySlopes(size_t typeAtm, double ha, double *slopes)
+{
+  static const double avogad = 6.022045E+23;
+  static const double airmwt = 28.964;
+  for(size_t k = 0; k < 5; k++) slopes[k] = 0.0;
+  if(!(ha >= 0.0 && ha < st76Alt[49])) return;
+
+  size_t tip = (typeAtm >= 1 && typeAtm <= 6) ? typeAtm - 1 : 5; // Default: US St76 Atm.
+  size_t segment = std::upper_bound(st76Alt, st76Alt + 50, ha) - st76Alt;
+  const double (*c)[3] = st76Coefficients().coef[tip][segment];
+  double ha2 = ha * ha;
+
+  double ppmv = 1e-6 * ((c[0][0] + c[0][1] * ha + c[0][2] * ha2) * airmwt * 1e6 / avogad) * avogad / airmwt;
+  double dppmv = 1e-6 * ((c[0][1] + 2.0 * c[0][2] * ha) * airmwt * 1e6 / avogad) * avogad / airmwt;
+  const size_t order[5] = { 0, 2, 1, 3, 4 }; // the table holds o3, n2o, co, no2, so2
+  for(size_t k = 1; k < 6; k++) {
+    slopes[order[k - 1]] = (c[k][1] + 2.0 * c[k][2] * ha) * ppmv + (c[k][0] + c[k][1] * ha + c[k][2] * ha2) * dppmv;
   }
+  slopes[0] = slopes[0] * (segment < 30 ? 0.82 : 1.65);
+}
 
-  minorden.push_back(o3den);
-  minorden.push_back(n2oden);
-  minorden.push_back(coden);
-  minorden.push_back(no2den);
-  minorden.push_back(so2den);
+// derivative of the geometric mean sqrt(a*b) of two positive values; for a = b = 0, that of values
+// growing in proportion to the parameter (water vapor with respect to the relative humidity in a dry profile)
+static double geometricMeanPartial(double a, double b, double da, double db)
+{
+  if(a > 0.0 && b > 0.0) return 0.5 * sqrt(a * b) * (da / a + db / b);
+  return (da > 0.0 && db > 0.0) ? sqrt(da * db) : 0.0;
+}
 
-  return minorden;
+void AtmProfile::clearLayerPartials()
+{
+  for(size_t q = 0; q < 4; q++) layerPartials_[q].resize(0);
 }
 
 double AtmProfile::poli2(double ha,
@@ -1510,14 +1897,10 @@ double AtmProfile::poli2(double ha,
   return a + b * ha + c * pow(ha, (int)2);
 }
 
-size_t AtmProfile::mkAtmProfile()
-{
-  static const double
-      hx[20] = { 9.225, 10.225, 11.225, 12.850, 14.850, 16.850, 18.850, 22.600, 26.600, 30.600,
+const double AtmProfile::referenceHeight_[20] = { 9.225, 10.225, 11.225, 12.850, 14.850, 16.850, 18.850, 22.600, 26.600, 30.600,
 		 34.850, 40.850, 46.850, 52.850, 58.850, 65.100, 73.100, 81.100, 89.100, 95.600 };
 
-  static const double
-      px[6][20] = { { 0.3190E+03, 0.2768E+03, 0.2391E+03, 0.1864E+03, 0.1354E+03, 0.9613E+02, 0.6833E+02,
+const double AtmProfile::referencePressure_[6][20] = { { 0.3190E+03, 0.2768E+03, 0.2391E+03, 0.1864E+03, 0.1354E+03, 0.9613E+02, 0.6833E+02,
 		      0.3726E+02, 0.2023E+02, 0.1121E+02, 0.6142E+01, 0.2732E+01, 0.1260E+01, 0.6042E+00,
 		      0.2798E+00, 0.1202E+00, 0.3600E-01, 0.9162E-02, 0.2076E-02, 0.6374E-03 },
 		    { 0.3139E+03, 0.2721E+03, 0.2350E+03, 0.1833E+03, 0.1332E+03, 0.9726E+02, 0.7115E+02,
@@ -1536,8 +1919,7 @@ size_t AtmProfile::mkAtmProfile()
                       0.3688E+02, 0.1999E+02, 0.1087E+02, 0.5862E+01, 0.2565E+01, 0.1182E+01, 0.5572E+00,
                       0.2551E+00, 0.1074E+00, 0.3224E-01, 0.8697E-02, 0.2158E-02, 0.6851E-03 } };
 
-  static const double
-      tx[6][20] = { { 0.2421E+03, 0.2354E+03, 0.2286E+03, 0.2180E+03, 0.2046E+03, 0.1951E+03, 0.2021E+03,
+const double AtmProfile::referenceTemperature_[6][20] = { { 0.2421E+03, 0.2354E+03, 0.2286E+03, 0.2180E+03, 0.2046E+03, 0.1951E+03, 0.2021E+03,
 		      0.2160E+03, 0.2250E+03, 0.2336E+03, 0.2428E+03, 0.2558E+03, 0.2686E+03, 0.2667E+03,
 		      0.2560E+03, 0.2357E+03, 0.2083E+03, 0.1826E+03, 0.1767E+03, 0.1841E+03 },
 		    { 0.2403E+03, 0.2338E+03, 0.2273E+03, 0.2167E+03, 0.2157E+03, 0.2157E+03, 0.2177E+03,
@@ -1556,13 +1938,23 @@ size_t AtmProfile::mkAtmProfile()
 		      227.340, 236.110, 252.746, 268.936, 265.057, 250.174, 233.026, 212.656, 196.466,
                       187.260, 189.204}   };
 
-  double T_ground = groundTemperature_.get("K"); //  std::cout<<"T_ground: " << T_ground <<"K"<<endl;
-  double P_ground = groundPressure_.get("mb"); //  std::cout<<"P_ground: " << P_ground <<"mb"<<endl;
-  double rh = relativeHumidity_.get("%"); //  std::cout<<"rh:       " << rh <<"%"<<endl;
-  double h0 = wvScaleHeight_.get("km"); //  std::cout<<"h0:       " << h0 <<"km"<<endl;
-  double dp = pressureStep_.get("mb"); //  std::cout<<"dp:       " << dp <<"mb"<<endl;
-  double alti = altitude_.get("km"); //  std::cout<<"alti:     " << alti <<"km"<<endl;
-  double atmh = topAtmProfile_.get("km"); //  std::cout<<"atmh:     " << atmh <<"km"<<endl;
+size_t AtmProfile::mkAtmProfile()
+{
+  profileVersion_++;
+  const double (&hx)[20] = referenceHeight_;
+  const double (&px)[6][20] = referencePressure_;
+  const double (&tx)[6][20] = referenceTemperature_;
+
+  // a profile built from the basic parameters ends the altitude sliding mode
+  slidingReference_.reset();
+
+  double T_ground = groundTemperature_.get<Temperature::K>(); //  std::cout<<"T_ground: " << T_ground <<"K"<<endl;
+  double P_ground = groundPressure_.get<Pressure::mb>(); //  std::cout<<"P_ground: " << P_ground <<"mb"<<endl;
+  double rh = relativeHumidity_.get<Humidity::percent>(); //  std::cout<<"rh:       " << rh <<"%"<<endl;
+  double h0 = wvScaleHeight_.get<Length::km>(); //  std::cout<<"h0:       " << h0 <<"km"<<endl;
+  double dp = pressureStep_.get<Pressure::mb>(); //  std::cout<<"dp:       " << dp <<"mb"<<endl;
+  double alti = altitude_.get<Length::km>(); //  std::cout<<"alti:     " << alti <<"km"<<endl;
+  double atmh = topAtmProfile_.get<Length::km>(); //  std::cout<<"atmh:     " << atmh <<"km"<<endl;
   double dp1 = pressureStepFactor_; //  std::cout<<"dp1:      " << dp1 <<" "<<endl;
   double dt = tropoLapseRate_; // TODO implementer des unites (K/km) ici localement
   double prLimit;
@@ -1608,46 +2000,23 @@ size_t AtmProfile::mkAtmProfile()
 
   //int    nmaxLayers=40;  // FV peut etre devrions nos avoir un garde-fou au cas ou le nb de couches serait stupidement trop grand
 
-  vector<double> v_layerPressure;
-  vector<double> v_layerPressure0;
-  vector<double> v_layerPressure1;
-  vector<double> v_layerTemperature;
-  vector<double> v_layerTemperature0;
-  vector<double> v_layerTemperature1;
-  vector<double> v_layerThickness;
-  vector<double> v_layerWaterVapor;
-  vector<double> v_layerWaterVapor0;
-  vector<double> v_layerWaterVapor1;
-  vector<double> v_layerO3;
-  vector<double> v_layerCO;
-  vector<double> v_layerN2O;
-  vector<double> v_layerNO2;
-  vector<double> v_layerSO2;
-
-  vector<double> v_layerO3_aux;
-  vector<double> v_layerCO_aux;
-  vector<double> v_layerN2O_aux;
-  vector<double> v_layerNO2_aux;
-  vector<double> v_layerSO2_aux;
-  vector<double> v_layerPressure_aux;
-  vector<double> v_layerPressure0_aux;
-  vector<double> v_layerPressure1_aux;
-  vector<double> v_layerTemperature_aux;
-  vector<double> v_layerTemperature0_aux;
-  vector<double> v_layerTemperature1_aux;
-  vector<double> v_layerThickness_aux;
-  vector<double> v_layerWaterVapor_aux;
-  vector<double> v_layerWaterVapor0_aux;
-  vector<double> v_layerWaterVapor1_aux;
-  vector<NumberDensity> minorden;
+  // working levels, kept in the object so that rebuilding a profile of the same shape allocates nothing
+  vector<double> &v_layerPressure = v_workPressure_;
+  vector<double> &v_layerTemperature = v_workTemperature_;
+  vector<double> &v_layerThickness = v_workThickness_;
+  vector<double> &v_layerWaterVapor = v_workWaterVapor_;
+  v_layerPressure.clear();
+  v_layerTemperature.clear();
+  v_layerThickness.clear();
+  v_layerWaterVapor.clear();
 
   v_layerPressure.push_back(P_ground);
   v_layerThickness.push_back(alti * 1000);
   v_layerTemperature.push_back(T_ground);
 
-  wgr = rwat(Temperature(v_layerTemperature[0], "K"),
-             Humidity(rh, "%"),
-             Pressure(v_layerPressure[0], "mb")).get("gm**-3");
+  wgr = rwat(Temperature::from<Temperature::K>(v_layerTemperature[0]),
+             Humidity::from<Humidity::percent>(rh),
+             Pressure::from<Pressure::mb>(v_layerPressure[0])).get<MassDensity::g_m3>();
 
   // Absolute Humidity in gr/m**3 at altitude alti
   wgr0 = wgr * exp(alti / h0); // h0 in km ==> wgr0 would be the absolute humidity (gr/m**3) at sea level
@@ -1656,6 +2025,44 @@ size_t AtmProfile::mkAtmProfile()
 
   v_layerWaterVapor.push_back(wgr); // in gr/m**3
 
+  // derivatives of the levels with respect to the ground pressure, ground temperature, relative humidity
+  // and lapse rate, carried along the integration (the levels at which the troposphere ends are held)
+  vector<LevelPartials> &v_levelPartials = v_workPartials_;
+  double dwgr[3];
+  rwatPartials(T_ground, rh, P_ground, dwgr);
+  double dwgr0[4] = { dwgr[0] * exp(alti / h0), dwgr[1] * exp(alti / h0), dwgr[2] * exp(alti / h0), 0.0 };
+  double dg[4] = { 0.0, 0.0, 0.0, 0.0 }; // derivatives of the gravity g
+  v_levelPartials.resize(1);
+  for(size_t q = 0; q < 4; q++) {
+    v_levelPartials[0].pressure[q] = (q == 0) ? 1.0 : 0.0;
+    v_levelPartials[0].temperature[q] = (q == 1) ? 1.0 : 0.0;
+    v_levelPartials[0].height[q] = 0.0;
+    v_levelPartials[0].waterVapor[q] = (q < 3) ? dwgr[q] : 0.0;
+  }
+  // derivatives of the level i from those of the level i-1: after a hydrostatic step dh (in the troposphere,
+  // with the lapse rate, or up to the first level of the reference atmosphere) or a step of fixed height
+  auto mkLevelPartials = [&](size_t i, bool hydrostatic, bool tropospheric) {
+    v_levelPartials.resize(i + 1);
+    const LevelPartials &a = v_levelPartials[i - 1];
+    LevelPartials &b = v_levelPartials[i];
+    double m = 1.0 + 0.61 * v_layerWaterVapor[i - 1] / 1.0E6;
+    double lr = log(v_layerPressure[i - 1] / v_layerPressure[i]);
+    for(size_t q = 0; q < 4; q++) {
+      b.pressure[q] = tropospheric ? a.pressure[q] : 0.0;
+      double ddh = 0.0;
+      if(hydrostatic) {
+        if(tropospheric) dg[q] = -2.0 * g * a.height[q] / (1000.0 * rt + v_layerThickness[i - 1]);
+        ddh = 288.6948 * (a.temperature[q] * m * lr
+                          + v_layerTemperature[i - 1] * 0.61 * a.waterVapor[q] / 1.0E6 * lr
+                          + v_layerTemperature[i - 1] * m * (a.pressure[q] / v_layerPressure[i - 1] - b.pressure[q] / v_layerPressure[i]))
+            / g - dh * dg[q] / g;
+      }
+      b.height[q] = a.height[q] + ddh;
+      b.temperature[q] = tropospheric ? a.temperature[q] + dt * ddh / 1000.0 + (q == 3 ? dh / 1000.0 : 0.0) : 0.0;
+      b.waterVapor[q] = dwgr0[q] * exp(-v_layerThickness[i] / (1000.0 * h0)) - v_layerWaterVapor[i] * b.height[q] / (1000.0 * h0);
+    }
+  };
+
   i0 = 0;
   i = 0;
   j = 0;
@@ -1764,6 +2171,7 @@ size_t AtmProfile::mkAtmProfile()
         v_layerWaterVapor.push_back(wgr0 * exp(-v_layerThickness[i] / (1000.0 * h0)));
       }
       //  std::cout << "layer " << i << " j=" << j << " v_layerThickness[" << i << "]="  << v_layerThickness[i] << " v_layerPressure[" << i << "]=" << v_layerPressure[i]  << std::endl;
+      mkLevelPartials(i, control, false);
      if(control) {
         tropoLayer_ = i - 1;
 	//	std::cout << "tropoLayer_=" << tropoLayer_ << std::endl;
@@ -1797,6 +2205,7 @@ size_t AtmProfile::mkAtmProfile()
         v_layerTemperature[i] = v_layerTemperature[i - 1] + dt * dh / 1000.0;
         v_layerWaterVapor[i] = wgr0 * exp(-v_layerThickness[i] / (1000.0 * h0)); //r[i] in kgr/(m**2*1000m) [gr/m**3]
       }
+      mkLevelPartials(i, true, true);
 
       //std::cout << "dh=" << dh << std::endl;
        if( v_layerTemperature[i] <= tx[typeAtm_ - 1][0] && v_layerPressure[i] <= px[typeAtm_ - 1][0] )
@@ -1808,9 +2217,9 @@ size_t AtmProfile::mkAtmProfile()
       	  // std::cout << "new prLimit =" << prLimit << std::endl;
 	}
 
-//       humrel = rwat_inv(Temperature(v_layerTemperature[i], "K"),
-//                         MassDensity(v_layerWaterVapor[i], "gm**-3"),
-//                         Pressure(v_layerPressure[i], "mb")).get("%");
+//       humrel = rwat_inv(Temperature::from<Temperature::K>(v_layerTemperature[i]),
+//                         MassDensity::from<MassDensity::g_m3>(v_layerWaterVapor[i]),
+//                         Pressure::from<Pressure::mb>(v_layerPressure[i])).get<Humidity::percent>();
 
 
       /*	cout << "layer " << i
@@ -1828,15 +2237,17 @@ size_t AtmProfile::mkAtmProfile()
 
   // std::cout << "npp=" << npp << std::endl;
   // std::cout << "tropoLayer=" << tropoLayer_ << std::endl;
-  tropoTemperature_ = Temperature(v_layerTemperature[tropoLayer_], "K");
-  tropoAltitude_ = Length(v_layerThickness[tropoLayer_], "m");
-  // std::cout << "tropoAltitude=" << tropoAltitude_.get("km") << " km" << std::endl;
-  // std::cout << "tropoTemperature=" << tropoTemperature_.get("K") << " K" << std::endl;
-  // std::cout << "ground Altitude=" << altitude_.get("km") << " km" << std::endl;
-  // std::cout << "ground Temperature=" << groundTemperature_.get("K") << " K" << std::endl;
-  // std::cout << "Calculated Lapse Rate=" << (tropoTemperature_.get("K")-groundTemperature_.get("K"))/(tropoAltitude_.get("km")-altitude_.get("km")) << " K/km" << std::endl;
+  tropoTemperature_ = Temperature::from<Temperature::K>(v_layerTemperature[tropoLayer_]);
+  tropoAltitude_ = Length::from<Length::m>(v_layerThickness[tropoLayer_]);
+  // std::cout << "tropoAltitude=" << tropoAltitude_.get<Length::km>() << " km" << std::endl;
+  // std::cout << "tropoTemperature=" << tropoTemperature_.get<Temperature::K>() << " K" << std::endl;
+  // std::cout << "ground Altitude=" << altitude_.get<Length::km>() << " km" << std::endl;
+  // std::cout << "ground Temperature=" << groundTemperature_.get<Temperature::K>() << " K" << std::endl;
+  // std::cout << "Calculated Lapse Rate=" << (tropoTemperature_.get<Temperature::K>()-groundTemperature_.get<Temperature::K>())/(tropoAltitude_.get<Length::km>()-altitude_.get<Length::km>()) << " K/km" << std::endl;
 
 
+  if(!v_fixedLayerTop_.empty()) return mkFixedGridLayers(npp);
+
   altura = alti;
 
   /*
@@ -1850,16 +2261,44 @@ size_t AtmProfile::mkAtmProfile()
    */
 
 
+  v_layerTemperature0_.resize(npp);
+  v_layerTemperature1_.resize(npp);
+  v_layerPressure0_.resize(npp);
+  v_layerPressure1_.resize(npp);
+  v_layerWaterVapor0_.resize(npp);
+  v_layerWaterVapor1_.resize(npp);
+  v_layerO3_.resize(npp);
+  v_layerCO_.resize(npp);
+  v_layerN2O_.resize(npp);
+  v_layerNO2_.resize(npp);
+  v_layerSO2_.resize(npp);
+  v_workAltitude_.resize(npp);
+
+  for(size_t q = 0; q < 4; q++) layerPartials_[q].resize(npp);
   for(size_t jj = 0; jj < npp; jj++) {
+    const LevelPartials &lo = v_levelPartials[jj];
+    const LevelPartials &hi = v_levelPartials[jj + 1];
+    for(size_t q = 0; q < 4; q++) {
+      LayerPartials &d = layerPartials_[q];
+      d.thickness[jj] = hi.height[q] - lo.height[q];
+      d.temperature[jj] = (hi.temperature[q] + lo.temperature[q]) / 2.0;
+      d.pressure[jj] = geometricMeanPartial(v_layerPressure[jj], v_layerPressure[jj + 1], lo.pressure[q], hi.pressure[q]);
+      d.waterVapor[jj] = 1.0E-3 * geometricMeanPartial(v_layerWaterVapor[jj], v_layerWaterVapor[jj + 1],
+                                                       lo.waterVapor[q], hi.waterVapor[q]);
+      d.o3[jj] = (hi.height[q] + lo.height[q]) / 2.0E3; // derivative of the altitude of the middle of the layer, for now
+    }
+  }
 
-    v_layerTemperature0.push_back(v_layerTemperature[jj]);
-    v_layerTemperature1.push_back(v_layerTemperature[jj + 1]);
-    v_layerPressure0.push_back(v_layerPressure[jj]);
-    v_layerPressure1.push_back(v_layerPressure[jj + 1]);
-    v_layerWaterVapor0.push_back(1.0E-3*v_layerWaterVapor[jj]);
-    v_layerWaterVapor1.push_back(1.0E-3*v_layerWaterVapor[jj + 1]);
+  for(size_t jj = 0; jj < npp; jj++) {
 
-      }
+    v_layerTemperature0_[jj] = v_layerTemperature[jj];
+    v_layerTemperature1_[jj] = v_layerTemperature[jj + 1];
+    v_layerPressure0_[jj] = v_layerPressure[jj];
+    v_layerPressure1_[jj] = v_layerPressure[jj + 1];
+    v_layerWaterVapor0_[jj] = 1.0E-3*v_layerWaterVapor[jj];
+    v_layerWaterVapor1_[jj] = 1.0E-3*v_layerWaterVapor[jj + 1];
+
+  }
 
   for(j = 0; j < npp; j++) {
 
@@ -1876,15 +2315,13 @@ size_t AtmProfile::mkAtmProfile()
     //      std::cout << "type_=" << type_ << std::endl;
     //      std::cout << "typeAtm_=" << typeAtm_ << std::endl;
 
-    size_t atmType = typeAtm_; // conversion in int
-
     //      std::cout << "going to minorden with atmType=" << atmType << std::endl;
 
-    minorden = st76(Length(altura, "km"), atmType);
+    v_workAltitude_[j] = altura; // in km, the minor gases of all the layers are obtained at once below
 
-    //      std::cout << "Ozone: " << abun_ozono << "  " << ozono.get("cm**-3") << std::endl;
-    // std::cout << "N2O  : " << abun_n2o << "  " << n2o.get("cm**-3") << std::endl;
-    // std::cout << "CO   : " << abun_co  << "  " << co.get("cm**-3") << std::endl;
+    //      std::cout << "Ozone: " << abun_ozono << "  " << ozono.get<NumberDensity::per_cm3>() << std::endl;
+    // std::cout << "N2O  : " << abun_n2o << "  " << n2o.get<NumberDensity::per_cm3>() << std::endl;
+    // std::cout << "CO   : " << abun_co  << "  " << co.get<NumberDensity::per_cm3>() << std::endl;
 
 
     /* std::cout << j << " " << v_layerO3_.size()-1 << std::endl; */
@@ -1910,11 +2347,6 @@ size_t AtmProfile::mkAtmProfile()
     // v_layerNO2.push_back(1.E6*abun_no2);          // in m**-3
     // v_layerSO2.push_back(1.E6*abun_so2);          // in m**-3
 
-    v_layerO3.push_back(1.E6 * minorden[0].get("cm**-3")); // in m**-3
-    v_layerCO.push_back(1.E6 * minorden[2].get("cm**-3")); // in m**-3
-    v_layerN2O.push_back(1.E6 * minorden[1].get("cm**-3")); // in m**-3
-    v_layerNO2.push_back(1.E6 * minorden[3].get("cm**-3")); // in m**-3
-    v_layerSO2.push_back(1.E6 * minorden[4].get("cm**-3")); // in m**-3
 
 
 
@@ -1934,63 +2366,217 @@ size_t AtmProfile::mkAtmProfile()
    }
    } */
 
-  for(j = 0; j < npp; j++) {
+  getMinorGasDensities(typeAtm_, npp, v_workAltitude_.data(),
+                       v_layerO3_.data(), v_layerCO_.data(), v_layerN2O_.data(),
+                       v_layerNO2_.data(), v_layerSO2_.data()); // in m**-3
+
+  // the minor gases change with the basic parameters through the altitudes of the layers
+  for(size_t jj = 0; jj < npp; jj++) {
+    double slopes[5];
+    getMinorGasDensitySlopes(typeAtm_, v_workAltitude_[jj], slopes);
+    for(size_t q = 0; q < 4; q++) {
+      LayerPartials &d = layerPartials_[q];
+      double dAlt = d.o3[jj];
+      d.o3[jj] = slopes[0] * dAlt;
+      d.co[jj] = slopes[1] * dAlt;
+      d.n2o[jj] = slopes[2] * dAlt;
+      d.no2[jj] = slopes[3] * dAlt;
+      d.so2[jj] = slopes[4] * dAlt;
+    }
+  }
 
-    v_layerPressure_aux.push_back(v_layerPressure[j]);
-    v_layerPressure0_aux.push_back(v_layerPressure0[j]);
-    v_layerPressure1_aux.push_back(v_layerPressure1[j]);
-    v_layerTemperature_aux.push_back(v_layerTemperature[j]);
-    v_layerTemperature0_aux.push_back(v_layerTemperature0[j]);
-    v_layerTemperature1_aux.push_back(v_layerTemperature1[j]);
-    v_layerThickness_aux.push_back(v_layerThickness[j]);
-    v_layerWaterVapor_aux.push_back(v_layerWaterVapor[j]);
-    v_layerWaterVapor0_aux.push_back(v_layerWaterVapor0[j]);
-    v_layerWaterVapor1_aux.push_back(v_layerWaterVapor1[j]);
-    v_layerO3_aux.push_back(v_layerO3[j]);
-    v_layerCO_aux.push_back(v_layerCO[j]);
-    v_layerN2O_aux.push_back(v_layerN2O[j]);
-    v_layerNO2_aux.push_back(v_layerNO2[j]);
-    v_layerSO2_aux.push_back(v_layerSO2[j]);
-
-  }
-
-  if(j > v_layerPressure_.size() - 1) { // ?????
-    v_layerPressure_.reserve(npp);
-    v_layerPressure0_.reserve(npp);
-    v_layerPressure1_.reserve(npp);
-    v_layerTemperature_.reserve(npp);
-    v_layerTemperature0_.reserve(npp);
-    v_layerTemperature1_.reserve(npp);
-    v_layerThickness_.reserve(npp);
-    v_layerWaterVapor_.reserve(npp);
-    v_layerWaterVapor0_.reserve(npp);
-    v_layerWaterVapor1_.reserve(npp);
-    v_layerO3_.reserve(npp);
-    v_layerCO_.reserve(npp);
-    v_layerN2O_.reserve(npp);
-    v_layerNO2_.reserve(npp);
-    v_layerSO2_.reserve(npp);
-  }
-
-  v_layerPressure_ = v_layerPressure_aux;
-  v_layerPressure0_ = v_layerPressure0_aux;
-  v_layerPressure1_ = v_layerPressure1_aux;
-  v_layerTemperature_ = v_layerTemperature_aux;
-  v_layerTemperature0_ = v_layerTemperature0_aux;
-  v_layerTemperature1_ = v_layerTemperature1_aux;
-  v_layerThickness_ = v_layerThickness_aux;
-  v_layerWaterVapor_ = v_layerWaterVapor_aux;
-  v_layerWaterVapor0_ = v_layerWaterVapor0_aux;
-  v_layerWaterVapor1_ = v_layerWaterVapor1_aux;
-  v_layerO3_ = v_layerO3_aux;
-  v_layerCO_ = v_layerCO_aux;
-  v_layerN2O_ = v_layerN2O_aux;
-  v_layerNO2_ = v_layerNO2_aux;
-  v_layerSO2_ = v_layerSO2_aux;
+  // the member profiles keep their capacity from one call to the next
+  v_layerPressure_.assign(v_layerPressure.begin(), v_layerPressure.begin() + npp);
+  v_layerTemperature_.assign(v_layerTemperature.begin(), v_layerTemperature.begin() + npp);
+  v_layerThickness_.assign(v_layerThickness.begin(), v_layerThickness.begin() + npp);
+  v_layerWaterVapor_.assign(v_layerWaterVapor.begin(), v_layerWaterVapor.begin() + npp);
 
   // first = false; // ?????    [-Wunused_but_set_variable]
 
   return npp;
 }
 
+size_t AtmProfile::mkFixedGridLayers(size_t npp)
+{
+  // levels of the adaptive profile: heights above sea level (m), P (mb), T (K), water vapor (gr/m**3)
+  const vector<double> &z = v_workThickness_;
+  const vector<double> &p = v_workPressure_;
+  const vector<double> &t = v_workTemperature_;
+  const vector<double> &w = v_workWaterVapor_;
+  size_t numLevel = npp + 2;
+  size_t numLayer = v_fixedLayerTop_.size();
+  double alti = altitude_.get<Length::m>();
+  double zTropo = tropoAltitude_.get<Length::m>();
+
+  v_layerThickness_.resize(numLayer);
+  v_layerTemperature_.resize(numLayer);
+  v_layerTemperature0_.resize(numLayer);
+  v_layerTemperature1_.resize(numLayer);
+  v_layerPressure_.resize(numLayer);
+  v_layerPressure0_.resize(numLayer);
+  v_layerPressure1_.resize(numLayer);
+  v_layerWaterVapor_.resize(numLayer);
+  v_layerWaterVapor0_.resize(numLayer);
+  v_layerWaterVapor1_.resize(numLayer);
+  v_layerO3_.resize(numLayer);
+  v_layerCO_.resize(numLayer);
+  v_layerN2O_.resize(numLayer);
+  v_layerNO2_.resize(numLayer);
+  v_layerSO2_.resize(numLayer);
+
+  v_workAltitude_.resize(numLayer);
+  // the boundaries are fixed: the derivatives of the layers follow from those of the levels through the
+  // interpolation, and the minor gases, given by the altitude, do not change
+  const vector<LevelPartials> &lp = v_workPartials_;
+  double dtBottom[4], dpBottom[4], dwBottom[4];
+  for(size_t q = 0; q < 4; q++) {
+    layerPartials_[q].resize(numLayer);
+    dtBottom[q] = lp[0].temperature[q];
+    dpBottom[q] = lp[0].pressure[q];
+    dwBottom[q] = lp[0].waterVapor[q];
+  }
+
+  size_t k = 0; // the boundary lies between the levels k and k+1 (above the last level: extrapolation)
+  double zBottom = alti, tBottom = t[0], pBottom = p[0], wBottom = w[0];
+  tropoLayer_ = numLayer - 1;
+  for(size_t n = 0; n < numLayer; n++) {
+    double zTop = alti + v_fixedLayerTop_[n];
+    while(k + 2 < numLevel && z[k + 1] <= zTop) k++;
+    double f = (zTop - z[k]) / (z[k + 1] - z[k]);
+    double tTop = (zTop > z[numLevel - 1]) ? t[numLevel - 1] : t[k] + f * (t[k + 1] - t[k]);
+    double pTop = p[k] * exp(f * log(p[k + 1] / p[k]));
+    double wTop = (w[k] > 0.0 && w[k + 1] > 0.0) ? w[k] * exp(f * log(w[k + 1] / w[k])) : w[k] + f * (w[k + 1] - w[k]);
+
+    v_layerThickness_[n] = zTop - zBottom;
+    v_layerTemperature0_[n] = tBottom;
+    v_layerTemperature1_[n] = tTop;
+    v_layerTemperature_[n] = (tBottom + tTop) / 2.0;
+    v_layerPressure0_[n] = pBottom;
+    v_layerPressure1_[n] = pTop;
+    v_layerPressure_[n] = sqrt(pBottom * pTop);
+    v_layerWaterVapor0_[n] = 1.0E-3 * wBottom;
+    v_layerWaterVapor1_[n] = 1.0E-3 * wTop;
+    v_layerWaterVapor_[n] = 1.0E-3 * sqrt(wBottom * wTop);
+
+    v_workAltitude_[n] = (zBottom + zTop) / 2.0E3; // in km
+
+    for(size_t q = 0; q < 4; q++) {
+      const LevelPartials &a = lp[k];
+      const LevelPartials &b = lp[k + 1];
+      double df = -(a.height[q] + f * (b.height[q] - a.height[q])) / (z[k + 1] - z[k]);
+      double dtTop = (zTop > z[numLevel - 1]) ? lp[numLevel - 1].temperature[q]
+          : a.temperature[q] + df * (t[k + 1] - t[k]) + f * (b.temperature[q] - a.temperature[q]);
+      double dpTop = pTop * (a.pressure[q] / p[k] + df * log(p[k + 1] / p[k])
+                             + f * (b.pressure[q] / p[k + 1] - a.pressure[q] / p[k]));
+      double dwTop = (w[k] > 0.0 && w[k + 1] > 0.0)
+          ? wTop * (a.waterVapor[q] / w[k] + df * log(w[k + 1] / w[k]) + f * (b.waterVapor[q] / w[k + 1] - a.waterVapor[q] / w[k]))
+          : a.waterVapor[q] + df * (w[k + 1] - w[k]) + f * (b.waterVapor[q] - a.waterVapor[q]);
+
+      LayerPartials &d = layerPartials_[q];
+      d.thickness[n] = 0.0;
+      d.temperature[n] = (dtBottom[q] + dtTop) / 2.0;
+      d.pressure[n] = geometricMeanPartial(pBottom, pTop, dpBottom[q], dpTop);
+      d.waterVapor[n] = 1.0E-3 * geometricMeanPartial(wBottom, wTop, dwBottom[q], dwTop);
+      d.o3[n] = 0.0;
+      d.co[n] = 0.0;
+      d.n2o[n] = 0.0;
+      d.no2[n] = 0.0;
+      d.so2[n] = 0.0;
+      dtBottom[q] = dtTop;
+      dpBottom[q] = dpTop;
+      dwBottom[q] = dwTop;
+    }
+
+    if(zBottom <= zTropo && zTropo < zTop) tropoLayer_ = n;
+    zBottom = zTop;
+    tBottom = tTop;
+    pBottom = pTop;
+    wBottom = wTop;
+  }
+  getMinorGasDensities(typeAtm_, numLayer, v_workAltitude_.data(),
+                       v_layerO3_.data(), v_layerCO_.data(), v_layerN2O_.data(),
+                       v_layerNO2_.data(), v_layerSO2_.data()); // in m**-3
+
+  if(v_fixedLayerMerged_.size() == numLayer) return numLayer;
+
+  // merged layers, in place: the columns of dry air (P/T) and water vapor and the mean minor gas
+  // densities of the pinned layers of a group are kept
+  size_t first = 0;
+  size_t numMerged = v_fixedLayerMerged_.size();
+  size_t tropoPinned = tropoLayer_;
+  for(size_t g = 0; g < numMerged; g++) {
+    size_t last = first + v_fixedLayerMerged_[g] - 1;
+    double thickness = 0.0, column = 0.0, columnT = 0.0, columnW = 0.0;
+    double o3 = 0.0, co = 0.0, n2o = 0.0, no2 = 0.0, so2 = 0.0;
+    for(size_t n = first; n <= last; n++) {
+      double dz = v_layerThickness_[n];
+      thickness = thickness + dz;
+      column = column + dz * v_layerPressure_[n] / v_layerTemperature_[n];
+      columnT = columnT + dz * v_layerPressure_[n];
+      columnW = columnW + dz * v_layerWaterVapor_[n];
+      o3 = o3 + dz * v_layerO3_[n];
+      co = co + dz * v_layerCO_[n];
+      n2o = n2o + dz * v_layerN2O_[n];
+      no2 = no2 + dz * v_layerNO2_[n];
+      so2 = so2 + dz * v_layerSO2_[n];
+    }
+    for(size_t q = 0; q < 4; q++) {
+      LayerPartials &d = layerPartials_[q];
+      double dColumn = 0.0, dColumnT = 0.0, dColumnW = 0.0;
+      for(size_t n = first; n <= last; n++) {
+        double dz = v_layerThickness_[n];
+        dColumn = dColumn + dz * (d.pressure[n] - v_layerPressure_[n] * d.temperature[n] / v_layerTemperature_[n])
+            / v_layerTemperature_[n];
+        dColumnT = dColumnT + dz * d.pressure[n];
+        dColumnW = dColumnW + dz * d.waterVapor[n];
+      }
+      d.thickness[g] = 0.0;
+      d.temperature[g] = (dColumnT - columnT / column * dColumn) / column;
+      d.pressure[g] = dColumnT / thickness;
+      d.waterVapor[g] = dColumnW / thickness;
+      d.o3[g] = 0.0;
+      d.co[g] = 0.0;
+      d.n2o[g] = 0.0;
+      d.no2[g] = 0.0;
+      d.so2[g] = 0.0;
+    }
+    v_layerThickness_[g] = thickness;
+    v_layerTemperature_[g] = columnT / column;
+    v_layerTemperature0_[g] = v_layerTemperature0_[first];
+    v_layerTemperature1_[g] = v_layerTemperature1_[last];
+    v_layerPressure_[g] = columnT / thickness;
+    v_layerPressure0_[g] = v_layerPressure0_[first];
+    v_layerPressure1_[g] = v_layerPressure1_[last];
+    v_layerWaterVapor_[g] = columnW / thickness;
+    v_layerWaterVapor0_[g] = v_layerWaterVapor0_[first];
+    v_layerWaterVapor1_[g] = v_layerWaterVapor1_[last];
+    v_layerO3_[g] = o3 / thickness;
+    v_layerCO_[g] = co / thickness;
+    v_layerN2O_[g] = n2o / thickness;
+    v_layerNO2_[g] = no2 / thickness;
+    v_layerSO2_[g] = so2 / thickness;
+    if(first <= tropoPinned && tropoPinned <= last) tropoLayer_ = g;
+    first = last + 1;
+  }
+
+  for(size_t q = 0; q < 4; q++) layerPartials_[q].resize(numMerged);
+  v_layerThickness_.resize(numMerged);
+  v_layerTemperature_.resize(numMerged);
+  v_layerTemperature0_.resize(numMerged);
+  v_layerTemperature1_.resize(numMerged);
+  v_layerPressure_.resize(numMerged);
+  v_layerPressure0_.resize(numMerged);
+  v_layerPressure1_.resize(numMerged);
+  v_layerWaterVapor_.resize(numMerged);
+  v_layerWaterVapor0_.resize(numMerged);
+  v_layerWaterVapor1_.resize(numMerged);
+  v_layerO3_.resize(numMerged);
+  v_layerCO_.resize(numMerged);
+  v_layerN2O_.resize(numMerged);
+  v_layerNO2_.resize(numMerged);
+  v_layerSO2_.resize(numMerged);
+
+  return numMerged;
+}
+
 ATM_NAMESPACE_END
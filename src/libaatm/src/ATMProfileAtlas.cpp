@@ -0,0 +1,359 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMProfileAtlas.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMProfileAtlas.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <math.h>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+AtmProfileAtlas::AtmProfileAtlas() :
+  atmProfile_(0)
+{
+}
+
+AtmProfileAtlas::AtmProfileAtlas(const AtmProfile &atmProfile,
+                                 const vector<double> &groundPressure,
+                                 const vector<double> &groundTemperature,
+                                 const vector<double> &relativeHumidity,
+                                 const vector<double> &tropoLapseRate,
+                                 const vector<double> &wvScaleHeight) :
+  atmProfile_(atmProfile)
+{
+  v_axis_[0] = groundPressure;
+  v_axis_[1] = groundTemperature;
+  v_axis_[2] = relativeHumidity;
+  v_axis_[3] = tropoLapseRate;
+  v_axis_[4] = wvScaleHeight;
+  mkAtlas();
+}
+
+AtmProfileAtlas::AtmProfileAtlas(const AtmProfile &atmProfile,
+                                 const vector<double> &groundPressure,
+                                 const vector<double> &groundTemperature,
+                                 const vector<double> &relativeHumidity) :
+  atmProfile_(atmProfile)
+{
+  v_axis_[0] = groundPressure;
+  v_axis_[1] = groundTemperature;
+  v_axis_[2] = relativeHumidity;
+  v_axis_[3] = vector<double>(1, atmProfile.getTropoLapseRate());
+  v_axis_[4] = vector<double>(1, atmProfile.getWvScaleHeight().get<Length::km>());
+  mkAtlas();
+}
+
+AtmProfileAtlas::~AtmProfileAtlas()
+{
+}
+
+size_t AtmProfileAtlas::getNumNode() const
+{
+  if(v_layerThickness_.empty()) return 0;
+  size_t numNode = 1;
+  for(size_t a = 0; a < numAxis_; a++) numNode = numNode * v_axis_[a].size();
+  return numNode;
+}
+
+bool AtmProfileAtlas::mkAtlas()
+{
+  v_layerThickness_.clear();
+  v_table_.clear();
+  for(size_t a = 0; a < numAxis_; a++) {
+    bool valid = !v_axis_[a].empty();
+    for(size_t i = 1; valid && i < v_axis_[a].size(); i++) valid = v_axis_[a][i] > v_axis_[a][i - 1];
+    if(!valid) {
+      std::cout << " AtmProfileAtlas: ERROR: axis " << a << " is empty or not strictly increasing" << std::endl;
+      return false;
+    }
+  }
+
+  if(!atmProfile_.isLayerGridFixed()) atmProfile_.fixLayerGrid();
+  size_t numLayer = atmProfile_.getNumLayer();
+  for(size_t n = 0; n < numLayer; n++) v_layerThickness_.push_back(atmProfile_.getLayerThickness(n).get<Length::m>());
+
+  size_t numNode = getNumNode();
+  v_table_.resize(numNode * 3 * numLayer);
+  AtmProfile workProfile(atmProfile_);
+  double param[numAxis_];
+  for(size_t node = 0; node < numNode; node++) {
+    size_t index = node;
+    for(size_t a = numAxis_; a-- > 0;) {
+      param[a] = v_axis_[a][index % v_axis_[a].size()];
+      index = index / v_axis_[a].size();
+    }
+    double *row = &v_table_[node * 3 * numLayer];
+    mkProfile(workProfile, param, row, row + numLayer, row + 2 * numLayer);
+  }
+  return true;
+}
+
+void AtmProfileAtlas::mkProfile(AtmProfile &workProfile, const double *param,
+                                double *layerTemperature, double *layerPressure, double *layerWaterVapor) const
+{
+  workProfile.setBasicAtmosphericParameterThresholds(Length::from<Length::m>(0.0),
+                                                     Pressure::from<Pressure::mb>(0.0),
+                                                     Temperature::from<Temperature::K>(0.0),
+                                                     0.0,
+                                                     Humidity::from<Humidity::percent>(0.0),
+                                                     Length::from<Length::m>(0.0));
+  workProfile.setBasicAtmosphericParameters(atmProfile_.getAltitude(),
+                                            Pressure::from<Pressure::mb>(param[0]),
+                                            Temperature::from<Temperature::K>(param[1]),
+                                            param[3],
+                                            Humidity::from<Humidity::percent>(param[2]),
+                                            Length::from<Length::km>(param[4]));
+  for(size_t n = 0; n < getNumLayer(); n++) {
+    layerTemperature[n] = workProfile.getLayerTemperature(n).get<Temperature::K>();
+    layerPressure[n] = workProfile.getLayerPressure(n).get<Pressure::mb>();
+    layerWaterVapor[n] = workProfile.getLayerWaterVaporMassDensity(n).get<MassDensity::kg_m3>();
+  }
+}
+
+bool AtmProfileAtlas::getProfile(double groundPressure,
+                                 double groundTemperature,
+                                 double relativeHumidity,
+                                 double tropoLapseRate,
+                                 double wvScaleHeight,
+                                 double *layerTemperature,
+                                 double *layerPressure,
+                                 double *layerWaterVapor) const
+{
+  size_t numLayer = getNumLayer();
+  if(numLayer == 0) return false;
+
+  const double param[numAxis_] = { groundPressure, groundTemperature, relativeHumidity, tropoLapseRate, wvScaleHeight };
+  size_t stride[numAxis_];
+  stride[numAxis_ - 1] = 1;
+  for(size_t a = numAxis_ - 1; a > 0; a--) stride[a - 1] = stride[a] * v_axis_[a].size();
+
+  // lower corner of the cell, and the axes along which the parameter is not on a node
+  bool inside = true;
+  size_t base = 0;
+  size_t numActive = 0;
+  size_t active[numAxis_];
+  double frac[numAxis_];
+  for(size_t a = 0; a < numAxis_; a++) {
+    const vector<double> &x = v_axis_[a];
+    size_t n = x.size();
+    double v = param[a];
+    if(v < x[0]) {
+      if(v < x[0] - 1.0E-9 * fabs(x[0])) inside = false;
+      v = x[0];
+    } else if(v > x[n - 1]) {
+      if(v > x[n - 1] + 1.0E-9 * fabs(x[n - 1])) inside = false;
+      v = x[n - 1];
+    }
+    if(n == 1) continue;
+    size_t i = std::upper_bound(x.begin(), x.end(), v) - x.begin();
+    i = (i > n - 1) ? n - 2 : i - 1;
+    double f = (v - x[i]) / (x[i + 1] - x[i]);
+    base = base + i * stride[a];
+    if(f > 0.0) {
+      active[numActive] = a;
+      frac[numActive] = f;
+      numActive++;
+    }
+  }
+
+  for(size_t n = 0; n < numLayer; n++) {
+    layerTemperature[n] = 0.0;
+    layerPressure[n] = 0.0;
+    layerWaterVapor[n] = 0.0;
+  }
+  for(size_t corner = 0; corner < (size_t(1) << numActive); corner++) {
+    double w = 1.0;
+    size_t node = base;
+    for(size_t b = 0; b < numActive; b++) {
+      if((corner >> b) & 1) {
+        w = w * frac[b];
+        node = node + stride[active[b]];
+      } else {
+        w = w * (1.0 - frac[b]);
+      }
+    }
+    const double *row = &v_table_[node * 3 * numLayer];
+    for(size_t n = 0; n < numLayer; n++) {
+      layerTemperature[n] += w * row[n];
+      layerPressure[n] += w * row[numLayer + n];
+      layerWaterVapor[n] += w * row[2 * numLayer + n];
+    }
+  }
+  return inside;
+}
+
+bool AtmProfileAtlas::getProfile(double groundPressure,
+                                 double groundTemperature,
+                                 double relativeHumidity,
+                                 double *layerTemperature,
+                                 double *layerPressure,
+                                 double *layerWaterVapor) const
+{
+  if(getNumLayer() == 0) return false;
+  return getProfile(groundPressure, groundTemperature, relativeHumidity, v_axis_[3][0], v_axis_[4][0],
+                    layerTemperature, layerPressure, layerWaterVapor);
+}
+
+AtmProfileAtlas::InterpolationError AtmProfileAtlas::getInterpolationError() const
+{
+  InterpolationError error = { 0.0, 0.0, 0.0, 0.0, 0 };
+  size_t numLayer = getNumLayer();
+  if(numLayer == 0) return error;
+
+  size_t numCell = 1;
+  for(size_t a = 0; a < numAxis_; a++) numCell = numCell * std::max(v_axis_[a].size() - 1, size_t(1));
+
+  AtmProfile workProfile(atmProfile_);
+  vector<double> exact(3 * numLayer), interpolated(3 * numLayer);
+  double param[numAxis_];
+  for(size_t cell = 0; cell < numCell; cell++) {
+    size_t index = cell;
+    for(size_t a = numAxis_; a-- > 0;) {
+      const vector<double> &x = v_axis_[a];
+      if(x.size() == 1) {
+        param[a] = x[0];
+      } else {
+        size_t i = index % (x.size() - 1);
+        index = index / (x.size() - 1);
+        param[a] = (x[i] + x[i + 1]) / 2.0;
+      }
+    }
+    mkProfile(workProfile, param, &exact[0], &exact[numLayer], &exact[2 * numLayer]);
+    getProfile(param[0], param[1], param[2], param[3], param[4],
+               &interpolated[0], &interpolated[numLayer], &interpolated[2 * numLayer]);
+    double wExact = 0.0, wInterpolated = 0.0;
+    for(size_t n = 0; n < numLayer; n++) {
+      error.temperature = std::max(error.temperature, fabs(interpolated[n] - exact[n]));
+      error.pressure = std::max(error.pressure, fabs(interpolated[numLayer + n] / exact[numLayer + n] - 1.0));
+      error.waterVapor = std::max(error.waterVapor, fabs(interpolated[2 * numLayer + n] - exact[2 * numLayer + n]));
+      wExact = wExact + exact[2 * numLayer + n] * v_layerThickness_[n];
+      wInterpolated = wInterpolated + interpolated[2 * numLayer + n] * v_layerThickness_[n];
+    }
+    if(wExact > 0.0) error.groundWH2O = std::max(error.groundWH2O, fabs(wInterpolated / wExact - 1.0));
+    error.numTest++;
+  }
+  return error;
+}
+
+bool AtmProfileAtlas::save(const string &fileName) const
+{
+  std::ofstream file(fileName.c_str());
+  if(!file) {
+    std::cout << " AtmProfileAtlas: ERROR: cannot open " << fileName << " for writing" << std::endl;
+    return false;
+  }
+  file << std::setprecision(17);
+  file << "AtmProfileAtlas 1" << std::endl;
+  file << atmProfile_.getAltitude().get<Length::m>() << " " << atmProfile_.getPressureStep().get<Pressure::mb>() << " "
+       << atmProfile_.getPressureStepFactor().get() << " " << atmProfile_.getTopAtmProfile().get<Length::m>() << " "
+       << atmProfile_.getTypeAtm() << std::endl;
+  file << getNumLayer();
+  double top = 0.0;
+  for(size_t n = 0; n < getNumLayer(); n++) {
+    top = top + v_layerThickness_[n];
+    file << " " << top;
+  }
+  file << std::endl;
+  for(size_t a = 0; a < numAxis_; a++) {
+    file << v_axis_[a].size();
+    for(size_t i = 0; i < v_axis_[a].size(); i++) file << " " << v_axis_[a][i];
+    file << std::endl;
+  }
+  size_t rowSize = 3 * getNumLayer();
+  for(size_t node = 0; node < getNumNode(); node++) {
+    for(size_t k = 0; k < rowSize; k++) file << (k == 0 ? "" : " ") << v_table_[node * rowSize + k];
+    file << std::endl;
+  }
+  if(!file) {
+    std::cout << " AtmProfileAtlas: ERROR: failed to write " << fileName << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool AtmProfileAtlas::load(const string &fileName)
+{
+  std::ifstream file(fileName.c_str());
+  if(!file) {
+    std::cout << " AtmProfileAtlas: ERROR: cannot open " << fileName << std::endl;
+    return false;
+  }
+  string tag;
+  int version = 0;
+  double altitude = 0.0, pressureStep = 0.0, pressureStepFactor = 0.0, topAtmProfile = 0.0;
+  size_t typeAtm = 0, numLayer = 0;
+  file >> tag >> version >> altitude >> pressureStep >> pressureStepFactor >> topAtmProfile >> typeAtm >> numLayer;
+  if(!file || tag != "AtmProfileAtlas" || version != 1 || numLayer == 0) {
+    std::cout << " AtmProfileAtlas: ERROR: " << fileName << " is not an atlas file" << std::endl;
+    return false;
+  }
+  vector<Length> v_layerTop(numLayer);
+  for(size_t n = 0; n < numLayer; n++) {
+    double top = 0.0;
+    file >> top;
+    v_layerTop[n] = Length::from<Length::m>(top);
+  }
+  vector<double> v_axis[numAxis_];
+  size_t numNode = 1;
+  for(size_t a = 0; a < numAxis_ && file; a++) {
+    size_t n = 0;
+    file >> n;
+    v_axis[a].resize(n);
+    for(size_t i = 0; i < n; i++) file >> v_axis[a][i];
+    numNode = numNode * n;
+  }
+  vector<double> v_table(numNode * 3 * numLayer);
+  for(size_t k = 0; k < v_table.size() && file; k++) file >> v_table[k];
+  if(!file || numNode == 0) {
+    std::cout << " AtmProfileAtlas: ERROR: " << fileName << " is truncated or corrupted" << std::endl;
+    return false;
+  }
+
+  AtmProfile atmProfile(Length::from<Length::m>(altitude),
+                        Pressure::from<Pressure::mb>(v_axis[0][0]),
+                        Temperature::from<Temperature::K>(v_axis[1][0]),
+                        v_axis[3][0],
+                        Humidity::from<Humidity::percent>(v_axis[2][0]),
+                        Length::from<Length::km>(v_axis[4][0]),
+                        Pressure::from<Pressure::mb>(pressureStep),
+                        pressureStepFactor,
+                        Length::from<Length::m>(topAtmProfile),
+                        typeAtm);
+  if(!atmProfile.setFixedLayerGrid(v_layerTop)) return false;
+
+  atmProfile_ = atmProfile;
+  for(size_t a = 0; a < numAxis_; a++) v_axis_[a] = v_axis[a];
+  v_layerThickness_.resize(numLayer);
+  for(size_t n = 0; n < numLayer; n++) v_layerThickness_[n] = atmProfile_.getLayerThickness(n).get<Length::m>();
+  v_table_ = v_table;
+  return true;
+}
+
+ATM_NAMESPACE_END
@@ -0,0 +1,321 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMProfileBatch.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMProfileBatch.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+AtmProfileBatch::AtmProfileBatch(const AtmProfile &atmProfile) :
+  atmProfile_(atmProfile), workProfile_(atmProfile), numComputed_(0)
+{
+  v_layerOffset_.push_back(0);
+}
+
+AtmProfileBatch::~AtmProfileBatch()
+{
+}
+
+size_t AtmProfileBatch::addRecord(const Pressure &groundPressure,
+                                  const Temperature &groundTemperature,
+                                  const Humidity &relativeHumidity)
+{
+  v_groundPressure_.push_back(groundPressure.get<Pressure::mb>());
+  v_groundTemperature_.push_back(groundTemperature.get<Temperature::K>());
+  v_relativeHumidity_.push_back(relativeHumidity.get<Humidity::percent>());
+  return v_groundPressure_.size() - 1;
+}
+
+size_t AtmProfileBatch::addRecords(const vector<double> &groundPressure,
+                                   const vector<double> &groundTemperature,
+                                   const vector<double> &relativeHumidity)
+{
+  if(groundTemperature.size() != groundPressure.size() || relativeHumidity.size() != groundPressure.size()) {
+    std::cout << " AtmProfileBatch: ERROR: the arrays of ground pressure, temperature and humidity differ in size"
+        << std::endl;
+    return 0;
+  }
+  v_groundPressure_.insert(v_groundPressure_.end(), groundPressure.begin(), groundPressure.end());
+  v_groundTemperature_.insert(v_groundTemperature_.end(), groundTemperature.begin(), groundTemperature.end());
+  v_relativeHumidity_.insert(v_relativeHumidity_.end(), relativeHumidity.begin(), relativeHumidity.end());
+  return groundPressure.size();
+}
+
+void AtmProfileBatch::clearRecords()
+{
+  v_groundPressure_.clear();
+  v_groundTemperature_.clear();
+  v_relativeHumidity_.clear();
+  numComputed_ = 0;
+  v_layerOffset_.assign(1, 0);
+  v_groundWH2O_.clear();
+  v_layerThickness_.clear();
+  v_layerTemperature_.clear();
+  v_layerPressure_.clear();
+  v_layerWaterVapor_.clear();
+  v_layerO3_.clear();
+  v_layerCO_.clear();
+  v_layerN2O_.clear();
+  v_layerNO2_.clear();
+  v_layerSO2_.clear();
+}
+
+void AtmProfileBatch::compute()
+{
+  size_t numRecord = getNumRecord();
+
+  // the tables are refilled from the start; their capacity is kept from one call to the next
+  v_layerOffset_.assign(1, 0);
+  v_groundWH2O_.resize(numRecord);
+  size_t numLayerGuess = numRecord * atmProfile_.getNumLayer();
+  v_layerThickness_.clear();
+  v_layerTemperature_.clear();
+  v_layerPressure_.clear();
+  v_layerWaterVapor_.clear();
+  v_layerO3_.clear();
+  v_layerCO_.clear();
+  v_layerN2O_.clear();
+  v_layerNO2_.clear();
+  v_layerSO2_.clear();
+  v_layerThickness_.reserve(numLayerGuess);
+  v_layerTemperature_.reserve(numLayerGuess);
+  v_layerPressure_.reserve(numLayerGuess);
+  v_layerWaterVapor_.reserve(numLayerGuess);
+  v_layerO3_.reserve(numLayerGuess);
+  v_layerCO_.reserve(numLayerGuess);
+  v_layerN2O_.reserve(numLayerGuess);
+  v_layerNO2_.reserve(numLayerGuess);
+  v_layerSO2_.reserve(numLayerGuess);
+  v_layerOffset_.reserve(numRecord + 1);
+
+  if(workProfile_.v_fixedLayerTop_.empty()) {
+    mkLevels();
+    mkLayers();
+  } else {
+    mkRecordProfiles();
+  }
+  numComputed_ = numRecord;
+}
+
+void AtmProfileBatch::mkLevels()
+{
+  // the integration of AtmProfile::mkAtmProfile(), with the same arithmetic, carried out for all the
+  // records at each level
+  const AtmProfile &w = workProfile_;
+  const double (&hx)[20] = AtmProfile::referenceHeight_;
+  const double (&px)[20] = AtmProfile::referencePressure_[w.typeAtm_ - 1];
+  const double (&tx)[20] = AtmProfile::referenceTemperature_[w.typeAtm_ - 1];
+  size_t numRecord = getNumRecord();
+  double h0 = w.wvScaleHeight_.get<Length::km>();
+  double dp = w.pressureStep_.get<Pressure::mb>();
+  double alti = w.altitude_.get<Length::km>();
+  double atmh = w.topAtmProfile_.get<Length::km>();
+  double dp1 = w.pressureStepFactor_;
+  double dt = w.tropoLapseRate_;
+  double rt = 6371.2E+0; // Earth radius in km
+  double g0 = 9.80665E+0; // Earth gravity at the surface  (m/s**2)
+
+  // level 0: the ground, with the values mkAtmProfile() reads back from the basic parameters
+  v_levelPressure_.resize(numRecord);
+  v_levelTemperature_.resize(numRecord);
+  v_levelHeight_.assign(numRecord, alti * 1000);
+  v_levelWaterVapor_.resize(numRecord);
+  v_wgr0_.resize(numRecord);
+  v_gravity_.assign(numRecord, g0);
+  v_prLimit_.assign(numRecord, 100.0); // as mkAtmProfile() for all the types of atmosphere
+  v_refLevel_.assign(numRecord, 0);
+  v_tropospheric_.assign(numRecord, 1);
+  v_numLayerRecord_.assign(numRecord, 0);
+  v_active_.resize(numRecord);
+  for(size_t r = 0; r < numRecord; r++) {
+    v_levelPressure_[r] = Pressure::from<Pressure::mb>(v_groundPressure_[r]).get<Pressure::mb>();
+    v_levelTemperature_[r] = Temperature::from<Temperature::K>(v_groundTemperature_[r]).get<Temperature::K>();
+    double rh = Humidity::from<Humidity::percent>(v_relativeHumidity_[r]).get<Humidity::percent>();
+    v_levelWaterVapor_[r] = w.rwat(Temperature::from<Temperature::K>(v_levelTemperature_[r]),
+                                   Humidity::from<Humidity::percent>(rh),
+                                   Pressure::from<Pressure::mb>(v_levelPressure_[r])).get<MassDensity::g_m3>();
+    v_wgr0_[r] = v_levelWaterVapor_[r] * exp(alti / h0);
+    v_active_[r] = r;
+  }
+
+  for(size_t i = 1; !v_active_.empty(); i++) {
+    v_levelPressure_.resize((i + 1) * numRecord);
+    v_levelTemperature_.resize((i + 1) * numRecord);
+    v_levelHeight_.resize((i + 1) * numRecord);
+    v_levelWaterVapor_.resize((i + 1) * numRecord);
+    const double *p0 = &v_levelPressure_[(i - 1) * numRecord];
+    const double *t0 = &v_levelTemperature_[(i - 1) * numRecord];
+    const double *z0 = &v_levelHeight_[(i - 1) * numRecord];
+    const double *w0 = &v_levelWaterVapor_[(i - 1) * numRecord];
+    double *p1 = &v_levelPressure_[i * numRecord];
+    double *t1 = &v_levelTemperature_[i * numRecord];
+    double *z1 = &v_levelHeight_[i * numRecord];
+    double *w1 = &v_levelWaterVapor_[i * numRecord];
+    double pstep = dp * pow(dp1, (int)(i - 1)); // the same for all the records
+
+    size_t numActive = 0;
+    for(size_t a = 0; a < v_active_.size(); a++) {
+      size_t r = v_active_[a];
+      if(p0[r] - pstep <= v_prLimit_[r]) {
+        // above the troposphere: the levels of the reference atmosphere
+        size_t &j = v_refLevel_[r];
+        if(v_tropospheric_[r]) {
+          double minmin = 20000.0;
+          for(size_t k = 0; k < 20; k++) {
+            if((fabs(p0[r] - pstep) > 1.05 * px[k]) && (fabs(p0[r] - pstep - px[k]) <= minmin)) {
+              j = k;
+              minmin = fabs(p0[r] - pstep - px[k]);
+            }
+          }
+          size_t j0 = (j > 0) ? j - 1 : 0;
+          p1[r] = px[j0];
+          t1[r] = tx[j0];
+          double www = w0[r] / 1000.0;
+          double dh = 288.6948 * t0[r] * (1.0 + 0.61 * www / 1000.0) * log(p0[r] / p1[r]) / v_gravity_[r];
+          z1[r] = z0[r] + dh;
+          v_tropospheric_[r] = 0;
+        } else {
+          j++;
+          p1[r] = px[j - 1];
+          t1[r] = tx[j - 1];
+          z1[r] = (hx[j] - hx[j - 1]) * 1000.0 + z0[r];
+        }
+        w1[r] = v_wgr0_[r] * exp(-z1[r] / (1000.0 * h0));
+      } else {
+        // troposphere: hydrostatic step with the lapse rate
+        p1[r] = p0[r] - pstep;
+        double www = w0[r] / 1000.0; // in kg/m**3
+        v_gravity_[r] = g0 * pow(1. + ((z0[r] / 1000.0)) / rt, (int)(-2)); // gravity corrected for the height
+        double dh = 288.6948 * t0[r] * (1.0 + 0.61 * www / 1000.0) * log(p0[r] / p1[r]) / v_gravity_[r];
+        z1[r] = z0[r] + dh;
+        t1[r] = t0[r] + dt * dh / 1000.0;
+        w1[r] = v_wgr0_[r] * exp(-z1[r] / (1000.0 * h0));
+        if(t1[r] <= tx[0] && p1[r] <= px[0]) v_prLimit_[r] = p1[r];
+      }
+      if(z1[r] > (atmh * 1000.0)) {
+        v_numLayerRecord_[r] = i - 1; // the last level is not used, as in mkAtmProfile()
+      } else {
+        v_active_[numActive++] = r;
+      }
+    }
+    v_active_.resize(numActive);
+  }
+}
+
+void AtmProfileBatch::mkLayers()
+{
+  size_t numRecord = getNumRecord();
+  double alti = workProfile_.altitude_.get<Length::km>();
+  size_t numLayerTotal = 0;
+  v_layerAltitude_.clear();
+
+  for(size_t r = 0; r < numRecord; r++) {
+    size_t numLayer = v_numLayerRecord_[r];
+    double altura = alti;
+    double wm = 0;
+    for(size_t j = 0; j < numLayer; j++) {
+      size_t l0 = j * numRecord + r;
+      size_t l1 = l0 + numRecord;
+      double thickness = v_levelHeight_[l1] - v_levelHeight_[l0]; // in m
+      double waterVapor = 1.0E-3 * exp((log(v_levelWaterVapor_[l1]) + log(v_levelWaterVapor_[l0])) / 2.0); // in kg/m**3
+      altura = altura + thickness / 2.0E3; // in km
+      v_layerAltitude_.push_back(altura);
+      altura = altura + thickness / 2.0E3;
+      v_layerThickness_.push_back(thickness);
+      v_layerTemperature_.push_back((v_levelTemperature_[l1] + v_levelTemperature_[l0]) / 2.); // in K
+      v_layerPressure_.push_back(exp((log(v_levelPressure_[l1]) + log(v_levelPressure_[l0])) / 2.0)); // in mb
+      v_layerWaterVapor_.push_back(waterVapor);
+      wm = wm + waterVapor * thickness; // kg/m**2 or mm
+    }
+    numLayerTotal = numLayerTotal + numLayer;
+    v_layerOffset_.push_back(numLayerTotal);
+    v_groundWH2O_[r] = wm * 1e-3; // in m
+  }
+
+  // the minor gases of all the layers of all the records at once
+  v_layerO3_.resize(numLayerTotal);
+  v_layerCO_.resize(numLayerTotal);
+  v_layerN2O_.resize(numLayerTotal);
+  v_layerNO2_.resize(numLayerTotal);
+  v_layerSO2_.resize(numLayerTotal);
+  AtmProfile::getMinorGasDensities(workProfile_.typeAtm_, numLayerTotal, v_layerAltitude_.data(),
+                                   v_layerO3_.data(), v_layerCO_.data(), v_layerN2O_.data(),
+                                   v_layerNO2_.data(), v_layerSO2_.data()); // in m**-3
+}
+
+void AtmProfileBatch::mkRecordProfiles()
+{
+  size_t numRecord = getNumRecord();
+  size_t numLayerTotal = 0;
+  AtmProfile &w = workProfile_;
+  for(size_t record = 0; record < numRecord; record++) {
+    // same profile as the constructor of AtmProfile would build, without the threshold checks
+    w.groundPressure_ = Pressure::from<Pressure::mb>(v_groundPressure_[record]);
+    w.groundTemperature_ = Temperature::from<Temperature::K>(v_groundTemperature_[record]);
+    w.relativeHumidity_ = Humidity::from<Humidity::percent>(v_relativeHumidity_[record]);
+    w.numLayer_ = w.mkAtmProfile();
+    w.newBasicParam_ = true;
+
+    size_t numLayer = w.numLayer_;
+    v_layerThickness_.insert(v_layerThickness_.end(), w.v_layerThickness_.begin(), w.v_layerThickness_.begin() + numLayer);
+    v_layerTemperature_.insert(v_layerTemperature_.end(), w.v_layerTemperature_.begin(), w.v_layerTemperature_.begin() + numLayer);
+    v_layerPressure_.insert(v_layerPressure_.end(), w.v_layerPressure_.begin(), w.v_layerPressure_.begin() + numLayer);
+    v_layerWaterVapor_.insert(v_layerWaterVapor_.end(), w.v_layerWaterVapor_.begin(), w.v_layerWaterVapor_.begin() + numLayer);
+    v_layerO3_.insert(v_layerO3_.end(), w.v_layerO3_.begin(), w.v_layerO3_.begin() + numLayer);
+    v_layerCO_.insert(v_layerCO_.end(), w.v_layerCO_.begin(), w.v_layerCO_.begin() + numLayer);
+    v_layerN2O_.insert(v_layerN2O_.end(), w.v_layerN2O_.begin(), w.v_layerN2O_.begin() + numLayer);
+    v_layerNO2_.insert(v_layerNO2_.end(), w.v_layerNO2_.begin(), w.v_layerNO2_.begin() + numLayer);
+    v_layerSO2_.insert(v_layerSO2_.end(), w.v_layerSO2_.begin(), w.v_layerSO2_.begin() + numLayer);
+
+    numLayerTotal = numLayerTotal + numLayer;
+    v_layerOffset_.push_back(numLayerTotal);
+    v_groundWH2O_[record] = w.getGroundWH2O().get();
+  }
+}
+
+size_t AtmProfileBatch::getNumLayer(size_t record) const
+{
+  if(record >= numComputed_) return 0;
+  return v_layerOffset_[record + 1] - v_layerOffset_[record];
+}
+
+size_t AtmProfileBatch::getLayerOffset(size_t record) const
+{
+  if(record > numComputed_) return v_layerOffset_[numComputed_];
+  return v_layerOffset_[record];
+}
+
+Length AtmProfileBatch::getGroundWH2O(size_t record) const
+{
+  if(record >= numComputed_) return Length::from<Length::mm>(-999.0);
+  return Length::from<Length::m>(v_groundWH2O_[record]);
+}
+
+ATM_NAMESPACE_END
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMProfileReader.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMProfileReader.h"
+
+#include <ctype.h>
+#include <sstream>
+#include <stdlib.h>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+AtmProfileReader::AtmProfileReader(const string &fileName) :
+  file_(fileName.c_str()), stream_(0), lineNumber_(0), pendingHeader_(false), numColumn_(0), numProfile_(0)
+{
+  if(file_) stream_ = &file_;
+}
+
+AtmProfileReader::AtmProfileReader(std::istream &stream) :
+  stream_(&stream), lineNumber_(0), pendingHeader_(false), numColumn_(0), numProfile_(0)
+{
+}
+
+AtmProfileReader::~AtmProfileReader()
+{
+}
+
+bool AtmProfileReader::next()
+{
+  error_.clear();
+  label_.clear();
+  numColumn_ = 0;
+  for(size_t k = 0; k < maxColumn_; k++) v_column_[k].clear();
+  if(stream_ == 0) return false;
+
+  bool started = false;
+  if(pendingHeader_) {
+    label_ = pendingLabel_;
+    pendingHeader_ = false;
+    started = true;
+  }
+  while(std::getline(*stream_, line_)) {
+    lineNumber_++;
+    size_t first = line_.find_first_not_of(" \t\r");
+    if(first == string::npos || line_[first] == '#') continue;
+    if(line_.compare(first, 7, "profile") == 0 && (first + 7 == line_.size() || isspace(line_[first + 7]))) {
+      size_t begin = line_.find_first_not_of(" \t\r", first + 7);
+      size_t end = line_.find_last_not_of(" \t\r");
+      string label = begin == string::npos ? string() : line_.substr(begin, end + 1 - begin);
+      if(started) {
+        // this header starts the next profile
+        pendingHeader_ = true;
+        pendingLabel_ = label;
+        break;
+      }
+      label_ = label;
+      started = true;
+      continue;
+    }
+    started = true;
+    // after a problem, the rest of the profile is skipped
+    if(error_.empty()) parseLevel();
+  }
+  if(!started) return false;
+
+  numProfile_++;
+  if(error_.empty()) {
+    string problem = AtmProfile::checkUserLevels(getLevels());
+    if(!problem.empty()) {
+      std::ostringstream where;
+      where << "profile ending at line " << lineNumber_ << ": " << problem;
+      error_ = where.str();
+    }
+  }
+  return true;
+}
+
+bool AtmProfileReader::parseLevel()
+{
+  double value[maxColumn_];
+  size_t num = 0;
+  const char *c = line_.c_str();
+  char *end;
+  while(true) {
+    while(isspace(*c)) c++;
+    if(*c == '\0') break;
+    value[num < maxColumn_ ? num : maxColumn_ - 1] = strtod(c, &end);
+    if(end == c || (*end != '\0' && !isspace(*end))) {
+      std::ostringstream problem;
+      problem << "line " << lineNumber_ << ": column " << num + 1 << " is not a number";
+      error_ = problem.str();
+      return false;
+    }
+    c = end;
+    num++;
+  }
+  if((num != minColumn_ && num != maxColumn_) || (numColumn_ != 0 && num != numColumn_)) {
+    std::ostringstream problem;
+    problem << "line " << lineNumber_ << ": " << num << " columns instead of ";
+    if(numColumn_ != 0) problem << numColumn_;
+    else problem << minColumn_ << " or " << maxColumn_;
+    error_ = problem.str();
+    return false;
+  }
+  numColumn_ = num;
+  for(size_t k = 0; k < num; k++) v_column_[k].push_back(value[k]);
+  return true;
+}
+
+AtmProfile::UserLevels AtmProfileReader::getLevels() const
+{
+  AtmProfile::UserLevels levels;
+  levels.numLevel = getNumLevel();
+  if(levels.numLevel == 0) return levels;
+  levels.altitude = &v_column_[0][0];
+  levels.pressure = &v_column_[1][0];
+  levels.temperature = &v_column_[2][0];
+  levels.waterVapor = &v_column_[3][0];
+  if(hasMinorGases()) {
+    levels.o3 = &v_column_[4][0];
+    levels.co = &v_column_[5][0];
+    levels.n2o = &v_column_[6][0];
+    levels.no2 = &v_column_[7][0];
+    levels.so2 = &v_column_[8][0];
+  }
+  return levels;
+}
+
+ATM_NAMESPACE_END
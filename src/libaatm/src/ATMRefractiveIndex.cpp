@@ -44,7 +44,7 @@ ATM_NAMESPACE_BEGIN
   // Constructors
 
 
-  RefractiveIndex::RefractiveIndex(){ }
+  RefractiveIndex::RefractiveIndex() : partials_(0) { }
 
   RefractiveIndex::~RefractiveIndex()
   {
@@ -88,6 +88,38 @@ ATM_NAMESPACE_BEGIN
     return averagen;
   }
 
+  std::complex<double> RefractiveIndex::getRefractivity_o2(double temperature, double pressure, double wvpressure, double frequency,
+							 Partials &partials){
+
+    static const double abun_18o=0.0020439;
+    static const double abun_17o=0.0003750;
+    static const double o2_mixing_ratio=0.2092;
+
+    // same sum as getRefractivity_o2(temperature,pressure,wvpressure,frequency), each term with its derivatives
+    double pob=exp(-1556.38*1.43/temperature);
+    double dpob=pob*1556.38*1.43/(temperature*temperature);
+    double w[4]={(1.0-2.0*(abun_18o+abun_17o))*(1.0-pob), (1.0-2.0*(abun_18o+abun_17o))*pob, 2.0*abun_18o, 2.0*abun_17o};
+    double dw[4]={-(1.0-2.0*(abun_18o+abun_17o))*dpob, (1.0-2.0*(abun_18o+abun_17o))*dpob, 0.0, 0.0};
+    std::complex<double> sum(0.0,0.0);
+    partials=Partials();
+    for(size_t species=1; species<5; species++){
+      Partials p;
+      std::complex<double> r=mkSpecificRefractivity(species,temperature,pressure,wvpressure,frequency,p);
+      sum=sum+r*w[species-1];
+      partials.temperature=partials.temperature+p.temperature*w[species-1]+r*dw[species-1];
+      partials.pressure=partials.pressure+p.pressure*w[species-1];
+      partials.wvpressure=partials.wvpressure+p.wvpressure*w[species-1];
+    }
+
+    // number density of O2 proportional to pressure/temperature
+    double density=o2_mixing_ratio*pressure*100.0/(1.380662e-23*temperature);
+    partials.temperature=(partials.temperature-sum/temperature)*density;
+    partials.pressure=partials.pressure*density+sum*(o2_mixing_ratio*100.0/(1.380662e-23*temperature));
+    partials.wvpressure=partials.wvpressure*density;
+    return sum*density;
+
+  }
+
 
 
   std::complex<double> RefractiveIndex::getRefractivity_h2o(double temperature, double pressure, double wvpressure, double frequency){
@@ -124,6 +156,40 @@ ATM_NAMESPACE_BEGIN
     return averagen;
   }
 
+  std::complex<double> RefractiveIndex::getRefractivity_h2o(double temperature, double pressure, double wvpressure, double frequency,
+							  Partials &partials){
+
+    static const double abun_18o=0.0020439;
+    static const double abun_17o=0.0003750;
+    static const double abun_D=0.000298444;
+    static const double mmol_h2o=18.005059688;
+
+    // same sum as getRefractivity_h2o(temperature,pressure,wvpressure,frequency), each term with its derivatives
+    static const size_t species[5]={11,12,13,14,15};
+    double pob=exp(-2322.92/temperature);
+    double dpob=pob*2322.92/(temperature*temperature);
+    double w[5]={(1-abun_18o-abun_17o-2.0*abun_D)*(1.0-pob), (1-abun_18o-abun_17o-2.0*abun_D)*pob, abun_18o, abun_17o, 2.0*abun_D};
+    double dw[5]={-(1-abun_18o-abun_17o-2.0*abun_D)*dpob, (1-abun_18o-abun_17o-2.0*abun_D)*dpob, 0.0, 0.0, 0.0};
+    std::complex<double> sum(0.0,0.0);
+    partials=Partials();
+    for(size_t k=0; k<5; k++){
+      Partials p;
+      std::complex<double> r=mkSpecificRefractivity(species[k],temperature,pressure,wvpressure,frequency,p);
+      sum=sum+r*w[k];
+      partials.temperature=partials.temperature+p.temperature*w[k]+r*dw[k];
+      partials.pressure=partials.pressure+p.pressure*w[k];
+      partials.wvpressure=partials.wvpressure+p.wvpressure*w[k];
+    }
+
+    // number density of H2O proportional to wvpressure/temperature
+    double density=6.023e23*wvpressure*217.0/(temperature*mmol_h2o);
+    partials.temperature=(partials.temperature-sum/temperature)*density;
+    partials.pressure=partials.pressure*density;
+    partials.wvpressure=partials.wvpressure*density+sum*(6.023e23*217.0/(temperature*mmol_h2o));
+    return sum*density;
+
+  }
+
 
   std::complex<double> RefractiveIndex::getSpecificRefractivity_o3(double temperature, double pressure, double frequency){
 
@@ -175,6 +241,92 @@ ATM_NAMESPACE_BEGIN
     return averagen;
   }
 
+  std::complex<double> RefractiveIndex::getSpecificRefractivity_o3(double temperature, double pressure, double frequency,
+								 Partials &partials){
+
+    static const double abun_18o=0.0020439;
+    static const double abun_17o=0.0003750;
+    static const double Tex_nu2=1009.5;   //(in Kelvin)  Degeneracy=1  http://www.cfa.harvard.edu/hitran/vibrational.html
+    static const double Tex_nu1=1588.41;  //(in Kelvin)  Degeneracy=1
+    static const double Tex_nu3=1500.48;  //(in Kelvin)  Degeneracy=1
+
+    // same sum as getSpecificRefractivity_o3(temperature,pressure,frequency), each term with its derivatives
+    static const size_t species[8]={16,21,20,23,22,17,18,19};
+    double pob_v2=exp(-Tex_nu2/temperature);
+    double pob_v1=exp(-Tex_nu1/temperature);
+    double pob_v3=exp(-Tex_nu3/temperature);
+    double dpob_v2=pob_v2*Tex_nu2/(temperature*temperature);
+    double dpob_v1=pob_v1*Tex_nu1/(temperature*temperature);
+    double dpob_v3=pob_v3*Tex_nu3/(temperature*temperature);
+    double g=(1-pob_v2-pob_v1-pob_v3)/(1.0+3.0*(abun_18o+abun_17o));
+    double dg=-(dpob_v2+dpob_v1+dpob_v3)/(1.0+3.0*(abun_18o+abun_17o));
+    double a[5]={1.0, 2*abun_17o, 2*abun_18o, abun_17o, abun_18o};
+    double w[8]={g*a[0], g*a[1], g*a[2], g*a[3], g*a[4], pob_v2, pob_v1, pob_v3};
+    double dw[8]={dg*a[0], dg*a[1], dg*a[2], dg*a[3], dg*a[4], dpob_v2, dpob_v1, dpob_v3};
+    std::complex<double> sum(0.0,0.0);
+    partials=Partials();
+    for(size_t k=0; k<8; k++){
+      Partials p;
+      std::complex<double> r=mkSpecificRefractivity(species[k],temperature,pressure,0.0,frequency,p);
+      sum=sum+r*w[k];
+      partials.temperature=partials.temperature+p.temperature*w[k]+r*dw[k];
+      partials.pressure=partials.pressure+p.pressure*w[k];
+    }
+    return sum;    //m^2
+
+  }
+
+  RefractiveIndex::LineCache &RefractiveIndex::lineCache(size_t species, double tt, double pp, double eh2o, size_t numLines)
+  {
+    LineCache &c=lineCache_[species];
+    if(c.tt!=tt||c.pp!=pp||c.eh2o!=eh2o||c.ready.size()!=numLines){
+      c.tt=tt;
+      c.pp=pp;
+      c.eh2o=eh2o;
+      c.dv.resize(numLines);
+      c.itf.assign(numLines,0.0);
+      c.boltz.resize(numLines);
+      c.stim.resize(numLines);
+      c.ready.assign(numLines,0);
+      c.partials=false;
+    }
+    if(partials_&&!c.partials){
+      // the derivatives of dv and itf are kept with every line computed from now on
+      c.ddv.resize(3*numLines);
+      c.ditf.assign(3*numLines,0.0);
+      c.ready.assign(numLines,0);
+      c.partials=true;
+    }
+    return c;
+  }
+
+  void RefractiveIndex::addLinePartials(Partials &sum, double v, double vl, double dv, double itf,
+					const double *ddv, const double *ditf,
+					double strength, double dlnStrength, const std::complex<double> &term)
+  {
+    // derivatives of lineshape(v,vl,dv,itf) with respect to dv and itf
+    std::complex<double> a(vl-v,-dv);
+    std::complex<double> b(vl+v,dv);
+    std::complex<double> i(0.0,1.0);
+    std::complex<double> ldv=(v/vl)*i*(std::complex<double>(1.0,-itf)/(a*a)+std::complex<double>(1.0,itf)/(b*b))*strength;
+    sum.temperature=sum.temperature+ldv*ddv[0]+term*dlnStrength;
+    sum.pressure=sum.pressure+ldv*ddv[1];
+    sum.wvpressure=sum.wvpressure+ldv*ddv[2];
+    if(ditf){
+      std::complex<double> litf=-(v/vl)*i*(1.0/a+1.0/b)*strength;
+      sum.temperature=sum.temperature+litf*ditf[0];
+      sum.pressure=sum.pressure+litf*ditf[1];
+      sum.wvpressure=sum.wvpressure+litf*ditf[2];
+    }
+  }
+
+  void RefractiveIndex::scalePartials(Partials &sum, double scale, const std::complex<double> &value, double dlnScale)
+  {
+    sum.temperature=sum.temperature*scale+value*dlnScale;
+    sum.pressure=sum.pressure*scale;
+    sum.wvpressure=sum.wvpressure*scale;
+  }
+
   size_t RefractiveIndex::vpIndex(double nu)
   {
     size_t vp;
@@ -187,10 +339,22 @@ ATM_NAMESPACE_BEGIN
     return vp;
   }
 
-  double RefractiveIndex::linebroadening(double nu, double temp, double pr, double mmol, double dv0_lines, double texp_lines){
+  // derivatives of the broadening dv from those of the pressure broadening dv0 (beta_dop: Doppler width,
+  // proportional to sqrt(temperature)), in the order (temperature, pressure, water vapor pressure)
+  static void mkBroadeningPartials(double dv0, double beta_dop, double temp, double *partials)
+  {
+    if((dv0/beta_dop)<1.25){
+      double s=sqrt(0.217*pow(dv0,2)+0.6931*pow(beta_dop,2));
+      for(size_t k=0; k<3; k++){ partials[k]=0.535*partials[k]+0.217*dv0*partials[k]/s; }
+      partials[0]=partials[0]+0.6931*beta_dop*beta_dop/(2.0*temp*s);
+    }
+  }
+
+  double RefractiveIndex::linebroadening(double nu, double temp, double pr, double mmol, double dv0_lines, double texp_lines,
+					 double *partials){
 
-    // pr = pp.get("mb");
-    // temp = tt.get("K");
+    // pr = pp.get<Pressure::mb>();
+    // temp = tt.get<Temperature::K>();
     double dv0;
     double dv;
 
@@ -202,15 +366,22 @@ ATM_NAMESPACE_BEGIN
     }else{
       dv=dv0;
     }
+    if(partials){
+      partials[0]=-texp_lines*dv0/temp;
+      partials[1]=dv0_lines*pow(300/temp,texp_lines);
+      partials[2]=0.0;
+      mkBroadeningPartials(dv0,beta_dop,temp,partials);
+    }
     return dv;   //in GHz
   }
 
 
-  double RefractiveIndex::linebroadening_o2(double nu, double temp, double pr, double eh2o, double mmol, double ensanche1, double ensanche2){
+  double RefractiveIndex::linebroadening_o2(double nu, double temp, double pr, double eh2o, double mmol, double ensanche1, double ensanche2,
+					    double *partials){
 
-    // pr = pp.get("mb");
-    // eh2o = ph2o.get("mb");
-    // temp = tt.get("K");
+    // pr = pp.get<Pressure::mb>();
+    // eh2o = ph2o.get<Pressure::mb>();
+    // temp = tt.get<Temperature::K>();
     // nu in GHz
     double dv0;
     double dv;
@@ -221,34 +392,46 @@ ATM_NAMESPACE_BEGIN
 
     if((dv0/beta_dop)<1.25){
       dv=0.535*dv0+sqrt(0.217*pow(dv0,2)+0.6931*pow(beta_dop,2));   // "Atmospheric Remote Sensing", Janssen, pag. 59
-      //      cout << pp.get("mb") << "mb: usando beta_dop" << endl;
+      //      cout << pp.get<Pressure::mb>() << "mb: usando beta_dop" << endl;
     }else{
       dv=dv0;
     }
+    if(partials){
+      partials[0]=-1e-3*ensanche1*((pr-eh2o)*ensanche2*pow(300/temp,ensanche2)+1.1*eh2o*300/temp)/temp;
+      partials[1]=1e-3*ensanche1*pow(300/temp,ensanche2);
+      partials[2]=1e-3*ensanche1*(1.1*300/temp-pow(300/temp,ensanche2));
+      mkBroadeningPartials(dv0,beta_dop,temp,partials);
+    }
 
     return dv;   // in GHz
 
   }
 
 
-  double RefractiveIndex::interf_o2(double temp, double pp, double ensanche3,double ensanche4){
+  double RefractiveIndex::interf_o2(double temp, double pp, double ensanche3,double ensanche4, double *partials){
 
-    // temp = tt.get("K");
+    // temp = tt.get<Temperature::K>();
 
     double interf=1e-3*(ensanche3+ensanche4*(300/temp))*pp*pow(300/temp,0.8);
+    if(partials){
+      partials[0]=-1e-3*(ensanche4*(300/temp)+0.8*(ensanche3+ensanche4*(300/temp)))*pp*pow(300/temp,0.8)/temp;
+      partials[1]=1e-3*(ensanche3+ensanche4*(300/temp))*pow(300/temp,0.8);
+      partials[2]=0.0;
+    }
     return interf;   // GHz
 
   }
 
 
-  double RefractiveIndex::linebroadening_water(double nu, double temp, double pr, double eh2o, double ensanche1, double ensanche2, double ensanche3, double ensanche4){
+  double RefractiveIndex::linebroadening_water(double nu, double temp, double pr, double eh2o, double ensanche1, double ensanche2, double ensanche3, double ensanche4,
+					       double *partials){
 
     static const double mmol=18.0;
 
     // nu GHz
-    // pr = pp.get("mb");
-    // eh2o = ph2o.get("mb");
-    // temp = tt.get("K");
+    // pr = pp.get<Pressure::mb>();
+    // eh2o = ph2o.get<Pressure::mb>();
+    // temp = tt.get<Temperature::K>();
     double dv0;
     double dv;
 
@@ -263,26 +446,42 @@ ATM_NAMESPACE_BEGIN
 
     if((dv0/beta_dop)<1.25){
       dv=0.535*dv0+sqrt(0.217*pow(dv0,2)+0.6931*pow(beta_dop,2));   // "Atmospheric Remote Sensing", Janssen, pag. 59
-      //      cout << pp.get("mb") << "mb: usando beta_dop" << endl;
+      //      cout << pp.get<Pressure::mb>() << "mb: usando beta_dop" << endl;
     }else{
       dv=dv0;
     }
+    if(partials){
+      double a=0.68, b=4.50, d=0.80;   // exponents and self broadening ratio of the default broadening above
+      if(ensanche2>0){ a=ensanche3; b=ensanche2; d=ensanche4; }
+      partials[0]=-1e-3*ensanche1*((pr-eh2o)*a*pow(300/temp,a)+b*eh2o*d*pow(300.0/temp,d))/temp;
+      partials[1]=1e-3*ensanche1*pow(300/temp,a);
+      partials[2]=1e-3*ensanche1*(b*pow(300.0/temp,d)-pow(300/temp,a));
+      mkBroadeningPartials(dv0,beta_dop,temp,partials);
+    }
 
-    //    cout << nu.get("GHz") << "  " << pr << "  " <<  eh2o << "  " << dv << endl;
+    //    cout << nu.get<Frequency::GHz>() << "  " << pr << "  " <<  eh2o << "  " << dv << endl;
 
     return dv; // GHz
   }
 
-  double RefractiveIndex::linebroadening_hh18o_hh17o(double temp, double pr, double eh2o, double dv0, double dvlm, double temp_exp){
+  double RefractiveIndex::linebroadening_hh18o_hh17o(double temp, double pr, double eh2o, double dv0, double dvlm, double temp_exp,
+						     double *partials){
 
-    // pr = pp.get("mb");
-    // eh2o = ph2o.get("mb");
-    // temp = tt.get("K");
+    // pr = pp.get<Pressure::mb>();
+    // eh2o = ph2o.get<Pressure::mb>();
+    // temp = tt.get<Temperature::K>();
     double dv;
     double rho=18.0*eh2o*100/(8.315727226*temp);   // Na*Kb=8.315727226
     double c2=4.6E-03*rho*temp/pr;
 
     dv=(dv0*(pr/1013.0)/(pow(temp/300.0,temp_exp)))*(1.+c2*(dvlm/dv0-1.));
+    if(partials){
+      // c2 is proportional to eh2o/pr, the temperature cancels out
+      double g=dv0/1013.0/pow(temp/300.0,temp_exp);
+      partials[0]=-temp_exp*dv/temp;
+      partials[1]=g;
+      partials[2]=g*4.6E-03*18.0*100/8.315727226*(dvlm/dv0-1.);
+    }
 
     return dv; // GHz
   }
@@ -298,10 +497,10 @@ ATM_NAMESPACE_BEGIN
     //    *   {[(vl-v)/((v-vl)**2+dv**2)]-[(vl+v)/((v+vl)**2+dv**2)]} REAL (UNITS 1/freq) *
     //    *********************************************************************************
 
-    //    dv  = linebroad.get("GHz");      LINE BROADENING PARAMETER
-    //    itf = interf.get("GHz");         LINE INTERFERENCE
-    //    vl  = linefreq.get("GHz");       FREQUENCY OF RESONANT LINE
-    //    v   = nu.get("GHz");             CURRENT WORKING FREQUENCY
+    //    dv  = linebroad.get<Frequency::GHz>();      LINE BROADENING PARAMETER
+    //    itf = interf.get<Frequency::GHz>();         LINE INTERFERENCE
+    //    vl  = linefreq.get<Frequency::GHz>();       FREQUENCY OF RESONANT LINE
+    //    v   = nu.get<Frequency::GHz>();             CURRENT WORKING FREQUENCY
 
     //    double lf=dv*itf;
     //    double dv2=dv*dv;
@@ -383,6 +582,18 @@ ATM_NAMESPACE_BEGIN
     return aa;
   }
 
+  std::complex<double>  RefractiveIndex::mkSpecificRefractivity(size_t species,
+							   double tt, double pp, double eh2o,
+							   double nu, Partials &partials)
+  {
+    // the kernel accumulates the derivatives in partials_ as it goes through its lines
+    partials=Partials();
+    partials_=&partials;
+    std::complex<double> n=mkSpecificRefractivity(species,tt,pp,eh2o,nu);
+    partials_=0;
+    return n;
+  }
+
 
   //////////////////////// Opacity Source Number: 8 //////////////////////////////
 
@@ -579,20 +790,30 @@ ATM_NAMESPACE_BEGIN
 
       }else{
 
+	LineCache &c=lineCache(8,tt,pp,0.0,594);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdSO2air[i]*0.001,0.75),0.0);   // broadenind en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdSO2air[i]*0.001,0.75,c.dvPartials(i));   // broadenind en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);   //2.5 MHz/mb
 
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
 
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (m^2)    // (  rad m^2 , m^2 )
 
 
@@ -750,20 +971,30 @@ ATM_NAMESPACE_BEGIN
 
       }else{
 
+	LineCache &c=lineCache(7,tt,pp,0.0,248);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdNO2air[i]*0.001,texpNO2[i]),0.0);   // broadenind en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdNO2air[i]*0.001,texpNO2[i],c.dvPartials(i));   // broadenind en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
 
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
 
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
 
@@ -954,20 +1185,30 @@ ATM_NAMESPACE_BEGIN
 
       }else{
 
+	LineCache &c=lineCache(6,tt,pp,0.0,39);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdN2Oair[i]*0.001,texpN2O[i]),0.0);   // broadening en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdN2Oair[i]*0.001,texpN2O[i],c.dvPartials(i));   // broadening en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  // lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
 
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
 
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.0/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
 
@@ -1150,20 +1391,30 @@ ATM_NAMESPACE_BEGIN
 
       }else{
 
+	LineCache &c=lineCache(5,tt,pp,0.0,8);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdCOair[i]*0.001,texpCO[i]),0.0);   // broadening en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdCOair[i]*0.001,texpCO[i],c.dvPartials(i));   // broadening en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
 
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
 
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.0/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
 
@@ -1196,6 +1447,17 @@ ATM_NAMESPACE_BEGIN
 
     double delayh2o=(4.163*t300+0.239)*eh2o*t300*nu*1.2008e-3/57.29578;   // VERSIÓN INSTALADA ANTES DE 16/12/2015 // AÑADIR REFERENCIA
 
+    if(partials_){
+      // cnth2o is proportional to eee*ppp*t300^3, delayh2o to (4.163*t300+0.239)*eh2o*t300
+      double k=0.0315*pow(nu/225,2);
+      if(nu>=900){ k=0.0315*pow(nu/225,1.8)-0.0315*pow((double)(900/225),1.8)+0.0315*pow((double)(900/225),2); }
+      partials_->temperature=std::complex<double>(-(2*4.163*t300+0.239)*eh2o*t300/tt*nu*1.2008e-3/57.29578,
+						  -3*cnth2o/tt);
+      partials_->pressure=std::complex<double>(0.0,k*eee*pow(t300,3)/1013.0);
+      partials_->wvpressure=std::complex<double>((4.163*t300+0.239)*t300*nu*1.2008e-3/57.29578,
+						 k*(ppp-eee)*pow(t300,3)/1013.0);
+    }
+
     // double delayh2o=eh2o*pow(t300,2.5)*.791e-6*pow(nu,2)*nu*1.2008e-3/57.29578; //VERSION DE PRUEBA 16/12/2015
 
     return std::complex<double> (delayh2o,cnth2o);       // (  rad m^-1 , m^-1 )
@@ -1226,6 +1488,23 @@ ATM_NAMESPACE_BEGIN
 		     -6.14e-5*ppp*pow(t300,2)*pow(nu,2)/(pow(nu,2)+pow(gamma0,2))
 		     )*nu*1.2008e-3/57.29578;
 
+    if(partials_){
+      // gamma0 depends on the temperature and the pressure, ppp on the pressure and the water vapor pressure
+      double d=pow(nu,2)+pow(gamma0,2);
+      double dgT=-0.8*gamma0/tt, dgP=5.6E-04*pow(t300,0.8);
+      double dnsec1T=6.14e-5*ppp*nu*(-2*pow(t300,2)/tt*gamma0/d+pow(t300,2)*dgT*(pow(nu,2)-pow(gamma0,2))/(d*d));
+      double dnsec1P=6.14e-5*nu*pow(t300,2)*(gamma0/d+ppp*dgP*(pow(nu,2)-pow(gamma0,2))/(d*d));
+      double dnsec1E=-6.14e-5*nu*pow(t300,2)*gamma0/d;
+      double dnsec2T=-3.5*nsec2/tt, dnsec2P=2*1.4E-12*ppp*pow(t300,3.5)*nu;
+      double dlyT=0.2588*ppp*(-t300/tt)-6.14e-5*ppp*pow(nu,2)*(-2*pow(t300,2)/tt/d-pow(t300,2)*2*gamma0*dgT/(d*d));
+      double dlyP=0.2588*t300-6.14e-5*pow(t300,2)*pow(nu,2)*(1/d-ppp*2*gamma0*dgP/(d*d));
+      double dlyE=-0.2588*t300+6.14e-5*pow(t300,2)*pow(nu,2)/d;
+      double ka=nu*0.1820/4.34e3, kd=nu*1.2008e-3/57.29578;
+      partials_->temperature=std::complex<double>(dlyT*kd,(dnsec1T+0.85633*dnsec2T)*ka);
+      partials_->pressure=std::complex<double>(dlyP*kd,(dnsec1P+0.85633*dnsec2P)*ka);
+      partials_->wvpressure=std::complex<double>(dlyE*kd,(dnsec1E-0.85633*dnsec2P)*ka);
+    }
+
 
 //     double delaydry_deltap=(0.2588*(pp+1.0-eh2o)*t300
 // 			    -6.14e-5*(pp+1.0-eh2o)*pow(t300,2)*pow(nu,2)/(pow(nu,2)+pow(gamma0,2))
@@ -1641,19 +1920,30 @@ ATM_NAMESPACE_BEGIN
 
       }else{
 
+	LineCache &c=lineCache(12,tt,pp,eh2o,335);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening_water(fre[i],tt,pp,eh2o,ensanche[i][0],ensanche[i][1],ensanche[i][2],ensanche[i][3]),0.0);
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening_water(fre[i],tt,pp,eh2o,ensanche[i][0],ensanche[i][1],ensanche[i][2],ensanche[i][3],c.dvPartials(i));
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 
-	  lshape=lshape*flin[i]*gl[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+	  lshape=lshape*flin[i]*gl[i]*c.boltz[i]*c.stim[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*gl[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
 
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
 	                                                                    // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (m^2)  // (  rad m^2 , m^2 )
 
       }
@@ -2116,17 +2406,28 @@ ATM_NAMESPACE_BEGIN
 
       //  cout << "nu=" << nu << " GHz: including lines from " << fre[ini] << " GHz to " << fre[ifin] << " GHz" << endl;
 
+      LineCache &c=lineCache(11,tt,pp,eh2o,522);   // layer-dependent parameters of the lines
       for(size_t i=ini; i<ifin+1; i++){
 
-	lshape=lineshape(nu,fre[i],linebroadening_water(fre[i],tt,pp,eh2o,ensanche[i][0],ensanche[i][1],ensanche[i][2],ensanche[i][3]),0.0);
-	lshape=lshape*flin[i]*gl[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+	if(!c.ready[i]){
+	  c.dv[i]=linebroadening_water(fre[i],tt,pp,eh2o,ensanche[i][0],ensanche[i][1],ensanche[i][2],ensanche[i][3],c.dvPartials(i));
+	  c.boltz[i]=exp(-el[i]/tt);
+	  c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+	  c.ready[i]=1;
+	}
+	lshape=lineshape(nu,fre[i],c.dv[i],0.0);
+	lshape=lshape*flin[i]*gl[i]*c.boltz[i]*c.stim[i];
+	if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*gl[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
 	lshapeacum=lshapeacum+lshape;
 
       }
 
-      lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+      double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+      lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
       // real part: delay in rad*cm^2
 
+      if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.5/tt);}
+
       return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
     }
@@ -2311,16 +2612,27 @@ ATM_NAMESPACE_BEGIN
 
       }else{
 
+	LineCache &c=lineCache(14,tt,pp,eh2o,16);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening_hh18o_hh17o(tt,pp,eh2o,dv0[i],dvlm[i],temp_exp[i]),0.0);
-	  lshape=lshape*flin[i]*gl[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening_hh18o_hh17o(tt,pp,eh2o,dv0[i],dvlm[i],temp_exp[i],c.dvPartials(i));
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
+	  lshape=lshape*flin[i]*gl[i]*c.boltz[i]*c.stim[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*gl[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
 	                                                                    // real part: delay in rad*cm^2
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
       }
@@ -2619,6 +2931,8 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_hdo(double tt, dou
 
 
       std::complex<double>  lshapeacum1(0.0,0.0);
+      Partials partials1;
+      double ddv1[3]={-0.7*0.003*pp*pow((300/tt),0.7)/tt, 0.003*pow((300/tt),0.7), 0.0};
 
       if(ifin1==0||ifin1<ini1){
 
@@ -2629,15 +2943,24 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_hdo(double tt, dou
 
 	  lshape=lineshape(nu,fre[i],0.003*pp*pow((300/tt),0.7),0.0);
 	  lshape=lshape*flin[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+	  if(partials_){
+	    double stim=1-exp(-0.047992745509*fre[i]/tt);
+	    addLinePartials(partials1,nu,fre[i],0.003*pp*pow((300/tt),0.7),0.0,ddv1,0,flin[i]*exp(-el[i]/tt)*stim,
+			    (el[i]-0.047992745509*fre[i]*(1-stim)/stim)/(tt*tt),lshape);
+	  }
           lshapeacum1=lshapeacum1+lshape;
 
 	}
 
-	lshapeacum1=lshapeacum1*(nu/pi)*(picube8div3hcesu*pow(mua,2)/q); // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mua,2)/q);
+	lshapeacum1=lshapeacum1*pref; // imaginary part: absorption coefficient in cm^2
 	                                                                    // real part: delay in rad*cm^2
+	if(partials_){scalePartials(partials1,pref*1e-4*0.25,lshapeacum1*1e-4*0.25,-1.5/tt);}
       }
 
       std::complex<double>  lshapeacum2(0.0,0.0);
+      Partials partials2;
+      double ddv2[3]={0.0, 0.003, 0.0};
 
       if(ifin2==0||ifin2<ini2){
 
@@ -2648,12 +2971,24 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_hdo(double tt, dou
 
 	  lshape=lineshape(nu,fre[i],0.003*pp,0.0);
 	  lshape=lshape*flin[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+	  if(partials_){
+	    double stim=1-exp(-0.047992745509*fre[i]/tt);
+	    addLinePartials(partials2,nu,fre[i],0.003*pp,0.0,ddv2,0,flin[i]*exp(-el[i]/tt)*stim,
+			    (el[i]-0.047992745509*fre[i]*(1-stim)/stim)/(tt*tt),lshape);
+	  }
           lshapeacum2=lshapeacum2+lshape;
 
 	}
 
-	lshapeacum2=lshapeacum2*(nu/pi)*(picube8div3hcesu*pow(mub,2)/q); // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mub,2)/q);
+	lshapeacum2=lshapeacum2*pref; // imaginary part: absorption coefficient in cm^2
 	                                                                    // real part: delay in rad*cm^2
+	if(partials_){scalePartials(partials2,pref*1e-4*0.25,lshapeacum2*1e-4*0.25,-1.5/tt);}
+      }
+
+      if(partials_){
+	partials_->temperature=partials1.temperature+partials2.temperature;
+	partials_->pressure=partials1.pressure+partials2.pressure;
       }
 
       return (lshapeacum1+lshapeacum2)*1e-4*0.25;    // to give it in SI units (  rad m^2 , m^2 )  (20181121: 0.25 is an empirical factor to fit FTS Data from Mauna Kea)
@@ -2838,17 +3173,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_hdo(double tt, dou
 
       }else{
 
+	LineCache &c=lineCache(13,tt,pp,eh2o,15);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening_hh18o_hh17o(tt,pp,eh2o,dv0[i],dvlm[i],temp_exp[i]),0.0);
-	  lshape=lshape*flin[i]*gl[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening_hh18o_hh17o(tt,pp,eh2o,dv0[i],dvlm[i],temp_exp[i],c.dvPartials(i));
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
+	  lshape=lshape*flin[i]*gl[i]*c.boltz[i]*c.stim[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*gl[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
 	                                                                    // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
       }
@@ -2879,17 +3225,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_hdo(double tt, dou
 
     if(nu>999.9){return std::complex<double> (0.0,0.0);}
 
+    LineCache &c=lineCache(2,tt,pp,eh2o,6);   // layer-dependent parameters of the lines
     for(size_t i=0; i<6; i++){
 
-      lshape=lineshape(nu,fre[i], linebroadening_o2(fre[i],tt,pp,eh2o,32.0,dv0,0.2),0.0);
-      lshape=lshape*flin[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+      if(!c.ready[i]){
+        c.dv[i]=linebroadening_o2(fre[i],tt,pp,eh2o,32.0,dv0,0.2,c.dvPartials(i));
+        c.boltz[i]=exp(-el[i]/tt);
+        c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+        c.ready[i]=1;
+      }
+      lshape=lineshape(nu,fre[i],c.dv[i],0.0);
+      lshape=lshape*flin[i]*c.boltz[i]*c.stim[i];
+      if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
       lshapeacum=lshapeacum+lshape;
 
     }
 
-    lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+    double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+    lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
                                                                         // real part: delay in rad*cm^2
 
+    if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.0/tt);}
+
     return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
   }
@@ -2926,17 +3283,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_hdo(double tt, dou
 
     if(nu>999.9){return std::complex<double> (0.0,0.0);}
 
+    LineCache &c=lineCache(4,tt,pp,eh2o,14);   // layer-dependent parameters of the lines
     for(size_t i=0; i<14; i++){
 
-      lshape=lineshape(nu,fre[i],linebroadening_o2(fre[i],tt,pp,eh2o,33.0,dv0,0.2),0.0);
-      lshape=lshape*flin[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+      if(!c.ready[i]){
+        c.dv[i]=linebroadening_o2(fre[i],tt,pp,eh2o,33.0,dv0,0.2,c.dvPartials(i));
+        c.boltz[i]=exp(-el[i]/tt);
+        c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+        c.ready[i]=1;
+      }
+      lshape=lineshape(nu,fre[i],c.dv[i],0.0);
+      lshape=lshape*flin[i]*c.boltz[i]*c.stim[i];
+      if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
       lshapeacum=lshapeacum+lshape;
 
     }
 
-    lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+    double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+    lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
     // real part: delay in rad*cm^2
 
+    if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.0/tt);}
+
     return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
   }
@@ -2973,17 +3341,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
     if(nu>999.9){return std::complex<double> (0.0,0.0);}
 
+    LineCache &c=lineCache(3,tt,pp,eh2o,15);   // layer-dependent parameters of the lines
     for(size_t i=0; i<15; i++){
 
-      lshape=lineshape(nu,fre[i], linebroadening_o2(fre[i],tt,pp,eh2o,34.0,dv0,0.2),0.0);
-      lshape=lshape*flin[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+      if(!c.ready[i]){
+        c.dv[i]=linebroadening_o2(fre[i],tt,pp,eh2o,34.0,dv0,0.2,c.dvPartials(i));
+        c.boltz[i]=exp(-el[i]/tt);
+        c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+        c.ready[i]=1;
+      }
+      lshape=lineshape(nu,fre[i],c.dv[i],0.0);
+      lshape=lshape*flin[i]*c.boltz[i]*c.stim[i];
+      if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
       lshapeacum=lshapeacum+lshape;
 
     }
 
-    lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+    double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+    lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
 	                                                                    // real part: delay in rad*cm^2
 
+    if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.0/tt);}
+
     return lshapeacum*1e-4;    // to give it in SI units (m^2)    // (  rad m^2 , m^2 )
 
   }
@@ -3183,19 +3562,30 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(1,tt,pp,eh2o,55);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening_o2(fre[i],tt,pp,eh2o,32.0,ensanche[i][0],ensanche[i][1]),
-			   interf_o2(tt,pp,ensanche[i][2],ensanche[i][3]));
-
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*(1-exp(-0.047992745509*fre[i]/tt));
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening_o2(fre[i],tt,pp,eh2o,32.0,ensanche[i][0],ensanche[i][1],c.dvPartials(i));
+	    c.itf[i]=interf_o2(tt,pp,ensanche[i][2],ensanche[i][3],c.itfPartials(i));
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.stim[i]=1-exp(-0.047992745509*fre[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],c.itf[i]);
+
+	  lshape=lshape*flin[i]*c.boltz[i]*c.stim[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*c.stim[i],(el[i]-0.047992745509*fre[i]*(1-c.stim[i])/c.stim[i])/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q); // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref; // imaginary part: absorption coefficient in cm^2
 	                                                                    // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-1.0/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (m^2)    // (  rad m^2 , m^2 )
 
 
@@ -3422,18 +3812,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(18,tt,pp,0.0,666);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i]),0.0);   // BROADENING EN GHZ/MB 13/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i],c.dvPartials(i));   // BROADENING EN GHZ/MB 13/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //  lshape=lineshape(nu,FRE[I],linebroadening(FRE[I],TT,PP,MMOL,0.0025,0.76),0.0);
 
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)  // IMAGINARY PART: ABSORPTION COEFFICIENT IN CM^2
-	  *(0.047992745509/tt);                                                               // REAL PART: DELAY IN RAD*CM^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)*(0.047992745509/tt);
+	lshapeacum=lshapeacum*pref;  // IMAGINARY PART: ABSORPTION COEFFICIENT IN CM^2
+	                               // REAL PART: DELAY IN RAD*CM^2
+
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
 
 	return lshapeacum*1e-4;    // TO GIVE IT IN SI UNITS (M^2)    // (  RAD M^2 , M^2 )
 
@@ -3694,17 +4094,27 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(19,tt,pp,0.0,714);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i]),0.0);   // broadening en ghz/mb 13/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i],c.dvPartials(i));   // broadening en ghz/mb 13/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //     lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)  // imaginary part: absorption coefficient in cm^2
-	  *(0.047992745509/tt);                                                               // real part: delay in rad*cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)*(0.047992745509/tt);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
+	                               // real part: delay in rad*cm^2
+
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
 
 	return lshapeacum*1e-4;    // to give it in si units (m^2)    // (  rad m^2 , m^2 )
 
@@ -3964,18 +4374,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(17,tt,pp,0.0,568);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdo3air[i]*0.001,texpo3[i]),0.0);   // broadening en ghz/mb 13/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdo3air[i]*0.001,texpo3[i],c.dvPartials(i));   // broadening en ghz/mb 13/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //    lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
 
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)  // imaginary part: absorption coefficient in cm^2
-	  *(0.047992745509/tt);                                                               // real part: delay in rad*cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)*(0.047992745509/tt);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
+	                               // real part: delay in rad*cm^2
+
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
 
 	return lshapeacum*1e-4;    // to give it in si units (m^2)    // (  rad m^2 , m^2 )
 
@@ -4522,16 +4942,26 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(16,tt,pp,0.0,1151);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i]),0.0);   // broadening en GHz/mb 20/6/2018
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i],c.dvPartials(i));   // broadening en GHz/mb 20/6/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)  // imaginary part: absorption coefficient in cm^2
-	  *(0.047992745509/tt);                                                               // real part: delay in rad*cm^2
+	double pref=(nu/pi)*(picube8div3hcesu*pow(mu,2)/q)*(0.047992745509/tt);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
+	                               // real part: delay in rad*cm^2
+
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
 
 	return lshapeacum*1e-4;    // to give it in SI units (  rad m^2 , m^2 )
 
@@ -5024,17 +5454,27 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(20,tt,pp,0.0,1376);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i]),0.0);   // broadening en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i],c.dvPartials(i));   // broadening en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  // lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (m^2)    // (  rad m^2 , m^2 )
 
 
@@ -5524,18 +5964,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(21,tt,pp,0.0,1363);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i]),0.0);   // broadening en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i],c.dvPartials(i));   // broadening en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (m^2)    // (  rad m^2 , m^2 )
 
       }
@@ -5882,18 +6332,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(22,tt,pp,0.0,755);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i]),0.0);   // broadening en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i],c.dvPartials(i));   // broadening en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  //	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (m^2)    // (  rad m^2 , m^2 )
 
       }
@@ -6184,18 +6644,28 @@ std::complex<double>  RefractiveIndex::mkSpecificRefractivity_16o18o(double tt,
 
       }else{
 
+	LineCache &c=lineCache(23,tt,pp,0.0,518);   // layer-dependent parameters of the lines
 	for(size_t i=ini; i<ifin+1; i++){
 
-	  lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i]),0.0);   // broadening en GHz/mb 14/11/2018
+	  if(!c.ready[i]){
+	    c.dv[i]=linebroadening(fre[i],tt,pp,mmol,brdO3air[i]*0.001,texpO3[i],c.dvPartials(i));   // broadening en GHz/mb 14/11/2018
+	    c.boltz[i]=exp(-el[i]/tt);
+	    c.ready[i]=1;
+	  }
+	  lshape=lineshape(nu,fre[i],c.dv[i],0.0);
 	  // lshape=lineshape(nu,fre[i],linebroadening(fre[i],tt,pp,mmol,0.0025,0.76),0.0);
-	  lshape=lshape*flin[i]*exp(-el[i]/tt)*fre[i];
+	  lshape=lshape*flin[i]*c.boltz[i]*fre[i];
+	  if(partials_){addLinePartials(*partials_,c,i,nu,fre[i],flin[i]*c.boltz[i]*fre[i],el[i]/(tt*tt),lshape);}
           lshapeacum=lshapeacum+lshape;
 
 	}
 
-	lshapeacum=lshapeacum*(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);  // imaginary part: absorption coefficient in cm^2
+	double pref=(nu/pi)*(0.047992745509/tt)*(picube8div3hcesu*pow(mu,2)/q);
+	lshapeacum=lshapeacum*pref;  // imaginary part: absorption coefficient in cm^2
 	                                                                                                  // real part: delay in rad*cm^2
 
+	if(partials_){scalePartials(*partials_,pref*1e-4,lshapeacum*1e-4,-2.5/tt);}
+
 	return lshapeacum*1e-4;    // to give it in SI units (m^2)    // (  rad m^2 , m^2 )
 
       }
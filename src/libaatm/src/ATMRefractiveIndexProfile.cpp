@@ -25,32 +25,39 @@
 
 #include "ATMRefractiveIndexProfile.h"
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <math.h>
 #include <string>
+#include <utility>
 #include <vector>
 
 
 
 ATM_NAMESPACE_BEGIN
 
+const double RefractiveIndexProfile::uniqueFreqTolerance_ = 1.0e-3;
+const size_t RefractiveIndexProfile::chanBlockSize_ = 64;
+
 // Constructors
 
 RefractiveIndexProfile::RefractiveIndexProfile(const Frequency &freq,
                                                const AtmProfile &atmProfile) :
-  AtmProfile(atmProfile), SpectralGrid(freq)
+  AtmProfile(atmProfile), SpectralGrid(freq), lazyMode_(false)
 {
   mkRefractiveIndexProfile();
 }
 
 RefractiveIndexProfile::RefractiveIndexProfile(const SpectralGrid &spectralGrid,
-                                               const AtmProfile &atmProfile) :
-  AtmProfile(atmProfile), SpectralGrid(spectralGrid)
+                                               const AtmProfile &atmProfile,
+                                               bool lazy) :
+  AtmProfile(atmProfile), SpectralGrid(spectralGrid), lazyMode_(lazy)
 {
   mkRefractiveIndexProfile();
 }
 
-RefractiveIndexProfile::RefractiveIndexProfile(const RefractiveIndexProfile & a) : AtmProfile(a), SpectralGrid(a)
+RefractiveIndexProfile::RefractiveIndexProfile(const RefractiveIndexProfile & a) : AtmProfile(a), SpectralGrid(a), lazyMode_(a.lazyMode_)
 {
   //   std::cout<<"Enter RefractiveIndexProfile copy constructor version Fri May 20 00:59:47 CEST 2005"<<endl;
 
@@ -134,79 +141,123 @@ RefractiveIndexProfile::RefractiveIndexProfile(const RefractiveIndexProfile & a)
 
   v_transfertId_ = a.v_transfertId_;
 
-  // level Absorption Profile
-  vv_N_H2OLinesPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_H2OContPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_O2LinesPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_DryContPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_O3LinesPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_COLinesPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_N2OLinesPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_NO2LinesPtr_.reserve(a.v_chanFreq_.size());
-  vv_N_SO2LinesPtr_.reserve(a.v_chanFreq_.size());
-
-  std::vector<std::complex<double> >* v_N_H2OLinesPtr;
-  std::vector<std::complex<double> >* v_N_H2OContPtr;
-  std::vector<std::complex<double> >* v_N_O2LinesPtr;
-  std::vector<std::complex<double> >* v_N_DryContPtr;
-  std::vector<std::complex<double> >* v_N_O3LinesPtr;
-  std::vector<std::complex<double> >* v_N_COLinesPtr;
-  std::vector<std::complex<double> >* v_N_N2OLinesPtr;
-  std::vector<std::complex<double> >* v_N_NO2LinesPtr;
-  std::vector<std::complex<double> >* v_N_SO2LinesPtr;
-
-  for(size_t nc = 0; nc < v_chanFreq_.size(); nc++) {
-
-    v_N_H2OLinesPtr = new std::vector<std::complex<double> > ;
-    v_N_H2OLinesPtr->reserve(numLayer_);
-    v_N_H2OContPtr = new std::vector<std::complex<double> > ;
-    v_N_H2OContPtr->reserve(numLayer_);
-    v_N_O2LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_O2LinesPtr->reserve(numLayer_);
-    v_N_DryContPtr = new std::vector<std::complex<double> > ;
-    v_N_DryContPtr->reserve(numLayer_);
-    v_N_O3LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_O3LinesPtr->reserve(numLayer_);
-    v_N_COLinesPtr = new std::vector<std::complex<double> > ;
-    v_N_COLinesPtr->reserve(numLayer_);
-    v_N_N2OLinesPtr = new std::vector<std::complex<double> > ;
-    v_N_N2OLinesPtr->reserve(numLayer_);
-    v_N_NO2LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_NO2LinesPtr->reserve(numLayer_);
-    v_N_SO2LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_SO2LinesPtr->reserve(numLayer_);
-
-    for(size_t n = 0; n < numLayer_; n++) {
-
-      // std::cout << "numLayer_=" << nc << " " << n << std::endl; // COMMENTED OUT BY JUAN MAY/16/2005
-
-      v_N_H2OLinesPtr->push_back(a.vv_N_H2OLinesPtr_[nc]->at(n));
-      v_N_H2OContPtr->push_back(a.vv_N_H2OContPtr_[nc]->at(n));
-      v_N_O2LinesPtr->push_back(a.vv_N_O2LinesPtr_[nc]->at(n));
-      v_N_DryContPtr->push_back(a.vv_N_DryContPtr_[nc]->at(n));
-      v_N_O3LinesPtr->push_back(a.vv_N_O3LinesPtr_[nc]->at(n));
-      v_N_COLinesPtr->push_back(a.vv_N_COLinesPtr_[nc]->at(n));
-      v_N_N2OLinesPtr->push_back(a.vv_N_N2OLinesPtr_[nc]->at(n));
-      v_N_NO2LinesPtr->push_back(a.vv_N_NO2LinesPtr_[nc]->at(n));
-      v_N_SO2LinesPtr->push_back(a.vv_N_SO2LinesPtr_[nc]->at(n));
-
+  // level Absorption Profile (one profile per distinct frequency)
+  v_uniqueFreq_ = a.v_uniqueFreq_;
+  v_uniqueFreqId_ = a.v_uniqueFreqId_;
+
+  vv_N_H2OLinesPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_H2OContPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_O2LinesPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_DryContPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_O3LinesPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_COLinesPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_N2OLinesPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_NO2LinesPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_N_SO2LinesPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_absTotalDryPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_absTotalWetPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_delayTotalDryPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+  vv_delayTotalWetPtr_.reserve(a.vv_N_H2OLinesPtr_.size());
+
+  for(size_t nu = 0; nu < a.vv_N_H2OLinesPtr_.size(); nu++) {
+    if(a.vv_N_H2OLinesPtr_[nu] == 0) { // not computed in a
+      vv_N_H2OLinesPtr_.push_back(0);
+      vv_N_H2OContPtr_.push_back(0);
+      vv_N_O2LinesPtr_.push_back(0);
+      vv_N_DryContPtr_.push_back(0);
+      vv_N_O3LinesPtr_.push_back(0);
+      vv_N_COLinesPtr_.push_back(0);
+      vv_N_N2OLinesPtr_.push_back(0);
+      vv_N_NO2LinesPtr_.push_back(0);
+      vv_N_SO2LinesPtr_.push_back(0);
+      vv_absTotalDryPtr_.push_back(0);
+      vv_absTotalWetPtr_.push_back(0);
+      vv_delayTotalDryPtr_.push_back(0);
+      vv_delayTotalWetPtr_.push_back(0);
+      continue;
     }
-
-    vv_N_H2OLinesPtr_.push_back(v_N_H2OLinesPtr);
-    vv_N_H2OContPtr_.push_back(v_N_H2OContPtr);
-    vv_N_O2LinesPtr_.push_back(v_N_O2LinesPtr);
-    vv_N_DryContPtr_.push_back(v_N_DryContPtr);
-    vv_N_O3LinesPtr_.push_back(v_N_O3LinesPtr);
-    vv_N_COLinesPtr_.push_back(v_N_COLinesPtr);
-    vv_N_N2OLinesPtr_.push_back(v_N_N2OLinesPtr);
-    vv_N_NO2LinesPtr_.push_back(v_N_NO2LinesPtr);
-    vv_N_SO2LinesPtr_.push_back(v_N_SO2LinesPtr);
-
-  }
-
-}
-
-RefractiveIndexProfile::RefractiveIndexProfile()
+    vv_N_H2OLinesPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_H2OLinesPtr_[nu]));
+    vv_N_H2OContPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_H2OContPtr_[nu]));
+    vv_N_O2LinesPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_O2LinesPtr_[nu]));
+    vv_N_DryContPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_DryContPtr_[nu]));
+    vv_N_O3LinesPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_O3LinesPtr_[nu]));
+    vv_N_COLinesPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_COLinesPtr_[nu]));
+    vv_N_N2OLinesPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_N2OLinesPtr_[nu]));
+    vv_N_NO2LinesPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_NO2LinesPtr_[nu]));
+    vv_N_SO2LinesPtr_.push_back(new std::vector<std::complex<double> >(*a.vv_N_SO2LinesPtr_[nu]));
+    vv_absTotalDryPtr_.push_back(new std::vector<double>(*a.vv_absTotalDryPtr_[nu]));
+    vv_absTotalWetPtr_.push_back(new std::vector<double>(*a.vv_absTotalWetPtr_[nu]));
+    vv_delayTotalDryPtr_.push_back(new std::vector<double>(*a.vv_delayTotalDryPtr_[nu]));
+    vv_delayTotalWetPtr_.push_back(new std::vector<double>(*a.vv_delayTotalWetPtr_[nu]));
+  }
+
+  // what has been computed in a is computed here
+  lazyGuard_.resize(a.lazyGuard_.numSpw(), a.lazyGuard_.numFreq());
+  for(size_t spwid = 0; spwid < a.lazyGuard_.numSpw(); spwid++) {
+    if(a.lazyGuard_.spwIsReady(spwid)) lazyGuard_.setSpwReady(spwid);
+  }
+  for(size_t nf = 0; nf < a.lazyGuard_.numFreq(); nf++) {
+    if(a.lazyGuard_.freqIsReady(nf)) lazyGuard_.setFreqReady(nf);
+  }
+  referenceAbsorption_ = a.referenceAbsorption_;
+
+}
+
+RefractiveIndexProfile::RefractiveIndexProfile(RefractiveIndexProfile &&a) : lazyMode_(false)
+{
+  *this = std::move(a);
+}
+
+RefractiveIndexProfile &RefractiveIndexProfile::operator=(const RefractiveIndexProfile &a)
+{
+  if(this != &a) *this = RefractiveIndexProfile(a);
+  return *this;
+}
+
+RefractiveIndexProfile &RefractiveIndexProfile::operator=(RefractiveIndexProfile &&a)
+{
+  if(this != &a) {
+    rmRefractiveIndexProfile();
+    AtmProfile::operator=(std::move(a));
+    SpectralGrid::operator=(std::move(a));
+    vv_N_H2OLinesPtr_ = std::move(a.vv_N_H2OLinesPtr_);
+    a.vv_N_H2OLinesPtr_.clear();
+    vv_N_H2OContPtr_ = std::move(a.vv_N_H2OContPtr_);
+    a.vv_N_H2OContPtr_.clear();
+    vv_N_O2LinesPtr_ = std::move(a.vv_N_O2LinesPtr_);
+    a.vv_N_O2LinesPtr_.clear();
+    vv_N_DryContPtr_ = std::move(a.vv_N_DryContPtr_);
+    a.vv_N_DryContPtr_.clear();
+    vv_N_O3LinesPtr_ = std::move(a.vv_N_O3LinesPtr_);
+    a.vv_N_O3LinesPtr_.clear();
+    vv_N_COLinesPtr_ = std::move(a.vv_N_COLinesPtr_);
+    a.vv_N_COLinesPtr_.clear();
+    vv_N_N2OLinesPtr_ = std::move(a.vv_N_N2OLinesPtr_);
+    a.vv_N_N2OLinesPtr_.clear();
+    vv_N_NO2LinesPtr_ = std::move(a.vv_N_NO2LinesPtr_);
+    a.vv_N_NO2LinesPtr_.clear();
+    vv_N_SO2LinesPtr_ = std::move(a.vv_N_SO2LinesPtr_);
+    a.vv_N_SO2LinesPtr_.clear();
+    vv_absTotalDryPtr_ = std::move(a.vv_absTotalDryPtr_);
+    a.vv_absTotalDryPtr_.clear();
+    vv_absTotalWetPtr_ = std::move(a.vv_absTotalWetPtr_);
+    a.vv_absTotalWetPtr_.clear();
+    vv_delayTotalDryPtr_ = std::move(a.vv_delayTotalDryPtr_);
+    a.vv_delayTotalDryPtr_.clear();
+    vv_delayTotalWetPtr_ = std::move(a.vv_delayTotalWetPtr_);
+    a.vv_delayTotalWetPtr_.clear();
+    v_uniqueFreq_ = std::move(a.v_uniqueFreq_);
+    v_uniqueFreqId_ = std::move(a.v_uniqueFreqId_);
+    a.v_uniqueFreq_.clear();
+    a.v_uniqueFreqId_.clear();
+    lazyMode_ = a.lazyMode_;
+    lazyGuard_ = std::move(a.lazyGuard_);
+    referenceAbsorption_ = std::move(a.referenceAbsorption_);
+  }
+  return *this;
+}
+
+RefractiveIndexProfile::RefractiveIndexProfile() : lazyMode_(false)
 {
 }
 
@@ -217,17 +268,59 @@ RefractiveIndexProfile::~RefractiveIndexProfile()
 
 void RefractiveIndexProfile::rmRefractiveIndexProfile()
 {
-  // for every frequency channel delete the pointer to the absorption profile
-  for(size_t nc = 0; nc < v_chanFreq_.size(); nc++) {
-    delete vv_N_H2OLinesPtr_[nc];
-    delete vv_N_H2OContPtr_[nc];
-    delete vv_N_O2LinesPtr_[nc];
-    delete vv_N_DryContPtr_[nc];
-    delete vv_N_O3LinesPtr_[nc];
-    delete vv_N_COLinesPtr_[nc];
-    delete vv_N_N2OLinesPtr_[nc];
-    delete vv_N_NO2LinesPtr_[nc];
-    delete vv_N_SO2LinesPtr_[nc];
+  // for every distinct frequency delete the pointer to the absorption profile
+  for(size_t nu = 0; nu < vv_N_H2OLinesPtr_.size(); nu++) {
+    delete vv_N_H2OLinesPtr_[nu];
+    delete vv_N_H2OContPtr_[nu];
+    delete vv_N_O2LinesPtr_[nu];
+    delete vv_N_DryContPtr_[nu];
+    delete vv_N_O3LinesPtr_[nu];
+    delete vv_N_COLinesPtr_[nu];
+    delete vv_N_N2OLinesPtr_[nu];
+    delete vv_N_NO2LinesPtr_[nu];
+    delete vv_N_SO2LinesPtr_[nu];
+    delete vv_absTotalDryPtr_[nu];
+    delete vv_absTotalWetPtr_[nu];
+    delete vv_delayTotalDryPtr_[nu];
+    delete vv_delayTotalWetPtr_[nu];
+  }
+  vv_N_H2OLinesPtr_.clear();
+  vv_N_H2OContPtr_.clear();
+  vv_N_O2LinesPtr_.clear();
+  vv_N_DryContPtr_.clear();
+  vv_N_O3LinesPtr_.clear();
+  vv_N_COLinesPtr_.clear();
+  vv_N_N2OLinesPtr_.clear();
+  vv_N_NO2LinesPtr_.clear();
+  vv_N_SO2LinesPtr_.clear();
+  vv_absTotalDryPtr_.clear();
+  vv_absTotalWetPtr_.clear();
+  vv_delayTotalDryPtr_.clear();
+  vv_delayTotalWetPtr_.clear();
+  lazyGuard_.clear();
+}
+
+void RefractiveIndexProfile::mkUniqueFreqTable()
+{
+  // Channels already indexed keep their entry; only the channels of newly added
+  // spectral windows are looked up. Two channels share an entry when their frequencies
+  // differ by less than uniqueFreqTolerance_ (this absorbs the rounding of the image
+  // sideband frequencies computed from the LO and the IF).
+  if(v_uniqueFreqId_.size() == v_chanFreq_.size()) return;
+  std::map<double, size_t> m_freqIndex;
+  for(size_t nu = 0; nu < v_uniqueFreq_.size(); nu++) m_freqIndex[v_uniqueFreq_[nu]] = nu;
+
+  v_uniqueFreqId_.reserve(v_chanFreq_.size());
+  for(size_t nc = v_uniqueFreqId_.size(); nc < v_chanFreq_.size(); nc++) {
+    double freq = v_chanFreq_[nc];
+    std::map<double, size_t>::const_iterator it = m_freqIndex.lower_bound(freq - uniqueFreqTolerance_);
+    if(it != m_freqIndex.end() && it->first <= freq + uniqueFreqTolerance_) {
+      v_uniqueFreqId_.push_back(it->second);
+    } else {
+      v_uniqueFreqId_.push_back(v_uniqueFreq_.size());
+      m_freqIndex[freq] = v_uniqueFreq_.size();
+      v_uniqueFreq_.push_back(freq);
+    }
   }
 }
 
@@ -248,7 +341,7 @@ bool RefractiveIndexProfile::updateRefractiveIndexProfile(const Length &altitude
                                           wvScaleHeight);
   size_t numLayer = getNumLayer();
 
-  if(vv_N_H2OLinesPtr_.size() < v_chanFreq_.size()) {
+  if(v_uniqueFreqId_.size() < v_chanFreq_.size()) {
     mkNewAtmProfile = true;
     std::cout << " RefractiveIndexProfile: number of spectral windows has increased"
         << std::endl;
@@ -284,90 +377,339 @@ bool RefractiveIndexProfile::setBasicAtmosphericParameters(const Length &altitud
 
 void RefractiveIndexProfile::mkRefractiveIndexProfile()
 {
+  //TODO we will have to put numLayer_ and v_chanFreq_.size() const
+  //we do not want to resize! ==> pas de setter pour SpectralGrid
+
+  // new basic parameters: all the layer profiles are recomputed, in the storage of the previous ones
+  if(newBasicParam_) {
+    lazyGuard_.reset();
+    referenceAbsorption_.reset();
+    profileVersion_++;
+  }
+
+  // new spectral windows in the altitude sliding mode: their profiles are computed for the reference
+  // profile, the observer going back to its altitude afterwards
+  bool sliding = isAltitudeSliding() && v_uniqueFreqId_.size() < v_chanFreq_.size();
+  Length observerAltitude = altitude_;
+  if(sliding) stopAltitudeSliding();
+
+  // index the channels of new spectral windows; the absorption profiles are computed
+  // only for the distinct frequencies not yet in the table.
+  mkUniqueFreqTable();
+
+  // the profiles of the new frequencies are allocated and filled by mkAbsorptionProfile(), so that
+  // the frequencies never accessed in lazy mode cost no memory
+  vv_N_H2OLinesPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_H2OContPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_O2LinesPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_DryContPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_O3LinesPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_COLinesPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_N2OLinesPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_NO2LinesPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_N_SO2LinesPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_absTotalDryPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_absTotalWetPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_delayTotalDryPtr_.resize(v_uniqueFreq_.size(), 0);
+  vv_delayTotalWetPtr_.resize(v_uniqueFreq_.size(), 0);
+  lazyGuard_.resize(v_numChan_.size(), v_uniqueFreq_.size());
+
+  newBasicParam_ = false;
+
+  // in lazy mode the spectral windows are computed by the first accessor which needs them
+  if(!lazyMode_) {
+    for(size_t spwid = 0; spwid < v_numChan_.size(); spwid++) mkSpectralWindow(spwid);
+  }
+
+  if(sliding) {
+    startAltitudeSliding();
+    setObserverAltitude(observerAltitude);
+  }
+}
+
+void RefractiveIndexProfile::mkSpectralWindow(size_t spwid) const
+{
+  if(lazyGuard_.spwIsReady(spwid)) return;
+
+  // one thread computes the window, the others wait for it. Windows sharing distinct
+  // frequencies are serialized by the same lock so that no frequency is computed twice.
+  std::lock_guard<std::mutex> lock(lazyGuard_.mutex());
+  if(lazyGuard_.spwIsReady(spwid)) return;
+  // distinct frequencies of the window still to be computed, each listed once
+  vector<size_t> nfs;
+  vector<bool> listed(v_uniqueFreq_.size(), false);
+  for(size_t nc = v_transfertId_[spwid]; nc < v_transfertId_[spwid] + v_numChan_[spwid]; nc++) {
+    size_t nf = v_uniqueFreqId_[nc];
+    if(!lazyGuard_.freqIsReady(nf) && !listed[nf]) {
+      nfs.push_back(nf);
+      listed[nf] = true;
+    }
+  }
+  mkAbsorptionProfile(nfs);
+  for(size_t n = 0; n < nfs.size(); n++) lazyGuard_.setFreqReady(nfs[n]);
+  lazyGuard_.setSpwReady(spwid);
+}
+
+void RefractiveIndexProfile::mkChanSpectralWindow(size_t nc) const
+{
+  // spectral window to which the channel nc of the grid belongs
+  size_t spwid = std::upper_bound(v_transfertId_.begin(), v_transfertId_.end(), nc) - v_transfertId_.begin() - 1;
+  mkSpectralWindow(spwid);
+}
 
+void RefractiveIndexProfile::prefetch(const vector<size_t> &spwIds) const
+{
+  for(size_t n = 0; n < spwIds.size(); n++) {
+    if(spwIds[n] < lazyGuard_.numSpw()) mkSpectralWindow(spwIds[n]);
+  }
+}
+
+void RefractiveIndexProfile::setLazyMode(bool lazy)
+{
+  lazyMode_ = lazy;
+  if(!lazyMode_) {
+    for(size_t spwid = 0; spwid < lazyGuard_.numSpw(); spwid++) mkSpectralWindow(spwid);
+  }
+}
+
+void RefractiveIndexProfile::getAbsorptionTables(vector<vector<std::complex<double> >*> *refractivity[9],
+                                                 vector<vector<double>*> *total[4]) const
+{
+  refractivity[0] = &vv_N_H2OLinesPtr_;
+  refractivity[1] = &vv_N_H2OContPtr_;
+  refractivity[2] = &vv_N_O2LinesPtr_;
+  refractivity[3] = &vv_N_DryContPtr_;
+  refractivity[4] = &vv_N_O3LinesPtr_;
+  refractivity[5] = &vv_N_COLinesPtr_;
+  refractivity[6] = &vv_N_N2OLinesPtr_;
+  refractivity[7] = &vv_N_NO2LinesPtr_;
+  refractivity[8] = &vv_N_SO2LinesPtr_;
+  total[0] = &vv_absTotalDryPtr_;
+  total[1] = &vv_absTotalWetPtr_;
+  total[2] = &vv_delayTotalDryPtr_;
+  total[3] = &vv_delayTotalWetPtr_;
+}
+
+void RefractiveIndexProfile::startAltitudeSliding()
+{
+  for(size_t spwid = 0; spwid < v_numChan_.size(); spwid++) mkSpectralWindow(spwid);
+  AtmProfile::startAltitudeSliding();
+
+  vector<vector<std::complex<double> >*> *refractivity[9];
+  vector<vector<double>*> *total[4];
+  getAbsorptionTables(refractivity, total);
+  std::shared_ptr<ReferenceAbsorption> reference(new ReferenceAbsorption);
+  for(size_t s = 0; s < 9; s++) {
+    reference->refractivity[s].resize(v_uniqueFreq_.size());
+    for(size_t nf = 0; nf < v_uniqueFreq_.size(); nf++) reference->refractivity[s][nf] = *(*refractivity[s])[nf];
+  }
+  for(size_t s = 0; s < 4; s++) {
+    reference->total[s].resize(v_uniqueFreq_.size());
+    for(size_t nf = 0; nf < v_uniqueFreq_.size(); nf++) reference->total[s][nf] = *(*total[s])[nf];
+  }
+  referenceAbsorption_ = reference;
+}
+
+bool RefractiveIndexProfile::setObserverAltitude(const Length &altitude)
+{
+  if(!isAltitudeSliding()) {
+    std::cout << " RefractiveIndexProfile: ERROR: the altitude sliding mode is not on" << std::endl;
+    return false;
+  }
+  size_t k;
+  double w;
+  if(!mkObserverLayers(altitude, k, w)) return false;
+
+  vector<vector<std::complex<double> >*> *refractivity[9];
+  vector<vector<double>*> *total[4];
+  getAbsorptionTables(refractivity, total);
+  for(size_t nf = 0; nf < v_uniqueFreq_.size(); nf++) {
+    std::complex<double> dry, wet;
+    for(size_t s = 0; s < 9; s++) {
+      const vector<std::complex<double> > &r = referenceAbsorption_->refractivity[s][nf];
+      vector<std::complex<double> > &v = *(*refractivity[s])[nf];
+      v.assign(r.begin() + k, r.end());
+      if(w > 0.0) {
+        v[0] = std::complex<double>(interpolateLayers(real(r[k]), real(r[k + 1]), w),
+                                    interpolateLayers(imag(r[k]), imag(r[k + 1]), w));
+      }
+      if(s < 2) {
+        wet = wet + v[0];
+      } else {
+        dry = dry + v[0];
+      }
+    }
+    for(size_t s = 0; s < 4; s++) {
+      const vector<double> &r = referenceAbsorption_->total[s][nf];
+      (*total[s])[nf]->assign(r.begin() + k, r.end());
+    }
+    // the sums of the cut layer are those of its interpolated refractivities
+    if(w > 0.0) {
+      (*vv_absTotalDryPtr_[nf])[0] = imag(dry);
+      (*vv_absTotalWetPtr_[nf])[0] = imag(wet);
+      (*vv_delayTotalDryPtr_[nf])[0] = real(dry);
+      (*vv_delayTotalWetPtr_[nf])[0] = real(wet);
+    }
+  }
+  return true;
+}
+
+void RefractiveIndexProfile::stopAltitudeSliding()
+{
+  if(isAltitudeSliding()) setObserverAltitude(getReferenceAltitude());
+  AtmProfile::stopAltitudeSliding();
+  referenceAbsorption_.reset();
+}
+
+bool RefractiveIndexProfile::getZenithSpectrum(size_t spwid, ZenithSpectrum &zenithSpectrum) const
+{
+  if(spwid >= v_numChan_.size()) {
+    std::cout << " RefractiveIndexProfile: ERROR: spectral window identifier out of range" << std::endl;
+    return false;
+  }
+  mkSpectralWindow(spwid);
+
+  size_t numChan = v_numChan_[spwid];
+  zenithSpectrum.dryOpacity.resize(numChan);
+  zenithSpectrum.wetOpacity.resize(numChan);
+  zenithSpectrum.nonDispersiveDryPathLength.resize(numChan);
+  zenithSpectrum.dispersiveDryPathLength.resize(numChan);
+  zenithSpectrum.nonDispersiveH2OPathLength.resize(numChan);
+  zenithSpectrum.dispersiveH2OPathLength.resize(numChan);
+
+  for(size_t n = 0; n < numChan; n++) {
+    size_t nc = v_transfertId_[spwid] + n;
+    size_t nf = v_uniqueFreqId_[nc];
+    double dryOpacity = 0.0, wetOpacity = 0.0;
+    double nonDispersiveDry = 0.0, dispersiveDry = 0.0, nonDispersiveH2O = 0.0, dispersiveH2O = 0.0;
+    for(size_t j = 0; j < numLayer_; j++) {
+      dryOpacity = dryOpacity + (*vv_absTotalDryPtr_[nf])[j] * v_layerThickness_[j];
+      wetOpacity = wetOpacity + (*vv_absTotalWetPtr_[nf])[j] * v_layerThickness_[j];
+      nonDispersiveDry = nonDispersiveDry + real((*vv_N_DryContPtr_[nf])[j]) * v_layerThickness_[j];
+      dispersiveDry = dispersiveDry
+          + real((*vv_N_O2LinesPtr_[nf])[j] + (*vv_N_O3LinesPtr_[nf])[j] + (*vv_N_N2OLinesPtr_[nf])[j]
+                 + (*vv_N_COLinesPtr_[nf])[j] + (*vv_N_NO2LinesPtr_[nf])[j] + (*vv_N_SO2LinesPtr_[nf])[j])
+              * v_layerThickness_[j];
+      nonDispersiveH2O = nonDispersiveH2O + real((*vv_N_H2OContPtr_[nf])[j]) * v_layerThickness_[j];
+      dispersiveH2O = dispersiveH2O + real((*vv_N_H2OLinesPtr_[nf])[j]) * v_layerThickness_[j];
+    }
+    // phase delay (deg) = delay (rad) * 57.29578 and path length = wavelength * delay (deg) / 360
+    double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
+    zenithSpectrum.dryOpacity[n] = dryOpacity;
+    zenithSpectrum.wetOpacity[n] = wetOpacity;
+    zenithSpectrum.nonDispersiveDryPathLength[n] = (wavelength / 360.0) * nonDispersiveDry * 57.29578;
+    zenithSpectrum.dispersiveDryPathLength[n] = (wavelength / 360.0) * dispersiveDry * 57.29578;
+    zenithSpectrum.nonDispersiveH2OPathLength[n] = (wavelength / 360.0) * nonDispersiveH2O * 57.29578;
+    zenithSpectrum.dispersiveH2OPathLength[n] = (wavelength / 360.0) * dispersiveH2O * 57.29578;
+  }
+  return true;
+}
+
+bool RefractiveIndexProfile::getGroundSensitivity(size_t spwid, GroundSensitivity &groundSensitivity) const
+{
+  if(spwid >= v_numChan_.size()) {
+    std::cout << " RefractiveIndexProfile: ERROR: spectral window identifier out of range" << std::endl;
+    return false;
+  }
+  if(!hasLayerPartials()) {
+    std::cout << " RefractiveIndexProfile: ERROR: the layers have been changed since they were built from the basic parameters"
+              << std::endl;
+    return false;
+  }
+
+  // in the order of the derivatives of the layers
+  ZenithSpectrum *d[4] = { &groundSensitivity.groundPressure, &groundSensitivity.groundTemperature,
+                           &groundSensitivity.relativeHumidity, &groundSensitivity.tropoLapseRate };
+  size_t numChan = v_numChan_[spwid];
+  for(size_t q = 0; q < 4; q++) {
+    d[q]->dryOpacity.assign(numChan, 0.0);
+    d[q]->wetOpacity.assign(numChan, 0.0);
+    d[q]->nonDispersiveDryPathLength.assign(numChan, 0.0);
+    d[q]->dispersiveDryPathLength.assign(numChan, 0.0);
+    d[q]->nonDispersiveH2OPathLength.assign(numChan, 0.0);
+    d[q]->dispersiveH2OPathLength.assign(numChan, 0.0);
+  }
+
+  // layer by layer, as in mkAbsorptionProfile(), so that the line parameters of a layer and their
+  // derivatives are shared by the channels; the derivative of a sum over the layers of N*thickness is
+  // that of N times the thickness plus N times that of the thickness
+  RefractiveIndex atm;
+  LayerRefractivity n, dn[4];
+  for(size_t j = 0; j < numLayer_; j++) {
+    for(size_t i = 0; i < numChan; i++) {
+      size_t nc = v_transfertId_[spwid] + i;
+      mkLayerRefractivity(atm, 1.0E-9 * v_uniqueFreq_[v_uniqueFreqId_[nc]], j, n, dn);
+      std::complex<double> dispersiveDry = n.o2Lines + n.o3Lines + n.n2oLines + n.coLines + n.no2Lines + n.so2Lines;
+      for(size_t q = 0; q < 4; q++) {
+        const LayerRefractivity &dq = dn[q];
+        double thickness = v_layerThickness_[j];
+        double dThickness = layerPartials_[q].thickness[j];
+        std::complex<double> dDispersiveDry = dq.o2Lines + dq.o3Lines + dq.n2oLines + dq.coLines + dq.no2Lines + dq.so2Lines;
+        d[q]->dryOpacity[i] += imag(dDispersiveDry + dq.dryCont) * thickness + imag(dispersiveDry + n.dryCont) * dThickness;
+        d[q]->wetOpacity[i] += imag(dq.h2oLines + dq.h2oCont) * thickness + imag(n.h2oLines + n.h2oCont) * dThickness;
+        d[q]->nonDispersiveDryPathLength[i] += real(dq.dryCont) * thickness + real(n.dryCont) * dThickness;
+        d[q]->dispersiveDryPathLength[i] += real(dDispersiveDry) * thickness + real(dispersiveDry) * dThickness;
+        d[q]->nonDispersiveH2OPathLength[i] += real(dq.h2oCont) * thickness + real(n.h2oCont) * dThickness;
+        d[q]->dispersiveH2OPathLength[i] += real(dq.h2oLines) * thickness + real(n.h2oLines) * dThickness;
+      }
+    }
+  }
+
+  // phase delay (deg) = delay (rad) * 57.29578 and path length = wavelength * delay (deg) / 360
+  for(size_t i = 0; i < numChan; i++) {
+    double wavelength = 299792458.0 / v_chanFreq_[v_transfertId_[spwid] + i]; // in m
+    for(size_t q = 0; q < 4; q++) {
+      d[q]->nonDispersiveDryPathLength[i] *= (wavelength / 360.0) * 57.29578;
+      d[q]->dispersiveDryPathLength[i] *= (wavelength / 360.0) * 57.29578;
+      d[q]->nonDispersiveH2OPathLength[i] *= (wavelength / 360.0) * 57.29578;
+      d[q]->dispersiveH2OPathLength[i] *= (wavelength / 360.0) * 57.29578;
+    }
+  }
+  return true;
+}
+
+void RefractiveIndexProfile::mkAbsorptionProfile(const vector<size_t> &nfs) const
+{
   //    static const double abun_18o=0.0020439;
   //    static const double abun_17o=0.0003750;
   //    static const double abun_D=0.000298444;
   //    static const double o2_mixing_ratio=0.2092;
   //    static const double mmol_h2o=18.005059688;  //   20*0.0020439+19*(0.0003750+2*0.000298444)+18*(1-0.0020439-0.0003750-2*0.000298444)
 
-  // static bool first = true;   // [-Wunused_but_set_variable]
-
-  double abun_O3, abun_CO, abun_N2O, abun_NO2, abun_SO2;
-  double wvt, wv;
-  // double t; // [-Wunused_but_set_variable]
-  double nu;
-  // double nu2, nu_pi; // [-Wunused_but_set_variable]
-  // double width;
-  // size_t npoints;
   RefractiveIndex atm;
-  //    double sumAbsO3Lines1, sumAbsCOLines1, sumAbsN2OLines1, sumAbsNO2Lines1, sumAbsSO2Lines1;
-
 
-  //TODO we will have to put numLayer_ and v_chanFreq_.size() const
-  //we do not want to resize! ==> pas de setter pour SpectralGrid
-
-  //cout << "vv_N_H2OLinesPtr_.size()=" << vv_N_H2OLinesPtr_.size() << std::endl;
-  if(vv_N_H2OLinesPtr_.size() == 0) { // first time
-    vv_N_H2OLinesPtr_.reserve(v_chanFreq_.size());
-    vv_N_H2OContPtr_.reserve(v_chanFreq_.size());
-    vv_N_O2LinesPtr_.reserve(v_chanFreq_.size());
-    vv_N_DryContPtr_.reserve(v_chanFreq_.size());
-    vv_N_O3LinesPtr_.reserve(v_chanFreq_.size());
-    vv_N_COLinesPtr_.reserve(v_chanFreq_.size());
-    vv_N_N2OLinesPtr_.reserve(v_chanFreq_.size());
-    vv_N_NO2LinesPtr_.reserve(v_chanFreq_.size());
-    vv_N_SO2LinesPtr_.reserve(v_chanFreq_.size());
-  } else {
-    if(vv_N_H2OLinesPtr_.size() == v_chanFreq_.size()) // there are new basic param
-    rmRefractiveIndexProfile(); // delete all the layer profiles for all the frequencies
-  }
-
-  std::vector<std::complex<double> >* v_N_H2OLinesPtr;
-  std::vector<std::complex<double> >* v_N_H2OContPtr;
-  std::vector<std::complex<double> >* v_N_O2LinesPtr;
-  std::vector<std::complex<double> >* v_N_DryContPtr;
-  std::vector<std::complex<double> >* v_N_O3LinesPtr;
-  std::vector<std::complex<double> >* v_N_COLinesPtr;
-  std::vector<std::complex<double> >* v_N_N2OLinesPtr;
-  std::vector<std::complex<double> >* v_N_NO2LinesPtr;
-  std::vector<std::complex<double> >* v_N_SO2LinesPtr;
-
-  // std::cout << "v_chanFreq_.size()=" << v_chanFreq_.size() << std::endl;
-  // std::cout << "numLayer_=" << numLayer_ << std::endl;
-  // std::cout << "v_chanFreq_[0]=" << v_chanFreq_[0] << std::endl;
-  // check if new spectral windows have been added
-  size_t ncmin;
-  /*  std::cout << "vv_N_H2OLinesPtr_.size()="<<vv_N_H2OLinesPtr_.size()<<endl; */
-  ncmin = vv_N_H2OLinesPtr_.size(); // will be > 0 if spectral window(s) have been added
-  if(newBasicParam_) ncmin = 0;
-
-  //    std::cout << "ncmin=" << ncmin << std::endl;
-
-  for(size_t nc = ncmin; nc < v_chanFreq_.size(); nc++) {
-
-    v_N_H2OLinesPtr = new std::vector<std::complex<double> > ;
-    v_N_H2OContPtr = new std::vector<std::complex<double> > ;
-    v_N_O2LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_DryContPtr = new std::vector<std::complex<double> > ;
-    v_N_O3LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_COLinesPtr = new std::vector<std::complex<double> > ;
-    v_N_N2OLinesPtr = new std::vector<std::complex<double> > ;
-    v_N_NO2LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_SO2LinesPtr = new std::vector<std::complex<double> > ;
-    v_N_H2OLinesPtr->reserve(numLayer_);
-    v_N_H2OContPtr->reserve(numLayer_);
-    v_N_O2LinesPtr->reserve(numLayer_);
-    v_N_DryContPtr->reserve(numLayer_);
-    v_N_O3LinesPtr->reserve(numLayer_);
-    v_N_COLinesPtr->reserve(numLayer_);
-    v_N_N2OLinesPtr->reserve(numLayer_);
-    v_N_NO2LinesPtr->reserve(numLayer_);
-    v_N_SO2LinesPtr->reserve(numLayer_);
-
-    nu = 1.0E-9 * v_chanFreq_[nc]; // ATM uses GHz units
-
-    // std::cout << "freq. points =" << v_chanFreq_.size() << std::endl;
+  for(size_t n = 0; n < nfs.size(); n++) {
+    size_t nf = nfs[n];
+    if(vv_N_H2OLinesPtr_[nf] == 0) {
+      vv_N_H2OLinesPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_H2OContPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_O2LinesPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_DryContPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_O3LinesPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_COLinesPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_N2OLinesPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_NO2LinesPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_N_SO2LinesPtr_[nf] = new std::vector<std::complex<double> >;
+      vv_absTotalDryPtr_[nf] = new std::vector<double>;
+      vv_absTotalWetPtr_[nf] = new std::vector<double>;
+      vv_delayTotalDryPtr_[nf] = new std::vector<double>;
+      vv_delayTotalWetPtr_[nf] = new std::vector<double>;
+    }
+    // a profile computed for previous basic parameters is overwritten in place
+    vv_N_H2OLinesPtr_[nf]->resize(numLayer_);
+    vv_N_H2OContPtr_[nf]->resize(numLayer_);
+    vv_N_O2LinesPtr_[nf]->resize(numLayer_);
+    vv_N_DryContPtr_[nf]->resize(numLayer_);
+    vv_N_O3LinesPtr_[nf]->resize(numLayer_);
+    vv_N_COLinesPtr_[nf]->resize(numLayer_);
+    vv_N_N2OLinesPtr_[nf]->resize(numLayer_);
+    vv_N_NO2LinesPtr_[nf]->resize(numLayer_);
+    vv_N_SO2LinesPtr_[nf]->resize(numLayer_);
+    vv_absTotalDryPtr_[nf]->resize(numLayer_);
+    vv_absTotalWetPtr_[nf]->resize(numLayer_);
+    vv_delayTotalDryPtr_[nf]->resize(numLayer_);
+    vv_delayTotalWetPtr_[nf]->resize(numLayer_);
+  }
 
     /*       TO BE IMPLEMENTED IN NEXT RELEASE
 
@@ -393,158 +735,202 @@ void RefractiveIndexProfile::mkRefractiveIndexProfile()
 
     */
 
-
-
-    // std::cout << "nc =" << nc << " nu=" << nu << " width=" << width << " GHz    npoints=" << npoints << std::endl;
-
-    // nu2 = nu * nu;      // [-Wunused_but_set_variable]
-    // nu_pi = nu / M_PI;    // [-Wunused_but_set_variable]
-
+  // Blocked schedule: the frequencies are taken chanBlockSize_ at a time and, within a block,
+  // the layers are the outer loop. The state of a layer and the line catalogs scanned for it
+  // are then reused for all the frequencies of the block instead of being reloaded for every
+  // (frequency, layer) cell. Every cell is computed exactly as before.
+  LayerRefractivity n;
+  std::complex<double> dry, wet;
+  for(size_t first = 0; first < nfs.size(); first += chanBlockSize_) {
+    size_t last = std::min(first + chanBlockSize_, nfs.size());
     for(size_t j = 0; j < numLayer_; j++) {
-
-      wv = v_layerWaterVapor_[j] * 1000.0; // se multiplica por 10**3 por cuestión de unidades en las rutinas fortran.
-      wvt = wv * v_layerTemperature_[j] / 217.0; // v_layerWaterVapor_[j] está en kg/m**3
-      // t = v_layerTemperature_[j] / 300.0;    // [-Wunused_but_set_variable]
-
-
-      // std::cout <<"ATMRefractiveIndexProfile: " << v_layerTemperature_[j] << " K " << v_layerPressure_[j] << " mb "  << nu << " GHz " << std::endl;
-      // std::cout <<"ATMRefractiveIndexProfile: O2" <<  atm.getRefractivity_o2(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu) << std::endl;
-      // std::cout << "ATMRefractiveIndexProfile: O2" << atm.getRefractivity_o2(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu,width,npoints) << std::endl;
-      // std::cout << "ATMRefractiveIndexProfile: H2O" << atm.getRefractivity_h2o(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu) << std::endl;
-      // std::cout << "ATMRefractiveIndexProfile: H2O" << atm.getRefractivity_h2o(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu,width,npoints) << std::endl;
-      // std::cout <<"ATMRefractiveIndexProfile: O3" <<  atm.getRefractivity_o3(v_layerTemperature_[j],v_layerPressure_[j],nu,v_layerO3_[j]) << std::endl;
-      // std::cout << "ATMRefractiveIndexProfile: O3" << atm.getRefractivity_o3(v_layerTemperature_[j],v_layerPressure_[j],nu,width,npoints,v_layerO3_[j]) << std::endl;
-      // std::cout <<"ATMRefractiveIndexProfile: CO" <<  atm.getSpecificRefractivity_co(v_layerTemperature_[j],v_layerPressure_[j],nu) << std::endl;
-      // std::cout << "ATMRefractiveIndexProfile: CO" << atm.getSpecificRefractivity_co(v_layerTemperature_[j],v_layerPressure_[j],nu,width,npoints) << std::endl;
-
-      v_N_O2LinesPtr->push_back(atm.getRefractivity_o2(v_layerTemperature_[j],
-                                                       v_layerPressure_[j],
-                                                       wvt,
-                                                       nu));     // ,width,npoints)); TO BE IMPLEMENTED IN NEXT RELEASE
-
-      std::complex<double> cont_h2o =
-        atm.getSpecificRefractivity_cnth2o(v_layerTemperature_[j],
-                                           v_layerPressure_[j],
-                                           wvt,
-                                           nu);                   // ,width,npoints); TO BE IMPLEMENTED IN NEXT RELEASE
-      std::complex<double> cont_dry =
-          atm.getSpecificRefractivity_cntdry(v_layerTemperature_[j],
-                                             v_layerPressure_[j],
-                                             wvt,
-                                             nu);                  // ,width,npoints); TO BE IMPLEMENTED IN NEXT RELEASE
-
-      v_N_H2OContPtr->push_back(cont_h2o);
-      v_N_DryContPtr->push_back(cont_dry);
-
-      if(v_layerWaterVapor_[j] > 0) {
-
-        v_N_H2OLinesPtr->push_back(atm.getRefractivity_h2o(v_layerTemperature_[j],
-                                                           v_layerPressure_[j],
-                                                           wvt,
-                                                           nu)); // ,width,npoints)); TO BE IMPLEMENTED IN NEXT RELEASE
-      } else {
-        v_N_H2OLinesPtr->push_back(0.0);
+      for(size_t k = first; k < last; k++) {
+        size_t nf = nfs[k];
+        double nu = 1.0E-9 * v_uniqueFreq_[nf]; // ATM uses GHz units
+        mkLayerRefractivity(atm, nu, j, n);
+        (*vv_N_H2OLinesPtr_[nf])[j] = n.h2oLines;
+        (*vv_N_H2OContPtr_[nf])[j] = n.h2oCont;
+        (*vv_N_O2LinesPtr_[nf])[j] = n.o2Lines;
+        (*vv_N_DryContPtr_[nf])[j] = n.dryCont;
+        (*vv_N_O3LinesPtr_[nf])[j] = n.o3Lines;
+        (*vv_N_COLinesPtr_[nf])[j] = n.coLines;
+        (*vv_N_N2OLinesPtr_[nf])[j] = n.n2oLines;
+        (*vv_N_NO2LinesPtr_[nf])[j] = n.no2Lines;
+        (*vv_N_SO2LinesPtr_[nf])[j] = n.so2Lines;
+
+        dry = n.o2Lines + n.dryCont + n.o3Lines + n.coLines + n.n2oLines + n.no2Lines + n.so2Lines;
+        wet = n.h2oLines + n.h2oCont;
+        (*vv_absTotalDryPtr_[nf])[j] = imag(dry);
+        (*vv_absTotalWetPtr_[nf])[j] = imag(wet);
+        (*vv_delayTotalDryPtr_[nf])[j] = real(dry);
+        (*vv_delayTotalWetPtr_[nf])[j] = real(wet);
       }
+    }
+  }
+}
 
-      //	if(v_layerO3_[j]<0.0||j==10){cout << "v_layerO3_[" << j << "]=" << v_layerO3_[j] << std::endl;}
-
-      if(v_layerO3_[j] > 0) {
-
-        abun_O3 = v_layerO3_[j] * 1E-6;
-        v_N_O3LinesPtr->push_back(atm.getRefractivity_o3(v_layerTemperature_[j],
-                                                         v_layerPressure_[j],
-                                                         nu,      // width,npoints, TO BE IMPLEMENTED IN NEXT RELEASE
-                                                         abun_O3 * 1e6));
-      } else {
-        v_N_O3LinesPtr->push_back(0.0);
-      }
+void RefractiveIndexProfile::mkLayerRefractivity(RefractiveIndex &atm,
+                                                 double nu,
+                                                 size_t j,
+                                                 LayerRefractivity &n) const
+{
+  double abun_O3, abun_CO, abun_N2O, abun_NO2, abun_SO2;
+  double wvt, wv;
+  // double t; // [-Wunused_but_set_variable]
 
-      if(v_layerCO_[j] > 0) {
-        abun_CO = v_layerCO_[j] * 1E-6; // in cm^-3
-        v_N_COLinesPtr->push_back(atm.getSpecificRefractivity_co(v_layerTemperature_[j],
-								 v_layerPressure_[j],
-								 nu)            // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
-				  * abun_CO * 1e6); // m^2 * m^-3 = m^-1
-        } else {
-        v_N_COLinesPtr->push_back(0.0);
-      }
+  wv = v_layerWaterVapor_[j] * 1000.0; // se multiplica por 10**3 por cuestión de unidades en las rutinas fortran.
+  wvt = wv * v_layerTemperature_[j] / 217.0; // v_layerWaterVapor_[j] está en kg/m**3
+  // t = v_layerTemperature_[j] / 300.0;    // [-Wunused_but_set_variable]
+
+
+  // std::cout <<"ATMRefractiveIndexProfile: " << v_layerTemperature_[j] << " K " << v_layerPressure_[j] << " mb "  << nu << " GHz " << std::endl;
+  // std::cout <<"ATMRefractiveIndexProfile: O2" <<  atm.getRefractivity_o2(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu) << std::endl;
+  // std::cout << "ATMRefractiveIndexProfile: O2" << atm.getRefractivity_o2(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu,width,npoints) << std::endl;
+  // std::cout << "ATMRefractiveIndexProfile: H2O" << atm.getRefractivity_h2o(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu) << std::endl;
+  // std::cout << "ATMRefractiveIndexProfile: H2O" << atm.getRefractivity_h2o(v_layerTemperature_[j],v_layerPressure_[j],wvt,nu,width,npoints) << std::endl;
+  // std::cout <<"ATMRefractiveIndexProfile: O3" <<  atm.getRefractivity_o3(v_layerTemperature_[j],v_layerPressure_[j],nu,v_layerO3_[j]) << std::endl;
+  // std::cout << "ATMRefractiveIndexProfile: O3" << atm.getRefractivity_o3(v_layerTemperature_[j],v_layerPressure_[j],nu,width,npoints,v_layerO3_[j]) << std::endl;
+  // std::cout <<"ATMRefractiveIndexProfile: CO" <<  atm.getSpecificRefractivity_co(v_layerTemperature_[j],v_layerPressure_[j],nu) << std::endl;
+  // std::cout << "ATMRefractiveIndexProfile: CO" << atm.getSpecificRefractivity_co(v_layerTemperature_[j],v_layerPressure_[j],nu,width,npoints) << std::endl;
+
+  n.o2Lines = atm.getRefractivity_o2(v_layerTemperature_[j],
+                                     v_layerPressure_[j],
+                                     wvt,
+                                     nu);     // ,width,npoints); TO BE IMPLEMENTED IN NEXT RELEASE
+
+  n.h2oCont = atm.getSpecificRefractivity_cnth2o(v_layerTemperature_[j],
+                                                 v_layerPressure_[j],
+                                                 wvt,
+                                                 nu);   // ,width,npoints); TO BE IMPLEMENTED IN NEXT RELEASE
+  n.dryCont = atm.getSpecificRefractivity_cntdry(v_layerTemperature_[j],
+                                                 v_layerPressure_[j],
+                                                 wvt,
+                                                 nu);   // ,width,npoints); TO BE IMPLEMENTED IN NEXT RELEASE
+
+  if(v_layerWaterVapor_[j] > 0) {
+    n.h2oLines = atm.getRefractivity_h2o(v_layerTemperature_[j],
+                                         v_layerPressure_[j],
+                                         wvt,
+                                         nu); // ,width,npoints); TO BE IMPLEMENTED IN NEXT RELEASE
+  } else {
+    n.h2oLines = 0.0;
+  }
 
-      if(v_layerN2O_[j] > 0) {
-        abun_N2O = v_layerN2O_[j] * 1E-6;
-        v_N_N2OLinesPtr->push_back(atm.getSpecificRefractivity_n2o(v_layerTemperature_[j],
-								   v_layerPressure_[j],
-								   nu)             // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
-				   * abun_N2O * 1e6); // m^2 * m^-3 = m^-1
-        } else {
-        v_N_N2OLinesPtr->push_back(0.0);
-      }
+  //	if(v_layerO3_[j]<0.0||j==10){cout << "v_layerO3_[" << j << "]=" << v_layerO3_[j] << std::endl;}
 
-      if(v_layerNO2_[j] > 0) {
-        abun_NO2 = v_layerNO2_[j] * 1E-6;
-        v_N_NO2LinesPtr->push_back(atm.getSpecificRefractivity_no2(v_layerTemperature_[j],
-								   v_layerPressure_[j],
-								   nu)             // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
-				   * abun_NO2 * 1e6); // m^2 * m^-3 = m^-1
-      } else {
-        v_N_NO2LinesPtr->push_back(0.0);
-      }
+  if(v_layerO3_[j] > 0) {
+    abun_O3 = v_layerO3_[j] * 1E-6;
+    n.o3Lines = atm.getRefractivity_o3(v_layerTemperature_[j],
+                                       v_layerPressure_[j],
+                                       nu,      // width,npoints, TO BE IMPLEMENTED IN NEXT RELEASE
+                                       abun_O3 * 1e6);
+  } else {
+    n.o3Lines = 0.0;
+  }
 
-      if(v_layerSO2_[j] > 0) {
-        abun_SO2 = v_layerSO2_[j] * 1E-6;
-        v_N_SO2LinesPtr->push_back(atm.getSpecificRefractivity_so2(v_layerTemperature_[j],
-								   v_layerPressure_[j],
-								   nu)            // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
-				   * abun_SO2 * 1e6); // m^2 * m^-3 = m^-1
-      } else {
-        v_N_SO2LinesPtr->push_back(0.0);
-      }
-    }
+  if(v_layerCO_[j] > 0) {
+    abun_CO = v_layerCO_[j] * 1E-6; // in cm^-3
+    n.coLines = atm.getSpecificRefractivity_co(v_layerTemperature_[j],
+                                               v_layerPressure_[j],
+                                               nu)            // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
+                * abun_CO * 1e6; // m^2 * m^-3 = m^-1
+  } else {
+    n.coLines = 0.0;
+  }
 
-    // if(vv_N_H2OLinesPtr_.size() == 0) first = true;  // [-Wunused_but_set_variable]
-
-    if(vv_N_H2OLinesPtr_.size() < v_chanFreq_.size()) {
-      vv_N_H2OLinesPtr_.push_back(v_N_H2OLinesPtr);
-      vv_N_H2OContPtr_.push_back(v_N_H2OContPtr);
-      vv_N_O2LinesPtr_.push_back(v_N_O2LinesPtr);
-      vv_N_DryContPtr_.push_back(v_N_DryContPtr);
-      vv_N_O3LinesPtr_.push_back(v_N_O3LinesPtr);
-      vv_N_COLinesPtr_.push_back(v_N_COLinesPtr);
-      vv_N_N2OLinesPtr_.push_back(v_N_N2OLinesPtr);
-      vv_N_NO2LinesPtr_.push_back(v_N_NO2LinesPtr);
-      vv_N_SO2LinesPtr_.push_back(v_N_SO2LinesPtr);
-    } else {
-      vv_N_H2OLinesPtr_[nc] = v_N_H2OLinesPtr;
-      vv_N_H2OContPtr_[nc] = v_N_H2OContPtr;
-      vv_N_O2LinesPtr_[nc] = v_N_O2LinesPtr;
-      vv_N_DryContPtr_[nc] = v_N_DryContPtr;
-      vv_N_O3LinesPtr_[nc] = v_N_O3LinesPtr;
-      vv_N_COLinesPtr_[nc] = v_N_COLinesPtr;
-      vv_N_N2OLinesPtr_[nc] = v_N_N2OLinesPtr;
-      vv_N_NO2LinesPtr_[nc] = v_N_NO2LinesPtr;
-      vv_N_SO2LinesPtr_[nc] = v_N_SO2LinesPtr;
-    }
+  if(v_layerN2O_[j] > 0) {
+    abun_N2O = v_layerN2O_[j] * 1E-6;
+    n.n2oLines = atm.getSpecificRefractivity_n2o(v_layerTemperature_[j],
+                                                 v_layerPressure_[j],
+                                                 nu)             // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
+                 * abun_N2O * 1e6; // m^2 * m^-3 = m^-1
+  } else {
+    n.n2oLines = 0.0;
+  }
 
+  if(v_layerNO2_[j] > 0) {
+    abun_NO2 = v_layerNO2_[j] * 1E-6;
+    n.no2Lines = atm.getSpecificRefractivity_no2(v_layerTemperature_[j],
+                                                 v_layerPressure_[j],
+                                                 nu)             // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
+                 * abun_NO2 * 1e6; // m^2 * m^-3 = m^-1
+  } else {
+    n.no2Lines = 0.0;
   }
 
-  newBasicParam_ = false;
-  // first = false;  // [-Wunused_but_set_variable]
+  if(v_layerSO2_[j] > 0) {
+    abun_SO2 = v_layerSO2_[j] * 1E-6;
+    n.so2Lines = atm.getSpecificRefractivity_so2(v_layerTemperature_[j],
+                                                 v_layerPressure_[j],
+                                                 nu)            // ,width,npoints) TO BE IMPLEMENTED IN NEXT RELEASE
+                 * abun_SO2 * 1e6; // m^2 * m^-3 = m^-1
+  } else {
+    n.so2Lines = 0.0;
+  }
+}
+
+void RefractiveIndexProfile::mkLayerRefractivity(RefractiveIndex &atm,
+                                                 double nu,
+                                                 size_t j,
+                                                 LayerRefractivity &n,
+                                                 LayerRefractivity partials[4]) const
+{
+  double t = v_layerTemperature_[j];
+  double p = v_layerPressure_[j];
+  double wvt = v_layerWaterVapor_[j] * 1000.0 * t / 217.0; // water vapor partial pressure (mb)
+
+  RefractiveIndex::Partials o2, h2oCont, dryCont, h2o, o3, co, n2o, no2, so2;
+  std::complex<double> o3Specific(0.0, 0.0), coSpecific(0.0, 0.0), n2oSpecific(0.0, 0.0);
+  std::complex<double> no2Specific(0.0, 0.0), so2Specific(0.0, 0.0);
+  n.o2Lines = atm.getRefractivity_o2(t, p, wvt, nu, o2);
+  n.h2oCont = atm.getSpecificRefractivity_cnth2o(t, p, wvt, nu, h2oCont);
+  n.dryCont = atm.getSpecificRefractivity_cntdry(t, p, wvt, nu, dryCont);
+  n.h2oLines = (v_layerWaterVapor_[j] > 0) ? atm.getRefractivity_h2o(t, p, wvt, nu, h2o) : 0.0;
+  if(v_layerO3_[j] > 0) o3Specific = atm.getSpecificRefractivity_o3(t, p, nu, o3);
+  if(v_layerCO_[j] > 0) coSpecific = atm.getSpecificRefractivity_co(t, p, nu, co);
+  if(v_layerN2O_[j] > 0) n2oSpecific = atm.getSpecificRefractivity_n2o(t, p, nu, n2o);
+  if(v_layerNO2_[j] > 0) no2Specific = atm.getSpecificRefractivity_no2(t, p, nu, no2);
+  if(v_layerSO2_[j] > 0) so2Specific = atm.getSpecificRefractivity_so2(t, p, nu, so2);
+  n.o3Lines = o3Specific * v_layerO3_[j];
+  n.coLines = coSpecific * v_layerCO_[j];
+  n.n2oLines = n2oSpecific * v_layerN2O_[j];
+  n.no2Lines = no2Specific * v_layerNO2_[j];
+  n.so2Lines = so2Specific * v_layerSO2_[j];
+
+  // chain rule from the derivatives of the layer parameters
+  for(size_t q = 0; q < 4; q++) {
+    const LayerPartials &d = layerPartials_[q];
+    double dt = d.temperature[j];
+    double dp = d.pressure[j];
+    double de = (d.waterVapor[j] * t + v_layerWaterVapor_[j] * dt) * 1000.0 / 217.0;
+    LayerRefractivity &dn = partials[q];
+    dn.o2Lines = o2.temperature * dt + o2.pressure * dp + o2.wvpressure * de;
+    dn.h2oCont = h2oCont.temperature * dt + h2oCont.pressure * dp + h2oCont.wvpressure * de;
+    dn.dryCont = dryCont.temperature * dt + dryCont.pressure * dp + dryCont.wvpressure * de;
+    dn.h2oLines = h2o.temperature * dt + h2o.pressure * dp + h2o.wvpressure * de;
+    dn.o3Lines = (o3.temperature * dt + o3.pressure * dp) * v_layerO3_[j] + o3Specific * d.o3[j];
+    dn.coLines = (co.temperature * dt + co.pressure * dp) * v_layerCO_[j] + coSpecific * d.co[j];
+    dn.n2oLines = (n2o.temperature * dt + n2o.pressure * dp) * v_layerN2O_[j] + n2oSpecific * d.n2o[j];
+    dn.no2Lines = (no2.temperature * dt + no2.pressure * dp) * v_layerNO2_[j] + no2Specific * d.no2[j];
+    dn.so2Lines = (so2.temperature * dt + so2.pressure * dp) * v_layerSO2_[j] + so2Specific * d.so2[j];
+  }
 }
 
 
 Opacity RefractiveIndexProfile::getDryOpacityUpTo(size_t nc, Length refalti)
 {
   size_t ires; size_t numlayerold; Length alti;  double fractionLast;
-  Opacity opacityout0; Opacity opacityout1; Opacity zeroOp(0.0,"np");
+  Opacity opacityout0; Opacity opacityout1; Opacity zeroOp = Opacity::from<Opacity::np>(0.0);
 
-  if(refalti.get("km") <= altitude_.get("km")) {
+  if(refalti.get<Length::km>() <= altitude_.get<Length::km>()) {
     return zeroOp;
   }else{
       fractionLast = 1.0; numlayerold = numLayer_;
       opacityout0=getDryOpacity(nc); ires=numlayerold-1; alti=altitude_;
       for(size_t i=0; i<numLayer_; i++){
-	if(alti.get("km") < refalti.get("km") &&  (alti.get("km")+v_layerThickness_[i]/1000.0) >= refalti.get("km"))
-	  { ires=i; fractionLast = (refalti.get("m")-alti.get("m"))/v_layerThickness_[i]; }
-	alti = alti + Length(v_layerThickness_[i],"m");
+	if(alti.get<Length::km>() < refalti.get<Length::km>() &&  (alti.get<Length::km>()+v_layerThickness_[i]/1000.0) >= refalti.get<Length::km>())
+	  { ires=i; fractionLast = (refalti.get<Length::m>()-alti.get<Length::m>())/v_layerThickness_[i]; }
+	alti = alti + Length::from<Length::m>(v_layerThickness_[i]);
       }
       numLayer_ = ires;
       opacityout0=getDryOpacity(nc);
@@ -558,11 +944,9 @@ Opacity RefractiveIndexProfile::getDryOpacity(size_t nc)
 {
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
+  const double *absDry = vv_absTotalDryPtr_[v_uniqueFreqId_[nc]]->data();
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_O2LinesPtr_[nc]->at(j) + vv_N_DryContPtr_[nc]->at(j)
-		   + vv_N_O3LinesPtr_[nc]->at(j)  + vv_N_COLinesPtr_[nc]->at(j)
-		   + vv_N_N2OLinesPtr_[nc]->at(j) + vv_N_NO2LinesPtr_[nc]->at(j)
-		   + vv_N_SO2LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + absDry[j] * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -572,7 +956,7 @@ Opacity RefractiveIndexProfile::getAverageDryOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getDryOpacity(spwid, nc);
   }
@@ -584,7 +968,7 @@ Opacity RefractiveIndexProfile::getAverageO2LinesOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getO2LinesOpacity(spwid, nc);
   }
@@ -596,13 +980,13 @@ Opacity RefractiveIndexProfile::getAverageO3LinesOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
-    /*      std::cout << " Freq = " << getChanFreq(spwid,nc).get("GHz")
-     << " O3 opacity = " << getO3LinesOpacity(spwid,nc).get("np")
-     << " O3 pathlength = " << getO3LinesPathLength(spwid,nc).get("microns")
-     << " O2 opacity = " << getO2LinesOpacity(spwid,nc).get("np")
-     << " O2 pathlength = " << getO2LinesPathLength(spwid,nc).get("microns")
+    /*      std::cout << " Freq = " << getChanFreq(spwid,nc).get<Frequency::GHz>()
+     << " O3 opacity = " << getO3LinesOpacity(spwid,nc).get<Opacity::np>()
+     << " O3 pathlength = " << getO3LinesPathLength(spwid,nc).get<Length::micron>()
+     << " O2 opacity = " << getO2LinesOpacity(spwid,nc).get<Opacity::np>()
+     << " O2 pathlength = " << getO2LinesPathLength(spwid,nc).get<Length::micron>()
      << std::endl; */
     totalaverage = totalaverage + getO3LinesOpacity(spwid, nc);
   }
@@ -614,7 +998,7 @@ Opacity RefractiveIndexProfile::getAverageN2OLinesOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getN2OLinesOpacity(spwid, nc);
   }
@@ -626,7 +1010,7 @@ Opacity RefractiveIndexProfile::getAverageNO2LinesOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getNO2LinesOpacity(spwid, nc);
   }
@@ -638,7 +1022,7 @@ Opacity RefractiveIndexProfile::getAverageSO2LinesOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getSO2LinesOpacity(spwid, nc);
   }
@@ -653,7 +1037,7 @@ Opacity RefractiveIndexProfile::getAverageCOLinesOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getCOLinesOpacity(spwid, nc);
   }
@@ -665,7 +1049,7 @@ Opacity RefractiveIndexProfile::getAverageDryContOpacity(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getDryContOpacity(spwid, nc);
   }
@@ -683,7 +1067,7 @@ Opacity RefractiveIndexProfile::getDryContOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_DryContPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_DryContPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -705,7 +1089,7 @@ Opacity RefractiveIndexProfile::getO2LinesOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_O2LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_O2LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -727,7 +1111,7 @@ Opacity RefractiveIndexProfile::getCOLinesOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_COLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_COLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -759,7 +1143,7 @@ Opacity RefractiveIndexProfile::getN2OLinesOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_N2OLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_N2OLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -776,7 +1160,7 @@ Opacity RefractiveIndexProfile::getNO2LinesOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_NO2LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_NO2LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -794,7 +1178,7 @@ Opacity RefractiveIndexProfile::getSO2LinesOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_SO2LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_SO2LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -817,7 +1201,7 @@ Opacity RefractiveIndexProfile::getO3LinesOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_O3LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_O3LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv);
 }
@@ -846,10 +1230,9 @@ Opacity RefractiveIndexProfile::getWetOpacity(const Length &integratedwatercolum
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   /*  std::cout<<"nc="<<nc<<endl; */
+  const double *absWet = vv_absTotalWetPtr_[v_uniqueFreqId_[nc]]->data();
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_H2OLinesPtr_[nc]->at(j) + vv_N_H2OContPtr_[nc]->at(j))
-        * v_layerThickness_[j];
-
+    kv = kv + absWet[j] * v_layerThickness_[j];
   }
   return Opacity(kv*(integratedwatercolumn.get()/getGroundWH2O().get()));
 }
@@ -867,7 +1250,7 @@ Opacity RefractiveIndexProfile::getAverageWetOpacity(const Length &integratedwat
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getWetOpacity(integratedwatercolumn, spwid, nc);
   }
@@ -886,8 +1269,8 @@ Opacity RefractiveIndexProfile::getH2OLinesOpacity(const Length &integratedwater
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    /*    std::cout <<"j="<<j<<" abs H2O Lines ="<<vv_N_H2OLinesPtr_[nc]->at(j) <<endl; */
-    kv = kv + imag(vv_N_H2OLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    /*    std::cout <<"j="<<j<<" abs H2O Lines ="<<vv_N_H2OLinesPtr_[v_uniqueFreqId_[nc]]->at(j) <<endl; */
+    kv = kv + imag(vv_N_H2OLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv*(integratedwatercolumn.get()/getGroundWH2O().get()));
 }
@@ -905,7 +1288,7 @@ Opacity RefractiveIndexProfile::getAverageH2OLinesOpacity(const Length &integrat
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getH2OLinesOpacity(integratedwatercolumn,spwid, nc);
   }
@@ -926,7 +1309,7 @@ Opacity RefractiveIndexProfile::getH2OContOpacity(const Length &integratedwaterc
   if(!chanIndexIsValid(nc)) return Opacity(-999.0);
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_H2OContPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_H2OContPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return Opacity(kv*(integratedwatercolumn.get()/getGroundWH2O().get()));
 }
@@ -947,7 +1330,7 @@ Opacity RefractiveIndexProfile::getAverageH2OContOpacity(const Length &integrate
 {
   if(!spwidAndIndexAreValid(spwid, 0)) return Opacity(-999.0);
   Opacity totalaverage;
-  totalaverage = Opacity(0.0, "np");
+  totalaverage = Opacity::from<Opacity::np>(0.0);
   for(size_t nc = 0; nc < getNumChan(spwid); nc++) {
     totalaverage = totalaverage + getH2OContOpacity(integratedwatercolumn,spwid, nc);
   }
@@ -969,13 +1352,13 @@ Angle RefractiveIndexProfile::getDispersiveH2OPhaseDelay(const Length &integrate
                                                          size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_H2OLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_H2OLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv*(integratedwatercolumn.get()/getGroundWH2O().get())* 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv*(integratedwatercolumn.get()/getGroundWH2O().get())* 57.29578);
   return aa;
 }
 
@@ -983,11 +1366,11 @@ Length RefractiveIndexProfile::getDispersiveH2OPathLength(const Length &integrat
                                                           size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getDispersiveH2OPhaseDelay(integratedwatercolumn,nc).get("deg"),
-            "m");
+  Length ll =
+    Length::from<Length::m>((wavelength / 360.0) * getDispersiveH2OPhaseDelay(integratedwatercolumn,nc).get<Angle::deg>());
   return ll;
 }
 
@@ -996,7 +1379,7 @@ Angle RefractiveIndexProfile::getDispersiveH2OPhaseDelay(const Length &integrate
                                                          size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getDispersiveH2OPhaseDelay(integratedwatercolumn,v_transfertId_[spwid] + nc);
 }
@@ -1005,14 +1388,14 @@ Angle RefractiveIndexProfile::getAverageDispersiveH2OPhaseDelay(const Length &in
                                                                 size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getDispersiveH2OPhaseDelay(integratedwatercolumn,v_transfertId_[spwid] + i).get("deg");
+    av = av + getDispersiveH2OPhaseDelay(integratedwatercolumn,v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1021,7 +1404,7 @@ Length RefractiveIndexProfile::getDispersiveH2OPathLength(const Length &integrat
                                                           size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getDispersiveH2OPathLength(integratedwatercolumn,v_transfertId_[spwid] + nc);
 }
@@ -1030,14 +1413,14 @@ Length RefractiveIndexProfile::getAverageDispersiveH2OPathLength(const Length &i
                                                                  size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getDispersiveH2OPathLength(integratedwatercolumn,v_transfertId_[spwid] + i).get("mm");
+    av = av + getDispersiveH2OPathLength(integratedwatercolumn,v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1064,24 +1447,24 @@ Length RefractiveIndexProfile::getDispersiveDryPathLength()
 Angle RefractiveIndexProfile::getNonDispersiveDryPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_DryContPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_DryContPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv * 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv * 57.29578);
   return aa;
 }
 
 Angle RefractiveIndexProfile::getDispersiveDryPhaseDelay(size_t nc)
 {
-  //    std::cout << "getO2LinesPhaseDelay(" << nc << ")=" << getO2LinesPhaseDelay(nc).get("deg")  << std::endl;
-  // std::cout << "getO3LinesPhaseDelay(" << nc << ")=" << getO3LinesPhaseDelay(nc).get("deg") << std::endl;
-  //    std::cout << "getN2OLinesPhaseDelay(" << nc << ")=" << getN2OLinesPhaseDelay(nc).get("deg") << std::endl;
-  //    std::cout << "getNO2LinesPhaseDelay(" << nc << ")=" << getNO2LinesPhaseDelay(nc).get("deg") << std::endl;
-  //    std::cout << "getSO2LinesPhaseDelay(" << nc << ")=" << getSO2LinesPhaseDelay(nc).get("deg") << std::endl;
-  //    std::cout << "getCOLinesPhaseDelay(" << nc << ")=" << getCOLinesPhaseDelay(nc).get("deg") << std::endl;
+  //    std::cout << "getO2LinesPhaseDelay(" << nc << ")=" << getO2LinesPhaseDelay(nc).get<Angle::deg>()  << std::endl;
+  // std::cout << "getO3LinesPhaseDelay(" << nc << ")=" << getO3LinesPhaseDelay(nc).get<Angle::deg>() << std::endl;
+  //    std::cout << "getN2OLinesPhaseDelay(" << nc << ")=" << getN2OLinesPhaseDelay(nc).get<Angle::deg>() << std::endl;
+  //    std::cout << "getNO2LinesPhaseDelay(" << nc << ")=" << getNO2LinesPhaseDelay(nc).get<Angle::deg>() << std::endl;
+  //    std::cout << "getSO2LinesPhaseDelay(" << nc << ")=" << getSO2LinesPhaseDelay(nc).get<Angle::deg>() << std::endl;
+  //    std::cout << "getCOLinesPhaseDelay(" << nc << ")=" << getCOLinesPhaseDelay(nc).get<Angle::deg>() << std::endl;
   return getO2LinesPhaseDelay(nc) + getO3LinesPhaseDelay(nc)
       + getN2OLinesPhaseDelay(nc) + getCOLinesPhaseDelay(nc)
       + getNO2LinesPhaseDelay(nc) + getSO2LinesPhaseDelay(nc);
@@ -1090,12 +1473,10 @@ Angle RefractiveIndexProfile::getDispersiveDryPhaseDelay(size_t nc)
 Length RefractiveIndexProfile::getNonDispersiveDryPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length
-      ll((wavelength / 360.0) * getNonDispersiveDryPhaseDelay(nc).get("deg"),
-         "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getNonDispersiveDryPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1103,7 +1484,7 @@ Angle RefractiveIndexProfile::getNonDispersiveDryPhaseDelay(size_t spwid,
                                                             size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getNonDispersiveDryPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1111,11 +1492,10 @@ Angle RefractiveIndexProfile::getNonDispersiveDryPhaseDelay(size_t spwid,
 Length RefractiveIndexProfile::getDispersiveDryPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getDispersiveDryPhaseDelay(nc).get("deg"),
-            "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getDispersiveDryPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1123,7 +1503,7 @@ Angle RefractiveIndexProfile::getDispersiveDryPhaseDelay(size_t spwid,
                                                          size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getDispersiveDryPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1131,29 +1511,29 @@ Angle RefractiveIndexProfile::getDispersiveDryPhaseDelay(size_t spwid,
 Angle RefractiveIndexProfile::getAverageNonDispersiveDryPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
     av = av
-        + getNonDispersiveDryPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+        + getNonDispersiveDryPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
 Angle RefractiveIndexProfile::getAverageDispersiveDryPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getDispersiveDryPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getDispersiveDryPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1161,7 +1541,7 @@ Length RefractiveIndexProfile::getNonDispersiveDryPathLength(size_t spwid,
                                                              size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getNonDispersiveDryPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1170,7 +1550,7 @@ Length RefractiveIndexProfile::getDispersiveDryPathLength(size_t spwid,
                                                           size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getDispersiveDryPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1178,30 +1558,30 @@ Length RefractiveIndexProfile::getDispersiveDryPathLength(size_t spwid,
 Length RefractiveIndexProfile::getAverageNonDispersiveDryPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
     av = av
-        + getNonDispersiveDryPathLength(v_transfertId_[spwid] + i).get("mm");
+        + getNonDispersiveDryPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
 Length RefractiveIndexProfile::getAverageDispersiveDryPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getDispersiveDryPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getDispersiveDryPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
 
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1218,23 +1598,23 @@ Length RefractiveIndexProfile::getO2LinesPathLength()
 Angle RefractiveIndexProfile::getO2LinesPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_O2LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_O2LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv * 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv * 57.29578);
   return aa;
 }
 
 Length RefractiveIndexProfile::getO2LinesPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getO2LinesPhaseDelay(nc).get("deg"), "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getO2LinesPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1242,7 +1622,7 @@ Angle RefractiveIndexProfile::getO2LinesPhaseDelay(size_t spwid,
                                                    size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getO2LinesPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1250,14 +1630,14 @@ Angle RefractiveIndexProfile::getO2LinesPhaseDelay(size_t spwid,
 Angle RefractiveIndexProfile::getAverageO2LinesPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getO2LinesPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getO2LinesPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1265,7 +1645,7 @@ Length RefractiveIndexProfile::getO2LinesPathLength(size_t spwid,
                                                     size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getO2LinesPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1273,14 +1653,14 @@ Length RefractiveIndexProfile::getO2LinesPathLength(size_t spwid,
 Length RefractiveIndexProfile::getAverageO2LinesPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getO2LinesPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getO2LinesPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1297,7 +1677,7 @@ Length RefractiveIndexProfile::getO3LinesPathLength()
 Angle RefractiveIndexProfile::getO3LinesPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
 
@@ -1305,21 +1685,21 @@ Angle RefractiveIndexProfile::getO3LinesPhaseDelay(size_t nc)
 
   for(size_t j = 0; j < numLayer_; j++) {
     /* if(nc=66){
-     std::cout << "j=" << j << " vv_N_O3LinesPtr_[" << nc << "]->at(" << j << ")="  << vv_N_O3LinesPtr_[nc]->at(j) << std::endl;
+     std::cout << "j=" << j << " vv_N_O3LinesPtr_[" << nc << "]->at(" << j << ")="  << vv_N_O3LinesPtr_[v_uniqueFreqId_[nc]]->at(j) << std::endl;
      } */
-    kv = kv + real(vv_N_O3LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_O3LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv * 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv * 57.29578);
   return aa;
 }
 
 Length RefractiveIndexProfile::getO3LinesPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getO3LinesPhaseDelay(nc).get("deg"), "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getO3LinesPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1327,7 +1707,7 @@ Angle RefractiveIndexProfile::getO3LinesPhaseDelay(size_t spwid,
                                                    size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getO3LinesPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1335,14 +1715,14 @@ Angle RefractiveIndexProfile::getO3LinesPhaseDelay(size_t spwid,
 Angle RefractiveIndexProfile::getAverageO3LinesPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getO3LinesPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getO3LinesPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1350,7 +1730,7 @@ Length RefractiveIndexProfile::getO3LinesPathLength(size_t spwid,
                                                     size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getO3LinesPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1358,14 +1738,14 @@ Length RefractiveIndexProfile::getO3LinesPathLength(size_t spwid,
 Length RefractiveIndexProfile::getAverageO3LinesPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getO3LinesPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getO3LinesPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1382,23 +1762,23 @@ Length RefractiveIndexProfile::getCOLinesPathLength()
 Angle RefractiveIndexProfile::getCOLinesPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_COLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_COLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv * 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv * 57.29578);
   return aa;
 }
 
 Length RefractiveIndexProfile::getCOLinesPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getCOLinesPhaseDelay(nc).get("deg"), "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getCOLinesPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1406,7 +1786,7 @@ Angle RefractiveIndexProfile::getCOLinesPhaseDelay(size_t spwid,
                                                    size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getCOLinesPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1414,14 +1794,14 @@ Angle RefractiveIndexProfile::getCOLinesPhaseDelay(size_t spwid,
 Angle RefractiveIndexProfile::getAverageCOLinesPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getCOLinesPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getCOLinesPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1429,7 +1809,7 @@ Length RefractiveIndexProfile::getCOLinesPathLength(size_t spwid,
                                                     size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getCOLinesPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1437,14 +1817,14 @@ Length RefractiveIndexProfile::getCOLinesPathLength(size_t spwid,
 Length RefractiveIndexProfile::getAverageCOLinesPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getCOLinesPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getCOLinesPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1461,23 +1841,23 @@ Length RefractiveIndexProfile::getN2OLinesPathLength()
 Angle RefractiveIndexProfile::getN2OLinesPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_N2OLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_N2OLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv * 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv * 57.29578);
   return aa;
 }
 
 Length RefractiveIndexProfile::getN2OLinesPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getN2OLinesPhaseDelay(nc).get("deg"), "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getN2OLinesPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1485,7 +1865,7 @@ Angle RefractiveIndexProfile::getN2OLinesPhaseDelay(size_t spwid,
                                                     size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getN2OLinesPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1493,14 +1873,14 @@ Angle RefractiveIndexProfile::getN2OLinesPhaseDelay(size_t spwid,
 Angle RefractiveIndexProfile::getAverageN2OLinesPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getN2OLinesPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getN2OLinesPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1508,7 +1888,7 @@ Length RefractiveIndexProfile::getN2OLinesPathLength(size_t spwid,
                                                      size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getN2OLinesPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1516,14 +1896,14 @@ Length RefractiveIndexProfile::getN2OLinesPathLength(size_t spwid,
 Length RefractiveIndexProfile::getAverageN2OLinesPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getN2OLinesPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getN2OLinesPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1545,23 +1925,23 @@ Length RefractiveIndexProfile::getNO2LinesPathLength()
 Angle RefractiveIndexProfile::getNO2LinesPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_NO2LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_NO2LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv * 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv * 57.29578);
   return aa;
 }
 
 Length RefractiveIndexProfile::getNO2LinesPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getNO2LinesPhaseDelay(nc).get("deg"), "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getNO2LinesPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1569,7 +1949,7 @@ Angle RefractiveIndexProfile::getNO2LinesPhaseDelay(size_t spwid,
                                                     size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getNO2LinesPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1577,14 +1957,14 @@ Angle RefractiveIndexProfile::getNO2LinesPhaseDelay(size_t spwid,
 Angle RefractiveIndexProfile::getAverageNO2LinesPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getNO2LinesPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getNO2LinesPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1592,7 +1972,7 @@ Length RefractiveIndexProfile::getNO2LinesPathLength(size_t spwid,
                                                      size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getNO2LinesPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1600,14 +1980,14 @@ Length RefractiveIndexProfile::getNO2LinesPathLength(size_t spwid,
 Length RefractiveIndexProfile::getAverageNO2LinesPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getNO2LinesPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getNO2LinesPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1631,23 +2011,23 @@ Length RefractiveIndexProfile::getSO2LinesPathLength()
 Angle RefractiveIndexProfile::getSO2LinesPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_SO2LinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_SO2LinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv * 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv * 57.29578);
   return aa;
 }
 
 Length RefractiveIndexProfile::getSO2LinesPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getSO2LinesPhaseDelay(nc).get("deg"), "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getSO2LinesPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1655,7 +2035,7 @@ Angle RefractiveIndexProfile::getSO2LinesPhaseDelay(size_t spwid,
                                                     size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getSO2LinesPhaseDelay(v_transfertId_[spwid] + nc);
 }
@@ -1663,14 +2043,14 @@ Angle RefractiveIndexProfile::getSO2LinesPhaseDelay(size_t spwid,
 Angle RefractiveIndexProfile::getAverageSO2LinesPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getSO2LinesPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getSO2LinesPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
@@ -1678,7 +2058,7 @@ Length RefractiveIndexProfile::getSO2LinesPathLength(size_t spwid,
                                                      size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   return getSO2LinesPathLength(v_transfertId_[spwid] + nc);
 }
@@ -1686,14 +2066,14 @@ Length RefractiveIndexProfile::getSO2LinesPathLength(size_t spwid,
 Length RefractiveIndexProfile::getAverageSO2LinesPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getSO2LinesPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getSO2LinesPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -1713,12 +2093,12 @@ Angle RefractiveIndexProfile::getNonDispersiveH2OPhaseDelay(const Length &integr
 {
   double kv = 0;
   if(!chanIndexIsValid(nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_H2OContPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_H2OContPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(kv*(integratedwatercolumn.get()/getGroundWH2O().get())* 57.29578, "deg");
+  Angle aa = Angle::from<Angle::deg>(kv*(integratedwatercolumn.get()/getGroundWH2O().get())* 57.29578);
   return aa;
 }
 
@@ -1726,10 +2106,11 @@ Length RefractiveIndexProfile::getNonDispersiveH2OPathLength(const Length &integ
                                                              size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    return Length(-999.0, "m");
+    return Length::from<Length::m>(-999.0);
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getNonDispersiveH2OPhaseDelay(integratedwatercolumn,nc).get("deg"),"m");
+  Length ll =
+    Length::from<Length::m>((wavelength / 360.0) * getNonDispersiveH2OPhaseDelay(integratedwatercolumn,nc).get<Angle::deg>());
   return ll;
 }
 
@@ -1738,7 +2119,7 @@ Angle RefractiveIndexProfile::getNonDispersiveH2OPhaseDelay(const Length &integr
                                                             size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   return getNonDispersiveH2OPhaseDelay(integratedwatercolumn,v_transfertId_[spwid] + nc);
 }
@@ -1747,15 +2128,15 @@ Angle RefractiveIndexProfile::getAverageNonDispersiveH2OPhaseDelay(const Length
                                                                    size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    return Angle(-999.0, "deg");
+    return Angle::from<Angle::deg>(-999.0);
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
     av = av
-        + getNonDispersiveH2OPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+        + getNonDispersiveH2OPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av*(integratedwatercolumn.get()/getGroundWH2O().get()), "deg");
+  Angle average = Angle::from<Angle::deg>(av*(integratedwatercolumn.get()/getGroundWH2O().get()));
   return average;
 }
 
@@ -1778,17 +2159,20 @@ Length RefractiveIndexProfile::getAverageNonDispersiveH2OPathLength(const Length
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
     av = av
-      + getNonDispersiveH2OPathLength(integratedwatercolumn,v_transfertId_[spwid] + i).get("deg");
+      + getNonDispersiveH2OPathLength(integratedwatercolumn,v_transfertId_[spwid] + i).get<Length::m>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "deg");
+  Length average = Length::from<Length::m>(av);
   return average;
 }
 
 // NB: the function chanIndexIsValid will be overrided by ....
 bool RefractiveIndexProfile::chanIndexIsValid(size_t nc)
 {
-  if(nc < vv_N_H2OLinesPtr_.size()) return true;
+  if(nc < v_uniqueFreqId_.size()) {
+    mkChanSpectralWindow(nc); // no-op unless in lazy mode and the spectral window is not yet computed
+    return true;
+  }
   if(nc < v_chanFreq_.size()) {
     std::cout
         << " RefractiveIndexProfile: Requested index in a new spectral window ==> update profile"
@@ -24,9 +24,16 @@
  */
 
 #include "ATMSkyStatus.h"
+#include "ATMLevenbergMarquardt.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <math.h>
+#include <thread>
+#include <utility>
 
 ATM_NAMESPACE_BEGIN
 
@@ -34,7 +41,16 @@ ATM_NAMESPACE_BEGIN
 
 SkyStatus::SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile) :
   RefractiveIndexProfile(refractiveIndexProfile), airMass_(1.0),
-      skyBackgroundTemperature_(2.73, "K")
+      skyBackgroundTemperature_(Temperature::from<Temperature::K>(2.73))
+{
+
+  iniSkyStatus();
+
+}
+
+SkyStatus::SkyStatus(RefractiveIndexProfile &&refractiveIndexProfile) :
+  RefractiveIndexProfile(std::move(refractiveIndexProfile)), airMass_(1.0),
+      skyBackgroundTemperature_(Temperature::from<Temperature::K>(2.73))
 {
 
   iniSkyStatus();
@@ -44,7 +60,7 @@ SkyStatus::SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile) :
 SkyStatus::SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile,
                      double airMass) :
   RefractiveIndexProfile(refractiveIndexProfile), airMass_(airMass),
-      skyBackgroundTemperature_(2.73, "K")
+      skyBackgroundTemperature_(Temperature::from<Temperature::K>(2.73))
 {
 
   iniSkyStatus();
@@ -64,7 +80,7 @@ SkyStatus::SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile,
 SkyStatus::SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile,
                      const Length &wh2o) :
   RefractiveIndexProfile(refractiveIndexProfile), airMass_(1.0),
-      skyBackgroundTemperature_(2.73, "K"), wh2o_user_(wh2o)
+      skyBackgroundTemperature_(Temperature::from<Temperature::K>(2.73)), wh2o_user_(wh2o)
 {
 
   iniSkyStatus();
@@ -97,7 +113,7 @@ SkyStatus::SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile,
                      const Length &wh2o,
                      double airMass) :
   RefractiveIndexProfile(refractiveIndexProfile), airMass_(airMass),
-      skyBackgroundTemperature_(2.73, "K"), wh2o_user_(wh2o)
+      skyBackgroundTemperature_(Temperature::from<Temperature::K>(2.73)), wh2o_user_(wh2o)
 {
 
   iniSkyStatus();
@@ -108,7 +124,7 @@ SkyStatus::SkyStatus(const RefractiveIndexProfile &refractiveIndexProfile,
                      double airMass,
                      const Length &wh2o) :
   RefractiveIndexProfile(refractiveIndexProfile), airMass_(airMass),
-      skyBackgroundTemperature_(2.73, "K"), wh2o_user_(wh2o)
+      skyBackgroundTemperature_(Temperature::from<Temperature::K>(2.73)), wh2o_user_(wh2o)
 {
 
   iniSkyStatus();
@@ -700,7 +716,7 @@ Opacity SkyStatus::getH2OLinesOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return (double) -999.0;
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_H2OLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_H2OLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return ((getUserWH2O().get()) / (getGroundWH2O().get())) * kv;
 }
@@ -708,19 +724,19 @@ Opacity SkyStatus::getH2OLinesOpacity(size_t nc)
 Opacity SkyStatus::getH2OLinesOpacityUpTo(size_t nc, Length refalti)
 {
   size_t ires; size_t numlayerold; Length alti;
-  Opacity opacityout0; Opacity opacityout1; Opacity zeroOp(0.0,"np");
+  Opacity opacityout0; Opacity opacityout1; Opacity zeroOp = Opacity::from<Opacity::np>(0.0);
   double fractionLast; double g1; double g2;
 
-  if(refalti.get("km") <= altitude_.get("km")) {
+  if(refalti.get<Length::km>() <= altitude_.get<Length::km>()) {
     return zeroOp;
   }else{
       fractionLast = 1.0; numlayerold = numLayer_;
       g1=getGroundWH2O().get();
       opacityout0=getH2OLinesOpacity(nc); ires=numlayerold-1; alti=altitude_;
       for(size_t i=0; i<numLayer_; i++){
-	if(alti.get("km") < refalti.get("km") &&  (alti.get("km")+v_layerThickness_[i]/1000.0) >= refalti.get("km"))
-	  { ires=i; fractionLast = (refalti.get("m")-alti.get("m"))/v_layerThickness_[i]; }
-	alti = alti + Length(v_layerThickness_[i],"m");
+	if(alti.get<Length::km>() < refalti.get<Length::km>() &&  (alti.get<Length::km>()+v_layerThickness_[i]/1000.0) >= refalti.get<Length::km>())
+	  { ires=i; fractionLast = (refalti.get<Length::m>()-alti.get<Length::m>())/v_layerThickness_[i]; }
+	alti = alti + Length::from<Length::m>(v_layerThickness_[i]);
       }
       numLayer_ = ires; g2=getGroundWH2O().get();
       opacityout0=getH2OLinesOpacity(nc)*(g2/g1);
@@ -736,24 +752,24 @@ Opacity SkyStatus::getTotalOpacityUpTo(size_t nc, Length refalti)    //15NOV2017
   {
     size_t ires; size_t numlayerold; Length alti;
     Opacity opacityout; Opacity opacityout0;
-    Opacity opacityout1; Opacity zeroOp(0.0,"np");
+    Opacity opacityout1; Opacity zeroOp = Opacity::from<Opacity::np>(0.0);
     double fractionLast; double g1; double g2;
 
-    if(refalti.get("km") <= altitude_.get("km")) {
+    if(refalti.get<Length::km>() <= altitude_.get<Length::km>()) {
       return zeroOp;
     }else{
       fractionLast = 1.0; numlayerold = numLayer_;
       g1=getGroundWH2O().get(); ires = numlayerold-1; alti=altitude_;
       for(size_t i=0; i<numLayer_; i++){
-	if(alti.get("km") < refalti.get("km") &&  (alti.get("km")+v_layerThickness_[i]/1000.0) >= refalti.get("km"))
-	  { ires=i; fractionLast = (refalti.get("m")-alti.get("m"))/v_layerThickness_[i]; }
-	alti = alti + Length(v_layerThickness_[i],"m");
+	if(alti.get<Length::km>() < refalti.get<Length::km>() &&  (alti.get<Length::km>()+v_layerThickness_[i]/1000.0) >= refalti.get<Length::km>())
+	  { ires=i; fractionLast = (refalti.get<Length::m>()-alti.get<Length::m>())/v_layerThickness_[i]; }
+	alti = alti + Length::from<Length::m>(v_layerThickness_[i]);
       }
       numLayer_ = ires+1; g2=getGroundWH2O().get();
       // std::cout << "En getTotalOpacityUpTo numlayerold numLayer_ fractionLast " << numlayerold << " " << numLayer_ << " " << fractionLast << std::endl;
       // std::cout << "calculando opacityout1" << std::endl;
       opacityout1 = getWetOpacity(nc)*(g2/g1) + getDryOpacity(nc);
-      // std::cout << "opacityout1= " << opacityout1.get("np") << std::endl;
+      // std::cout << "opacityout1= " << opacityout1.get<Opacity::np>() << std::endl;
       // std::cout << "calculando opacityout0" << std::endl;
       // std::cout << "ires=" << ires << std::endl;
       if(ires == 0){
@@ -762,7 +778,7 @@ Opacity SkyStatus::getTotalOpacityUpTo(size_t nc, Length refalti)    //15NOV2017
 	numLayer_ = ires; g2=getGroundWH2O().get();
 	opacityout0 = getWetOpacity(nc)*(g2/g1) + getDryOpacity(nc);
       }
-      //    std::cout << "opacityout0= " << opacityout0.get("np") << std::endl;
+      //    std::cout << "opacityout0= " << opacityout0.get<Opacity::np>() << std::endl;
       opacityout = opacityout0 + (opacityout1-opacityout0)*fractionLast;
       numLayer_ = numlayerold;
       return opacityout;
@@ -775,7 +791,7 @@ Opacity SkyStatus::getH2OContOpacity(size_t nc)
   if(!chanIndexIsValid(nc)) return (double) -999.0;
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + imag(vv_N_H2OContPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + imag(vv_N_H2OContPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
   return ((getUserWH2O().get()) / (getGroundWH2O().get())) * kv;
 }
@@ -783,20 +799,20 @@ Opacity SkyStatus::getH2OContOpacity(size_t nc)
 Opacity SkyStatus::getH2OContOpacityUpTo(size_t nc, Length refalti)
 {
   size_t ires; size_t numlayerold; Length alti;
-  Opacity opacityout0; Opacity opacityout1; Opacity zeroOp(0.0,"np");
+  Opacity opacityout0; Opacity opacityout1; Opacity zeroOp = Opacity::from<Opacity::np>(0.0);
   double fractionLast; double g1; double g2;
 
 
-  if(refalti.get("km") <= altitude_.get("km")) {
+  if(refalti.get<Length::km>() <= altitude_.get<Length::km>()) {
     return zeroOp;
   }else{
       fractionLast = 1.0; numlayerold = numLayer_;
       g1=getGroundWH2O().get();
       opacityout0=getH2OContOpacity(nc); ires=numlayerold-1; alti=altitude_;
       for(size_t i=0; i<numLayer_; i++){
-	if(alti.get("km") < refalti.get("km") &&  (alti.get("km")+v_layerThickness_[i]/1000.0) >= refalti.get("km"))
-	  { ires=i; fractionLast = (refalti.get("m")-alti.get("m"))/v_layerThickness_[i]; }
-	alti = alti + Length(v_layerThickness_[i],"m");
+	if(alti.get<Length::km>() < refalti.get<Length::km>() &&  (alti.get<Length::km>()+v_layerThickness_[i]/1000.0) >= refalti.get<Length::km>())
+	  { ires=i; fractionLast = (refalti.get<Length::m>()-alti.get<Length::m>())/v_layerThickness_[i]; }
+	alti = alti + Length::from<Length::m>(v_layerThickness_[i]);
       }
       numLayer_ = ires; g2=getGroundWH2O().get();
       opacityout0=getH2OContOpacity(nc)*(g2/g1);
@@ -810,27 +826,25 @@ Opacity SkyStatus::getH2OContOpacityUpTo(size_t nc, Length refalti)
 Angle SkyStatus::getDispersiveH2OPhaseDelay(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    Angle aa(0.0, "deg");
+    Angle aa = Angle::from<Angle::deg>(0.0);
     return aa;
   }
   double kv = 0;
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_H2OLinesPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_H2OLinesPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(((getUserWH2O().get()) / (getGroundWH2O().get())) * kv * 57.29578,
-           "deg");
+  Angle aa = Angle::from<Angle::deg>(((getUserWH2O().get()) / (getGroundWH2O().get())) * kv * 57.29578);
   return aa;
 }
 
 Length SkyStatus::getDispersiveH2OPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    Length ll(0.0, "mm");
+    Length ll = Length::from<Length::mm>(0.0);
     return ll;
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length ll((wavelength / 360.0) * getDispersiveH2OPhaseDelay(nc).get("deg"),
-            "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getDispersiveH2OPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
@@ -838,89 +852,86 @@ Angle SkyStatus::getNonDispersiveH2OPhaseDelay(size_t nc)
 {
   double kv = 0;
   if(!chanIndexIsValid(nc)) {
-    Angle aa(0.0, "deg");
+    Angle aa = Angle::from<Angle::deg>(0.0);
     return aa;
   }
   for(size_t j = 0; j < numLayer_; j++) {
-    kv = kv + real(vv_N_H2OContPtr_[nc]->at(j)) * v_layerThickness_[j];
+    kv = kv + real(vv_N_H2OContPtr_[v_uniqueFreqId_[nc]]->at(j)) * v_layerThickness_[j];
   }
-  Angle aa(((getUserWH2O().get()) / (getGroundWH2O().get())) * kv * 57.29578,
-           "deg");
+  Angle aa = Angle::from<Angle::deg>(((getUserWH2O().get()) / (getGroundWH2O().get())) * kv * 57.29578);
   return aa;
 }
 
 Length SkyStatus::getNonDispersiveH2OPathLength(size_t nc)
 {
   if(!chanIndexIsValid(nc)) {
-    Length ll(0.0, "mm");
+    Length ll = Length::from<Length::mm>(0.0);
     return ll;
   }
   double wavelength = 299792458.0 / v_chanFreq_[nc]; // in m
-  Length
-      ll((wavelength / 360.0) * getNonDispersiveH2OPhaseDelay(nc).get("deg"),
-         "m");
+  Length ll = Length::from<Length::m>((wavelength / 360.0) * getNonDispersiveH2OPhaseDelay(nc).get<Angle::deg>());
   return ll;
 }
 
 Angle SkyStatus::getAverageDispersiveH2OPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    Angle aa(-999.0, "deg");
+    Angle aa = Angle::from<Angle::deg>(-999.0);
     return aa;
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getDispersiveH2OPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+    av = av + getDispersiveH2OPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
 Length SkyStatus::getAverageDispersiveH2OPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    Length ll(0.0, "mm");
+    Length ll = Length::from<Length::mm>(0.0);
     return ll;
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
-    av = av + getDispersiveH2OPathLength(v_transfertId_[spwid] + i).get("mm");
+    av = av + getDispersiveH2OPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
 Angle SkyStatus::getAverageNonDispersiveH2OPhaseDelay(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    Angle aa(0.0, "deg");
+    Angle aa = Angle::from<Angle::deg>(0.0);
     return aa;
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
     av = av
-        + getNonDispersiveH2OPhaseDelay(v_transfertId_[spwid] + i).get("deg");
+        + getNonDispersiveH2OPhaseDelay(v_transfertId_[spwid] + i).get<Angle::deg>();
   }
   av = av / getNumChan(spwid);
-  Angle average(av, "deg");
+  Angle average = Angle::from<Angle::deg>(av);
   return average;
 }
 
 Length SkyStatus::getAverageNonDispersiveH2OPathLength(size_t spwid)
 {
   if(!spwidAndIndexAreValid(spwid, 0)) {
-    Length ll(0.0, "mm");
+    Length ll = Length::from<Length::mm>(0.0);
     return ll;
   }
   double av = 0.0;
   for(size_t i = 0; i < getNumChan(spwid); i++) {
     av = av
-        + getNonDispersiveH2OPathLength(v_transfertId_[spwid] + i).get("mm");
+        + getNonDispersiveH2OPathLength(v_transfertId_[spwid] + i).get<Length::mm>();
   }
   av = av / getNumChan(spwid);
-  Length average(av, "mm");
+  Length average = Length::from<Length::mm>(av);
   return average;
 }
 
@@ -930,7 +941,7 @@ Temperature SkyStatus::getAverageTebbSky(size_t spwid,
                                          double skycoupling,
                                          const Temperature &Tspill)
 {
-  Temperature tt(-999, "K");
+  Temperature tt = Temperature::from<Temperature::K>(-999);
   if(!spwidAndIndexAreValid(spwid, 0)) {
     return tt;
   }
@@ -941,12 +952,12 @@ Temperature SkyStatus::getAverageTebbSky(size_t spwid,
   if(airmass < 1.0) {
     return tt;
   }
-  if(Tspill.get("K") < 0.0 || Tspill.get("K") > 350.0) {
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
     return tt;
   }
   return RT(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             spwid);
 }
@@ -958,7 +969,7 @@ Temperature SkyStatus::getAverageTebbSky(size_t spwid,
                                          double signalgain,     // adition
                                          const Temperature &Tspill)
 {
-  Temperature tt(-999, "K");
+  Temperature tt = Temperature::from<Temperature::K>(-999);
   if(!spwidAndIndexAreValid(spwid, 0)) {
     return tt;
   }
@@ -969,17 +980,17 @@ Temperature SkyStatus::getAverageTebbSky(size_t spwid,
   if(airmass < 1.0) {
     return tt;
   }
-  if(Tspill.get("K") < 0.0 || Tspill.get("K") > 350.0) {
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
     return tt;
   }
   return signalgain*RT(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             spwid)+
     +(1-signalgain)*RT(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             getAssocSpwId(spwid)[0]);
 }
@@ -991,7 +1002,7 @@ Temperature SkyStatus::getTebbSky(size_t spwid,
                                   double skycoupling,
                                   const Temperature &Tspill)
 {
-  Temperature tt(-999, "K");
+  Temperature tt = Temperature::from<Temperature::K>(-999);
   if(!spwidAndIndexAreValid(spwid, nc)) {
     return tt;
   }
@@ -1004,25 +1015,65 @@ Temperature SkyStatus::getTebbSky(size_t spwid,
   if(airmass < 1.0) {
     return tt;
   }
-  if(Tspill.get("K") < 0.0 || Tspill.get("K") > 350.0) {
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
     return tt;
   }
   return RT(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             spwid,
             nc);
 }
 
 
+Temperature SkyStatus::getTebbSkyDerivatives(size_t spwid,
+                                             size_t nc,
+                                             const Length &wh2o,
+                                             double airmass,
+                                             double skycoupling,
+                                             const Temperature &Tspill,
+                                             double &dTebb_dWH2O,
+                                             double &dTebb_dSkyCoupling,
+                                             double &dTebb_dTspill)
+{
+  Temperature tt = Temperature::from<Temperature::K>(-999);
+  if(!spwidAndIndexAreValid(spwid, nc)) {
+    return tt;
+  }
+  if(wh2o.get() < 0.0) {
+    return tt;
+  }
+  if(skycoupling < 0.0 || skycoupling > 1.0) {
+    return tt;
+  }
+  if(airmass < 1.0) {
+    return tt;
+  }
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
+    return tt;
+  }
+  double jacobian[3];
+  double tebb = RT(((wh2o.get()) / (getGroundWH2O().get())),
+                   skycoupling,
+                   Tspill.get<Temperature::K>(),
+                   airmass,
+                   spwid,
+                   nc,
+                   jacobian);
+  dTebb_dWH2O = jacobian[0] / getGroundWH2O().get<Length::mm>();
+  dTebb_dSkyCoupling = jacobian[1];
+  dTebb_dTspill = jacobian[2];
+  return Temperature::from<Temperature::K>(tebb);
+}
+
 Temperature SkyStatus::getAverageTrjSky(size_t spwid,
                                          const Length &wh2o,
                                          double airmass,
                                          double skycoupling,
                                          const Temperature &Tspill)
 {
-  Temperature tt(-999, "K");
+  Temperature tt = Temperature::from<Temperature::K>(-999);
   if(!spwidAndIndexAreValid(spwid, 0)) {
     return tt;
   }
@@ -1033,12 +1084,12 @@ Temperature SkyStatus::getAverageTrjSky(size_t spwid,
   if(airmass < 1.0) {
     return tt;
   }
-  if(Tspill.get("K") < 0.0 || Tspill.get("K") > 350.0) {
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
     return tt;
   }
   return RTRJ(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             spwid);
 }
@@ -1050,7 +1101,7 @@ Temperature SkyStatus::getAverageTrjSky(size_t spwid,
                                          double signalgain,     // adition
                                          const Temperature &Tspill)
 {
-  Temperature tt(-999, "K");
+  Temperature tt = Temperature::from<Temperature::K>(-999);
   if(!spwidAndIndexAreValid(spwid, 0)) {
     return tt;
   }
@@ -1061,17 +1112,17 @@ Temperature SkyStatus::getAverageTrjSky(size_t spwid,
   if(airmass < 1.0) {
     return tt;
   }
-  if(Tspill.get("K") < 0.0 || Tspill.get("K") > 350.0) {
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
     return tt;
   }
   return signalgain*RTRJ(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             spwid)+
     +(1-signalgain)*RTRJ(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             getAssocSpwId(spwid)[0]);
 }
@@ -1083,7 +1134,7 @@ Temperature SkyStatus::getTrjSky(size_t spwid,
                                   double skycoupling,
                                   const Temperature &Tspill)
 {
-  Temperature tt(-999, "K");
+  Temperature tt = Temperature::from<Temperature::K>(-999);
   if(!spwidAndIndexAreValid(spwid, nc)) {
     return tt;
   }
@@ -1096,12 +1147,12 @@ Temperature SkyStatus::getTrjSky(size_t spwid,
   if(airmass < 1.0) {
     return tt;
   }
-  if(Tspill.get("K") < 0.0 || Tspill.get("K") > 350.0) {
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
     return tt;
   }
   return RTRJ(((wh2o.get()) / (getGroundWH2O().get())),
             skycoupling,
-            Tspill.get("K"),
+            Tspill.get<Temperature::K>(),
             airmass,
             spwid,
             nc);
@@ -1112,7 +1163,7 @@ Temperature SkyStatus::getTrjSky(size_t spwid,
 Angle SkyStatus::getDispersiveH2OPhaseDelay(size_t spwid, size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    Angle aa(0.0, "deg");
+    Angle aa = Angle::from<Angle::deg>(0.0);
     return aa;
   }
   return getDispersiveH2OPhaseDelay(v_transfertId_[spwid] + nc);
@@ -1122,7 +1173,7 @@ Length SkyStatus::getDispersiveH2OPathLength(size_t spwid,
                                              size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    Length ll(0.0, "mm");
+    Length ll = Length::from<Length::mm>(0.0);
     return ll;
   }
   return getDispersiveH2OPathLength(v_transfertId_[spwid] + nc);
@@ -1132,7 +1183,7 @@ Angle SkyStatus::getNonDispersiveH2OPhaseDelay(size_t spwid,
                                                size_t nc)
 {
   if(!spwidAndIndexAreValid(spwid, nc)) {
-    Angle aa(0.0, "deg");
+    Angle aa = Angle::from<Angle::deg>(0.0);
     return aa;
   }
   return getNonDispersiveH2OPhaseDelay(v_transfertId_[spwid] + nc);
@@ -1151,7 +1202,7 @@ Length SkyStatus::WaterVaporRetrieval_fromFTS(size_t spwId,
                                               const Frequency &f2)
 {
   if(f1.get() > f2.get()) {
-    return Length(-999, "mm");
+    return Length::from<Length::mm>(-999);
   }
   if(v_transmission.size() == getSpectralWindow(spwId).size()) {
     return mkWaterVaporRetrieval_fromFTS(spwId,
@@ -1160,7 +1211,7 @@ Length SkyStatus::WaterVaporRetrieval_fromFTS(size_t spwId,
                                          f1,
                                          f2);
   } else {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
 }
 
@@ -1293,14 +1344,14 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(size_t spwId,
 {
   if(v_tebb.size() == getSpectralWindow(spwId).size()) {
     return mkWaterVaporRetrieval_fromTEBB(spwId,
-                                          Percent(100.0, "%"),
+                                          Percent::from<Percent::percent>(100.0),
                                           v_tebb,
                                           getAirMass(),
                                           spwId_filter,
                                           skycoupling,
                                           tspill);
   } else {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
 }
 Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
@@ -1311,7 +1362,7 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
 {
   vector<Percent> signalGain;
   for(size_t i = 0; i < spwId.size(); i++) {
-    signalGain.push_back(Percent(100.0, "%"));
+    signalGain.push_back(Percent::from<Percent::percent>(100.0));
   }
   return mkWaterVaporRetrieval_fromTEBB(spwId,
                                         signalGain,
@@ -1329,7 +1380,7 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
 {
   vector<Percent> signalGain;
   for(size_t i = 0; i < spwId.size(); i++) {
-    signalGain.push_back(Percent(100.0, "%"));
+    signalGain.push_back(Percent::from<Percent::percent>(100.0));
   }
   return mkWaterVaporRetrieval_fromTEBB(spwId,
                                         signalGain,
@@ -1356,7 +1407,7 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(size_t spwId,
                                           skycoupling,
                                           tspill);
   } else {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
 }
 Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
@@ -1552,14 +1603,14 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(size_t spwId,
 {
   if(v_tebb.size() == getSpectralWindow(spwId).size()) {
     return mkWaterVaporRetrieval_fromTEBB(spwId,
-                                          Percent(100.0, "%"),
+                                          Percent::from<Percent::percent>(100.0),
                                           v_tebb,
                                           airmass,
                                           spwId_filter,
                                           skycoupling,
                                           tspill);
   } else {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
 }
 Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
@@ -1571,12 +1622,12 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
 {
   for(size_t j = 0; j < spwId.size(); j++) {
     if(vv_tebb[j].size() != getSpectralWindow(spwId[j]).size()) {
-      return Length(-999.0, "mm");
+      return Length::from<Length::mm>(-999.0);
     }
   }
   vector<Percent> signalGain;
   for(size_t i = 0; i < spwId.size(); i++) {
-    signalGain.push_back(Percent(100.0, "%"));
+    signalGain.push_back(Percent::from<Percent::percent>(100.0));
   }
   return mkWaterVaporRetrieval_fromTEBB(spwId,
                                         signalGain,
@@ -1595,7 +1646,7 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
 {
   vector<Percent> signalGain;
   for(size_t i = 0; i < spwId.size(); i++) {
-    signalGain.push_back(Percent(100.0, "%"));
+    signalGain.push_back(Percent::from<Percent::percent>(100.0));
   }
   return mkWaterVaporRetrieval_fromTEBB(spwId,
                                         signalGain,
@@ -1623,7 +1674,7 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(size_t spwId,
                                           skycoupling,
                                           tspill);
   } else {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
 }
 
@@ -1637,21 +1688,21 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
 {
 
   if(spwId.size() != signalGain.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
   for(size_t j = 0; j < spwId.size(); j++) {
     if(vv_tebb[j].size() != getSpectralWindow(spwId[j]).size()) {
-      return Length(-999.0, "mm");
+      return Length::from<Length::mm>(-999.0);
     }
   }
   if(spwId.size() != spwId_filter.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
   if(spwId.size() != skycoupling.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
   if(spwId.size() != tspill.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
 
   return mkWaterVaporRetrieval_fromTEBB(spwId,
@@ -1672,19 +1723,19 @@ Length SkyStatus::WaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
                                                const vector<Temperature> &tspill)
 {
   if(spwId.size() != signalGain.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
   if(spwId.size() != v_tebb.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
   if(spwId.size() != spwId_filter.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
   if(spwId.size() != skycoupling.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
   if(spwId.size() != tspill.size()) {
-    return Length(-999.0, "mm");
+    return Length::from<Length::mm>(-999.0);
   }
 
   return mkWaterVaporRetrieval_fromTEBB(spwId,
@@ -1773,7 +1824,7 @@ double SkyStatus::SkyCouplingRetrieval_fromTEBB(size_t spwId,
 {
   if(v_tebb.size() == getSpectralWindow(spwId).size()) {
     return mkSkyCouplingRetrieval_fromTEBB(spwId,
-                                           Percent(100, "%"),
+                                           Percent::from<Percent::percent>(100),
                                            v_tebb,
                                            getAirMass(),
                                            spwId_filter,
@@ -1811,7 +1862,7 @@ double SkyStatus::SkyCouplingRetrieval_fromTEBB(size_t spwId,
 {
   if(v_tebb.size() == getSpectralWindow(spwId).size()) {
     return mkSkyCouplingRetrieval_fromTEBB(spwId,
-                                           Percent(100, "%"),
+                                           Percent::from<Percent::percent>(100),
                                            v_tebb,
                                            airmass,
                                            spwId_filter,
@@ -1836,8 +1887,8 @@ double SkyStatus::getSigmaTransmissionFit(size_t spwId,
     size_t num = 0;
 
     for(size_t i = 0; i < v_transmission.size(); i++) {
-      if((getSpectralWindow(spwId)[i] * 1E-09 >= f1.get("GHz")
-          && getSpectralWindow(spwId)[i] * 1E-09 <= f2.get("GHz"))) {
+      if((getSpectralWindow(spwId)[i] * 1E-09 >= f1.get<Frequency::GHz>()
+          && getSpectralWindow(spwId)[i] * 1E-09 <= f2.get<Frequency::GHz>())) {
         num++;
         rms = rms + pow((v_transmission[i] - exp(-airm
 						 * ( (getDryContOpacity(spwId, i).get()+getO2LinesOpacity(spwId, i).get()+0.65*getO3LinesOpacity(spwId, i).get()  )  // getDryOpacity(spwId, i).get()
@@ -1859,14 +1910,14 @@ Temperature SkyStatus::getSigmaFit(size_t spwId,
                                    double skyCoupling,
                                    const Temperature &Tspill)
 {
-  Temperature ttt(-999, "K");
+  Temperature ttt = Temperature::from<Temperature::K>(-999);
   if(!spwidAndIndexAreValid(spwId, 0)) {
     return ttt;
   }
   if(v_tebbspec.size() != getSpectralWindow(spwId).size()) {
     return ttt;
   }
-  if(wh2o.get("mm") < 0.0) {
+  if(wh2o.get<Length::mm>() < 0.0) {
     return ttt;
   }
   if(skyCoupling < 0.0 || skyCoupling > 1.0) {
@@ -1875,7 +1926,7 @@ Temperature SkyStatus::getSigmaFit(size_t spwId,
   if(airmass < 1.0) {
     return ttt;
   }
-  if(Tspill.get("K") < 0.0 || Tspill.get("K") > 350.0) {
+  if(Tspill.get<Temperature::K>() < 0.0 || Tspill.get<Temperature::K>() > 350.0) {
     return ttt;
   }
   double rms = 0.0;
@@ -1883,17 +1934,17 @@ Temperature SkyStatus::getSigmaFit(size_t spwId,
   for(size_t i = 0; i < v_tebbspec.size(); i++) {
     if(v_tebbspec[i].get() > 0.0) {
       num++;
-      rms = rms + pow((v_tebbspec[i].get("K") - getTebbSky(spwId,
+      rms = rms + pow((v_tebbspec[i].get<Temperature::K>() - getTebbSky(spwId,
                                                            i,
                                                            wh2o,
                                                            airmass,
                                                            skyCoupling,
-                                                           Tspill).get("K")),
+                                                           Tspill).get<Temperature::K>()),
                       2);
     }
   }
   rms = sqrt(rms / num);
-  return Temperature(rms, "K");
+  return Temperature::from<Temperature::K>(rms);
 }
 
 Length SkyStatus::mkWaterVaporRetrieval_fromFTS(size_t spwId,
@@ -1903,149 +1954,53 @@ Length SkyStatus::mkWaterVaporRetrieval_fromFTS(size_t spwId,
                                                 const Frequency &fre2)
 {
   double pfit_wh2o;
-  double deltaa = 0.02;
-  double sig_fit = -999.0;
-  double eps = 0.01;
-  vector<double> transmission_fit;
-  transmission_fit.reserve(measuredSkyTransmission.size()); // allows resizing
-
-  size_t num;
-  double flamda;
-  size_t niter = 20;
-  double alpha;
-  double beta;
-  double array;
-  double f1;
-  double psave;
-  double f2;
-  double deriv;
-  double chisq1;
-  double chisqr;
-  double pfit_wh2o_b;
-  double res;
-  Length wh2o_retrieved(-999.0, "mm");
-  Length werr(-888, "mm");
+  Length wh2o_retrieved = Length::from<Length::mm>(-999.0);
+  Length werr = Length::from<Length::mm>(-888);
   double sigma_fit_transm0;
-  Length sigma_wh2o;
 
-  num = 0;
-
-  flamda = 0.001;
-  pfit_wh2o = 1.0; // (getUserWH2O().get("mm"))/(getGroundWH2O().get("mm"));
-
-  size_t nl = 0;
-
-  if(fre1.get("GHz") < 0) {
-    nl = getSpectralWindow(spwId).size();
-  } else {
-    for(size_t i = 0; i < getSpectralWindow(spwId).size(); i++) {
-      if(getSpectralWindow(spwId)[i] * 1E-09 >= fre1.get("GHz")
-          && getSpectralWindow(spwId)[i] * 1E-09 <= fre2.get("GHz")) {
-        nl = nl + 1;
-      }
+  pfit_wh2o = 1.0; // (getUserWH2O().get<Length::mm>())/(getGroundWH2O().get<Length::mm>());
+
+  // channels of the fit, with their dry and wet opacities
+  vector<size_t> chan;
+  vector<double> dryOpacity;
+  vector<double> wetOpacity;
+  vector<double> measured;
+  for(size_t i = 0; i < getSpectralWindow(spwId).size(); i++) {
+    if(fre1.get<Frequency::GHz>() < 0 || (getSpectralWindow(spwId)[i] * 1E-09 >= fre1.get<Frequency::GHz>()
+                                          && getSpectralWindow(spwId)[i] * 1E-09 <= fre2.get<Frequency::GHz>())) {
+      chan.push_back(i);
+      dryOpacity.push_back(getDryContOpacity(spwId, i).get() + getO2LinesOpacity(spwId, i).get()
+                           + 0.65 * getO3LinesOpacity(spwId, i).get()); // getDryOpacity(spwId, i).get()
+      wetOpacity.push_back(getWetOpacity(spwId, i).get());
+      measured.push_back(measuredSkyTransmission[i]);
     }
   }
-
-  for(size_t kite = 0; kite < niter; kite++) {
-
-    num = num + 1;
-
-    beta = 0.0;
-    alpha = 0.0;
-
-    //    for(size_t i=0; i<getSpectralWindow(spwId).size(); i++){
-
-    for(size_t i = 0; i < getSpectralWindow(spwId).size(); i++) {
-
-      if(nl == getSpectralWindow(spwId).size() || (getSpectralWindow(spwId)[i]
-          * 1E-09 >= fre1.get("GHz") && getSpectralWindow(spwId)[i] * 1E-09
-          <= fre2.get("GHz"))) {
-	//
-        transmission_fit[i] = exp(-( (getDryContOpacity(spwId, i).get()+getO2LinesOpacity(spwId, i).get()+0.65*getO3LinesOpacity(spwId, i).get() )                                              //getDryOpacity(spwId, i).get()
-				     + pfit_wh2o * getWetOpacity(spwId, i).get() ) );
-	//
-        f1 = transmission_fit[i];
-        psave = pfit_wh2o;
-        pfit_wh2o = pfit_wh2o + deltaa;
-        f2 = exp(-( (getDryContOpacity(spwId, i).get()+getO2LinesOpacity(spwId, i).get()+0.65*getO3LinesOpacity(spwId, i).get() )     //getDryOpacity(spwId, i).get()
-		   + pfit_wh2o* getWetOpacity(spwId, i).get()));
-        deriv = (f2 - f1) / deltaa;
-        pfit_wh2o = psave;
-        beta = beta + (measuredSkyTransmission[i] - transmission_fit[i])
-            * deriv;
-        alpha = alpha + deriv * deriv;
-      }
-    }
-
-    chisq1 = 0;
-    for(size_t i = 0; i < getSpectralWindow(spwId).size(); i++) {
-      if(nl == getSpectralWindow(spwId).size() || (getSpectralWindow(spwId)[i]
-          * 1E-09 >= fre1.get("GHz") && getSpectralWindow(spwId)[i] * 1E-09
-          <= fre2.get("GHz"))) {
-        res = -transmission_fit[i] + measuredSkyTransmission[i];
-        chisq1 = chisq1 + res * res;
-      }
-    }
-    if(nl > 1) {
-      chisq1 = chisq1 / (nl - 1);
-    }
-
-    adjust: array = 1.0 / (1.0 + flamda);
-    pfit_wh2o_b = pfit_wh2o;
-    pfit_wh2o_b = pfit_wh2o_b + beta * array / alpha;
-    if(pfit_wh2o_b < 0.0) pfit_wh2o_b = 0.9 * pfit_wh2o;
-
-    chisqr = 0;
-    for(size_t i = 0; i < getSpectralWindow(spwId).size(); i++) {
-      if(nl == getSpectralWindow(spwId).size() || (getSpectralWindow(spwId)[i]
-          * 1E-09 >= fre1.get("GHz") && getSpectralWindow(spwId)[i] * 1E-09
-          <= fre2.get("GHz"))) {
-        transmission_fit[i] = exp(-( ( getDryContOpacity(spwId, i).get()+getO2LinesOpacity(spwId, i).get()+0.65*getO3LinesOpacity(spwId, i).get() )             //      (getDryOpacity(spwId, i).get())
-				     + pfit_wh2o_b * getWetOpacity(spwId, i).get()));
-        res = -transmission_fit[i] + measuredSkyTransmission[i];
-        chisqr = chisqr + res * res;
-      }
-    }
-
-    if(nl > 1) {
-      chisqr = chisqr / (nl - 1);
-    }
-
-    if(fabs(chisq1 - chisqr) > 0.001) {
-      if(chisq1 < chisqr) {
-        flamda = flamda * 10.0;
-        goto adjust;
-      }
-    }
-
-    flamda = flamda / 10.0;
-    sig_fit = sqrt(chisqr);
-    pfit_wh2o = pfit_wh2o_b;
-    sigma_wh2o = Length(sqrt(array / alpha) * sig_fit * pfit_wh2o
-        * (getUserWH2O().get()), "mm");
-
-    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < eps) {
-
-      /*	for(size_t i=0; i<getSpectralWindow(spwId).size(); i++){
-       cout << getSpectralWindow(spwId)[i]*1E-09 << "  "  << measuredSkyTransmission[i] << "  "  << transmission_fit[i] << endl;
-       } */
-
-      sigma_fit_transm0 = sig_fit;
-
-      wh2o_retrieved = Length(pfit_wh2o * getUserWH2O().get("mm"), "mm");
-
-      goto salir;
-
-    }
-
+  if(chan.empty()) {
+    sigma_transmission_FTSfit_ = -888.0;
+    return werr;
+  }
+
+  LevenbergMarquardt fit(1, chan.size());
+  fit.setData(&measured[0]);
+  fit.setConstraint([](const double *pfit, double *pfit_b) {
+                      if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                    });
+  bool converged = fit.solve([&dryOpacity, &wetOpacity](const double *pfit, double *transmission, double *deriv) {
+                               for(size_t i = 0; i < dryOpacity.size(); i++) {
+                                 transmission[i] = exp(-(dryOpacity[i] + pfit[0] * wetOpacity[i]));
+                                 deriv[i] = -wetOpacity[i] * transmission[i];
+                               }
+                             },
+                             &pfit_wh2o);
+
+  if(converged) {
+    sigma_fit_transm0 = fit.getSigma();
+    wh2o_retrieved = Length::from<Length::mm>(pfit_wh2o * getUserWH2O().get<Length::mm>());
+  } else {
+    wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
+    sigma_fit_transm0 = -888.0; // Extra error code, fit not reached after 20 iterations
   }
 
-  wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
-  sigma_fit_transm0 = -888.0; // Extra error code, fit not reached after 20 iterations
-  sigma_wh2o = werr; // Extra error code, fit not reached after 20 iterations
-
-  salir:
-
   sigma_transmission_FTSfit_ = sigma_fit_transm0;
 
   if(wh2o_retrieved.get() > 0.0) {
@@ -2065,147 +2020,51 @@ Length SkyStatus::mkWaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
 {
 
   double pfit_wh2o;
-  double deltaa = 0.02;
-  double sig_fit = -999.0;
-  double eps = 0.001;
-  vector<Temperature> v_tebb_fit;
-
-  size_t num;
-  double flamda;
-  size_t niter = 20;
-  double alpha;
-  double beta;
-  double array;
-  double f1;
-  double psave;
-  double f2;
-  double deriv;
-  double chisq1;
-  double chisqr;
-  double pfit_wh2o_b;
-  double res;
-  Length wh2o_retrieved(-999.0, "mm");
-  Length werr(-888, "mm");
+  Length wh2o_retrieved = Length::from<Length::mm>(-999.0);
+  Length werr = Length::from<Length::mm>(-888);
   double sigma_fit_transm0;
-  Length sigma_wh2o;
-  v_tebb_fit.reserve(measuredAverageSkyTEBB.size());
 
-  num = 0;
-  flamda = 0.001;
-
-  pfit_wh2o = (getUserWH2O().get("mm")) / (getGroundWH2O().get("mm"));
-
-  for(size_t kite = 0; kite < niter; kite++) {
-
-    num = num + 1;
-
-    beta = 0.0;
-    alpha = 0.0;
-
-    for(size_t j = 0; j < spwId.size(); j++) {
-
-
-      f1 = RT(pfit_wh2o,
-	      skycoupling[j],
-	      tspill[j].get("K"),
-	      airm,
-	      spwId[j],
-	      spwId_filter[j],
-	      signalGain[j]);    // if signalGain[j] < 1.0 then there is an image side
-                                 // band and it is correctly taken into account in RT
-
-      v_tebb_fit[j] = Temperature(f1, "K");
-
-      psave = pfit_wh2o;
-      pfit_wh2o = pfit_wh2o + deltaa;
-
-      f2 = RT(pfit_wh2o,
-              skycoupling[j],
-              tspill[j].get("K"),
-              airm,
-              spwId[j],
-              spwId_filter[j],
-              signalGain[j]);
-
-      deriv = (f2 - f1) / deltaa;
-
-      pfit_wh2o = psave;
-      beta = beta + ((measuredAverageSkyTEBB[j]).get("K") - f1) * deriv;
-      alpha = alpha + deriv * deriv;
-
-    }
-
-    chisq1 = 0;
-
-    for(size_t j = 0; j < measuredAverageSkyTEBB.size(); j++) {
-
-      res = -v_tebb_fit[j].get("K") + (measuredAverageSkyTEBB[j]).get("K");
-      chisq1 = chisq1 + res * res;
-
-    }
-
-    if(measuredAverageSkyTEBB.size() > 1) {
-      chisq1 = chisq1 / (measuredAverageSkyTEBB.size() - 1);
-    }
-
-    adjust: array = 1.0 / (1.0 + flamda);
-    pfit_wh2o_b = pfit_wh2o;
-    pfit_wh2o_b = pfit_wh2o_b + beta * array / alpha;
-    if(pfit_wh2o_b < 0.0) pfit_wh2o_b = 0.9 * pfit_wh2o;
-
-    chisqr = 0;
-
-    for(size_t j = 0; j < spwId.size(); j++) {
-
-      v_tebb_fit[j] = Temperature(RT(pfit_wh2o_b,
-                                     skycoupling[j],
-                                     tspill[j].get("K"),
-                                     airm,
-                                     spwId[j],
-                                     spwId_filter[j],
-                                     signalGain[j]), "K");
-
-      res = -v_tebb_fit[j].get("K") + (measuredAverageSkyTEBB[j]).get("K");
-      chisqr = chisqr + res * res;
-
-    }
-
-    if(spwId.size() > 1) {
-      chisqr = chisqr / (spwId.size() - 1);
-    }
-
-    if(fabs(chisq1 - chisqr) > 0.001) {
-      if(chisq1 < chisqr) {
-        flamda = flamda * 10.0;
-        goto adjust;
-      }
-    }
-
-    flamda = flamda / 10.0;
-    sig_fit = sqrt(chisqr);
-    pfit_wh2o = pfit_wh2o_b;
-    sigma_wh2o = Length(sqrt(array / alpha) * sig_fit * pfit_wh2o
-        * (getGroundWH2O().get("mm")), "mm");
-
-    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < eps) {
-
-      sigma_fit_transm0 = sig_fit;
-
-      wh2o_retrieved = Length(pfit_wh2o * getGroundWH2O().get("mm"), "mm");
-
-      goto salir;
-
-    }
+  pfit_wh2o = (getUserWH2O().get<Length::mm>()) / (getGroundWH2O().get<Length::mm>());
 
+  vector<double> measured(spwId.size());
+  for(size_t j = 0; j < spwId.size(); j++) {
+    measured[j] = measuredAverageSkyTEBB[j].get<Temperature::K>();
+  }
+
+  LevenbergMarquardt fit(1, spwId.size());
+  fit.setData(&measured[0]);
+  LevenbergMarquardt::Settings settings;
+  settings.tolerance = 0.001;
+  fit.setSettings(settings);
+  fit.setConstraint([](const double *pfit, double *pfit_b) {
+                      if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                    });
+  bool converged = fit.solve([&](const double *pfit, double *tebb, double *deriv) {
+                               double jacobian[3];
+                               for(size_t j = 0; j < spwId.size(); j++) {
+                                 tebb[j] = RT(pfit[0],
+                                              skycoupling[j],
+                                              tspill[j].get<Temperature::K>(),
+                                              airm,
+                                              spwId[j],
+                                              spwId_filter[j],
+                                              signalGain[j],
+                                              jacobian); // if signalGain[j] < 1.0 then there is an image side
+                                                         // band and it is correctly taken into account in RT
+                                 deriv[j] = jacobian[0];
+                               }
+                             },
+                             &pfit_wh2o);
+
+  if(converged) {
+    sigma_fit_transm0 = fit.getSigma();
+    wh2o_retrieved = Length::from<Length::mm>(pfit_wh2o * getGroundWH2O().get<Length::mm>());
+  } else {
+    wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
+    sigma_fit_transm0 = -888.0; // Extra error code, fit not reached after 20 iterations
   }
 
-  wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
-  sigma_fit_transm0 = -888.0; // Extra error code, fit not reached after 20 iterations
-  sigma_wh2o = werr; // Extra error code, fit not reached after 20 iterations
-
-  salir:
-
-  sigma_TEBBfit_ = Temperature(sigma_fit_transm0, "K");
+  sigma_TEBBfit_ = Temperature::from<Temperature::K>(sigma_fit_transm0);
   if(wh2o_retrieved.get() > 0.0) {
     wh2o_user_ = wh2o_retrieved;
   }
@@ -2223,235 +2082,84 @@ Length SkyStatus::mkWaterVaporRetrieval_fromTEBB(const vector<size_t> &spwId,
 {
 
   double pfit_wh2o;
-  double deltaa = 0.02;
-  double sig_fit = -999.0;
-  double eps = 0.01;
-  vector<vector<Temperature> > vv_tebb_fit;
-  vector<Temperature> v_tebb_fit;
-
-  size_t num;
-  double flamda;
-  size_t niter = 20;
-  double alpha;
-  double beta;
-  double array;
-  double f1;
-  double psave;
-  double f2;
-  double deriv;
-  double chisq1;
-  double chisqr;
-  double pfit_wh2o_b;
-  double res;
-  Length wh2o_retrieved(-999.0, "mm");
-  Length werr(-888, "mm");
+  Length wh2o_retrieved = Length::from<Length::mm>(-999.0);
+  Length werr = Length::from<Length::mm>(-888);
   double sigma_fit_transm0;
-  Length sigma_wh2o;
-  vector<double> spwIdNorm;
-  vector<double> validchannels;
-  spwIdNorm.reserve(spwId.size());
-  validchannels.reserve(spwId.size());
-  vv_tebb_fit.reserve(spwId.size());
 
+  // channels of the fit (those selected by the filters), weighted by their filter
+  vector<size_t> window;
+  vector<size_t> chan;
+  vector<double> measured;
+  vector<double> weight;
   for(size_t j = 0; j < spwId.size(); j++) {
-    spwIdNorm[j] = 0.0;
-    validchannels[j] = 0.0;
+    double spwIdNorm = 0.0;
+    double validchannels = 0.0;
     for(size_t i = 0; i < getSpectralWindow(spwId[j]).size(); i++) {
       if(spwId_filter[j][i] > 0) {
-        spwIdNorm[j] = spwIdNorm[j] + spwId_filter[j][i];
-        validchannels[j] = validchannels[j] + 1.0;
+        spwIdNorm = spwIdNorm + spwId_filter[j][i];
+        validchannels = validchannels + 1.0;
       }
     }
-  }
-
-  num = 0;
-  flamda = 0.001;
-  pfit_wh2o = (getUserWH2O().get("mm")) / (getGroundWH2O().get("mm"));
-
-  for(size_t kite = 0; kite < niter; kite++) {
-
-    num = num + 1;
-
-    beta = 0.0;
-    alpha = 0.0;
-
-    for(size_t j = 0; j < spwId.size(); j++) {
-
-      v_tebb_fit.clear();
-
-      for(size_t i = 0; i < getSpectralWindow(spwId[j]).size(); i++) {
-
-        if(spwId_filter[j][i] > 0) {
-
-          if(signalGain[j].get() < 1.0) {
-            f1 = RT(pfit_wh2o,
-                    skycoupling[j],
-                    tspill[j].get("K"),
-                    airm,
-                    spwId[j],
-                    i) * signalGain[j].get() + RT(pfit_wh2o,
-                                                  skycoupling[j],
-                                                  tspill[j].get("K"),
-                                                  airm,
-                                                  getAssocSpwId(spwId[j])[0],
-                                                  i)
-                * (1 - signalGain[j].get());
-          } else {
-            f1 = RT(pfit_wh2o,
-                    skycoupling[j],
-                    tspill[j].get("K"),
-                    airm,
-                    spwId[j],
-                    i);
-          }
-
-          psave = pfit_wh2o;
-          pfit_wh2o = pfit_wh2o + deltaa;
-
-          v_tebb_fit.push_back(Temperature(f1, "K"));
-
-          if(signalGain[j].get() < 1.0) {
-            f2 = (RT(pfit_wh2o,
-                     skycoupling[j],
-                     tspill[j].get("K"),
-                     airm,
-                     spwId[j],
-                     i) * signalGain[j].get() + RT(pfit_wh2o,
-                                                   skycoupling[j],
-                                                   tspill[j].get("K"),
-                                                   airm,
-                                                   getAssocSpwId(spwId[j])[0],
-                                                   i) * (1
-                - signalGain[j].get()));
-          } else {
-            f2 = (RT(pfit_wh2o,
-                     skycoupling[j],
-                     tspill[j].get("K"),
-                     airm,
-                     spwId[j],
-                     i) * signalGain[j].get());
-          }
-
-          f2 = f2 * spwId_filter[j][i] * validchannels[j] / spwIdNorm[j];
-          f1 = f1 * spwId_filter[j][i] * validchannels[j] / spwIdNorm[j];
-          deriv = (f2 - f1) / deltaa;
-
-          pfit_wh2o = psave;
-          beta = beta + ((measuredSkyTEBB[j][i]).get("K") - f1) * deriv; //*spwId_filter[j][i]/spwIdNorm[j];
-          alpha = alpha + deriv * deriv;
-
-        } else {
-
-          v_tebb_fit.push_back(Temperature(-999, "K"));
-
-        }
-
-      }
-
-      vv_tebb_fit.push_back(v_tebb_fit);
-
-    }
-
-    chisq1 = 0;
-
-    for(size_t j = 0; j < spwId.size(); j++) {
-
-      for(size_t i = 0; i < getSpectralWindow(spwId[j]).size(); i++) {
-        if(spwId_filter[j][i] > 0) {
-          res
-              = (-vv_tebb_fit[j][i].get("K") + (measuredSkyTEBB[j][i]).get("K"))
-                  * spwId_filter[j][i] * validchannels[j] / spwIdNorm[j];
-          chisq1 = chisq1 + res * res;
-        }
-      }
-
-    }
-
-    if(spwId.size() > 1) {
-      chisq1 = chisq1 / (spwId.size() - 1);
-    }
-
-    adjust: array = 1.0 / (1.0 + flamda);
-    pfit_wh2o_b = pfit_wh2o;
-    pfit_wh2o_b = pfit_wh2o_b + beta * array / alpha;
-    if(pfit_wh2o_b < 0.0) pfit_wh2o_b = 0.9 * pfit_wh2o;
-
-    chisqr = 0;
-
-    for(size_t j = 0; j < spwId.size(); j++) {
-
-      for(size_t i = 0; i < getSpectralWindow(spwId[j]).size(); i++) {
-
-        if(spwId_filter[j][i] > 0) {
-
-          if(signalGain[j].get() < 1.0) {
-            vv_tebb_fit[j][i] = Temperature(RT(pfit_wh2o_b,
-                                               skycoupling[j],
-                                               tspill[j].get("K"),
-                                               airm,
-                                               spwId[j],
-                                               i) * signalGain[j].get()
-                + RT(pfit_wh2o_b,
-                     skycoupling[j],
-                     tspill[j].get("K"),
-                     airm,
-                     getAssocSpwId(spwId[j])[0],
-                     i) * (1 - signalGain[j].get()), "K");
-          } else {
-            vv_tebb_fit[j][i] = Temperature(RT(pfit_wh2o_b,
-                                               skycoupling[j],
-                                               tspill[j].get("K"),
-                                               airm,
-                                               spwId[j],
-                                               i) * signalGain[j].get(), "K");
-          }
-
-          res
-              = (-vv_tebb_fit[j][i].get("K") + (measuredSkyTEBB[j][i]).get("K"))
-                  * spwId_filter[j][i] * validchannels[j] / spwIdNorm[j];
-
-          chisqr = chisqr + res * res;
-        }
-      }
-
-    }
-
-    if(spwId.size() > 1) {
-      chisqr = chisqr / (spwId.size() - 1);
-    }
-
-    if(fabs(chisq1 - chisqr) > 0.001) {
-      if(chisq1 < chisqr) {
-        flamda = flamda * 10.0;
-        goto adjust;
+    for(size_t i = 0; i < getSpectralWindow(spwId[j]).size(); i++) {
+      if(spwId_filter[j][i] > 0) {
+        window.push_back(j);
+        chan.push_back(i);
+        measured.push_back(measuredSkyTEBB[j][i].get<Temperature::K>());
+        weight.push_back(spwId_filter[j][i] * validchannels / spwIdNorm);
       }
     }
-
-    flamda = flamda / 10.0;
-    sig_fit = sqrt(chisqr);
-    pfit_wh2o = pfit_wh2o_b;
-    sigma_wh2o = Length(sqrt(array / alpha) * sig_fit * pfit_wh2o
-        * (getGroundWH2O().get("mm")), "mm");
-
-    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < eps) {
-
-      sigma_fit_transm0 = sig_fit;
-
-      wh2o_retrieved = Length(pfit_wh2o * getGroundWH2O().get("mm"), "mm");
-
-      goto salir;
-
-    }
-
+  }
+  if(chan.empty()) {
+    sigma_TEBBfit_ = Temperature::from<Temperature::K>(-888.0);
+    return werr;
+  }
+
+  pfit_wh2o = (getUserWH2O().get<Length::mm>()) / (getGroundWH2O().get<Length::mm>());
+
+  LevenbergMarquardt fit(1, chan.size());
+  fit.setData(&measured[0]);
+  fit.setWeight(&weight[0]);
+  fit.setDegreesOfFreedom(spwId.size() > 1 ? spwId.size() - 1.0 : 1.0);
+  fit.setConstraint([](const double *pfit, double *pfit_b) {
+                      if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                    });
+  bool converged = fit.solve([&](const double *pfit, double *tebb, double *deriv) {
+                               double jacobian[3];
+                               double jacobianImage[3];
+                               for(size_t k = 0; k < chan.size(); k++) {
+                                 size_t j = window[k];
+                                 tebb[k] = RT(pfit[0],
+                                              skycoupling[j],
+                                              tspill[j].get<Temperature::K>(),
+                                              airm,
+                                              spwId[j],
+                                              chan[k],
+                                              jacobian);
+                                 deriv[k] = jacobian[0];
+                                 if(signalGain[j].get() < 1.0) {
+                                   tebb[k] = tebb[k] * signalGain[j].get() + RT(pfit[0],
+                                                                                skycoupling[j],
+                                                                                tspill[j].get<Temperature::K>(),
+                                                                                airm,
+                                                                                getAssocSpwId(spwId[j])[0],
+                                                                                chan[k],
+                                                                                jacobianImage)
+                                       * (1 - signalGain[j].get());
+                                   deriv[k] = deriv[k] * signalGain[j].get() + jacobianImage[0] * (1 - signalGain[j].get());
+                                 }
+                               }
+                             },
+                             &pfit_wh2o);
+
+  if(converged) {
+    sigma_fit_transm0 = fit.getSigma();
+    wh2o_retrieved = Length::from<Length::mm>(pfit_wh2o * getGroundWH2O().get<Length::mm>());
+  } else {
+    wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
+    sigma_fit_transm0 = -888.0; // Extra error code, fit not reached after 20 iterations
   }
 
-  wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
-  sigma_fit_transm0 = -888.0; // Extra error code, fit not reached after 20 iterations
-  sigma_wh2o = werr; // Extra error code, fit not reached after 20 iterations
-
-  salir:
-
-  sigma_TEBBfit_ = Temperature(sigma_fit_transm0, "K");
+  sigma_TEBBfit_ = Temperature::from<Temperature::K>(sigma_fit_transm0);
   if(wh2o_retrieved.get() > 0.0) {
     wh2o_user_ = wh2o_retrieved;
   }
@@ -2468,115 +2176,72 @@ double SkyStatus::mkSkyCouplingRetrieval_fromTEBB(size_t spwId,
                                                   const Temperature &tspill)
 {
 
-  // double pfit_wh2o;  // [-Wunused_but_set_variable]
   double pfit_skycoupling;
-  double pfit_skycoupling_b;
-  double deltaa = 0.02;
-  // double sig_fit = -999.0;  // [-Wunused_but_set_variable]
-  double eps = 0.01;
-  vector<Temperature> tebb_fit;
-  tebb_fit.reserve(measuredSkyTEBB.size()); // allows resizing
-
-  size_t num;
-  double flamda;
-  size_t niter = 20;
-  double alpha;
-  double beta;
-  double array;
-  double f1;
-  double psave;
-  double f2;
-  double deriv;
-  double chisq1;
-  double chisqr;
-  double res;
-  Length wh2o_retrieved(-999.0, "mm");
-  Length werr(-888, "mm");
-  // double sigma_fit_transm0; // [-Wunused_but_set_variable]
-  Length sigma_wh2o;
-
-  num = 0;
-
-  flamda = 0.001;
-  // pfit_wh2o = (getUserWH2O().get("mm")) / (getGroundWH2O().get("mm")); // [-Wunused_but_set_variable]
-  pfit_skycoupling = 1.0;
-
-  for(size_t kite = 0; kite < niter; kite++) {
-
-    num = num + 1;
-
-    beta = 0.0;
-    alpha = 0.0;
-
-    //    for(size_t i=0; i<getSpectralWindow(spwId).size(); i++){
-
-    mkWaterVaporRetrieval_fromTEBB(spwId,
-                                   signalGain,
-                                   measuredSkyTEBB,
-                                   airm,
-                                   spwId_filter,
-                                   pfit_skycoupling * skycoupling,
-                                   tspill);
-    f1 = sigma_TEBBfit_.get("K");
-    // cout << "pfit_skycoupling =" << pfit_skycoupling << "  f1=" << f1 << "  wh2o_user_=" << wh2o_user_.get("mm") << " mm" << endl;
-    psave = pfit_skycoupling;
-    pfit_skycoupling = pfit_skycoupling + deltaa;
-    mkWaterVaporRetrieval_fromTEBB(spwId,
-                                   signalGain,
-                                   measuredSkyTEBB,
-                                   airm,
-                                   spwId_filter,
-                                   pfit_skycoupling * skycoupling,
-                                   tspill);
-    f2 = sigma_TEBBfit_.get("K");
-    // cout << "pfit_skycoupling =" << pfit_skycoupling << "  f2=" << f2 << "  wh2o_user_=" << wh2o_user_.get("mm") << " mm" << endl;
-    deriv = (f2 - f1) / deltaa;
-    pfit_skycoupling = psave;
-    beta = beta - f1 * deriv;
-    alpha = alpha + deriv * deriv;
-
-    chisq1 = 0;
-    res = f1;
-    chisq1 = chisq1 + res * res;
-
-    adjust: array = 1.0 / (1.0 + flamda);
-    pfit_skycoupling_b = pfit_skycoupling;
-    pfit_skycoupling_b = pfit_skycoupling_b + beta * array / alpha;
-    if(pfit_skycoupling_b < 0.0) pfit_skycoupling_b = 0.9 * pfit_skycoupling;
-    chisqr = 0;
-    mkWaterVaporRetrieval_fromTEBB(spwId,
-                                   signalGain,
-                                   measuredSkyTEBB,
-                                   airm,
-                                   spwId_filter,
-                                   pfit_skycoupling_b * skycoupling,
-                                   tspill);
-    res = sigma_TEBBfit_.get("K");
-    // cout << "pfit_skycoupling =" << pfit_skycoupling_b << "  res=" << res << "  wh2o_user_=" << wh2o_user_.get("mm") << " mm" << endl;
-    chisqr = chisqr + res * res;
-
-    if(fabs(chisq1 - chisqr) > 0.001) {
-      if(chisq1 < chisqr) {
-        flamda = flamda * 10.0;
-        goto adjust;
-      }
-    }
+  double norm = 0.0;
+  double validchannels = 0.0;
 
-    flamda = flamda / 10.0;
-    // sig_fit = sqrt(chisqr); // [-Wunused_but_set_variable]
-    pfit_skycoupling = pfit_skycoupling_b;
+  pfit_skycoupling = 1.0;
 
-    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < eps) {
-      goto salir;
+  for(size_t i = 0; i < getSpectralWindow(spwId).size(); i++) {
+    if(spwId_filter[i] > 0) {
+      norm = norm + spwId_filter[i];
+      validchannels = validchannels + 1.0;
     }
-
   }
 
-  wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
-  //sigma_fit_transm0 = -888.0; // Extra error code, fit not reached after 20 iterations [-Wunused_but_set_variable]
-  sigma_wh2o = werr; // Extra error code, fit not reached after 20 iterations
-
-  salir: return pfit_skycoupling * skycoupling;
+  // the rms of the water vapor retrieval is fitted to 0
+  double zero = 0.0;
+  LevenbergMarquardt fit(1, 1);
+  fit.setData(&zero);
+  fit.setConstraint([](const double *pfit, double *pfit_b) {
+                      if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                    });
+  fit.solve([&](const double *pfit, double *sigma, double *deriv) {
+              double jacobian[3];
+              mkWaterVaporRetrieval_fromTEBB(spwId,
+                                             signalGain,
+                                             measuredSkyTEBB,
+                                             airm,
+                                             spwId_filter,
+                                             pfit[0] * skycoupling,
+                                             tspill);
+              sigma[0] = sigma_TEBBfit_.get<Temperature::K>();
+              // cout << "pfit_skycoupling =" << pfit[0] << "  sigma=" << sigma[0] << "  wh2o_user_=" << wh2o_user_.get<Length::mm>() << " mm" << endl;
+              // the water vapor column being fitted for every sky coupling, the derivative of the rms of the fit
+              // is, at the fitted column, that of the residuals with respect to the sky coupling alone
+              deriv[0] = 0.0;
+              for(size_t i = 0; i < getSpectralWindow(spwId).size(); i++) {
+                if(spwId_filter[i] > 0) {
+                  double tebb;
+                  double dtebb_dskycoupling;
+                  tebb = RT(wh2o_user_.get() / getGroundWH2O().get(),
+                            pfit[0] * skycoupling,
+                            tspill.get<Temperature::K>(),
+                            airm,
+                            spwId,
+                            i,
+                            jacobian);
+                  dtebb_dskycoupling = jacobian[1];
+                  if(signalGain.get() < 1.0) {
+                    tebb = tebb * signalGain.get() + RT(wh2o_user_.get() / getGroundWH2O().get(),
+                                                        pfit[0] * skycoupling,
+                                                        tspill.get<Temperature::K>(),
+                                                        airm,
+                                                        getAssocSpwId(spwId)[0],
+                                                        i,
+                                                        jacobian) * (1.0 - signalGain.get());
+                    dtebb_dskycoupling = dtebb_dskycoupling * signalGain.get() + jacobian[1] * (1.0 - signalGain.get());
+                  }
+                  double weight = spwId_filter[i] * validchannels / norm;
+                  deriv[0] = deriv[0] - (measuredSkyTEBB[i].get<Temperature::K>() - tebb) * weight * weight
+                                        * dtebb_dskycoupling * skycoupling;
+                }
+              }
+              if(sigma[0] > 0.0) deriv[0] = deriv[0] / sigma[0];
+            },
+            &pfit_skycoupling);
+
+  return pfit_skycoupling * skycoupling;
 
 }
 
@@ -2638,45 +2303,170 @@ double SkyStatus::RT(double pfit_wh2o,
 
   double radiance;
   double singlefreq;
-  // double chanwidth;  // [-Wunused_but_set_variable]
   double tebb;
   double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
   double kv;
   double tau_layer;
-  double tbgr = skyBackgroundTemperature_.get("K");
   double ratioWater = pfit_wh2o;
 
-  singlefreq = getChanFreq(spwid, nc).get("GHz");
-  // chanwidth = getChanWidth(spwid, nc).get("GHz"); // [-Wunused_but_set_variable]
-  // cout << "Chan freq. =" << singlefreq << " GHz" << endl;
-  // cout << "Chan width =" << chanwidth << " GHz" << endl;
+  // the Planck terms, absorption coefficients and thicknesses come packed from the RT cache
+  const double *cache = getRTCache(spwid, nc, tspill);
+  const double *layer = cache + rtCacheHeader_;
+  singlefreq = cache[0];
 
-  tebb=0.0;
   kv = 0.0;
   radiance = 0.0;
 
-  for(size_t i = 0; i < getNumLayer(); i++) {
+  for(size_t i = 0; i < numLayer_; i++, layer += rtCacheStride_) {
+
+    tau_layer = (layer[0] * ratioWater + layer[1]) * layer[2];
 
-    tau_layer = ((getAbsTotalWet(spwid, nc, i).get()) * ratioWater+ getAbsTotalDry(spwid, nc, i).get()) * getLayerThickness(i).get();
+    radiance = radiance + layer[3] * exp(-kv * airm) * (1.0 - exp(-airm * tau_layer));
 
-    // cout << i << "  " <<  getAbsTotalWet(spwid, nc, i).get() << "  " << getAbsTotalDry(spwid, nc, i).get() << endl;
+    kv = kv + tau_layer;
+
+  }
 
-    radiance = radiance + (1.0 / (exp(h_div_k * singlefreq/ getLayerTemperature(i).get()) - 1.0)) * exp(-kv * airm) * (1.0- exp(-airm * tau_layer));
+  radiance = skycoupling * (radiance + cache[2] * exp(-kv * airm)) + cache[4] * (1 - skycoupling);
+
+  tebb = h_div_k * singlefreq / log(1 + (1 / radiance));
+
+  return tebb;
+
+}
+
+
+double SkyStatus::RT(double pfit_wh2o,
+                     double skycoupling,
+                     double tspill,
+                     double airm,
+                     size_t spwid,
+                     size_t nc,
+                     double *jacobian)
+{
+  return RT(getRTCache(spwid, nc, tspill), numLayer_, pfit_wh2o, skycoupling, tspill, airm, jacobian);
+}
+
+double SkyStatus::RT(const double *cache,
+                     size_t numLayer,
+                     double pfit_wh2o,
+                     double skycoupling,
+                     double tspill,
+                     double airm,
+                     double *jacobian)
+{
+
+  double radiance;
+  double singlefreq;
+  double tebb;
+  double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
+  double kv;
+  double tau_layer;
+  double ratioWater = pfit_wh2o;
+  double dkv;
+  double dtau_layer;
+  double dradiance;
+
+  const double *layer = cache + rtCacheHeader_;
+  singlefreq = cache[0];
+
+  kv = 0.0;
+  radiance = 0.0;
+  dkv = 0.0;
+  dradiance = 0.0;
+
+  // the layer opacities are linear in the water vapor scale factor: their derivatives (the wet
+  // opacities) are carried along the recursion of RT()
+  for(size_t i = 0; i < numLayer; i++, layer += rtCacheStride_) {
+
+    tau_layer = (layer[0] * ratioWater + layer[1]) * layer[2];
+    dtau_layer = layer[0] * layer[2];
+
+    double transmission_below = exp(-kv * airm);
+    double transmission_layer = exp(-airm * tau_layer);
+    radiance = radiance + layer[3] * transmission_below * (1.0 - transmission_layer);
+    dradiance = dradiance + layer[3] * transmission_below * airm
+                            * (dtau_layer * transmission_layer - dkv * (1.0 - transmission_layer));
 
     kv = kv + tau_layer;
+    dkv = dkv + dtau_layer;
 
   }
 
-  radiance = skycoupling * (radiance + (1.0 / (exp(h_div_k * singlefreq / tbgr)- 1.0)) * exp(-kv * airm)) + (1.0 / (exp(h_div_k * singlefreq / tspill)- 1.0)) * (1 - skycoupling);
+  double background = cache[2] * exp(-kv * airm);
+  double sky = radiance + background;
+  radiance = skycoupling * sky + cache[4] * (1 - skycoupling);
 
   tebb = h_div_k * singlefreq / log(1 + (1 / radiance));
-  // tebb = tebb+  h_div_k * singlefreq * radiance;
-  // cout << "singlefreq = " << singlefreq <<  " total opacity = " << kv << " tebb = " << tebb << endl;
+
+  // dTebb/dradiance, and dB/dT of the spill over Planck term B = 1/(exp(x)-1), x = h nu / k T
+  double dtebb = tebb * tebb / (h_div_k * singlefreq) / (radiance * (radiance + 1.0));
+  double dspill = cache[4] * (cache[4] + 1.0) * (h_div_k * singlefreq / tspill) / tspill;
+
+  jacobian[0] = dtebb * skycoupling * (dradiance - airm * dkv * background);
+  jacobian[1] = dtebb * (sky - cache[4]);
+  jacobian[2] = dtebb * (1 - skycoupling) * dspill;
 
   return tebb;
 
 }
 
+double SkyStatus::RT(double pfit_wh2o,
+                     double skycoupling,
+                     double tspill,
+                     double airmass,
+                     size_t spwid,
+                     const vector<double> &spwId_filter,
+                     const Percent &signalgain,
+                     double *jacobian)
+{
+
+  double tebb_channel = 0.0;
+  double rtr;
+  double norm = 0.0;
+  double jac[3];
+  double jacImage[3];
+
+  for(size_t k = 0; k < 3; k++) jacobian[k] = 0.0;
+
+  for(size_t n = 0; n < v_numChan_[spwid]; n++) {
+    if(spwId_filter[n] > 0) {
+      norm = norm + spwId_filter[n];
+    }
+  }
+
+  if(norm == 0.0) {
+    return norm;
+  }
+
+  for(size_t n = 0; n < v_numChan_[spwid]; n++) {
+
+    if(spwId_filter[n] > 0) {
+
+      if(signalgain.get() < 1.0) {
+        rtr = RT(pfit_wh2o, skycoupling, tspill, airmass, spwid, n, jac)
+            * signalgain.get() + RT(pfit_wh2o,
+                                    skycoupling,
+                                    tspill,
+                                    airmass,
+                                    getAssocSpwId(spwid)[0],
+                                    n,
+                                    jacImage) * (1.0 - signalgain.get());
+        for(size_t k = 0; k < 3; k++) {
+          jac[k] = jac[k] * signalgain.get() + jacImage[k] * (1.0 - signalgain.get());
+        }
+      } else {
+        rtr = RT(pfit_wh2o, skycoupling, tspill, airmass, spwid, n, jac);
+      }
+      tebb_channel = tebb_channel + rtr * spwId_filter[n] / norm;
+      for(size_t k = 0; k < 3; k++) {
+        jacobian[k] = jacobian[k] + jac[k] * spwId_filter[n] / norm;
+      }
+    }
+  }
+
+  return tebb_channel;
+}
 
 double SkyStatus::RTRJ(double pfit_wh2o,
                      double skycoupling,
@@ -2688,31 +2478,30 @@ double SkyStatus::RTRJ(double pfit_wh2o,
 
   double radiance;
   double singlefreq;
-  // double chanwidth;  // [-Wunused_but_set_variable]
   double trj;
   double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
   double kv;
   double tau_layer;
-  double tbgr = skyBackgroundTemperature_.get("K");
   double ratioWater = pfit_wh2o;
 
-  singlefreq = getChanFreq(spwid, nc).get("GHz");
-  // chanwidth = getChanWidth(spwid, nc).get("GHz"); // [-Wunused_but_set_variable]
-  trj=0.0;
+  const double *cache = getRTCache(spwid, nc, tspill);
+  const double *layer = cache + rtCacheHeader_;
+  singlefreq = cache[0];
+
   kv = 0.0;
   radiance = 0.0;
 
-  for(size_t i = 0; i < getNumLayer(); i++) {
+  for(size_t i = 0; i < numLayer_; i++, layer += rtCacheStride_) {
 
-    tau_layer = ((getAbsTotalWet(spwid, nc, i).get()) * ratioWater+ getAbsTotalDry(spwid, nc, i).get()) * getLayerThickness(i).get();
+    tau_layer = (layer[0] * ratioWater + layer[1]) * layer[2];
 
-    radiance = radiance + (1.0 / (exp(h_div_k * singlefreq/ getLayerTemperature(i).get()) - 1.0)) * exp(-kv * airm) * (1.0- exp(-airm * tau_layer));
+    radiance = radiance + layer[3] * exp(-kv * airm) * (1.0 - exp(-airm * tau_layer));
 
     kv = kv + tau_layer;
 
   }
 
-  radiance = skycoupling * (radiance + (1.0 / (exp(h_div_k * singlefreq / tbgr)- 1.0)) * exp(-kv * airm)) + (1.0 / (exp(h_div_k * singlefreq / tspill)- 1.0)) * (1 - skycoupling);
+  radiance = skycoupling * (radiance + cache[2] * exp(-kv * airm)) + cache[4] * (1 - skycoupling);
 
   trj = h_div_k * singlefreq * radiance;
 
@@ -2720,73 +2509,728 @@ double SkyStatus::RTRJ(double pfit_wh2o,
 
 }
 
+const double *SkyStatus::getRTCache(size_t spwid, size_t nc, double tspill)
+{
+  checkRTCacheVersion();
+  if(vv_rtCache_.size() < v_chanFreq_.size()) vv_rtCache_.resize(v_chanFreq_.size());
+
+  vector<double> &cache = vv_rtCache_[v_transfertId_[spwid] + nc];
+  if(cache.empty()) mkRTCache(spwid, nc, cache);
 
+  setRTCacheTemperatures(skyBackgroundTemperature_.get<Temperature::K>(), tspill, &cache[0]);
+  return &cache[0];
+}
+
+void SkyStatus::mkRTCache(size_t spwid, size_t nc, vector<double> &cache) const
+{
+  double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
+
+  double singlefreq = getChanFreq(spwid, nc).get<Frequency::GHz>();
+  const double *absWet = getAbsTotalWetData(spwid, nc);
+  const double *absDry = getAbsTotalDryData(spwid, nc);
+  cache.resize(rtCacheHeader_ + rtCacheStride_ * numLayer_);
+  cache[0] = singlefreq;
+  cache[1] = std::numeric_limits<double>::quiet_NaN(); // background and spill over terms set by setRTCacheTemperatures()
+  cache[3] = std::numeric_limits<double>::quiet_NaN();
+  double *layer = &cache[rtCacheHeader_];
+  for(size_t i = 0; i < numLayer_; i++, layer += rtCacheStride_) {
+    layer[0] = absWet[i];
+    layer[1] = absDry[i];
+    layer[2] = v_layerThickness_[i];
+    layer[3] = 1.0 / (exp(h_div_k * singlefreq / v_layerTemperature_[i]) - 1.0);
+  }
+}
+
+void SkyStatus::setRTCacheTemperatures(double tbgr, double tspill, double *cache)
+{
+  double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
+
+  if(cache[1] != tbgr) {
+    cache[1] = tbgr;
+    cache[2] = 1.0 / (exp(h_div_k * cache[0] / tbgr) - 1.0);
+  }
+  if(cache[3] != tspill) {
+    cache[3] = tspill;
+    cache[4] = 1.0 / (exp(h_div_k * cache[0] / tspill) - 1.0);
+  }
+}
+
+void SkyStatus::checkRTCacheVersion()
+{
+  // the layers have changed since the caches were built: every channel and window is built again,
+  // in its storage
+  if(rtCacheVersion_ != profileVersion_) {
+    for(size_t n = 0; n < vv_rtCache_.size(); n++) vv_rtCache_[n].clear();
+    for(size_t n = 0; n < vv_rtSpwCache_.size(); n++) vv_rtSpwCache_[n].clear();
+    rtCacheVersion_ = profileVersion_;
+  }
+}
+
+const double *SkyStatus::getRTSpwCache(size_t spwid)
+{
+  double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
+
+  checkRTCacheVersion();
+  if(vv_rtSpwCache_.size() < v_numChan_.size()) vv_rtSpwCache_.resize(v_numChan_.size());
+
+  vector<double> &cache = vv_rtSpwCache_[spwid];
+  if(cache.empty()) {
+    size_t numChan = v_numChan_[spwid];
+    cache.resize(numChan * (1 + 3 * numLayer_));
+    for(size_t nc = 0; nc < numChan; nc++) {
+      double singlefreq = getChanFreq(spwid, nc).get<Frequency::GHz>();
+      const double *absWet = getAbsTotalWetData(spwid, nc);
+      const double *absDry = getAbsTotalDryData(spwid, nc);
+      cache[nc] = singlefreq;
+      double *layer = &cache[numChan];
+      for(size_t i = 0; i < numLayer_; i++, layer += 3 * numChan) {
+        layer[nc] = absWet[i];
+        layer[numChan + nc] = absDry[i];
+        layer[2 * numChan + nc] = 1.0 / (exp(h_div_k * singlefreq / v_layerTemperature_[i]) - 1.0);
+      }
+    }
+  }
+  return &cache[0];
+}
+
+void SkyStatus::RTSpectrum(double pfit_wh2o,
+                           const double *skycoupling,
+                           const double *tspill,
+                           double airm,
+                           size_t spwid,
+                           bool rayleighJeans,
+                           double *out)
+{
+  double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
+  double tbgr = skyBackgroundTemperature_.get<Temperature::K>();
+  double ratioWater = pfit_wh2o;
+  size_t numChan = v_numChan_[spwid];
+
+  const double *cache = getRTSpwCache(spwid);
+  const double *freq = cache;
+  const double *layer = cache + numChan;
+
+  // until the last layer out holds the radiance, kv the opacity of the layers below
+  vector<double> kv(numChan, 0.0);
+  for(size_t n = 0; n < numChan; n++) out[n] = 0.0;
+
+  for(size_t i = 0; i < numLayer_; i++, layer += 3 * numChan) {
+    const double *absWet = layer;
+    const double *absDry = layer + numChan;
+    const double *planck = layer + 2 * numChan;
+    double thickness = v_layerThickness_[i];
+    for(size_t n = 0; n < numChan; n++) {
+      double tau_layer = (absWet[n] * ratioWater + absDry[n]) * thickness;
+      out[n] = out[n] + planck[n] * exp(-kv[n] * airm) * (1.0 - exp(-airm * tau_layer));
+      kv[n] = kv[n] + tau_layer;
+    }
+  }
+
+  for(size_t n = 0; n < numChan; n++) {
+    double radiance = skycoupling[n] * (out[n] + (1.0 / (exp(h_div_k * freq[n] / tbgr) - 1.0)) * exp(-kv[n] * airm))
+                      + (1.0 / (exp(h_div_k * freq[n] / tspill[n]) - 1.0)) * (1 - skycoupling[n]);
+    if(rayleighJeans) {
+      out[n] = h_div_k * freq[n] * radiance;
+    } else {
+      out[n] = h_div_k * freq[n] / log(1 + (1 / radiance));
+    }
+  }
+}
+
+void SkyStatus::RTCube(const double *pfit_wh2o,
+                       size_t numWH2O,
+                       const double *airmass,
+                       size_t numAirmass,
+                       const double *skycoupling,
+                       const double *tspill,
+                       size_t spwid,
+                       double *out)
+{
+  double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
+  double tbgr = skyBackgroundTemperature_.get<Temperature::K>();
+  size_t numChan = v_numChan_[spwid];
+
+  const double *cache = getRTSpwCache(spwid);
+  const double *freq = cache;
+
+  // Planck terms of the background and spill over, common to the whole batch
+  vector<double> planckBackground(numChan), planckSpill(numChan);
+  for(size_t n = 0; n < numChan; n++) {
+    planckBackground[n] = 1.0 / (exp(h_div_k * freq[n] / tbgr) - 1.0);
+    planckSpill[n] = 1.0 / (exp(h_div_k * freq[n] / tspill[n]) - 1.0);
+  }
+
+  // for a water vapor scale factor, the opacity of every layer and that of the layers below it
+  vector<double> tau(numLayer_ * numChan), kv((numLayer_ + 1) * numChan);
+
+  for(size_t w = 0; w < numWH2O; w++) {
+    double ratioWater = pfit_wh2o[w];
+    const double *layer = cache + numChan;
+    for(size_t n = 0; n < numChan; n++) kv[n] = 0.0;
+    for(size_t i = 0; i < numLayer_; i++, layer += 3 * numChan) {
+      const double *absWet = layer;
+      const double *absDry = layer + numChan;
+      double thickness = v_layerThickness_[i];
+      for(size_t n = 0; n < numChan; n++) {
+        tau[i * numChan + n] = (absWet[n] * ratioWater + absDry[n]) * thickness;
+        kv[(i + 1) * numChan + n] = kv[i * numChan + n] + tau[i * numChan + n];
+      }
+    }
+
+    for(size_t a = 0; a < numAirmass; a++) {
+      double airm = airmass[a];
+      double *radiance = out + (w * numAirmass + a) * numChan;
+      for(size_t n = 0; n < numChan; n++) radiance[n] = 0.0;
+      layer = cache + numChan;
+      for(size_t i = 0; i < numLayer_; i++, layer += 3 * numChan) {
+        const double *planck = layer + 2 * numChan;
+        const double *tau_layer = &tau[i * numChan];
+        const double *kv_below = &kv[i * numChan];
+        for(size_t n = 0; n < numChan; n++) {
+          radiance[n] = radiance[n] + planck[n] * exp(-kv_below[n] * airm) * (1.0 - exp(-airm * tau_layer[n]));
+        }
+      }
+      const double *kv_total = &kv[numLayer_ * numChan];
+      for(size_t n = 0; n < numChan; n++) {
+        double rad = skycoupling[n] * (radiance[n] + planckBackground[n] * exp(-kv_total[n] * airm))
+                     + planckSpill[n] * (1 - skycoupling[n]);
+        radiance[n] = h_div_k * freq[n] / log(1 + (1 / rad));
+      }
+    }
+  }
+}
+
+double SkyStatus::RT(double pfit_wh2o,
+                     double skycoupling,
+                     double tspill,
+                     double airmass,
+                     size_t spwid)
+{
+  size_t numChan = v_numChan_[spwid];
+  vector<double> v_skycoupling(numChan, skycoupling);
+  vector<double> v_tspill(numChan, tspill);
+  vector<double> tebb(numChan);
+  RTSpectrum(pfit_wh2o, &v_skycoupling[0], &v_tspill[0], airmass, spwid, false, &tebb[0]);
+
+  double tebb_channel = 0.0;
+  for(size_t n = 0; n < numChan; n++) {
+    tebb_channel = tebb_channel + tebb[n] / numChan;
+  }
+  return tebb_channel;
+}
+
+double SkyStatus::RTRJ(double pfit_wh2o,
+                       double skycoupling,
+                       double tspill,
+                       double airmass,
+                       size_t spwid)
+{
+  size_t numChan = v_numChan_[spwid];
+  vector<double> v_skycoupling(numChan, skycoupling);
+  vector<double> v_tspill(numChan, tspill);
+  vector<double> trj(numChan);
+  RTSpectrum(pfit_wh2o, &v_skycoupling[0], &v_tspill[0], airmass, spwid, true, &trj[0]);
+
+  double trj_channel = 0.0;
+  for(size_t n = 0; n < numChan; n++) {
+    trj_channel = trj_channel + trj[n] / numChan;
+  }
+  return trj_channel;
+}
+
+bool SkyStatus::spectrumArgumentsAreValid(size_t spwid,
+                                          const Length &wh2o,
+                                          double airmass,
+                                          const double *skycoupling,
+                                          const double *tspill)
+{
+  if(!spwidAndIndexAreValid(spwid, 0)) {
+    return false;
+  }
+  if(wh2o.get() < 0.0) {
+    std::cout << " SkyStatus: ERROR: negative water vapor column, the spectrum is not computed" << std::endl;
+    return false;
+  }
+  if(airmass < 1.0) {
+    std::cout << " SkyStatus: ERROR: air mass lower than 1, the spectrum is not computed" << std::endl;
+    return false;
+  }
+  for(size_t n = 0; n < v_numChan_[spwid]; n++) {
+    if(skycoupling != 0 && (skycoupling[n] < 0.0 || skycoupling[n] > 1.0)) {
+      std::cout << " SkyStatus: ERROR: sky coupling of channel " << n << " of spectral window " << spwid
+                << " out of [0,1], the spectrum is not computed" << std::endl;
+      return false;
+    }
+    if(tspill != 0 && (tspill[n] < 0.0 || tspill[n] > 350.0)) {
+      std::cout << " SkyStatus: ERROR: spill over temperature of channel " << n << " of spectral window " << spwid
+                << " out of [0,350] K, the spectrum is not computed" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SkyStatus::getTebbSkySpectrum(size_t spwid,
+                                   const Length &wh2o,
+                                   double airmass,
+                                   const double *skycoupling,
+                                   const double *tspill,
+                                   double *tebbSky)
+{
+  return mkSkySpectrum(vector<size_t>(1, spwid), wh2o, airmass, skycoupling, tspill, false, tebbSky);
+}
+
+bool SkyStatus::getTebbSkySpectrum(const vector<size_t> &spwids,
+                                   const Length &wh2o,
+                                   double airmass,
+                                   const double *skycoupling,
+                                   const double *tspill,
+                                   double *tebbSky)
+{
+  return mkSkySpectrum(spwids, wh2o, airmass, skycoupling, tspill, false, tebbSky);
+}
+
+bool SkyStatus::getTrjSkySpectrum(size_t spwid,
+                                  const Length &wh2o,
+                                  double airmass,
+                                  const double *skycoupling,
+                                  const double *tspill,
+                                  double *trjSky)
+{
+  return mkSkySpectrum(vector<size_t>(1, spwid), wh2o, airmass, skycoupling, tspill, true, trjSky);
+}
+
+bool SkyStatus::getTrjSkySpectrum(const vector<size_t> &spwids,
+                                  const Length &wh2o,
+                                  double airmass,
+                                  const double *skycoupling,
+                                  const double *tspill,
+                                  double *trjSky)
+{
+  return mkSkySpectrum(spwids, wh2o, airmass, skycoupling, tspill, true, trjSky);
+}
+
+bool SkyStatus::getTebbSkyCube(size_t spwid,
+                               const vector<Length> &wh2o,
+                               const vector<double> &airmass,
+                               const double *skycoupling,
+                               const double *tspill,
+                               double *tebbSky)
+{
+  if(!spectrumArgumentsAreValid(spwid, Length::from<Length::mm>(0.0), 1.0, skycoupling, tspill)) {
+    return false;
+  }
+  for(size_t i = 0; i < wh2o.size(); i++) {
+    if(wh2o[i].get() < 0.0) {
+      std::cout << " SkyStatus: ERROR: negative water vapor column, the spectra are not computed" << std::endl;
+      return false;
+    }
+  }
+  for(size_t j = 0; j < airmass.size(); j++) {
+    if(airmass[j] < 1.0) {
+      std::cout << " SkyStatus: ERROR: air mass lower than 1, the spectra are not computed" << std::endl;
+      return false;
+    }
+  }
+
+  size_t numChan = v_numChan_[spwid];
+  vector<double> ratioWater(wh2o.size());
+  for(size_t i = 0; i < wh2o.size(); i++) {
+    ratioWater[i] = wh2o[i].get() / getGroundWH2O().get();
+  }
+  vector<double> v_skycoupling(numChan, 1.0);
+  vector<double> v_tspill(numChan, getGroundTemperature().get<Temperature::K>());
+  if(skycoupling != 0) std::copy(skycoupling, skycoupling + numChan, v_skycoupling.begin());
+  if(tspill != 0) std::copy(tspill, tspill + numChan, v_tspill.begin());
+  if(wh2o.empty() || airmass.empty()) return true;
+  RTCube(&ratioWater[0], wh2o.size(), &airmass[0], airmass.size(), &v_skycoupling[0], &v_tspill[0], spwid, tebbSky);
+  return true;
+}
+
+bool SkyStatus::getAverageTebbSkyCube(size_t spwid,
+                                      const vector<Length> &wh2o,
+                                      const vector<double> &airmass,
+                                      double skycoupling,
+                                      const Temperature &Tspill,
+                                      double *averageTebbSky)
+{
+  if(!spwidAndIndexAreValid(spwid, 0)) return false;
+  size_t numChan = v_numChan_[spwid];
+  vector<double> v_skycoupling(numChan, skycoupling);
+  vector<double> v_tspill(numChan, Tspill.get<Temperature::K>());
+  vector<double> tebb(wh2o.size() * airmass.size() * numChan);
+  if(!getTebbSkyCube(spwid, wh2o, airmass, &v_skycoupling[0], &v_tspill[0], tebb.empty() ? 0 : &tebb[0])) return false;
+
+  // the channels are averaged in the same order as in RT()
+  for(size_t k = 0; k < wh2o.size() * airmass.size(); k++) {
+    double tebb_channel = 0.0;
+    for(size_t n = 0; n < numChan; n++) {
+      tebb_channel = tebb_channel + tebb[k * numChan + n] / numChan;
+    }
+    averageTebbSky[k] = tebb_channel;
+  }
+  return true;
+}
+
+bool SkyStatus::mkSkySpectrum(const vector<size_t> &spwids,
+                              const Length &wh2o,
+                              double airmass,
+                              const double *skycoupling,
+                              const double *tspill,
+                              bool rayleighJeans,
+                              double *out)
+{
+  size_t offset = 0;
+  for(size_t k = 0; k < spwids.size(); k++) {
+    if(!spectrumArgumentsAreValid(spwids[k],
+                                  wh2o,
+                                  airmass,
+                                  skycoupling == 0 ? 0 : skycoupling + offset,
+                                  tspill == 0 ? 0 : tspill + offset)) {
+      return false;
+    }
+    offset = offset + v_numChan_[spwids[k]];
+  }
+
+  double ratioWater = wh2o.get() / getGroundWH2O().get();
+  offset = 0;
+  for(size_t k = 0; k < spwids.size(); k++) {
+    size_t numChan = v_numChan_[spwids[k]];
+    vector<double> v_skycoupling(numChan, 1.0);
+    vector<double> v_tspill(numChan, getGroundTemperature().get<Temperature::K>());
+    if(skycoupling != 0) std::copy(skycoupling + offset, skycoupling + offset + numChan, v_skycoupling.begin());
+    if(tspill != 0) std::copy(tspill + offset, tspill + offset + numChan, v_tspill.begin());
+    RTSpectrum(ratioWater, &v_skycoupling[0], &v_tspill[0], airmass, spwids[k], rayleighJeans, out + offset);
+    offset = offset + numChan;
+  }
+  return true;
+}
+
+bool SkyStatus::streamSpectrum(const std::function<void(const SpectrumChunk &)> &sink,
+                               size_t chunkSize) const
+{
+  if(airMass_ < 1.0) {
+    std::cout << " SkyStatus: ERROR: air mass lower than 1, the spectrum is not computed" << std::endl;
+    return false;
+  }
+  if(chunkSize == 0) chunkSize = 1;
+
+  double ratioWater = wh2o_user_.get() / getGroundWH2O().get();
+  size_t numChan = v_chanFreq_.size();
+  size_t blockSize = std::min(chunkSize, numChan);
+  vector<double> opacity(blockSize);
+  vector<double> tebbSky(blockSize);
+  vector<double> pathLength(blockSize);
+
+  SpectrumChunk chunk;
+  for(size_t firstChan = 0; firstChan < numChan; firstChan = firstChan + chunkSize) {
+    chunk.firstChan = firstChan;
+    chunk.numChan = std::min(chunkSize, numChan - firstChan);
+    mkSpectrumChunk(firstChan, chunk.numChan, ratioWater, &opacity[0], &tebbSky[0], &pathLength[0]);
+    chunk.frequency = &v_chanFreq_[firstChan];
+    chunk.opacity = &opacity[0];
+    chunk.tebbSky = &tebbSky[0];
+    chunk.pathLength = &pathLength[0];
+    sink(chunk);
+  }
+  return true;
+}
+
+bool SkyStatus::streamSpectrum(double *opacity,
+                               double *tebbSky,
+                               double *pathLength,
+                               size_t chunkSize) const
+{
+  return streamSpectrum([opacity, tebbSky, pathLength](const SpectrumChunk &chunk) {
+                          if(opacity != 0) std::copy(chunk.opacity, chunk.opacity + chunk.numChan, opacity + chunk.firstChan);
+                          if(tebbSky != 0) std::copy(chunk.tebbSky, chunk.tebbSky + chunk.numChan, tebbSky + chunk.firstChan);
+                          if(pathLength != 0) std::copy(chunk.pathLength, chunk.pathLength + chunk.numChan, pathLength + chunk.firstChan);
+                        },
+                        chunkSize);
+}
+
+void SkyStatus::mkSpectrumChunk(size_t firstChan,
+                                size_t numChan,
+                                double ratioWater,
+                                double *opacity,
+                                double *tebbSky,
+                                double *pathLength) const
+{
+  double h_div_k = 0.04799274551; /* plank=6.6262e-34,boltz=1.3806E-23 */
+  double tbgr = skyBackgroundTemperature_.get<Temperature::K>();
+  double airm = airMass_;
+  double nu;
+  double tau_layer;
+  double radiance;
+  std::complex<double> wet, dry;
+  RefractiveIndex atm;
+  LayerRefractivity n;
+
+  // the distinct frequencies of the chunk (see v_uniqueFreqId_), and for every channel the index
+  // of its frequency among them
+  std::map<size_t, size_t> m_chunkFreq;
+  vector<size_t> v_chunkFreqId(numChan);
+  vector<double> v_freq;
+  vector<double> v_nu;
+  for(size_t i = 0; i < numChan; i++) {
+    size_t nf = v_uniqueFreqId_[firstChan + i];
+    std::map<size_t, size_t>::const_iterator it = m_chunkFreq.find(nf);
+    if(it != m_chunkFreq.end()) {
+      v_chunkFreqId[i] = it->second;
+    } else {
+      v_chunkFreqId[i] = v_nu.size();
+      m_chunkFreq[nf] = v_nu.size();
+      v_freq.push_back(v_uniqueFreq_[nf]);
+      v_nu.push_back(1.0E-9 * v_uniqueFreq_[nf]); // ATM uses GHz units
+    }
+  }
+  size_t numFreq = v_nu.size();
+
+  // until the last layer tau holds the opacity of the layers below, rad the radiance and phase
+  // the phase delay (rad), for every distinct frequency
+  vector<double> tau(numFreq, 0.0);
+  vector<double> rad(numFreq, 0.0);
+  vector<double> phase(numFreq, 0.0);
+
+  // blocked schedule of mkAbsorptionProfile(): the frequencies are taken chanBlockSize_ at a time
+  // and, within a block, the layers are the outer loop; the sums are done in the same order as in
+  // RT() and getAbsTotalDry()/getAbsTotalWet()
+  for(size_t first = 0; first < numFreq; first += chanBlockSize_) {
+    size_t last = std::min(first + chanBlockSize_, numFreq);
+    for(size_t j = 0; j < numLayer_; j++) {
+      double thickness = v_layerThickness_[j];
+      double temperature = v_layerTemperature_[j];
+      for(size_t k = first; k < last; k++) {
+        nu = v_nu[k];
+        mkLayerRefractivity(atm, nu, j, n);
+        wet = n.h2oLines + n.h2oCont;
+        dry = n.o2Lines + n.dryCont + n.o3Lines + n.coLines + n.n2oLines + n.no2Lines + n.so2Lines;
+        tau_layer = (imag(wet) * ratioWater + imag(dry)) * thickness;
+        rad[k] = rad[k] + (1.0 / (exp(h_div_k * nu / temperature) - 1.0)) * exp(-tau[k] * airm) * (1.0 - exp(-airm * tau_layer));
+        tau[k] = tau[k] + tau_layer;
+        phase[k] = phase[k] + (real(wet) * ratioWater + real(dry)) * thickness;
+      }
+    }
+  }
+
+  for(size_t k = 0; k < numFreq; k++) {
+    nu = v_nu[k];
+    radiance = rad[k] + (1.0 / (exp(h_div_k * nu / tbgr) - 1.0)) * exp(-tau[k] * airm);
+    rad[k] = h_div_k * nu / log(1 + (1 / radiance));
+    phase[k] = ((299792458.0 / v_freq[k]) / 360.0) * phase[k] * 57.29578;
+  }
+
+  // back to the channels
+  for(size_t i = 0; i < numChan; i++) {
+    opacity[i] = tau[v_chunkFreqId[i]];
+    tebbSky[i] = rad[v_chunkFreqId[i]];
+    pathLength[i] = phase[v_chunkFreqId[i]];
+  }
+}
+
+SkyStatus::LayerMerging SkyStatus::mergeThinLayers(const Temperature &tebbTolerance,
+                                                   const Length &pathLengthTolerance)
+{
+  static const double thresholdFactor[] = { 4.0, 2.0, 1.0, 0.5, 0.25, 0.1, 0.05, 0.02 };
+  static const size_t numThreshold = sizeof(thresholdFactor) / sizeof(thresholdFactor[0]);
+
+  LayerMerging merging;
+  merging.numLayerBefore = numLayer_;
+  merging.numLayerAfter = numLayer_;
+  merging.errorThreshold = 0.0;
+  merging.tebbError = 0.0;
+  merging.pathLengthError = 0.0;
+  merging.opacityError = 0.0;
+
+  size_t numChan = v_chanFreq_.size();
+  if(numLayer_ < 2 || numChan == 0) return merging;
+  if(airMass_ < 1.0) {
+    std::cout << " SkyStatus: ERROR: air mass lower than 1, the layers are not merged" << std::endl;
+    return merging;
+  }
+
+  // reference spectrum and largest opacity of every layer over the spectral grid, for the
+  // original layers
+  vector<double> opacity0(numChan), tebbSky0(numChan), pathLength0(numChan);
+  streamSpectrum(&opacity0[0], &tebbSky0[0], &pathLength0[0]);
+
+  double ratioWater = wh2o_user_.get() / getGroundWH2O().get();
+  vector<double> layerOpacity(numLayer_, 0.0);
+  RefractiveIndex atm;
+  LayerRefractivity n;
+  for(size_t j = 0; j < numLayer_; j++) {
+    for(size_t i = 0; i < numChan; i++) {
+      mkLayerRefractivity(atm, 1.0E-9 * v_chanFreq_[i], j, n);
+      double tau = (imag(n.h2oLines + n.h2oCont) * ratioWater
+                    + imag(n.o2Lines + n.dryCont + n.o3Lines + n.coLines + n.n2oLines + n.no2Lines + n.so2Lines))
+                   * v_layerThickness_[j];
+      layerOpacity[j] = std::max(layerOpacity[j], tau);
+    }
+  }
+
+  // boundaries of the original layers, which are overwritten by the trials below
+  vector<double> v_tMin(numLayer_), v_tMax(numLayer_), v_logP0(numLayer_), v_logP1(numLayer_);
+  for(size_t j = 0; j < numLayer_; j++) {
+    v_tMin[j] = std::min(v_layerTemperature0_[j], v_layerTemperature1_[j]);
+    v_tMax[j] = std::max(v_layerTemperature0_[j], v_layerTemperature1_[j]);
+    v_logP0[j] = log(v_layerPressure0_[j]);
+    v_logP1[j] = log(v_layerPressure1_[j]);
+  }
+
+  vector<double> v_savedLayerTop = v_fixedLayerTop_;
+  vector<size_t> v_savedLayerMerged = v_fixedLayerMerged_;
+  bool savedNewBasicParam = newBasicParam_;
+  vector<double> opacity(numChan), tebbSky(numChan), pathLength(numChan);
+
+  // A group of layers is represented by one temperature and one pressure: the error it brings on the
+  // brightness temperatures is estimated as its opacity times the spread of its temperatures plus the
+  // effect of the pressure (to second order, absorption coefficients going as the square of the
+  // pressure in the line wings). Groups are grown from the ground up while the estimate stays below a
+  // threshold; from the largest threshold (fewest layers) down, the first one for which the errors
+  // actually obtained are within the tolerances is kept.
+  for(size_t k = 0; k < numThreshold; k++) {
+    double threshold = thresholdFactor[k] * tebbTolerance.get<Temperature::K>();
+    vector<size_t> v_numMerged;
+    size_t first = 0;
+    double tauGroup = 0.0, tMin = 0.0, tMax = 0.0;
+    for(size_t j = 0; j < merging.numLayerBefore; j++) {
+      if(j > first) {
+        double tau = tauGroup + layerOpacity[j];
+        double t0 = std::min(tMin, v_tMin[j]);
+        double t1 = std::max(tMax, v_tMax[j]);
+        double dlogP = v_logP0[first] - v_logP1[j];
+        if(tau * ((t1 - t0) + (t0 + t1) / 2.0 * dlogP * dlogP / 4.0) > threshold) {
+          v_numMerged.push_back(j - first);
+          first = j;
+        }
+      }
+      if(j == first) {
+        tauGroup = 0.0;
+        tMin = v_tMin[j];
+        tMax = v_tMax[j];
+      }
+      tauGroup = tauGroup + layerOpacity[j];
+      tMin = std::min(tMin, v_tMin[j]);
+      tMax = std::max(tMax, v_tMax[j]);
+    }
+    v_numMerged.push_back(merging.numLayerBefore - first);
+    if(v_numMerged.size() == merging.numLayerBefore) break;
+
+    // the groups are always formed from the original layers
+    if(numLayer_ != merging.numLayerBefore) {
+      v_fixedLayerTop_ = v_savedLayerTop;
+      v_fixedLayerMerged_ = v_savedLayerMerged;
+      numLayer_ = mkAtmProfile();
+    }
+    mergeLayers(v_numMerged);
+    streamSpectrum(&opacity[0], &tebbSky[0], &pathLength[0]);
+    double tebbError = 0.0, pathLengthError = 0.0, opacityError = 0.0;
+    for(size_t i = 0; i < numChan; i++) {
+      tebbError = std::max(tebbError, fabs(tebbSky[i] - tebbSky0[i]));
+      pathLengthError = std::max(pathLengthError, fabs(pathLength[i] - pathLength0[i]));
+      opacityError = std::max(opacityError, fabs(opacity[i] - opacity0[i]));
+    }
+    if(tebbError <= tebbTolerance.get<Temperature::K>() && pathLengthError <= pathLengthTolerance.get<Length::m>()) {
+      merging.numLayerAfter = numLayer_;
+      merging.errorThreshold = threshold;
+      merging.tebbError = tebbError;
+      merging.pathLengthError = pathLengthError;
+      merging.opacityError = opacityError;
+      mkRefractiveIndexProfile();
+      return merging;
+    }
+  }
+
+  // no merging within the tolerances: the original layers are rebuilt, identical to those of the
+  // absorption profiles, which stay valid
+  if(numLayer_ != merging.numLayerBefore) {
+    v_fixedLayerTop_ = v_savedLayerTop;
+    v_fixedLayerMerged_ = v_savedLayerMerged;
+    numLayer_ = mkAtmProfile();
+    newBasicParam_ = savedNewBasicParam;
+  }
+  return merging;
+}
+
+void SkyStatus::releaseMergedLayers()
+{
+  if(!isLayerGridFixed()) return;
+  releaseLayerGrid();
+  mkRefractiveIndexProfile();
+}
+
+bool SkyStatus::setObserverAltitude(const Length &altitude)
+{
+  double wh2o = getGroundWH2O().get();
+  if(!RefractiveIndexProfile::setObserverAltitude(altitude)) return false;
+  if(wh2o > 0.0) wh2o_user_ = Length(wh2o_user_.get() * getGroundWH2O().get() / wh2o);
+  return true;
+}
+
+void SkyStatus::stopAltitudeSliding()
+{
+  double wh2o = getGroundWH2O().get();
+  RefractiveIndexProfile::stopAltitudeSliding();
+  if(wh2o > 0.0) wh2o_user_ = Length(wh2o_user_.get() * getGroundWH2O().get() / wh2o);
+}
 
 void SkyStatus::iniSkyStatus()
 {
 
-  Length wh2o_default(1, "mm");
-  Length wh2o_default_neg(-999, "mm");
-  Temperature temp_default_neg(-999, "K");
+  Length wh2o_default = Length::from<Length::mm>(1);
+  Length wh2o_default_neg = Length::from<Length::mm>(-999);
+  Temperature temp_default_neg = Temperature::from<Temperature::K>(-999);
 
   if(wh2o_user_.get() <= 0.0 || wh2o_user_.get() > (getGroundWH2O().get())
-      * (200 / (getRelativeHumidity().get("%")))) {
+      * (200 / (getRelativeHumidity().get<Humidity::percent>()))) {
     wh2o_user_ = wh2o_default;
   }
 
 }
 
+// The derivatives are the analytic ones of getGroundSensitivity(), averaged over the channels of the
+// spectral window; for the ground temperature, the temperature of the tropopause is held, the lapse
+// rate changing by -1/(tropopause altitude - ground altitude) per K.
+
+static double channelAverage(const vector<double> &v)
+{
+  double av = 0.0;
+  for(size_t i = 0; i < v.size(); i++) av = av + v[i];
+  return av / v.size();
+}
+
 double SkyStatus::getAverageNonDispersiveDryPathLength_GroundPressureDerivative(size_t spwid)
 {
-  Pressure ref = getGroundPressure();
-  Length a =
-      RefractiveIndexProfile::getAverageNonDispersiveDryPathLength(spwid);
-  setBasicAtmosphericParameters(ref + Pressure(1.0, "mb"));
-  Length b =
-      RefractiveIndexProfile::getAverageNonDispersiveDryPathLength(spwid);
-  setBasicAtmosphericParameters(ref);
-  return b.get("microns") - a.get("microns");
+  GroundSensitivity sensitivity;
+  if(!getGroundSensitivity(spwid, sensitivity)) return -999.0;
+  return Length::from<Length::m>(channelAverage(sensitivity.groundPressure.nonDispersiveDryPathLength)).get<Length::micron>();
 }
 
 double SkyStatus::getAverageNonDispersiveDryPathLength_GroundTemperatureDerivative(size_t spwid)
 {
-  Temperature ref = getGroundTemperature();
-  double oldLapseRate = getTropoLapseRate();
-  Length a =
-      RefractiveIndexProfile::getAverageNonDispersiveDryPathLength(spwid);
-  double newLapseRate =
-      ((getTropopauseTemperature() - ref - Temperature(1.0, "K")).get("K"))
-          / ((getTropopauseAltitude() - getAltitude()).get("km"));
-  setBasicAtmosphericParameters(ref + Temperature(1.0, "K"), newLapseRate);
-  Length b =
-      RefractiveIndexProfile::getAverageNonDispersiveDryPathLength(spwid);
-  setBasicAtmosphericParameters(ref, oldLapseRate);
-  return b.get("microns") - a.get("microns");
+  GroundSensitivity sensitivity;
+  if(!getGroundSensitivity(spwid, sensitivity)) return -999.0;
+  double height = (getTropopauseAltitude() - getAltitude()).get<Length::km>();
+  double derivative = channelAverage(sensitivity.groundTemperature.nonDispersiveDryPathLength)
+      - channelAverage(sensitivity.tropoLapseRate.nonDispersiveDryPathLength) / height;
+  return Length::from<Length::m>(derivative).get<Length::micron>();
 }
 
 double SkyStatus::getAverageDispersiveDryPathLength_GroundPressureDerivative(size_t spwid)
 {
-  Pressure ref = getGroundPressure();
-  Length a = RefractiveIndexProfile::getAverageDispersiveDryPathLength(spwid);
-  // scanf("%d",&e);
-  setBasicAtmosphericParameters(ref + Pressure(1.0, "mb"));
-  Length b = RefractiveIndexProfile::getAverageDispersiveDryPathLength(spwid);
-  setBasicAtmosphericParameters(ref);
-  return b.get("microns") - a.get("microns");
+  GroundSensitivity sensitivity;
+  if(!getGroundSensitivity(spwid, sensitivity)) return -999.0;
+  return Length::from<Length::m>(channelAverage(sensitivity.groundPressure.dispersiveDryPathLength)).get<Length::micron>();
 }
 
 double SkyStatus::getAverageDispersiveDryPathLength_GroundTemperatureDerivative(size_t spwid)
 {
-  Temperature ref = getGroundTemperature();
-  double oldLapseRate = getTropoLapseRate();
-  Length a = RefractiveIndexProfile::getAverageDispersiveDryPathLength(spwid);
-  double newLapseRate =
-      ((getTropopauseTemperature() - ref - Temperature(1.0, "K")).get("K"))
-          / ((getTropopauseAltitude() - getAltitude()).get("km"));
-  setBasicAtmosphericParameters(ref + Temperature(1.0, "K"), newLapseRate);
-  Length b = RefractiveIndexProfile::getAverageDispersiveDryPathLength(spwid);
-  setBasicAtmosphericParameters(ref, oldLapseRate);
-  return b.get("microns") - a.get("microns");
+  GroundSensitivity sensitivity;
+  if(!getGroundSensitivity(spwid, sensitivity)) return -999.0;
+  double height = (getTropopauseAltitude() - getAltitude()).get<Length::km>();
+  double derivative = channelAverage(sensitivity.groundTemperature.dispersiveDryPathLength)
+      - channelAverage(sensitivity.tropoLapseRate.dispersiveDryPathLength) / height;
+  return Length::from<Length::m>(derivative).get<Length::micron>();
 }
 
 Temperature SkyStatus::getWVRAverageSigmaTskyFit(const vector<WVRMeasurement> &RadiometerData,
@@ -2797,12 +3241,12 @@ Temperature SkyStatus::getWVRAverageSigmaTskyFit(const vector<WVRMeasurement> &R
   double tr;
   Temperature sigmaT;
   if(m < n) {
-    return Temperature(-999, "K");
+    return Temperature::from<Temperature::K>(-999);
   }
   for(size_t i = n; i < m; i++) {
-    tr = RadiometerData[i].getSigmaFit().get("K");
+    tr = RadiometerData[i].getSigmaFit().get<Temperature::K>();
     if(tr < 0) {
-      return Temperature(-999, "K");
+      return Temperature::from<Temperature::K>(-999);
     }
     sigma = sigma + tr * tr;
   }
@@ -2810,7 +3254,7 @@ Temperature SkyStatus::getWVRAverageSigmaTskyFit(const vector<WVRMeasurement> &R
     sigmaT = RadiometerData[n].getSigmaFit();
   } else {
     sigma = sqrt(sigma / (m - n));
-    sigmaT = Temperature(sigma, "K");
+    sigmaT = Temperature::from<Temperature::K>(sigma);
   }
   return sigmaT;
 }
@@ -2823,15 +3267,15 @@ Temperature SkyStatus::getWVRSigmaChannelTskyFit(const vector<WVRMeasurement> &R
   double dtr;
   Temperature sigmaT;
   if(m <= n) {
-    return Temperature(-999, "K");
+    return Temperature::from<Temperature::K>(-999);
   }
   for(size_t i = n; i < m; i++) {
-    dtr = RadiometerData[i].getmeasuredSkyBrightness()[ichan].get("K")
-      -RadiometerData[i].getfittedSkyBrightness()[ichan].get("K");
+    dtr = RadiometerData[i].getmeasuredSkyBrightness()[ichan].get<Temperature::K>()
+      -RadiometerData[i].getfittedSkyBrightness()[ichan].get<Temperature::K>();
     sigma = sigma + dtr * dtr;
   }
   sigma = sqrt(sigma / (m - n));
-  sigmaT = Temperature(sigma, "K");
+  sigmaT = Temperature::from<Temperature::K>(sigma);
   return sigmaT;
 }
 
@@ -2842,147 +3286,53 @@ WVRMeasurement SkyStatus::mkWaterVaporRetrieval_fromWVR(const vector<Temperature
                                                         const Temperature &spilloverTemperature,
                                                         const Angle &elevation)
 {
-  double tspill = spilloverTemperature.get("K");
+  double tspill = spilloverTemperature.get<Temperature::K>();
   double pfit_wh2o;
-  double deltaa = 0.02;
-  double sig_fit = -999.0;
-  double eps = 0.01;
-  vector<double> tebb_fit;
-  tebb_fit.reserve(measuredSkyBrightnessVector.size());
-  double airm = 1.0 / sin((3.1415926 * elevation.get("deg")) / 180.0);
-  size_t num;
-  double flamda;
-  size_t niter = 20;
-  double alpha;
-  double beta;
-  double array;
-  double f1;
-  double psave;
-  double f2;
-  double deriv;
-  double chisq1;
-  double chisqr;
-  double pfit_wh2o_b;
-  double res;
-  Length wh2o_retrieved(-999.0, "mm");
-  Length werr(-888, "mm");
+  double airm = 1.0 / sin((3.1415926 * elevation.get<Angle::deg>()) / 180.0);
+  Length wh2o_retrieved = Length::from<Length::mm>(-999.0);
+  Length werr = Length::from<Length::mm>(-888);
   Temperature sigma_fit_temp0;
-  Temperature t_astro;
-  Length sigma_wh2o;
-
-  num = 0;
-
-  flamda = 0.001;
 
-  pfit_wh2o = (getUserWH2O().get("mm")) / (getGroundWH2O().get("mm"));
+  pfit_wh2o = (getUserWH2O().get<Length::mm>()) / (getGroundWH2O().get<Length::mm>());
 
   //    cout << "pfit_wh2o=" << pfit_wh2o << endl;
 
-  for(size_t kite = 0; kite < niter; kite++) {
-
-    num = num + 1;
-
-    beta = 0.0;
-    alpha = 0.0;
-
-    for(size_t i = 0; i < IdChannels.size(); i++) {
-
-      tebb_fit[i] = RT(pfit_wh2o,
-                       skyCoupling[i],
-                       tspill,
-                       airm,
-                       IdChannels[i],
-                       signalGain[i]);
-      // cout << i << " " << tebb_fit[i] << endl;
-
-
-      f1 = tebb_fit[i];
-      psave = pfit_wh2o;
-      pfit_wh2o = pfit_wh2o + deltaa;
-      f2 = RT(pfit_wh2o,
-              skyCoupling[i],
-              tspill,
-              airm,
-              IdChannels[i],
-              signalGain[i]);
-      deriv = (f2 - f1) / deltaa;
-      pfit_wh2o = psave;
-      beta = beta + (measuredSkyBrightnessVector[i].get("K") - tebb_fit[i])
-          * deriv;
-
-      alpha = alpha + deriv * deriv;
-
-    }
-
-    chisq1 = 0;
-    for(size_t i = 0; i < measuredSkyBrightnessVector.size(); i++) {
-      res = -tebb_fit[i] + measuredSkyBrightnessVector[i].get("K");
-      chisq1 = chisq1 + res * res;
-    }
-    if(measuredSkyBrightnessVector.size() > 1) {
-      chisq1 = chisq1 / (measuredSkyBrightnessVector.size() - 1);
-    }
-
-    adjust: array = 1.0 / (1.0 + flamda);
-    pfit_wh2o_b = pfit_wh2o;
-    pfit_wh2o_b = pfit_wh2o_b + beta * array / alpha;
-    if(pfit_wh2o_b < 0.0) pfit_wh2o_b = 0.9 * pfit_wh2o;
-
-    for(size_t i = 0; i < IdChannels.size(); i++) {
-
-      tebb_fit[i] = RT(pfit_wh2o_b,
-                       skyCoupling[i],
-                       tspill,
-                       airm,
-                       IdChannels[i],
-                       signalGain[i]);
-
-    }
-
-    chisqr = 0;
-    for(size_t i = 0; i < IdChannels.size(); i++) {
-      res = -tebb_fit[i] + measuredSkyBrightnessVector[i].get("K");
-      chisqr = chisqr + res * res;
-    }
-    if(IdChannels.size() > 1) {
-      chisqr = chisqr / (IdChannels.size() - 1);
-    }
-
-    if(fabs(chisq1 - chisqr) > 0.001) {
-      if(chisq1 < chisqr) {
-        flamda = flamda * 10.0;
-        goto adjust;
-      }
-    }
-
-    flamda = flamda / 10.0;
-    sig_fit = sqrt(chisqr);
-    pfit_wh2o = pfit_wh2o_b;
-    sigma_wh2o = Length(sqrt(array / alpha) * sig_fit * pfit_wh2o
-        * (getGroundWH2O().get("mm")), "mm");
-
-    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < eps) {
-
-      sigma_fit_temp0 = Temperature(sig_fit, "K");
-
-      wh2o_retrieved = Length(pfit_wh2o * getGroundWH2O().get("mm"), "mm");
-
-      goto salir;
-
-    }
-
+  vector<double> measured(IdChannels.size());
+  for(size_t i = 0; i < IdChannels.size(); i++) {
+    measured[i] = measuredSkyBrightnessVector[i].get<Temperature::K>();
+  }
+
+  LevenbergMarquardt fit(1, IdChannels.size());
+  fit.setData(&measured[0]);
+  fit.setConstraint([](const double *pfit, double *pfit_b) {
+                      if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                    });
+  bool converged = fit.solve([&](const double *pfit, double *tebb, double *deriv) {
+                               double jacobian[3];
+                               for(size_t i = 0; i < IdChannels.size(); i++) {
+                                 tebb[i] = RT(pfit[0],
+                                              skyCoupling[i],
+                                              tspill,
+                                              airm,
+                                              IdChannels[i],
+                                              signalGain[i],
+                                              jacobian);
+                                 deriv[i] = jacobian[0];
+                               }
+                             },
+                             &pfit_wh2o);
+
+  sigma_fit_temp0 = Temperature::from<Temperature::K>(fit.getSigma());
+  if(converged) {
+    wh2o_retrieved = Length::from<Length::mm>(pfit_wh2o * getGroundWH2O().get<Length::mm>());
+  } else {
+    wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
   }
 
-  wh2o_retrieved = werr; // Extra error code, fit not reached after 20 iterations
-  sigma_fit_temp0 = Temperature(sig_fit, "K"); // Extra error code, fit not reached after 20 iterations
-  sigma_wh2o = werr; // Extra error code, fit not reached after 20 iterations
-
-  salir:
-
   vector<Temperature> ttt;
 
   for(size_t i = 0; i < IdChannels.size(); i++) {
-    ttt.push_back(Temperature(tebb_fit[i], "K"));
+    ttt.push_back(Temperature::from<Temperature::K>(fit.getModel()[i]));
   }
 
   if(wh2o_retrieved.get() > 0.0) {
@@ -3015,7 +3365,7 @@ void SkyStatus::WaterVaporRetrieval_fromWVR(WVRMeasurement &RadiometerData)
   WVRMeasurement RadiometerData_withRetrieval;
 
   //    cout << waterVaporRadiometer_.getIdChannels().size() << endl;
-  //    cout << RadiometerData.getmeasuredSkyBrightness()[0].get("K") << " K" << endl;
+  //    cout << RadiometerData.getmeasuredSkyBrightness()[0].get<Temperature::K>() << " K" << endl;
   //    cout << waterVaporRadiometer_.getIdChannels()[1] << endl;
   //    cout << getAssocSpwIds(waterVaporRadiometer_.getIdChannels())[1] << endl;
 
@@ -3031,10 +3381,10 @@ void SkyStatus::WaterVaporRetrieval_fromWVR(WVRMeasurement &RadiometerData)
                                       RadiometerData.getElevation());
 
   // cout << "_fromWVR Sky Coupling = " <<  waterVaporRadiometer_.getSkyCoupling()[0] << endl;
-  // cout << "Signal Gain = " << waterVaporRadiometer_.getsignalGain()[0].get("%") << " %" <<  endl;
-  // cout << "Spillover Temp. = " << waterVaporRadiometer_.getSpilloverTemperature().get("K") << " K" << endl;
-  // cout << "Elevation = " << RadiometerData.getElevation().get("deg") << endl;
-  // cout << "PWV=" << RadiometerData_withRetrieval.getretrievedWaterVaporColumn().get("mm") << " mm" << endl;
+  // cout << "Signal Gain = " << waterVaporRadiometer_.getsignalGain()[0].get<Humidity::percent>() << " %" <<  endl;
+  // cout << "Spillover Temp. = " << waterVaporRadiometer_.getSpilloverTemperature().get<Temperature::K>() << " K" << endl;
+  // cout << "Elevation = " << RadiometerData.getElevation().get<Angle::deg>() << endl;
+  // cout << "PWV=" << RadiometerData_withRetrieval.getretrievedWaterVaporColumn().get<Length::mm>() << " mm" << endl;
 
   RadiometerData.setretrievedWaterVaporColumn(RadiometerData_withRetrieval.getretrievedWaterVaporColumn());
   RadiometerData.setfittedSkyBrightness(RadiometerData_withRetrieval.getfittedSkyBrightness());
@@ -3042,33 +3392,134 @@ void SkyStatus::WaterVaporRetrieval_fromWVR(WVRMeasurement &RadiometerData)
 
 }
 
+void SkyStatus::WaterVaporRetrieval_fromWVR(vector<WVRMeasurement> &RadiometerData,
+                                            size_t n,
+                                            size_t m,
+                                            unsigned int numThread)
+{
+  vector<size_t> IdChannels = waterVaporRadiometer_.getIdChannels();
+  vector<double> skyCoupling = waterVaporRadiometer_.getSkyCoupling();
+  vector<Percent> signalGain = waterVaporRadiometer_.getsignalGain();
+  double tspill = waterVaporRadiometer_.getSpilloverTemperature().get<Temperature::K>();
+  size_t numChan = IdChannels.size();
+
+  if(m > RadiometerData.size()) m = RadiometerData.size();
+  if(m <= n || numChan == 0) return;
+
+  // RT-ready data of all the channels of the WVR windows, and of their image side bands, built before the
+  // threads start: they only read them. Those of WVR channel i are v_signalCache[k], v_imageCache[k] for k
+  // from v_firstCache[i] to v_firstCache[i+1]-1.
+  vector<size_t> v_firstCache(numChan + 1, 0);
+  for(size_t i = 0; i < numChan; i++) {
+    v_firstCache[i + 1] = v_firstCache[i] + v_numChan_[IdChannels[i]];
+    for(size_t nc = 0; nc < v_numChan_[IdChannels[i]]; nc++) {
+      getRTCache(IdChannels[i], nc, tspill);
+      if(signalGain[i].get() < 1.0) getRTCache(getAssocSpwId(IdChannels[i])[0], nc, tspill);
+    }
+  }
+  vector<const double *> v_signalCache(v_firstCache[numChan], 0);
+  vector<const double *> v_imageCache(v_firstCache[numChan], 0);
+  for(size_t i = 0; i < numChan; i++) {
+    for(size_t nc = 0; nc < v_numChan_[IdChannels[i]]; nc++) {
+      v_signalCache[v_firstCache[i] + nc] = getRTCache(IdChannels[i], nc, tspill);
+      if(signalGain[i].get() < 1.0) {
+        v_imageCache[v_firstCache[i] + nc] = getRTCache(getAssocSpwId(IdChannels[i])[0], nc, tspill);
+      }
+    }
+  }
+
+  double groundWH2O = getGroundWH2O().get<Length::mm>();
+  double pfit_start = getUserWH2O().get<Length::mm>() / groundWH2O;
+  size_t numBlock = (m - n + wvrRetrievalBlock_ - 1) / wvrRetrievalBlock_;
+  std::atomic<size_t> nextBlock(0);
+
+  auto retrieveBlocks = [&]() {
+    // storage of the thread, reused by all its retrievals
+    LevenbergMarquardt fit(1, numChan);
+    vector<double> measured(numChan);
+    vector<Temperature> fitted(numChan);
+    double airm = 1.0;
+
+    fit.setConstraint([](const double *pfit, double *pfit_b) {
+                        if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                      });
+    // mkWaterVaporRetrieval_fromWVR(): every channel of a WVR window, with the image side band for a
+    // signal gain below 1, averaged in the same order as RT()
+    LevenbergMarquardt::Model model = [&](const double *pfit, double *tebb, double *deriv) {
+      double jacobian[3];
+      double jacImage[3];
+      for(size_t i = 0; i < numChan; i++) {
+        double norm = v_numChan_[IdChannels[i]];
+        double gain = signalGain[i].get();
+        tebb[i] = 0.0;
+        deriv[i] = 0.0;
+        for(size_t k = v_firstCache[i]; k < v_firstCache[i + 1]; k++) {
+          double rtr = RT(v_signalCache[k], numLayer_, pfit[0], skyCoupling[i], tspill, airm, jacobian);
+          if(gain < 1.0) {
+            rtr = rtr * gain + RT(v_imageCache[k], numLayer_, pfit[0], skyCoupling[i], tspill, airm, jacImage) * (1.0 - gain);
+            jacobian[0] = jacobian[0] * gain + jacImage[0] * (1.0 - gain);
+          }
+          tebb[i] = tebb[i] + rtr / norm;
+          deriv[i] = deriv[i] + jacobian[0] / norm;
+        }
+      }
+    };
+
+    for(size_t block = nextBlock++; block < numBlock; block = nextBlock++) {
+      double pfit_wh2o = pfit_start;
+      size_t last = std::min(m, n + (block + 1) * wvrRetrievalBlock_);
+      for(size_t j = n + block * wvrRetrievalBlock_; j < last; j++) {
+        WVRMeasurement &measurement = RadiometerData[j];
+        const vector<Temperature> &measuredSkyBrightness = measurement.getmeasuredSkyBrightness();
+        for(size_t i = 0; i < numChan; i++) {
+          measured[i] = measuredSkyBrightness[i].get<Temperature::K>();
+        }
+        airm = 1.0 / sin((3.1415926 * measurement.getElevation().get<Angle::deg>()) / 180.0);
+
+        double pfit = pfit_wh2o;
+        fit.setData(&measured[0]);
+        bool converged = fit.solve(model, &pfit);
+
+        Length wh2o_retrieved = converged ? Length::from<Length::mm>(pfit * groundWH2O)
+                                          : Length::from<Length::mm>(-888); // fit not reached after 20 iterations
+        for(size_t i = 0; i < numChan; i++) {
+          fitted[i] = Temperature::from<Temperature::K>(fit.getModel()[i]);
+        }
+        measurement.setretrievedWaterVaporColumn(wh2o_retrieved);
+        measurement.setfittedSkyBrightness(fitted);
+        measurement.setSigmaFit(Temperature::from<Temperature::K>(fit.getSigma()));
+
+        // the next retrieval starts from this one, as the serial retrievals do through wh2o_user_
+        if(wh2o_retrieved.get() > 0.0) {
+          pfit_wh2o = wh2o_retrieved.get<Length::mm>() / groundWH2O;
+        }
+      }
+    }
+  };
+
+  if(numThread == 0) numThread = std::thread::hardware_concurrency();
+  if(numThread == 0) numThread = 1;
+  if(numThread > numBlock) numThread = numBlock;
+  vector<std::thread> threads;
+  for(unsigned int t = 1; t < numThread; t++) threads.push_back(std::thread(retrieveBlocks));
+  retrieveBlocks();
+  for(size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+  for(size_t j = m; j-- > n;) {
+    if(RadiometerData[j].getretrievedWaterVaporColumn().get() > 0.0) {
+      wh2o_user_ = RadiometerData[j].getretrievedWaterVaporColumn();
+      break;
+    }
+  }
+}
+
 void SkyStatus::updateSkyCoupling_fromWVR(vector<WVRMeasurement> &RadiometerData,
                                           size_t n,
                                           size_t m)
 {
   double pfit;
   double deltaa = 0.02;
-  // double sig_fit = -999.0; // [-Wunused_but_set_variable]
-  double eps = 0.01;
-
-  size_t num;
-  double flamda;
-  size_t niter = 20;
-  double alpha;
-  double beta;
-  double array;
-  double f1;
-  double psave;
-  double f2;
-  double deriv;
-  double chisq1;
-  double chisqr;
-  double pfit_b;
-  double res;
-
-  num = 0;
-
-  flamda = 0.001;
+
   pfit = 0.5;
 
   // Find the maximum of skycoupling on the WVR channels
@@ -3078,70 +3529,34 @@ void SkyStatus::updateSkyCoupling_fromWVR(vector<WVRMeasurement> &RadiometerData
     if (waterVaporRadiometer_.getSkyCoupling()[i]>maxCoupling)
       maxCoupling = waterVaporRadiometer_.getSkyCoupling()[i];
 
-
-  for(size_t kite = 0; kite < niter; kite++) {
-
-    num = num + 1;
-    beta = 0.0;
-    alpha = 0.0;
-
-    if (pfit*maxCoupling>1.5)
-      pfit = 1.-deltaa;
-    f1 = sigmaSkyCouplingRetrieval_fromWVR(pfit,
-                                           waterVaporRadiometer_,
-                                           RadiometerData,
-                                           n,
-                                           m);
-    psave = pfit;
-    pfit = pfit + deltaa;
-    f2 = sigmaSkyCouplingRetrieval_fromWVR(pfit,
-                                           waterVaporRadiometer_,
-                                           RadiometerData,
-                                           n,
-                                           m);
-    deriv = (f2 - f1) / deltaa;
-    pfit = psave;
-    beta = beta - f1 * deriv;
-    alpha = alpha + deriv * deriv;
-    chisq1 = f1 * f1;
-
-    adjust: array = 1.0 / (1.0 + flamda);
-    pfit_b = pfit;
-    pfit_b = pfit_b + beta * array / alpha;
-
-    chisqr = 0.;
-
-    if(pfit_b < 0.0) {
-      pfit_b = 0.9 * pfit;
-    }
-    if (pfit_b*maxCoupling>1.5)
-      pfit_b = 1;
-
-    res = sigmaSkyCouplingRetrieval_fromWVR(pfit_b,
-                                            waterVaporRadiometer_,
-                                            RadiometerData,
-                                            n,
-                                            m);
-    chisqr = chisqr + res * res;
-
-    if(fabs(chisq1 - chisqr) > 0.001) {
-      if(chisq1 < chisqr) {
-        flamda = flamda * 10.0;
-        goto adjust;
-      }
-    }
-
-    flamda = flamda / 10.0;
-    // sig_fit = sqrt(chisqr); // [-Wunused_but_set_variable]
-    pfit = pfit_b;
-
-    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < eps) {
-      goto salir;
-    }
-
-  }
-
-  salir: waterVaporRadiometer_.multiplySkyCoupling(pfit);
+  if (pfit*maxCoupling>1.5)
+    pfit = 1.-deltaa;
+
+  // the average rms of the water vapor retrievals is fitted to 0; its derivative is taken by finite
+  // differences, the point at pfit being done last so that RadiometerData holds its retrievals
+  double zero = 0.0;
+  LevenbergMarquardt fit(1, 1);
+  fit.setData(&zero);
+  fit.setConstraint([maxCoupling](const double *pfit, double *pfit_b) {
+                      if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                      if (pfit_b[0]*maxCoupling>1.5) pfit_b[0] = 1;
+                    });
+  fit.solve([&](const double *par, double *sigma, double *deriv) {
+              double f2 = sigmaSkyCouplingRetrieval_fromWVR(par[0] + deltaa,
+                                                            waterVaporRadiometer_,
+                                                            RadiometerData,
+                                                            n,
+                                                            m);
+              sigma[0] = sigmaSkyCouplingRetrieval_fromWVR(par[0],
+                                                           waterVaporRadiometer_,
+                                                           RadiometerData,
+                                                           n,
+                                                           m);
+              deriv[0] = (f2 - sigma[0]) / deltaa;
+            },
+            &pfit);
+
+  waterVaporRadiometer_.multiplySkyCoupling(pfit);
 
   //    cout << "pfit=" << pfit << "  sky_coupling: " << waterVaporRadiometer_.getSkyCoupling()[0]   << endl;
 
@@ -3154,99 +3569,40 @@ void SkyStatus::updateSkyCouplingChannel_fromWVR(vector<WVRMeasurement> &Radiome
 {
   double pfit;
   double deltaa = 0.02;
-  // double sig_fit = -999.0;    // [-Wunused_but_set_variable]
-  double eps = 0.01;
-
-  size_t num;
-  double flamda;
-  size_t niter = 20;
-  double alpha;
-  double beta;
-  double array;
-  double f1;
-  double psave;
-  double f2;
-  double deriv;
-  double chisq1;
-  double chisqr;
-  double pfit_b;
-  double res;
-
-  num = 0;
-
-  flamda = 0.001;
+
   pfit = 1.00;
 
   // This value is used to assure that the found skycoupling does not exceed 1
   double maxCoupling = waterVaporRadiometer_.getSkyCoupling()[ichan];
 
-
-  for(size_t kite = 0; kite < niter; kite++) {
-
-    num = num + 1;
-    beta = 0.0;
-    alpha = 0.0;
-
-    if (pfit*maxCoupling>1)
-      pfit = 1.-deltaa;
-    f1 = sigmaSkyCouplingChannelRetrieval_fromWVR(pfit,
-						  waterVaporRadiometer_,
-						  RadiometerData,
-						  ichan,
-						  n,
-						  m);
-    psave = pfit;
-    pfit = pfit + deltaa;
-    f2 = sigmaSkyCouplingChannelRetrieval_fromWVR(pfit,
-						  waterVaporRadiometer_,
-						  RadiometerData,
-						  ichan,
-						  n,
-						  m);
-    deriv = (f2 - f1) / deltaa;
-    pfit = psave;
-    beta = beta - f1 * deriv;
-    alpha = alpha + deriv * deriv;
-    chisq1 = f1 * f1;
-
-    adjust: array = 1.0 / (1.0 + flamda);
-    pfit_b = pfit;
-    pfit_b = pfit_b + beta * array / alpha;
-
-    chisqr = 0.;
-
-    if(pfit_b < 0.0) {
-      pfit_b = 0.9 * pfit;
-    }
-    if (pfit_b*maxCoupling>1)
-      pfit_b = 1/maxCoupling;
-
-    res = sigmaSkyCouplingChannelRetrieval_fromWVR(pfit_b,
-						   waterVaporRadiometer_,
-						   RadiometerData,
-						   ichan,
-						   n,
-						   m);
-    chisqr = chisqr + res * res;
-
-    if(fabs(chisq1 - chisqr) > 0.001) {
-      if(chisq1 < chisqr) {
-        flamda = flamda * 10.0;
-        goto adjust;
-      }
-    }
-
-    flamda = flamda / 10.0;
-    // sig_fit = sqrt(chisqr);   // [-Wunused_but_set_variable]
-    pfit = pfit_b;
-
-    if(fabs(sqrt(chisq1) - sqrt(chisqr)) < eps) {
-      goto salir;
-    }
-
-  }
-
- salir: waterVaporRadiometer_.multiplySkyCouplingChannel(ichan, pfit);
+  if (pfit*maxCoupling>1)
+    pfit = 1.-deltaa;
+
+  double zero = 0.0;
+  LevenbergMarquardt fit(1, 1);
+  fit.setData(&zero);
+  fit.setConstraint([maxCoupling](const double *pfit, double *pfit_b) {
+                      if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                      if (pfit_b[0]*maxCoupling>1) pfit_b[0] = 1/maxCoupling;
+                    });
+  fit.solve([&](const double *par, double *sigma, double *deriv) {
+              double f2 = sigmaSkyCouplingChannelRetrieval_fromWVR(par[0] + deltaa,
+                                                                   waterVaporRadiometer_,
+                                                                   RadiometerData,
+                                                                   ichan,
+                                                                   n,
+                                                                   m);
+              sigma[0] = sigmaSkyCouplingChannelRetrieval_fromWVR(par[0],
+                                                                  waterVaporRadiometer_,
+                                                                  RadiometerData,
+                                                                  ichan,
+                                                                  n,
+                                                                  m);
+              deriv[0] = (f2 - sigma[0]) / deltaa;
+            },
+            &pfit);
+
+  waterVaporRadiometer_.multiplySkyCouplingChannel(ichan, pfit);
 
   //    cout << "pfit=" << pfit << "  sky_coupling: " << waterVaporRadiometer_.getSkyCoupling()[0]   << endl;
 
@@ -3284,7 +3640,7 @@ double SkyStatus::sigmaSkyCouplingRetrieval_fromWVR(double par_fit,
 
   }
 
-  return getWVRAverageSigmaTskyFit(RadiometerData, n, m).get("K");
+  return getWVRAverageSigmaTskyFit(RadiometerData, n, m).get<Temperature::K>();
 
 }
 
@@ -3320,8 +3676,8 @@ double SkyStatus::sigmaSkyCouplingChannelRetrieval_fromWVR(double par_fit,
 
   }
 
-  return getWVRAverageSigmaTskyFit(RadiometerData, n, m).get("K");
-  // return getWVRSigmaChannelTskyFit(RadiometerData, ichan, n, m).get("K");
+  return getWVRAverageSigmaTskyFit(RadiometerData, n, m).get<Temperature::K>();
+  // return getWVRSigmaChannelTskyFit(RadiometerData, ichan, n, m).get<Temperature::K>();
 
 }
 
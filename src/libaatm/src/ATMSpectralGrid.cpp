@@ -330,7 +330,7 @@ SpectralGrid::SpectralGrid(const std::vector<double> &chanFreq, const std::strin
   v_chanFreq_.reserve(chanFreq.size());
   freqUnits_ = "Hz";
   v_transfertId_.resize(0); // not sure this is necessary!
-  double refFreq = (Frequency(chanFreq[0], freqUnits)).get("Hz"); // We take the frequency of the first channel as
+  double refFreq = (Frequency(chanFreq[0], freqUnits)).get<Frequency::Hz>(); // We take the frequency of the first channel as
   // reference frequency because it has not been specified
   add(chanFreq.size(), refFreq, chanFreq, freqUnits);
   std::vector<size_t> v_dummyInt;
@@ -344,11 +344,11 @@ SpectralGrid::SpectralGrid(const std::vector<Frequency> &chanFreq)
   v_chanFreq_.reserve(chanFreq.size());
   freqUnits_ = "Hz";
   v_transfertId_.resize(0); // not sure this is necessary!
-  double refFreq = chanFreq[0].get("Hz"); // We take the frequency of the first channel as
+  double refFreq = chanFreq[0].get<Frequency::Hz>(); // We take the frequency of the first channel as
   // reference frequency because it has not been specified
   std::vector<double> chanFreq_double;
   for(size_t i = 0; i < chanFreq.size(); i++) {
-    chanFreq_double.push_back(chanFreq[i].get("GHz"));
+    chanFreq_double.push_back(chanFreq[i].get<Frequency::GHz>());
   }
 
   add(chanFreq.size(), refFreq, chanFreq_double, "GHz");
@@ -548,27 +548,27 @@ size_t SpectralGrid::getRefChan(size_t spwId) const
 
 Frequency SpectralGrid::getRefFreq() const
 {
-  return Frequency(v_refFreq_[0], "Hz");
+  return Frequency::from<Frequency::Hz>(v_refFreq_[0]);
 }
 Frequency SpectralGrid::getRefFreq(size_t spwId) const
 {
   if(wrongSpwId(spwId)) return 32767.;
-  return Frequency(v_refFreq_[spwId], "Hz");
+  return Frequency::from<Frequency::Hz>(v_refFreq_[spwId]);
 }
 
 Frequency SpectralGrid::getChanSep() const
 {
-  return Frequency(v_chanSep_[0], "Hz");
+  return Frequency::from<Frequency::Hz>(v_chanSep_[0]);
 }
 Frequency SpectralGrid::getChanSep(size_t spwId) const
 {
   if(wrongSpwId(spwId)) return 32767.;
-  return Frequency(v_chanSep_[spwId], "Hz");
+  return Frequency::from<Frequency::Hz>(v_chanSep_[spwId]);
 }
 
 Frequency SpectralGrid::getChanFreq(size_t i) const
 {
-  return Frequency(v_chanFreq_[i], "Hz");
+  return Frequency::from<Frequency::Hz>(v_chanFreq_[i]);
 }
 
 Frequency SpectralGrid::getChanWidth(size_t i) const
@@ -583,7 +583,7 @@ Frequency SpectralGrid::getChanWidth(size_t i) const
 Frequency SpectralGrid::getChanFreq(size_t spwId, size_t chanIdx) const
 {
   if(wrongSpwId(spwId)) return 32767.;
-  return Frequency(v_chanFreq_[v_transfertId_[spwId] + chanIdx], "Hz");
+  return Frequency::from<Frequency::Hz>(v_chanFreq_[v_transfertId_[spwId] + chanIdx]);
 }
 
 Frequency SpectralGrid::getChanWidth(size_t spwId, size_t chanIdx) const
@@ -599,8 +599,8 @@ Frequency SpectralGrid::getChanWidth(size_t spwId, size_t chanIdx) const
   if(chanIdx == 0){
     return getChanFreq(spwId,canalmasuno)-getChanFreq(spwId,canal);
   }else{
-    //  cout << "ChanFreq(" << banda << "," << canal << ")=" << getChanFreq(banda,canal).get("GHz") << endl;
-    //  cout << "ChanFreq(" << banda << "," << canalmenosuno << ")=" << getChanFreq(banda,canalmenosuno).get("GHz") << endl;
+    //  cout << "ChanFreq(" << banda << "," << canal << ")=" << getChanFreq(banda,canal).get<Frequency::GHz>() << endl;
+    //  cout << "ChanFreq(" << banda << "," << canalmenosuno << ")=" << getChanFreq(banda,canalmenosuno).get<Frequency::GHz>() << endl;
     return getChanFreq(banda,canal)-getChanFreq(banda,canalmenosuno);
   }
 }
@@ -633,22 +633,22 @@ std::vector<double> SpectralGrid::getSpectralWindow(size_t spwId) const
 
 Frequency SpectralGrid::getMinFreq() const
 {
-  return Frequency(v_minFreq_[0], "Hz");
+  return Frequency::from<Frequency::Hz>(v_minFreq_[0]);
 }
 Frequency SpectralGrid::getMinFreq(size_t spwId) const
 {
   if(wrongSpwId(spwId)) return 32767.;
-  return Frequency(v_minFreq_[spwId], "Hz");
+  return Frequency::from<Frequency::Hz>(v_minFreq_[spwId]);
 }
 
 Frequency SpectralGrid::getMaxFreq() const
 {
-  return Frequency(v_maxFreq_[0], "Hz");
+  return Frequency::from<Frequency::Hz>(v_maxFreq_[0]);
 }
 Frequency SpectralGrid::getMaxFreq(size_t spwId) const
 {
   if(wrongSpwId(spwId)) return 32767.;
-  return Frequency(v_maxFreq_[spwId], "Hz");
+  return Frequency::from<Frequency::Hz>(v_maxFreq_[spwId]);
 }
 
 double SpectralGrid::getChanNum(double freq) const
@@ -689,13 +689,13 @@ double SpectralGrid::getChanNum(size_t spwId, double freq) const
 
 Frequency SpectralGrid::getBandwidth() const
 {
-  return Frequency(v_maxFreq_[0] - v_minFreq_[0], "Hz");
+  return Frequency::from<Frequency::Hz>(v_maxFreq_[0] - v_minFreq_[0]);
 }
 
 Frequency SpectralGrid::getBandwidth(size_t spwId) const
 {
   if(wrongSpwId(spwId)) return 32767.;
-  return Frequency(v_maxFreq_[spwId] - v_minFreq_[spwId], "Hz");
+  return Frequency::from<Frequency::Hz>(v_maxFreq_[spwId] - v_minFreq_[spwId]);
 }
 
 bool SpectralGrid::isRegular() const
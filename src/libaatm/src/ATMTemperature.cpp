@@ -41,13 +41,13 @@ Temperature::Temperature(double temperature) :
 Temperature::Temperature(double temperature, const string &units)
 {
   if(units == "mK" || units == "mk") {
-    valueIS_ = 1.0E-3 * temperature;
+    valueIS_ = mK::toIS(temperature);
   } else if(units == "K" || units == "k") {
-    valueIS_ = temperature;
+    valueIS_ = K::toIS(temperature);
   } else if(units == "C" || units == "c") {
-    valueIS_ = temperature + 273.16;
+    valueIS_ = C::toIS(temperature);
   } else if(units == "F" || units == "f") {
-    valueIS_ = (temperature-32.0)*(5./9.)+273.16;
+    valueIS_ = F::toIS(temperature);
   } else {
     // Exception: Unknown temperature unit. S.I. used (Kelvin)
     valueIS_ = temperature;
@@ -57,13 +57,13 @@ Temperature::Temperature(double temperature, const string &units)
 double Temperature::get(const string &units) const
 {
   if(units == "mK") {
-    return 1.0E3 * valueIS_;
+    return mK::fromIS(valueIS_);
   } else if(units == "K") {
-    return valueIS_;
+    return K::fromIS(valueIS_);
   } else if(units == "C" || units == "c") {
-    return valueIS_ - 273.16;
+    return C::fromIS(valueIS_);
   } else if(units == "F" || units == "f") {
-    return (valueIS_ - 273.16)*(9./5.)+32.0;
+    return F::fromIS(valueIS_);
   } else {
     // Exception: Unknown temperature unit. S.I. used (Kelvin)
     return valueIS_;
@@ -0,0 +1,345 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMWVRInversionTable.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMWVRInversionTable.h"
+
+#include <math.h>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+WVRInversionTable::WVRInversionTable(const SkyStatus &skyStatus,
+                                     const Length &maxWH2O,
+                                     const Length &wh2oStep,
+                                     const Angle &minElevation,
+                                     double airMassStep) :
+  ownRadiometer_(true), waterVaporRadiometer_(skyStatus.getWaterVaporRadiometer()), retriever_(skyStatus)
+{
+  init(skyStatus, maxWH2O, wh2oStep, minElevation, airMassStep);
+}
+
+WVRInversionTable::WVRInversionTable(const SkyStatus &skyStatus,
+                                     const WaterVaporRadiometer &waterVaporRadiometer,
+                                     const Length &maxWH2O,
+                                     const Length &wh2oStep,
+                                     const Angle &minElevation,
+                                     double airMassStep) :
+  ownRadiometer_(false), waterVaporRadiometer_(waterVaporRadiometer), retriever_(skyStatus, waterVaporRadiometer)
+{
+  init(skyStatus, maxWH2O, wh2oStep, minElevation, airMassStep);
+}
+
+WVRInversionTable::~WVRInversionTable()
+{
+}
+
+void WVRInversionTable::init(const SkyStatus &skyStatus,
+                             const Length &maxWH2O,
+                             const Length &wh2oStep,
+                             const Angle &minElevation,
+                             double airMassStep)
+{
+  maxWH2O_ = maxWH2O.get<Length::mm>();
+  wh2oStep_ = wh2oStep.get<Length::mm>();
+  maxAirMass_ = 1.0 / sin((3.1415926 * minElevation.get<Angle::deg>()) / 180.0);
+  airMassStep_ = airMassStep;
+
+  // the grid covers the largest column and air mass asked for; the Hermite spline needs two columns, the
+  // Lagrange polynomial four air masses
+  numWH2O_ = (size_t) ceil(maxWH2O_ / wh2oStep_ - 1e-9) + 1;
+  if(numWH2O_ < 2) numWH2O_ = 2;
+  numAirMass_ = (size_t) ceil((maxAirMass_ - 1.0) / airMassStep_ - 1e-9) + 1;
+  if(numAirMass_ < 4) numAirMass_ = 4;
+
+  groundPressureThreshold_ = 1.0;
+  groundTemperatureThreshold_ = 1.0;
+  relativeHumidityThreshold_ = 5.0;
+  numBuild_ = 0;
+
+  build(skyStatus);
+}
+
+void WVRInversionTable::setThresholds(const Pressure &groundPressureThreshold,
+                                      const Temperature &groundTemperatureThreshold,
+                                      const Humidity &relativeHumidityThreshold)
+{
+  groundPressureThreshold_ = groundPressureThreshold.get<Pressure::mb>();
+  groundTemperatureThreshold_ = groundTemperatureThreshold.get<Temperature::K>();
+  relativeHumidityThreshold_ = relativeHumidityThreshold.get<Humidity::percent>();
+}
+
+bool WVRInversionTable::update(const SkyStatus &skyStatus)
+{
+  if(!isStale(skyStatus)) return false;
+
+  if(ownRadiometer_) {
+    waterVaporRadiometer_ = skyStatus.getWaterVaporRadiometer();
+    retriever_ = WVRStreamRetriever(skyStatus);
+  } else {
+    retriever_ = WVRStreamRetriever(skyStatus, waterVaporRadiometer_);
+  }
+  build(skyStatus);
+  return true;
+}
+
+bool WVRInversionTable::isStale(const SkyStatus &skyStatus) const
+{
+  if(ownRadiometer_) {
+    const WaterVaporRadiometer wvr = skyStatus.getWaterVaporRadiometer();
+    if(wvr.getIdChannels() != waterVaporRadiometer_.getIdChannels()) return true;
+    if(wvr.getSkyCoupling() != waterVaporRadiometer_.getSkyCoupling()) return true;
+    if(wvr.getSpilloverTemperature().get() != waterVaporRadiometer_.getSpilloverTemperature().get()) return true;
+    for(size_t i = 0; i < numChan_; i++) {
+      if(wvr.getsignalGain()[i].get() != waterVaporRadiometer_.getsignalGain()[i].get()) return true;
+    }
+  }
+  if(skyStatus.getSkyBackgroundTemperature().get<Temperature::K>() != skyBackgroundTemperature_) return true;
+  if(skyStatus.getProfileVersion() == profileVersion_) return false;
+
+  // the layers have changed: the small changes of the ground conditions are ignored, up to the thresholds
+  if(skyStatus.getNumLayer() != numLayer_) return true;
+  if(skyStatus.getAltitude().get<Length::m>() != altitude_) return true;
+  if(skyStatus.getTropoLapseRate() != tropoLapseRate_) return true;
+  if(skyStatus.getWvScaleHeight().get<Length::m>() != wvScaleHeight_) return true;
+  if(fabs(skyStatus.getGroundPressure().get<Pressure::mb>() - groundPressure_) > groundPressureThreshold_) return true;
+  if(fabs(skyStatus.getGroundTemperature().get<Temperature::K>() - groundTemperature_) > groundTemperatureThreshold_) return true;
+  if(fabs(skyStatus.getRelativeHumidity().get<Humidity::percent>() - relativeHumidity_) > relativeHumidityThreshold_) return true;
+  return false;
+}
+
+void WVRInversionTable::build(const SkyStatus &skyStatus)
+{
+  numChan_ = waterVaporRadiometer_.getIdChannels().size();
+  v_tebb_.resize(numAirMass_ * numWH2O_ * numChan_);
+  v_dTebb_.resize(numAirMass_ * numWH2O_ * numChan_);
+  for(size_t j = 0; j < numAirMass_; j++) {
+    double airmass = 1.0 + j * airMassStep_;
+    for(size_t k = 0; k < numWH2O_; k++) {
+      size_t offset = (j * numWH2O_ + k) * numChan_;
+      retriever_.getTebbSky(Length::from<Length::mm>(k * wh2oStep_), airmass, &v_tebb_[offset], &v_dTebb_[offset]);
+    }
+  }
+
+  profileVersion_ = skyStatus.getProfileVersion();
+  numLayer_ = skyStatus.getNumLayer();
+  altitude_ = skyStatus.getAltitude().get<Length::m>();
+  groundPressure_ = skyStatus.getGroundPressure().get<Pressure::mb>();
+  groundTemperature_ = skyStatus.getGroundTemperature().get<Temperature::K>();
+  relativeHumidity_ = skyStatus.getRelativeHumidity().get<Humidity::percent>();
+  tropoLapseRate_ = skyStatus.getTropoLapseRate();
+  wvScaleHeight_ = skyStatus.getWvScaleHeight().get<Length::m>();
+  skyBackgroundTemperature_ = skyStatus.getSkyBackgroundTemperature().get<Temperature::K>();
+  numBuild_++;
+
+  mkAccuracy();
+}
+
+void WVRInversionTable::mkAccuracy()
+{
+  // about 16 columns by 8 air masses, half way between those of the grid
+  size_t strideWH2O = (numWH2O_ - 1) / 16 > 1 ? (numWH2O_ - 1) / 16 : 1;
+  size_t strideAirMass = (numAirMass_ - 1) / 8 > 1 ? (numAirMass_ - 1) / 8 : 1;
+  vector<double> tebb(numChan_);
+  vector<double> tebbFit(numChan_);
+  vector<Temperature> v_tebb(numChan_);
+  double sumError = 0.0;
+
+  numCheck_ = 0;
+  maxError_ = 0.0;
+  maxTebbError_ = 0.0;
+  for(size_t j = 0; j + 1 < numAirMass_; j += strideAirMass) {
+    double airmass = 1.0 + (j + 0.5) * airMassStep_;
+    Angle elevation = Angle::from<Angle::deg>(asin(1.0 / airmass) * 180.0 / 3.1415926);
+    for(size_t k = 0; k + 1 < numWH2O_; k += strideWH2O) {
+      double wh2o = (k + 0.5) * wh2oStep_;
+      retriever_.getTebbSky(Length::from<Length::mm>(wh2o), airmass, &tebb[0], 0);
+
+      // the fit of SkyStatus::mkWaterVaporRetrieval_fromWVR(), started from the column of the SkyStatus
+      for(size_t i = 0; i < numChan_; i++) v_tebb[i] = Temperature::from<Temperature::K>(tebb[i]);
+      WVRMeasurement measurement(elevation, v_tebb);
+      retriever_.reset();
+      if(!retriever_.retrieve(0.0, measurement)) continue;
+      double wh2oFit = measurement.getretrievedWaterVaporColumn().get<Length::mm>();
+
+      double wh2oTable = getWH2O(&tebb[0], 1.0 / sin((3.1415926 * elevation.get<Angle::deg>()) / 180.0), 0);
+      double error = fabs(wh2oTable - wh2oFit);
+      if(error > maxError_) maxError_ = error;
+      sumError = sumError + error * error;
+
+      size_t first;
+      double weight[4];
+      getAirMassWeights(airmass, first, weight);
+      for(size_t i = 0; i < numChan_; i++) {
+        double deriv;
+        double tebbError = fabs(mkTebb(i, wh2o, first, weight, deriv) - tebb[i]);
+        if(tebbError > maxTebbError_) maxTebbError_ = tebbError;
+      }
+      numCheck_++;
+    }
+  }
+  rmsError_ = numCheck_ > 0 ? sqrt(sumError / numCheck_) : 0.0;
+}
+
+bool WVRInversionTable::getAirMassWeights(double airmass, size_t &first, double *weight) const
+{
+  double x = (airmass - 1.0) / airMassStep_;
+  if(x < -1e-9 || x > numAirMass_ - 1 + 1e-9) return false;
+
+  // the four air masses around airmass, shifted inside the table at its edges
+  size_t j = x > 0.0 ? (size_t) x : 0;
+  first = j > 0 ? j - 1 : 0;
+  if(first + 4 > numAirMass_) first = numAirMass_ - 4;
+  double u = x - first;
+  weight[0] = -(u - 1.0) * (u - 2.0) * (u - 3.0) / 6.0;
+  weight[1] = u * (u - 2.0) * (u - 3.0) / 2.0;
+  weight[2] = -u * (u - 1.0) * (u - 3.0) / 2.0;
+  weight[3] = u * (u - 1.0) * (u - 2.0) / 6.0;
+  return true;
+}
+
+double WVRInversionTable::mkTebb(size_t chan, double wh2o, size_t first, const double *weight, double &deriv) const
+{
+  size_t k = wh2o > 0.0 ? (size_t) (wh2o / wh2oStep_) : 0;
+  if(k > numWH2O_ - 2) k = numWH2O_ - 2;
+  double t = wh2o / wh2oStep_ - k;
+
+  // values and derivatives at the columns k and k+1, at the air mass
+  double tebb0 = 0.0, tebb1 = 0.0, deriv0 = 0.0, deriv1 = 0.0;
+  for(size_t l = 0; l < 4; l++) {
+    size_t offset = ((first + l) * numWH2O_ + k) * numChan_ + chan;
+    tebb0 = tebb0 + weight[l] * v_tebb_[offset];
+    deriv0 = deriv0 + weight[l] * v_dTebb_[offset];
+    tebb1 = tebb1 + weight[l] * v_tebb_[offset + numChan_];
+    deriv1 = deriv1 + weight[l] * v_dTebb_[offset + numChan_];
+  }
+  deriv0 = deriv0 * wh2oStep_;
+  deriv1 = deriv1 * wh2oStep_;
+
+  // cubic Hermite spline
+  double t2 = t * t;
+  double t3 = t2 * t;
+  deriv = ((6.0 * t2 - 6.0 * t) * (tebb0 - tebb1) + (3.0 * t2 - 4.0 * t + 1.0) * deriv0 + (3.0 * t2 - 2.0 * t) * deriv1)
+          / wh2oStep_;
+  return (2.0 * t3 - 3.0 * t2 + 1.0) * tebb0 + (t3 - 2.0 * t2 + t) * deriv0 + (-2.0 * t3 + 3.0 * t2) * tebb1
+         + (t3 - t2) * deriv1;
+}
+
+double WVRInversionTable::getWH2O(const double *tebbSky, double airmass, double *tebbFit) const
+{
+  size_t first;
+  double weight[4];
+  if(!getAirMassWeights(airmass, first, weight)) return -999.0;
+
+  // the column of the grid with the smallest squared residuals
+  size_t kbest = 0;
+  double chisqBest = -1.0;
+  for(size_t k = 0; k < numWH2O_; k++) {
+    double chisq = 0.0;
+    for(size_t i = 0; i < numChan_; i++) {
+      double tebb = 0.0;
+      for(size_t l = 0; l < 4; l++) tebb = tebb + weight[l] * v_tebb_[((first + l) * numWH2O_ + k) * numChan_ + i];
+      chisq = chisq + (tebbSky[i] - tebb) * (tebbSky[i] - tebb);
+    }
+    if(chisqBest < 0.0 || chisq < chisqBest) {
+      chisqBest = chisq;
+      kbest = k;
+    }
+  }
+
+  // Gauss-Newton steps on the spline, kept inside the table
+  double wh2o = kbest * wh2oStep_;
+  double maxWH2O = (numWH2O_ - 1) * wh2oStep_;
+  bool onEdge = false;
+  for(size_t iter = 0; iter < 10; iter++) {
+    double beta = 0.0;
+    double alpha = 0.0;
+    for(size_t i = 0; i < numChan_; i++) {
+      double deriv;
+      double tebb = mkTebb(i, wh2o, first, weight, deriv);
+      beta = beta + (tebbSky[i] - tebb) * deriv;
+      alpha = alpha + deriv * deriv;
+    }
+    if(alpha <= 0.0) break;
+    double step = beta / alpha;
+    double next = wh2o + step;
+    onEdge = next < 0.0 || next > maxWH2O;
+    if(next < 0.0) next = 0.0;
+    if(next > maxWH2O) next = maxWH2O;
+    step = next - wh2o;
+    wh2o = next;
+    if(fabs(step) < 1e-7) break;
+  }
+
+  // a solution held on an edge of the table is not a minimum of the residuals
+  if(onEdge) return -888.0;
+
+  if(tebbFit) {
+    for(size_t i = 0; i < numChan_; i++) {
+      double deriv;
+      tebbFit[i] = mkTebb(i, wh2o, first, weight, deriv);
+    }
+  }
+  return wh2o;
+}
+
+Length WVRInversionTable::getWH2O(const vector<Temperature> &tebbSky, const Angle &elevation) const
+{
+  vector<double> tebb(numChan_);
+  for(size_t i = 0; i < numChan_ && i < tebbSky.size(); i++) tebb[i] = tebbSky[i].get<Temperature::K>();
+  return Length::from<Length::mm>(getWH2O(&tebb[0], 1.0 / sin((3.1415926 * elevation.get<Angle::deg>()) / 180.0), 0));
+}
+
+bool WVRInversionTable::retrieve(const SkyStatus &skyStatus, WVRMeasurement &measurement)
+{
+  update(skyStatus);
+  return retrieve(measurement);
+}
+
+bool WVRInversionTable::retrieve(WVRMeasurement &measurement) const
+{
+  const vector<Temperature> &measuredSkyBrightness = measurement.getmeasuredSkyBrightness();
+  vector<double> tebb(numChan_);
+  vector<double> tebbFit(numChan_, -999.0);
+  for(size_t i = 0; i < numChan_ && i < measuredSkyBrightness.size(); i++) {
+    tebb[i] = measuredSkyBrightness[i].get<Temperature::K>();
+  }
+  double airmass = 1.0 / sin((3.1415926 * measurement.getElevation().get<Angle::deg>()) / 180.0);
+  double wh2o = getWH2O(&tebb[0], airmass, &tebbFit[0]);
+
+  // rms of the fit as that of the Levenberg-Marquardt retrievals
+  double chisq = 0.0;
+  vector<Temperature> fitted(numChan_);
+  for(size_t i = 0; i < numChan_; i++) {
+    chisq = chisq + (tebb[i] - tebbFit[i]) * (tebb[i] - tebbFit[i]);
+    fitted[i] = Temperature::from<Temperature::K>(tebbFit[i]);
+  }
+  measurement.setretrievedWaterVaporColumn(Length::from<Length::mm>(wh2o));
+  measurement.setfittedSkyBrightness(fitted);
+  measurement.setSigmaFit(Temperature::from<Temperature::K>(wh2o < 0.0 ? -999.0 : sqrt(chisq / (numChan_ > 1 ? numChan_ - 1.0 : 1.0))));
+  return wh2o >= 0.0;
+}
+
+ATM_NAMESPACE_END
@@ -41,10 +41,10 @@ WVRMeasurement::WVRMeasurement(const Angle &elevation,
 {
   elevation_ = elevation;
   v_measuredSkyBrightness_ = measuredSkyBrightness;
-  retrievedWaterVaporColumn_ = Length(-999, "mm"); // !< Retrieved zenith water vapor column for each event
-  sigma_fittedSkyBrightness_ = Temperature(-999, "K"); // !< Sigma on the fitted sky brightness temperatures (average sigma over the WVR channels for each event).
+  retrievedWaterVaporColumn_ = Length::from<Length::mm>(-999); // !< Retrieved zenith water vapor column for each event
+  sigma_fittedSkyBrightness_ = Temperature::from<Temperature::K>(-999); // !< Sigma on the fitted sky brightness temperatures (average sigma over the WVR channels for each event).
   for(size_t i = 0; i < v_measuredSkyBrightness_.size(); i++) {
-    v_fittedSkyBrightness_.push_back(Temperature(-999, "K"));
+    v_fittedSkyBrightness_.push_back(Temperature::from<Temperature::K>(-999));
   } // !< Fitted sky brightness temperatures over all WVR channels for each event
 }
 WVRMeasurement::WVRMeasurement(const Angle &elevation,
@@ -0,0 +1,201 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimiter Array
+ * (c) Instituto de Estructura de la Materia, 2009
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * "@(#) $Id: ATMWVRStreamRetriever.cpp Exp $"
+ *
+ * who       when      what
+ * --------  --------  ----------------------------------------------
+ * agent     19/10/26  created
+ */
+
+#include "ATMWVRStreamRetriever.h"
+
+#include <iostream>
+#include <math.h>
+
+
+
+ATM_NAMESPACE_BEGIN
+
+WVRStreamRetriever::WVRStreamRetriever(const SkyStatus &skyStatus) :
+  fit_(1, skyStatus.getWaterVaporRadiometer().getIdChannels().size())
+{
+  init(skyStatus, skyStatus.getWaterVaporRadiometer());
+}
+
+WVRStreamRetriever::WVRStreamRetriever(const SkyStatus &skyStatus,
+                                       const WaterVaporRadiometer &waterVaporRadiometer) :
+  fit_(1, waterVaporRadiometer.getIdChannels().size())
+{
+  init(skyStatus, waterVaporRadiometer);
+}
+
+WVRStreamRetriever::~WVRStreamRetriever()
+{
+}
+
+void WVRStreamRetriever::init(const SkyStatus &skyStatus, const WaterVaporRadiometer &waterVaporRadiometer)
+{
+  vector<size_t> IdChannels = waterVaporRadiometer.getIdChannels();
+  vector<Percent> signalGain = waterVaporRadiometer.getsignalGain();
+  double tbgr = skyStatus.getSkyBackgroundTemperature().get<Temperature::K>();
+
+  numChan_ = IdChannels.size();
+  numLayer_ = skyStatus.getNumLayer();
+  groundWH2O_ = skyStatus.getGroundWH2O().get<Length::mm>();
+  startPfit_ = skyStatus.getUserWH2O().get<Length::mm>() / groundWH2O_;
+  tspill_ = waterVaporRadiometer.getSpilloverTemperature().get<Temperature::K>();
+  v_skyCoupling_ = waterVaporRadiometer.getSkyCoupling();
+  v_signalGain_.resize(numChan_);
+
+  // the RT-ready data of every channel of the WVR windows, and of their image side bands, as the SkyStatus
+  // builds them for RT()
+  v_firstCache_.assign(numChan_ + 1, 0);
+  for(size_t i = 0; i < numChan_; i++) {
+    v_signalGain_[i] = signalGain[i].get();
+    v_firstCache_[i + 1] = v_firstCache_[i] + skyStatus.getNumChan(IdChannels[i]);
+  }
+  vv_signalCache_.resize(v_firstCache_[numChan_]);
+  vv_imageCache_.resize(v_firstCache_[numChan_]);
+  for(size_t i = 0; i < numChan_; i++) {
+    for(size_t nc = 0; nc < skyStatus.getNumChan(IdChannels[i]); nc++) {
+      vector<double> &signalCache = vv_signalCache_[v_firstCache_[i] + nc];
+      skyStatus.mkRTCache(IdChannels[i], nc, signalCache);
+      SkyStatus::setRTCacheTemperatures(tbgr, tspill_, &signalCache[0]);
+      if(v_signalGain_[i] < 1.0) {
+        vector<double> &imageCache = vv_imageCache_[v_firstCache_[i] + nc];
+        skyStatus.mkRTCache(skyStatus.getAssocSpwId(IdChannels[i])[0], nc, imageCache);
+        SkyStatus::setRTCacheTemperatures(tbgr, tspill_, &imageCache[0]);
+      }
+    }
+  }
+
+  linearPredictor_ = false;
+  maxGap_ = 10.0;
+  v_measured_.resize(numChan_);
+  v_fitted_.resize(numChan_);
+  airm_ = 1.0;
+  fit_.setConstraint([](const double *pfit, double *pfit_b) {
+                       if(pfit_b[0] < 0.0) pfit_b[0] = 0.9 * pfit[0];
+                     });
+  reset();
+  numSample_ = 0;
+  numFailure_ = 0;
+  totalNumEvaluation_ = 0;
+}
+
+void WVRStreamRetriever::reset()
+{
+  numSolution_ = 0;
+  time_ = 0.0;
+  pfit_ = startPfit_;
+  slope_ = 0.0;
+  settings_ = LevenbergMarquardt::Settings();
+}
+
+bool WVRStreamRetriever::retrieve(double time, WVRMeasurement &measurement)
+{
+  const vector<Temperature> &measuredSkyBrightness = measurement.getmeasuredSkyBrightness();
+  if(measuredSkyBrightness.size() < numChan_) {
+    std::cout << " WVRStreamRetriever: ERROR: " << measuredSkyBrightness.size()
+              << " sky brightness temperatures for " << numChan_ << " WVR channels" << std::endl;
+    return false;
+  }
+  for(size_t i = 0; i < numChan_; i++) {
+    v_measured_[i] = measuredSkyBrightness[i].get<Temperature::K>();
+  }
+  airm_ = 1.0 / sin((3.1415926 * measurement.getElevation().get<Angle::deg>()) / 180.0);
+
+  // starting point: the previous solution, or its extrapolation, unless the stream has been interrupted
+  if(numSolution_ > 0 && (time <= time_ || time - time_ > maxGap_)) reset();
+  double pfit = pfit_;
+  if(linearPredictor_ && numSolution_ > 1) {
+    double predicted = pfit_ + slope_ * (time - time_);
+    if(predicted > 0.0) pfit = predicted;
+  }
+
+  fit_.setSettings(settings_);
+  fit_.setData(&v_measured_[0]);
+  bool converged = fit_.solve([this](const double *p, double *tebb, double *deriv) { mkModel(p, airm_, tebb, deriv); },
+                              &pfit);
+  const LevenbergMarquardt::Statistics &statistics = fit_.getStatistics();
+
+  numSample_++;
+  totalNumEvaluation_ = totalNumEvaluation_ + statistics.numEvaluation;
+  if(converged) {
+    // the rate of change is smoothed: from one sample to the next, it is mostly that of the noise
+    if(numSolution_ > 0) slope_ = 0.9 * slope_ + 0.1 * (pfit - pfit_) / (time - time_);
+    pfit_ = pfit;
+    time_ = time;
+    numSolution_++;
+    // the next fit starts from the damping this one has ended with
+    settings_.initialDamping = statistics.damping;
+    if(settings_.initialDamping < minDamping_) settings_.initialDamping = minDamping_;
+    if(settings_.initialDamping > maxDamping_) settings_.initialDamping = maxDamping_;
+  } else {
+    numFailure_++;
+    settings_.initialDamping = LevenbergMarquardt::Settings().initialDamping;
+  }
+
+  for(size_t i = 0; i < numChan_; i++) {
+    v_fitted_[i] = Temperature::from<Temperature::K>(fit_.getModel()[i]);
+  }
+  measurement.setretrievedWaterVaporColumn(converged ? Length::from<Length::mm>(pfit * groundWH2O_)
+                                                     : Length::from<Length::mm>(-888));
+  measurement.setfittedSkyBrightness(v_fitted_);
+  measurement.setSigmaFit(Temperature::from<Temperature::K>(fit_.getSigma()));
+
+  return converged;
+}
+
+void WVRStreamRetriever::getTebbSky(const Length &wh2o, double airmass, double *tebbSky, double *dTebb_dWH2O) const
+{
+  double pfit = wh2o.get<Length::mm>() / groundWH2O_;
+  vector<double> deriv(numChan_);
+  mkModel(&pfit, airmass, tebbSky, &deriv[0]);
+  if(dTebb_dWH2O) {
+    for(size_t i = 0; i < numChan_; i++) dTebb_dWH2O[i] = deriv[i] / groundWH2O_;
+  }
+}
+
+void WVRStreamRetriever::mkModel(const double *pfit, double airm, double *tebb, double *deriv) const
+{
+  double jacobian[3];
+  double jacImage[3];
+
+  // as SkyStatus::RT() for a WVR channel: the channels of the window averaged, with the image side band
+  // for a signal gain below 1
+  for(size_t i = 0; i < numChan_; i++) {
+    double norm = v_firstCache_[i + 1] - v_firstCache_[i];
+    double gain = v_signalGain_[i];
+    tebb[i] = 0.0;
+    deriv[i] = 0.0;
+    for(size_t k = v_firstCache_[i]; k < v_firstCache_[i + 1]; k++) {
+      double rtr = SkyStatus::RT(&vv_signalCache_[k][0], numLayer_, pfit[0], v_skyCoupling_[i], tspill_, airm, jacobian);
+      if(gain < 1.0) {
+        rtr = rtr * gain + SkyStatus::RT(&vv_imageCache_[k][0], numLayer_, pfit[0], v_skyCoupling_[i], tspill_, airm,
+                                         jacImage) * (1.0 - gain);
+        jacobian[0] = jacobian[0] * gain + jacImage[0] * (1.0 - gain);
+      }
+      tebb[i] = tebb[i] + rtr / norm;
+      deriv[i] = deriv[i] + jacobian[0] / norm;
+    }
+  }
+}
+
+ATM_NAMESPACE_END
@@ -37,10 +37,10 @@ ATM_NAMESPACE_BEGIN
 WaterVaporRadiometer::WaterVaporRadiometer(const std::vector<size_t> &IdChannels)
 {
 
-  spilloverTemperature_ = Temperature(-999.0, "K");
+  spilloverTemperature_ = Temperature::from<Temperature::K>(-999.0);
   IdChannels_ = IdChannels;
 
-  Percent sg(50, "%"); // IF DOUBLE SIDE BAND, Default Sideband Gain is 50%
+  Percent sg = Percent::from<Percent::percent>(50); // IF DOUBLE SIDE BAND, Default Sideband Gain is 50%
 
   for(size_t i = 0; i < IdChannels.size(); i++) {
 
@@ -55,7 +55,7 @@ WaterVaporRadiometer::WaterVaporRadiometer(const std::vector<size_t> &IdChannels
                                            const std::vector<double> &skyCoupling)
 {
 
-  spilloverTemperature_ = Temperature(-999.0, "K");
+  spilloverTemperature_ = Temperature::from<Temperature::K>(-999.0);
   IdChannels_ = IdChannels;
 
   /*    if(IdChannels.size()!=skyCoupling.size()){throw Error();} */
@@ -83,7 +83,7 @@ WaterVaporRadiometer::WaterVaporRadiometer(const std::vector<size_t> &IdChannels
                                            const std::vector<Percent> &signalGain)
 {
 
-  spilloverTemperature_ = Temperature(-999.0, "K");
+  spilloverTemperature_ = Temperature::from<Temperature::K>(-999.0);
   IdChannels_ = IdChannels;
 
   if(IdChannels.size() < signalGain.size()) {
@@ -110,7 +110,7 @@ WaterVaporRadiometer::WaterVaporRadiometer(const std::vector<size_t> &IdChannels
                                            const std::vector<Percent> &signalGain)
 {
 
-  spilloverTemperature_ = Temperature(-999.0, "K");
+  spilloverTemperature_ = Temperature::from<Temperature::K>(-999.0);
   IdChannels_ = IdChannels;
 
   if(IdChannels.size() < skyCoupling.size()) {
@@ -156,7 +156,7 @@ WaterVaporRadiometer::WaterVaporRadiometer(const std::vector<size_t> &IdChannels
   spilloverTemperature_ = spilloverTemperature;
   IdChannels_ = IdChannels;
 
-  Percent sg(50, "%"); // IF DOUBLE SIDE BAND, Default Sideband Gain is 50%
+  Percent sg = Percent::from<Percent::percent>(50); // IF DOUBLE SIDE BAND, Default Sideband Gain is 50%
 
   for(size_t i = 0; i < IdChannels.size(); i++) {
 
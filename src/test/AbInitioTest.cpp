@@ -327,6 +327,22 @@ int main()
   cout << " AbInitioTest: AVERAGE DRY NON-DISPER PATHLENGTH Pr_DERIVATIVE  (ZENITH VALUE microns/mb)=" << skyAntenna1.getAverageNonDispersiveDryPathLength_GroundPressureDerivative(astro_band) << " microns/mb" << endl;
   cout << " AbInitioTest: AVERAGE DRY NON-DISPER PATHLENGTH Temp_DERIVATIVE (ZENITH VALUE microns/K)=" << skyAntenna1.getAverageNonDispersiveDryPathLength_GroundTemperatureDerivative(astro_band) << " microns/K" << endl;
 
+  // all the ground sensitivities of the band at once, without touching skyAntenna1
+  RefractiveIndexProfile::GroundSensitivity sensitivity;
+  skyAntenna1.getGroundSensitivity(astro_band, sensitivity);
+  double dDispDry_dP = 0.0, dWet_dRH = 0.0, dNonDispDry_dT = 0.0, dNonDispDry_dLapse = 0.0;
+  for(size_t n = 0; n < skyAntenna1.getNumChan(astro_band); n++) {
+    dDispDry_dP = dDispDry_dP + sensitivity.groundPressure.dispersiveDryPathLength[n] * 1e6 / skyAntenna1.getNumChan(astro_band);
+    dWet_dRH = dWet_dRH + sensitivity.relativeHumidity.wetOpacity[n] / skyAntenna1.getNumChan(astro_band);
+    dNonDispDry_dT = dNonDispDry_dT + sensitivity.groundTemperature.nonDispersiveDryPathLength[n] * 1e6 / skyAntenna1.getNumChan(astro_band);
+    dNonDispDry_dLapse = dNonDispDry_dLapse + sensitivity.tropoLapseRate.nonDispersiveDryPathLength[n] * 1e6 / skyAntenna1.getNumChan(astro_band);
+  }
+  cout << " AbInitioTest: GROUND SENSITIVITIES (ZENITH, AVERAGE OVER THE BAND):" << endl;
+  cout << " AbInitioTest:        DRY DISPERSIVE PATHLENGTH / GROUND PRESSURE   =" << dDispDry_dP << " microns/mb" << endl;
+  cout << " AbInitioTest:        WET OPACITY / GROUND RELATIVE HUMIDITY        =" << dWet_dRH << " np/%" << endl;
+  cout << " AbInitioTest:        DRY NON-DISPER PATHLENGTH / GROUND TEMPERATURE=" << dNonDispDry_dT << " microns/K (constant lapse rate)" << endl;
+  cout << " AbInitioTest:        DRY NON-DISPER PATHLENGTH / LAPSE RATE        =" << dNonDispDry_dLapse << " microns/(K/km)" << endl;
+
 
 
 
@@ -363,8 +379,38 @@ int main()
   cout << " AbInitioTest: AVERAGE DRY NON-DISPER PATHLENGTH Temp_DERIVATIVE (ZENITH VALUE microns/K)=" << skyAntenna1.getAverageNonDispersiveDryPathLength_GroundTemperatureDerivative(astro_band) << " microns/K" << endl;
 
 
-
-
+  cout << " AbInitioTest: " << endl;
+  cout << " AbInitioTest: STEP 10: WATER VAPOR RETRIEVAL OF A BLOCK OF WVR DATA ON SEVERAL THREADS" << endl;
+
+  size_t FirstBatchMeasurement=9000;
+  size_t NumberofBatchMeasurements=1000;
+  vector<WVRMeasurement> serialData(RadiometerData), threadedData(RadiometerData), singleThreadData(RadiometerData);
+  skyAntenna1.setUserWH2O(Length(1.0,"mm"));
+  skyAntenna1.WaterVaporRetrieval_fromWVR(serialData,FirstBatchMeasurement,FirstBatchMeasurement+NumberofBatchMeasurements);
+  double serialUserWH2O = skyAntenna1.getUserWH2O().get("mm");
+  skyAntenna1.setUserWH2O(Length(1.0,"mm"));
+  skyAntenna1.WaterVaporRetrieval_fromWVR(threadedData,FirstBatchMeasurement,FirstBatchMeasurement+NumberofBatchMeasurements,4);
+  double threadedUserWH2O = skyAntenna1.getUserWH2O().get("mm");
+  skyAntenna1.setUserWH2O(Length(1.0,"mm"));
+  skyAntenna1.WaterVaporRetrieval_fromWVR(singleThreadData,FirstBatchMeasurement,FirstBatchMeasurement+NumberofBatchMeasurements,1);
+  double maxDiffSerial = 0.0, maxDiffThreads = 0.0, maxDiffFirstBlock = 0.0;
+  size_t numRetrieved = 0;
+  for(size_t i=FirstBatchMeasurement; i<FirstBatchMeasurement+NumberofBatchMeasurements; i++){
+    double w = threadedData[i].getretrievedWaterVaporColumn().get("mm");
+    double diff = fabs(w-serialData[i].getretrievedWaterVaporColumn().get("mm"));
+    if(w > 0.0) numRetrieved++;
+    if(diff > maxDiffSerial) maxDiffSerial = diff;
+    if(i < FirstBatchMeasurement+64 && diff > maxDiffFirstBlock) maxDiffFirstBlock = diff;
+    diff = fabs(w-singleThreadData[i].getretrievedWaterVaporColumn().get("mm"));
+    if(diff > maxDiffThreads) maxDiffThreads = diff;
+  }
+  cout << " AbInitioTest: " << numRetrieved << " water vapor columns retrieved out of " << NumberofBatchMeasurements
+       << " WVR measurements starting at " << FirstBatchMeasurement << " (4 threads)" << endl;
+  cout << " AbInitioTest: Largest difference with the serial retrievals: " << maxDiffSerial*1000 << " microns (first block: "
+       << maxDiffFirstBlock*1000 << " microns)" << endl;
+  cout << " AbInitioTest: Largest difference between 4 threads and 1 thread: " << maxDiffThreads*1000 << " microns" << endl;
+  cout << " AbInitioTest: User Water Vapor Column after the retrievals: " << threadedUserWH2O << " mm (serial: "
+       << serialUserWH2O << " mm)" << endl;
 
   return 0;
 
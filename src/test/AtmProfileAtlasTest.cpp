@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <math.h>
+using namespace std;
+
+#include "ATMProfileAtlas.h"
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1AtmProfileAtlas.html">AtmProfileAtlas</a> Class
+   *
+   *   The test is structured as follows:
+   *         - A reference AtmProfile is created for the Chajnantor site.
+   *         - An AtmProfileAtlas is built on a grid of ground pressure, temperature and relative humidity,
+   *           and its interpolation error at the centre of the cells is printed.
+   *         - The profile interpolated at a set of ground conditions is compared with that of an AtmProfile
+   *           with the same layer grid.
+   *         - The atlas is saved, loaded into another atlas, and the two interpolated profiles are compared
+   *           (the difference must be 0).
+   */
+
+int main()
+{
+  Length         Alt(  5000,"m" );     // Altitude of the site
+  Length         WVL(   2.2,"km");     // Water vapor scale height
+  double         TLR=  -5.6      ;     // Tropospheric lapse rate (must be in K/km)
+  Length      topAtm(  48.0,"km");     // Upper atm. boundary for calculations
+  Pressure     Pstep(  10.0,"mb");     // Primary pressure step
+  double   PstepFact=         1.2;     // Pressure step ratio between two consecutive layers
+  size_t     atmType = 1;              // TROPICAL
+
+  AtmProfile myProfile(Alt, Pressure(560.0,"mb"), Temperature(270.0,"K"), TLR, Humidity(20.0,"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+
+  vector<double> pressure, temperature, humidity;
+  for(size_t i = 0; i < 9; i++) pressure.push_back(540.0 + 5.0*i);       // mb
+  for(size_t i = 0; i < 13; i++) temperature.push_back(255.0 + 2.5*i);   // K
+  for(size_t i = 0; i < 11; i++) humidity.push_back(10.0*i);             // %
+
+  AtmProfileAtlas myAtlas(myProfile, pressure, temperature, humidity);
+  AtmProfileAtlas::InterpolationError error = myAtlas.getInterpolationError();
+
+  cout << " AtmProfileAtlasTest: " << myAtlas.getNumNode() << " profiles of " << myAtlas.getNumLayer() << " layers" << endl;
+  cout << " AtmProfileAtlasTest: interpolation error over " << error.numTest << " cell centres:" << endl;
+  cout << " AtmProfileAtlasTest:   layer temperature:  " << error.temperature << " K" << endl;
+  cout << " AtmProfileAtlasTest:   layer pressure:     " << error.pressure << " (relative)" << endl;
+  cout << " AtmProfileAtlasTest:   layer water vapor:  " << error.waterVapor << " kg m-3" << endl;
+  cout << " AtmProfileAtlasTest:   water vapor column: " << error.groundWH2O << " (relative)" << endl;
+
+  double P = 556.3, T = 271.7, H = 33.0;
+  size_t numLayer = myAtlas.getNumLayer();
+  vector<double> layerT(numLayer), layerP(numLayer), layerW(numLayer);
+  myAtlas.getProfile(P, T, H, &layerT[0], &layerP[0], &layerW[0]);
+
+  AtmProfile myFixedProfile(myAtlas.getAtmProfile());
+  myFixedProfile.setBasicAtmosphericParameterThresholds(Length(0.0,"m"), Pressure(0.0,"mb"), Temperature(0.0,"K"),
+                                                        0.0, Humidity(0.0,"%"), Length(0.0,"m"));
+  myFixedProfile.setBasicAtmosphericParameters(Alt, Pressure(P,"mb"), Temperature(T,"K"), TLR, Humidity(H,"%"), WVL);
+  cout << " AtmProfileAtlasTest: P=" << P << " mb T=" << T << " K RH=" << H << " %, atlas and AtmProfile:" << endl;
+  for(size_t n = 0; n < numLayer; n += 4) {
+    cout << " AtmProfileAtlasTest:   layer " << n
+         << "  T: " << layerT[n] << " " << myFixedProfile.getLayerTemperature(n).get("K") << " K"
+         << "  P: " << layerP[n] << " " << myFixedProfile.getLayerPressure(n).get("mb") << " mb"
+         << "  WaterVapor: " << layerW[n] << " " << myFixedProfile.getLayerWaterVaporMassDensity(n).get("kgm**-3") << " kg m-3" << endl;
+  }
+
+  string fileName = "AtmProfileAtlasTest.atlas";
+  AtmProfileAtlas myLoadedAtlas;
+  bool saved = myAtlas.save(fileName);
+  bool loaded = myLoadedAtlas.load(fileName);
+  remove(fileName.c_str());
+  vector<double> loadedT(numLayer), loadedP(numLayer), loadedW(numLayer);
+  myLoadedAtlas.getProfile(P, T, H, &loadedT[0], &loadedP[0], &loadedW[0]);
+  double dMax = 0.0;
+  for(size_t n = 0; n < numLayer; n++) {
+    dMax = max(dMax, fabs(loadedT[n] - layerT[n]));
+    dMax = max(dMax, fabs(loadedP[n] - layerP[n]));
+    dMax = max(dMax, fabs(loadedW[n] - layerW[n]));
+  }
+  cout << " AtmProfileAtlasTest: saved: " << saved << " loaded: " << loaded << " (" << myLoadedAtlas.getNumNode()
+       << " profiles); largest difference after reloading: " << dMax << endl;
+
+  return 0;
+}
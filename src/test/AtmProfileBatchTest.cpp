@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <math.h>
+using namespace std;
+
+#include "ATMProfileBatch.h"
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1AtmProfileBatch.html">AtmProfileBatch</a> Class
+   *
+   *   The test is structured as follows:
+   *         - A reference AtmProfile is created for the Chajnantor site.
+   *         - An AtmProfileBatch is filled with a series of 6 ground weather records (pressure, temperature
+   *           and humidity) given as arrays, then computed.
+   *         - For every record the profile of the batch is compared, layer by layer, with that of an AtmProfile
+   *           built for that record alone. The differences must be at the level of the rounding
+   *           errors of the unit conversions of the AtmProfile accessors.
+   */
+
+int main()
+{
+  Length         Alt(  5000,"m" );     // Altitude of the site
+  Length         WVL(   2.2,"km");     // Water vapor scale height
+  double         TLR=  -5.6      ;     // Tropospheric lapse rate (must be in K/km)
+  Length      topAtm(  48.0,"km");     // Upper atm. boundary for calculations
+  Pressure     Pstep(  10.0,"mb");     // Primary pressure step
+  double   PstepFact=         1.2;     // Pressure step ratio between two consecutive layers
+  size_t     atmType = 1;              // TROPICAL
+
+  AtmProfile myProfile(Alt, Pressure(560.0,"mb"), Temperature(270.0,"K"), TLR, Humidity(20.0,"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+
+  vector<double> pressure, temperature, humidity;
+  for(size_t i = 0; i < 6; i++) {
+    pressure.push_back(548.0 + 3.0*i);        // mb
+    temperature.push_back(262.0 + 2.0*i);     // K
+    humidity.push_back(4.0 + 9.0*i);          // %
+  }
+
+  AtmProfileBatch myBatch(myProfile);
+  myBatch.addRecords(pressure, temperature, humidity);
+  myBatch.compute();
+
+  cout << " AtmProfileBatchTest: " << myBatch.getNumRecord() << " records, "
+       << myBatch.getLayerOffset(myBatch.getNumRecord()) << " layers in total" << endl;
+
+  for(size_t i = 0; i < myBatch.getNumRecord(); i++) {
+    AtmProfile recordProfile(Alt, Pressure(pressure[i],"mb"), Temperature(temperature[i],"K"), TLR, Humidity(humidity[i],"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+    size_t offset = myBatch.getLayerOffset(i);
+    double dMax = 0.0;
+    if(myBatch.getNumLayer(i) == recordProfile.getNumLayer()) {
+      for(size_t n = 0; n < recordProfile.getNumLayer(); n++) {
+        dMax = max(dMax, fabs(myBatch.getLayerThicknessTable()[offset + n] - recordProfile.getLayerThickness(n).get("m")));
+        dMax = max(dMax, fabs(myBatch.getLayerTemperatureTable()[offset + n] - recordProfile.getLayerTemperature(n).get("K")));
+        dMax = max(dMax, fabs(myBatch.getLayerPressureTable()[offset + n] - recordProfile.getLayerPressure(n).get("mb")));
+        dMax = max(dMax, fabs(myBatch.getLayerWaterVaporTable()[offset + n] - recordProfile.getLayerWaterVaporMassDensity(n).get("kgm**-3")));
+      }
+    } else {
+      dMax = -1.0;
+    }
+    cout << " AtmProfileBatchTest: record " << i << " P=" << pressure[i] << " mb T=" << temperature[i]
+         << " K RH=" << humidity[i] << " %: " << myBatch.getNumLayer(i) << " layers, water column "
+         << myBatch.getGroundWH2O(i).get("mm") << " mm (AtmProfile: " << recordProfile.getNumLayer()
+         << " layers, " << recordProfile.getGroundWH2O().get("mm") << " mm; largest difference " << dMax << ")" << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <math.h>
+using namespace std;
+
+#include "ATMProfileReader.h"
+#include "ATMSkyStatus.h"
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1AtmProfileReader.html">AtmProfileReader</a> Class
+   *
+   *   The test is structured as follows:
+   *         - A reference AtmProfile is created for the Chajnantor site, and its levels are exported as raw
+   *           SI arrays.
+   *         - An AtmProfile is built from these arrays and compared with the one built from the same levels
+   *           given as vectors of quantities (the difference must be at the rounding level). Its top, and the
+   *           tropopause of the levels of the troposphere alone, are compared with those of the reference
+   *           profile (altitudes above sea level).
+   *         - A columnar file is written with four profiles: the levels of the reference profile without and
+   *           with the minor gases, a profile with an increasing pressure, and one with a bad number.
+   *         - The file is streamed into a single AtmProfile: the problems of the invalid profiles are printed,
+   *           and for the valid ones the zenith sky brightness temperatures around 183 GHz are compared with
+   *           those of the reference profile.
+   */
+
+int main()
+{
+  Length         Alt(  5000,"m" );     // Altitude of the site
+  Length         WVL(   2.2,"km");     // Water vapor scale height
+  double         TLR=  -5.6      ;     // Tropospheric lapse rate (must be in K/km)
+  Length      topAtm(  48.0,"km");     // Upper atm. boundary for calculations
+  Pressure     Pstep(  10.0,"mb");     // Primary pressure step
+  double   PstepFact=         1.2;     // Pressure step ratio between two consecutive layers
+  size_t     atmType = 1;              // TROPICAL
+
+  AtmProfile myProfile(Alt, Pressure(560.0,"mb"), Temperature(270.0,"K"), TLR, Humidity(20.0,"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+  size_t numLayer = myProfile.getNumLayer();
+
+  // levels of the reference profile: the bottoms of the layers, then the top of the last one
+  vector<double> altitude, pressure, temperature, waterVapor, o3, co, n2o, no2, so2;
+  vector<Length> v_boundary;
+  vector<Pressure> v_pressure;
+  vector<Temperature> v_temperature;
+  vector<MassDensity> v_waterVapor;
+  for(size_t n = 0; n <= numLayer; n++) {
+    size_t i = n < numLayer ? n : numLayer - 1;
+    altitude.push_back(n < numLayer ? myProfile.getLayerBottomHeightAboveSeaLevel(i).get("m") : myProfile.getLayerTopHeightAboveSeaLevel(i).get("m"));
+    pressure.push_back(n < numLayer ? myProfile.getLayerBottomPressure(i).get("Pa") : myProfile.getLayerTopPressure(i).get("Pa"));
+    temperature.push_back(n < numLayer ? myProfile.getLayerBottomTemperature(i).get("K") : myProfile.getLayerTopTemperature(i).get("K"));
+    waterVapor.push_back(n < numLayer ? myProfile.getLayerBottomWaterVaporMassDensity(i).get("kgm**-3") : myProfile.getLayerTopWaterVaporMassDensity(i).get("kgm**-3"));
+    o3.push_back(myProfile.getLayerO3(i).get("m**-3"));
+    co.push_back(myProfile.getLayerCO(i).get("m**-3"));
+    n2o.push_back(myProfile.getLayerN2O(i).get("m**-3"));
+    no2.push_back(myProfile.getLayerNO2(i).get("m**-3"));
+    so2.push_back(myProfile.getLayerSO2(i).get("m**-3"));
+    v_boundary.push_back(Length(altitude[n], "m"));
+    v_pressure.push_back(Pressure(pressure[n], "Pa"));
+    v_temperature.push_back(Temperature(temperature[n], "K"));
+    v_waterVapor.push_back(MassDensity(waterVapor[n], "kgm**-3"));
+  }
+
+  AtmProfile::UserLevels levels;
+  levels.numLevel = altitude.size();
+  levels.altitude = &altitude[0];
+  levels.pressure = &pressure[0];
+  levels.temperature = &temperature[0];
+  levels.waterVapor = &waterVapor[0];
+  AtmProfile rawProfile(levels, atmType);
+  AtmProfile vectorProfile(v_boundary, v_pressure, v_temperature, v_waterVapor);
+  double maxDiff = 0.0;
+  for(size_t n = 0; n < numLayer; n++) {
+    maxDiff = max(maxDiff, fabs(rawProfile.getLayerThickness(n).get("m") - vectorProfile.getLayerThickness(n).get("m")));
+    maxDiff = max(maxDiff, fabs(rawProfile.getLayerPressure(n).get("mb") - vectorProfile.getLayerPressure(n).get("mb")));
+    maxDiff = max(maxDiff, fabs(rawProfile.getLayerTemperature(n).get("K") - vectorProfile.getLayerTemperature(n).get("K")));
+    maxDiff = max(maxDiff, fabs(rawProfile.getLayerWaterVaporMassDensity(n).get("gm**-3") - vectorProfile.getLayerWaterVaporMassDensity(n).get("gm**-3")));
+  }
+  cout << " AtmProfileReaderTest: profile from raw arrays: " << rawProfile.getNumLayer() << " layers (reference: " << numLayer
+       << "), ground " << rawProfile.getAltitude().get("m") << " m " << rawProfile.getGroundPressure().get("mb") << " mb "
+       << rawProfile.getGroundTemperature().get("K") << " K, water vapor column " << rawProfile.getGroundWH2O().get("mm")
+       << " mm (reference: " << myProfile.getGroundWH2O().get("mm") << " mm)" << endl;
+  cout << " AtmProfileReaderTest: tropopause at " << rawProfile.getTropopauseAltitude().get("km") << " km, "
+       << rawProfile.getTropopauseTemperature().get("K") << " K (reference: " << myProfile.getTropopauseAltitude().get("km")
+       << " km, " << myProfile.getTropopauseTemperature().get("K") << " K)" << endl;
+  cout << " AtmProfileReaderTest: top of the profile at " << rawProfile.getTopAtmProfile().get("km")
+       << " km (top of the last layer of the reference: " << myProfile.getLayerTopHeightAboveSeaLevel(numLayer - 1).get("km")
+       << " km)" << endl;
+
+  // the troposphere of the reference profile alone: its coldest level is the tropopause of the reference
+  AtmProfile::UserLevels troposphere = levels;
+  troposphere.numLevel = 0;
+  while(troposphere.numLevel < altitude.size()
+        && altitude[troposphere.numLevel] <= myProfile.getTropopauseAltitude().get("m") + 1.0) troposphere.numLevel++;
+  AtmProfile tropoProfile(troposphere, atmType);
+  cout << " AtmProfileReaderTest: troposphere from raw arrays: " << tropoProfile.getNumLayer() << " layers, tropopause at "
+       << tropoProfile.getTropopauseAltitude().get("km") << " km, " << tropoProfile.getTropopauseTemperature().get("K")
+       << " K (differences with the reference: " << tropoProfile.getTropopauseAltitude().get("m") - myProfile.getTropopauseAltitude().get("m")
+       << " m, " << tropoProfile.getTropopauseTemperature().get("K") - myProfile.getTropopauseTemperature().get("K") << " K)" << endl;
+  cout << " AtmProfileReaderTest: largest difference with the profile from vectors of quantities: " << maxDiff << endl;
+
+  string fileName = "AtmProfileReaderTest.dat";
+  ofstream out(fileName.c_str());
+  out << "# levels of the reference profile: altitude (m) pressure (Pa) temperature (K) water vapor (kg m**-3) [O3 CO N2O NO2 SO2 (m**-3)]" << endl;
+  out << setprecision(10);
+  out << "profile reference" << endl;
+  for(size_t n = 0; n <= numLayer; n++) out << altitude[n] << " " << pressure[n] << " " << temperature[n] << " " << waterVapor[n] << endl;
+  out << endl << "profile reference with minor gases" << endl;
+  for(size_t n = 0; n <= numLayer; n++) {
+    out << altitude[n] << " " << pressure[n] << " " << temperature[n] << " " << waterVapor[n] << " "
+        << o3[n] << " " << co[n] << " " << n2o[n] << " " << no2[n] << " " << so2[n] << endl;
+  }
+  out << "profile increasing pressure" << endl;
+  out << "5000 56000 270 1e-3" << endl << "5500 57000 267 9e-4" << endl;
+  out << "profile bad number" << endl;
+  out << "5000 56000 270 1e-3" << endl << "5500 5x000 267 9e-4" << endl;
+  out.close();
+
+  SpectralGrid band(8, 0, Frequency(181.0,"GHz"), Frequency(0.5,"GHz"));
+  SkyStatus reference(RefractiveIndexProfile(band, myProfile));
+  AtmProfile streamed(0);
+  AtmProfileReader reader(fileName);
+  while(reader.next()) {
+    if(!reader.isValid()) {
+      cout << " AtmProfileReaderTest: profile '" << reader.getLabel() << "' rejected: " << reader.getError() << endl;
+      continue;
+    }
+    streamed.setUserLevels(reader.getLevels());
+    SkyStatus skyStatus(RefractiveIndexProfile(band, streamed));
+    double maxTebbDiff = 0.0;
+    for(size_t n = 0; n < band.getNumChan(0); n++) {
+      maxTebbDiff = max(maxTebbDiff, fabs(skyStatus.getTebbSky(n).get("K") - reference.getTebbSky(n).get("K")));
+    }
+    cout << " AtmProfileReaderTest: profile '" << reader.getLabel() << "': " << reader.getNumLevel() << " levels, minor gases: "
+         << reader.hasMinorGases() << ", T_EBB at " << band.getChanFreq(0, 0).get("GHz") << " GHz " << skyStatus.getTebbSky(size_t(0)).get("K")
+         << " K, largest difference with the reference profile " << maxTebbDiff << " K" << endl;
+  }
+  cout << " AtmProfileReaderTest: " << reader.getNumProfile() << " profiles read" << endl;
+  remove(fileName.c_str());
+
+  return 0;
+}
@@ -141,4 +141,34 @@ int main()
          << "  N2O: "        << myProfile.getLayerN2O(i).get("m**-3")         << " m-3" << endl;
   }
 
+  cout<<" AtmProfileTest:   "<<endl;
+  cout<<" AtmProfileTest: Layer boundaries of myProfile pinned, then ground pressure raised by 20 mb"<<endl;
+  AtmProfile myFixedProfile(myProfile);
+  myFixedProfile.fixLayerGrid();
+  myFixedProfile.setBasicAtmosphericParameterThresholds(Length(0.0,"m"), Pressure(0.0,"mb"), Temperature(0.0,"K"),
+                                                        0.0, Humidity(0.0,"%"), Length(0.0,"m"));
+  myFixedProfile.setBasicAtmosphericParameters(Alt, Pressure(P.get("mb") + 20.0,"mb"), T, TLR, H, WVL);
+  AtmProfile myAdaptiveProfile( Alt, Pressure(P.get("mb") + 20.0,"mb"), T, TLR, H, WVL, Pstep, PstepFact, topAtm, atmType );
+  cout<<" AtmProfileTest: Number of layers, fixed grid:      " << myFixedProfile.getNumLayer()
+      << " (adaptive layering: " << myAdaptiveProfile.getNumLayer() << ")" <<endl;
+  cout<<" AtmProfileTest: Water vapor column, fixed grid:    " << myFixedProfile.getGroundWH2O().get("mm")
+      << " mm (adaptive layering: " << myAdaptiveProfile.getGroundWH2O().get("mm") << " mm)" <<endl;
+
+  cout<<" AtmProfileTest:   "<<endl;
+  cout<<" AtmProfileTest: Minor gases of the reference atmosphere at the layer middles of myProfile (all layers in one call):"<<endl;
+  size_t numLayer = myProfile.getNumLayer();
+  vector<double> altitude(numLayer), o3(numLayer), co(numLayer), n2o(numLayer), no2(numLayer), so2(numLayer);
+  double bottom = myProfile.getAltitude().get("km");
+  for(size_t i=0; i<numLayer; i++){
+    altitude[i] = bottom + myProfile.getLayerThickness(i).get("km")/2.0;
+    bottom = bottom + myProfile.getLayerThickness(i).get("km");
+  }
+  AtmProfile::getMinorGasDensities(atmType, numLayer, &altitude[0], &o3[0], &co[0], &n2o[0], &no2[0], &so2[0]);
+  for(size_t i=0; i<numLayer; i+=5){
+    cout << " AtmProfileTest:  altitude: " << altitude[i] << " km"
+         << "  O3: "  << o3[i]  << " m-3 (layer " << myProfile.getLayerO3(i).get("m**-3") << " m-3)"
+         << "  CO: "  << co[i]  << " m-3 (layer " << myProfile.getLayerCO(i).get("m**-3") << " m-3)"
+         << "  N2O: " << n2o[i] << " m-3 (layer " << myProfile.getLayerN2O(i).get("m**-3") << " m-3)" << endl;
+  }
+
 }
@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <math.h>
+using namespace std;
+
+#include "ATMAtmosphereBatch.h"
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1AtmosphereBatch.html">AtmosphereBatch</a> Class
+   *
+   *   The test is structured as follows:
+   *         - A reference AtmProfile is created for the Chajnantor site.
+   *         - A spectral grid with two spectral windows (near 183 GHz and in band 7) is defined.
+   *         - An AtmosphereBatch with this grid is filled with 5 states of different ground
+   *           pressure, temperature and humidity, then computed for an air mass of 1.5, a sky coupling
+   *           of 0.95 and a spill over temperature of 275 K.
+   *         - For every state the results of the batch are compared, at one channel of each spectral window,
+   *           with those of a SkyStatus object built for that state alone. The differences must be 0.
+   */
+
+int main()
+{
+  Length         Alt(  5000,"m" );     // Altitude of the site
+  Length         WVL(   2.2,"km");     // Water vapor scale height
+  double         TLR=  -5.6      ;     // Tropospheric lapse rate (must be in K/km)
+  Length      topAtm(  48.0,"km");     // Upper atm. boundary for calculations
+  Pressure     Pstep(  10.0,"mb");     // Primary pressure step
+  double   PstepFact=         1.2;     // Pressure step ratio between two consecutive layers
+  size_t     atmType = 1;              // TROPICAL
+
+  AtmProfile myProfile(Alt, Pressure(560.0,"mb"), Temperature(270.0,"K"), TLR, Humidity(20.0,"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+
+  SpectralGrid myGrid(16, 0, Frequency(180.0,"GHz"), Frequency(0.5,"GHz"));
+  myGrid.add(16, 0, Frequency(340.0,"GHz"), Frequency(0.5,"GHz"));
+
+  AtmosphereBatch myBatch(myGrid, myProfile);
+  for(size_t i = 0; i < 5; i++) {
+    myBatch.addState(Pressure(550.0 + 4.0*i,"mb"), Temperature(265.0 + 2.5*i,"K"), Humidity(5.0 + 10.0*i,"%"));
+  }
+  myBatch.setAirMass(1.5);
+  myBatch.setSkyCoupling(0.95);
+  myBatch.setSpilloverTemperature(Temperature(275.0,"K"));
+  myBatch.compute();
+
+  cout << " AtmosphereBatchTest: " << myBatch.getNumState() << " states, " << myBatch.getNumChan() << " channels" << endl;
+
+  for(size_t i = 0; i < myBatch.getNumState(); i++) {
+    AtmProfile stateProfile(Alt, Pressure(550.0 + 4.0*i,"mb"), Temperature(265.0 + 2.5*i,"K"), TLR, Humidity(5.0 + 10.0*i,"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+    SkyStatus stateSkyStatus(RefractiveIndexProfile(myGrid, stateProfile));
+    Length wh2o = stateSkyStatus.getGroundWH2O();
+    cout << " AtmosphereBatchTest: state " << i << " water column " << myBatch.getGroundWH2O(i).get("mm") << " mm" << endl;
+    for(size_t spwid = 0; spwid < 2; spwid++) {
+      size_t nc = 6;
+      double dTebb = myBatch.getTebbSky(i, spwid, nc).get("K")
+        - stateSkyStatus.getTebbSky(spwid, nc, wh2o, 1.5, 0.95, Temperature(275.0,"K")).get("K");
+      double dDry = myBatch.getDryOpacity(i, spwid, nc).get() - stateSkyStatus.getDryOpacity(spwid, nc).get();
+      cout << " AtmosphereBatchTest:   " << myGrid.getChanFreq(spwid, nc).get("GHz") << " GHz"
+           << " Tebb: " << myBatch.getTebbSky(i, spwid, nc).get("K") << " K"
+           << " dry opacity: " << myBatch.getDryOpacity(i, spwid, nc).get()
+           << " wet opacity: " << myBatch.getWetOpacity(i, spwid, nc).get()
+           << " (differences with SkyStatus: " << dTebb << " K, " << dDry << ")" << endl;
+    }
+  }
+
+  return 0;
+}
@@ -23,6 +23,9 @@ using namespace std;
 
 #include <iostream>
 #include "ATMLength.h"
+#include "ATMFrequency.h"
+#include "ATMPressure.h"
+#include "ATMTemperature.h"
 #include <string>
 
 
@@ -101,6 +104,19 @@ int main()
   p1 = p0*2.0e0+P;
   cout <<"p1=p0*2.0E0+P="<<p1.get()<<endl;
   cout << endl;
+  cout << "Units known at compile time, must agree with the units given as strings:" << endl;
+  Length hkm = Length::from<Length::km>(10);
+  cout << "Length::from<Length::km>(10) ==> " << hkm.get<Length::m>() << "m " << hkm.get<Length::mm>() << "mm (strings: "
+       << h.get("m") << "m " << h.get("mm") << "mm)" << endl;
+  cout << "Length::from<Length::micron>(850) ==> " << Length::from<Length::micron>(850).get<Length::mm>() << "mm (strings: "
+       << Length(850,"micron").get("mm") << "mm)" << endl;
+  cout << "Frequency::from<Frequency::GHz>(183.31) ==> " << Frequency::from<Frequency::GHz>(183.31).get<Frequency::MHz>()
+       << "MHz (strings: " << Frequency(183.31,"GHz").get("MHz") << "MHz)" << endl;
+  cout << "Pressure::from<Pressure::mb>(560) ==> " << Pressure::from<Pressure::mb>(560).get<Pressure::atmosphere>()
+       << "atm (strings: " << Pressure(560,"mb").get("atm") << "atm)" << endl;
+  cout << "Temperature::from<Temperature::C>(-3.16) ==> " << Temperature::from<Temperature::C>(-3.16).get<Temperature::K>()
+       << "K (strings: " << Temperature(-3.16,"C").get("K") << "K)" << endl;
+  cout << endl;
   cout << "TESTBED done " << endl;
 
   return 0;
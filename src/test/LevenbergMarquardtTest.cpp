@@ -0,0 +1,103 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+#include <math.h>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+#include "ATMLevenbergMarquardt.h"
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1LevenbergMarquardt.html">LevenbergMarquardt</a> Class
+   *
+   *   The test is structured as follows:
+   *         - A skydip-like decay T(m) = T0 exp(-tau m) + 2.7 is sampled at 12 air masses from 1 to 3.2, with a
+   *           small deterministic perturbation, and T0 and tau are fitted from a poor first guess. The solution,
+   *           its uncertainties, the rms of the fit and the convergence statistics are printed.
+   *         - The same data are fitted with weights, the last points being given half the weight of the others.
+   *         - A single parameter fit of a negative quantity is done with a constraint keeping the parameter
+   *           positive (a rejected negative trial being replaced by 0.9 times the current value), as the
+   *           retrievals of SkyStatus do for the water vapor column.
+   */
+
+int main()
+{
+  const size_t numData = 12;
+  vector<double> airmass(numData), data(numData), weight(numData);
+  double T0 = 250.0, tau = 0.35;
+  for(size_t i = 0; i < numData; i++) {
+    airmass[i] = 1.0 + 0.2 * i;
+    data[i] = T0 * exp(-tau * airmass[i]) + 2.7 + 0.05 * ((i % 3) - 1.0);
+    weight[i] = i < numData - 4 ? 1.0 : 0.5;
+  }
+
+  LevenbergMarquardt::Model decay = [&](const double *p, double *model, double *jacobian) {
+    for(size_t i = 0; i < numData; i++) {
+      double e = exp(-p[1] * airmass[i]);
+      model[i] = p[0] * e + 2.7;
+      jacobian[i * 2] = e;
+      jacobian[i * 2 + 1] = -p[0] * airmass[i] * e;
+    }
+  };
+
+  LevenbergMarquardt fit(2, numData);
+  LevenbergMarquardt::Settings settings;
+  settings.tolerance = 1e-6;
+  settings.maxIteration = 50;
+  fit.setSettings(settings);
+  fit.setData(&data[0]);
+
+  for(size_t w = 0; w < 2; w++) {
+    if(w == 1) fit.setWeight(&weight[0]);
+    double param[2] = { 100.0, 1.0 };
+    bool converged = fit.solve(decay, param);
+    const LevenbergMarquardt::Statistics &stat = fit.getStatistics();
+    cout << " LevenbergMarquardtTest: " << (w == 0 ? "unweighted" : "weighted") << " fit (T0=" << T0 << " K, tau="
+         << tau << "): converged: " << converged << endl;
+    cout << " LevenbergMarquardtTest:   T0 = " << param[0] << " +/- " << fit.getParameterError(0) << " K   tau = "
+         << param[1] << " +/- " << fit.getParameterError(1) << "   sigma of the fit: " << fit.getSigma() << " K" << endl;
+    cout << " LevenbergMarquardtTest:   " << stat.numIteration << " iterations, " << stat.numEvaluation
+         << " evaluations, " << stat.numRejection << " rejected steps" << endl;
+    cout << " LevenbergMarquardtTest:   fitted T(1) = " << fit.getModel()[0] << " K (data: " << data[0] << " K)" << endl;
+  }
+
+  // fit of x to -1: the constraint keeps x positive, x goes toward 0
+  double target = -1.0;
+  LevenbergMarquardt constrained(1, 1);
+  settings = LevenbergMarquardt::Settings();
+  settings.maxIteration = 50;
+  constrained.setSettings(settings);
+  constrained.setData(&target);
+  constrained.setConstraint([](const double *p, double *trial) {
+                              if(trial[0] < 0.0) trial[0] = 0.9 * p[0];
+                            });
+  double x = 2.0;
+  bool converged = constrained.solve([](const double *p, double *model, double *jacobian) {
+                                       model[0] = p[0];
+                                       jacobian[0] = 1.0;
+                                     },
+                                     &x);
+  cout << " LevenbergMarquardtTest: constrained fit of x to " << target << " from 2: x = " << x << " converged: "
+       << converged << " after " << constrained.getStatistics().numIteration << " iterations" << endl;
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+#include "ATMPressureStepTuner.h"
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1PressureStepTuner.html">PressureStepTuner</a> Class
+   *
+   *   The test is structured as follows:
+   *         - A reference AtmProfile is created for the Chajnantor site, with the usual pressure step
+   *           parameters (10 mb, 1.2).
+   *         - For a band around 90 GHz and a band around 183 GHz, the coarsest layering meeting a goal of
+   *           0.05 K on the sky brightness temperatures and 2 mm on the path lengths is searched, and the
+   *           chosen parameters, the errors and the cost relative to the usual parameters (and their errors)
+   *           are printed.
+   *         - The choice for the first band is saved in a cache file and loaded back by another tuner; it
+   *           is not found for other goals, nor for a profile of the site with other ground conditions.
+   */
+
+int main()
+{
+  Length         Alt(  5000,"m" );     // Altitude of the site
+  Length         WVL(   2.2,"km");     // Water vapor scale height
+  double         TLR=  -5.6      ;     // Tropospheric lapse rate (must be in K/km)
+  Length      topAtm(  48.0,"km");     // Upper atm. boundary for calculations
+  Pressure     Pstep(  10.0,"mb");     // Primary pressure step
+  double   PstepFact=         1.2;     // Pressure step ratio between two consecutive layers
+  size_t     atmType = 1;              // TROPICAL
+
+  AtmProfile myProfile(Alt, Pressure(560.0,"mb"), Temperature(270.0,"K"), TLR, Humidity(20.0,"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+
+  Temperature tebbGoal(0.05,"K");
+  Length pathLengthGoal(2.0,"mm");
+
+  SpectralGrid band3(64, 0, Frequency(84.0,"GHz"), Frequency(0.25,"GHz"));
+  SpectralGrid band183(64, 0, Frequency(175.0,"GHz"), Frequency(0.25,"GHz"));
+  SpectralGrid *bands[] = { &band3, &band183 };
+  const char *names[] = { "84-100 GHz", "175-191 GHz" };
+
+  for(size_t b = 0; b < 2; b++) {
+    PressureStepTuner tuner(myProfile, *bands[b]);
+    bool tuned = tuner.tune(tebbGoal, pathLengthGoal);
+    cout << " PressureStepTunerTest: band " << names[b] << ": goal met: " << tuned
+         << "  pressure step " << tuner.getPressureStep().get("mb") << " mb, factor " << tuner.getPressureStepFactor() << endl;
+    cout << " PressureStepTunerTest:   " << tuner.getNumLayer() << " layers (site profile: " << tuner.getSiteNumLayer()
+         << ", reference: " << tuner.getReferenceNumLayer() << "), cost ratio " << tuner.getCostRatio() << endl;
+    cout << " PressureStepTunerTest:   largest errors: T_EBB " << tuner.getTebbError().get("K") << " K  path length "
+         << tuner.getPathLengthError().get("micron") << " microns (site profile: " << tuner.getSiteTebbError().get("K")
+         << " K, " << tuner.getSitePathLengthError().get("micron") << " microns)" << endl;
+    cout << " PressureStepTunerTest:   tuned profile: " << tuner.getAtmProfile().getNumLayer() << " layers" << endl;
+  }
+
+  string fileName = "PressureStepTunerTest.cache";
+  PressureStepTuner tuner(myProfile, band3);
+  tuner.tune(tebbGoal, pathLengthGoal);
+  bool saved = tuner.save(fileName);
+  PressureStepTuner cachedTuner(myProfile, band3);
+  bool loaded = cachedTuner.load(fileName, tebbGoal, pathLengthGoal);
+  bool otherGoal = cachedTuner.load(fileName, Temperature(0.01,"K"), pathLengthGoal);
+  AtmProfile otherProfile(Alt, Pressure(555.0,"mb"), Temperature(265.0,"K"), TLR, Humidity(40.0,"%"), WVL, Pstep, PstepFact, topAtm, atmType);
+  PressureStepTuner otherTuner(otherProfile, band3);
+  bool otherGround = otherTuner.load(fileName, tebbGoal, pathLengthGoal);
+  remove(fileName.c_str());
+  cout << " PressureStepTunerTest: saved: " << saved << " loaded: " << loaded << " (pressure step "
+       << cachedTuner.getPressureStep().get("mb") << " mb, factor " << cachedTuner.getPressureStepFactor()
+       << ", " << cachedTuner.getNumLayer() << " layers, site profile: " << cachedTuner.getSiteNumLayer()
+       << "); entry for another goal found: " << otherGoal << "; for other ground conditions: " << otherGround << endl;
+
+  return 0;
+}
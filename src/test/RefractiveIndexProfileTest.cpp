@@ -129,6 +129,15 @@ using namespace atm;
    *<br>
    *<br>
    * RefractiveIndexProfileTest: (your actual water vapor column is 1.57182 mm; 1.57182 mm<br>
+   *<br>
+   * RefractiveIndexProfileTest: Example 2: a spectral window of 4 channels added, one of them at 850 GHz<br>
+   * RefractiveIndexProfileTest: Number of channels:              5<br>
+   * RefractiveIndexProfileTest: Number of distinct frequencies:  4<br>
+   * RefractiveIndexProfileTest: Total Dry Opacity at 850 GHz (spw 0 / spw 1): 0.117102 / 0.117102<br>
+   *<br>
+   * RefractiveIndexProfileTest: Example 3: the same spectral grid in lazy mode, spectral window 1 prefetched<br>
+   * RefractiveIndexProfileTest: Total Dry Opacity at 850 GHz (spw 0 / spw 1): 0.117102 / 0.117102<br>
+   * RefractiveIndexProfileTest: Total Dry Opacity at 850 GHz from the raw layer profile: 0.117102<br>
    *  </b>
   */
 
@@ -246,6 +255,34 @@ int main()
   cout << " RefractiveIndexProfileTest: (your actual water vapor column is " << (myProfile.getGroundWH2O()).get("mm") << " mm; " << (myRefractiveIndexProfile.getGroundWH2O()).get("mm") << " mm" <<endl;
   cout<<endl;
 
+  // a second spectral window whose reference channel falls on the first frequency: this channel
+  // shares the absorption profile already computed for 850 GHz.
+  myRefractiveIndexProfile.addNewSpectralWindow(4, 1, mySingleFreq, Frequency(0.5,"GHz"));
+  cout << " RefractiveIndexProfileTest: Example 2: a spectral window of 4 channels added, one of them at " << mySingleFreq.get("GHz") << " GHz" << endl;
+  cout << " RefractiveIndexProfileTest: Number of channels:              " << myRefractiveIndexProfile.getNumIndividualFrequencies() << endl;
+  cout << " RefractiveIndexProfileTest: Number of distinct frequencies:  " << myRefractiveIndexProfile.getNumUniqueFrequencies() << endl;
+  cout << " RefractiveIndexProfileTest: Total Dry Opacity at " << myRefractiveIndexProfile.getChanFreq(1,1).get("GHz")
+       << " GHz (spw 0 / spw 1): " << myRefractiveIndexProfile.getDryOpacity(0,0).get()
+       << " / " << myRefractiveIndexProfile.getDryOpacity(1,1).get() << endl;
+  cout<<endl;
+
+  // the same grid in lazy mode: nothing is computed before the first access to a spectral window
+  RefractiveIndexProfile myLazyRefractiveIndexProfile(myRefractiveIndexProfile, myProfile, true);
+  vector<size_t> spwIds(1, 1);
+  myLazyRefractiveIndexProfile.prefetch(spwIds);
+  cout << " RefractiveIndexProfileTest: Example 3: the same spectral grid in lazy mode, spectral window 1 prefetched" << endl;
+  cout << " RefractiveIndexProfileTest: Total Dry Opacity at " << myLazyRefractiveIndexProfile.getChanFreq(1,1).get("GHz")
+       << " GHz (spw 0 / spw 1): " << myLazyRefractiveIndexProfile.getDryOpacity(0,0).get()
+       << " / " << myLazyRefractiveIndexProfile.getDryOpacity(1,1).get() << endl;
+  const double *absDry = myLazyRefractiveIndexProfile.getAbsTotalDryData(1,1);
+  double dryOpacity = 0.0;
+  for(size_t j = 0; j < myLazyRefractiveIndexProfile.getNumLayer(); j++) {
+    dryOpacity = dryOpacity + absDry[j] * myLazyRefractiveIndexProfile.getLayerThickness(j).get("m");
+  }
+  cout << " RefractiveIndexProfileTest: Total Dry Opacity at " << myLazyRefractiveIndexProfile.getChanFreq(1,1).get("GHz")
+       << " GHz from the raw layer profile: " << dryOpacity << endl;
+  cout<<endl;
+
 
 
   /*
@@ -19,6 +19,8 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
  *******************************************************************************/
 
+#include <algorithm>
+#include <math.h>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -66,6 +68,20 @@ using namespace atm;
    *         of the <a href="classatm_1_1RefractiveIndexProfile.html">RefractiveIndexProfile</a> class that has a
    *         <a href="classatm_1_1SpectralGrid.html">SpectralGrid</a> with one band and eight frequecy channels.
    *         - Radiative transfer results are obtained for the eight frequency channels under different conditions specified by setters.
+   *         - The optically thin layers of a sky status for a band at 3 mm are merged, and the brightness temperatures obtained
+   *           with the original and the merged layers are compared.
+   *         - A sky status at 183 GHz is put in the altitude sliding mode, as for a balloon rising from the site: its
+   *           brightness temperatures at several observer altitudes are compared with those of sky statuses built at
+   *           these altitudes, then it goes back to the site.
+   *         - The ground temperature and sky background temperature of that sky status are changed, and its brightness
+   *           temperatures are compared with those of a new sky status (the difference must be 0).
+   *         - For a sky status with two spectral windows, around 183 GHz and at 3 mm, the brightness and Rayleigh-Jeans
+   *           temperatures of all the channels are obtained at once, with a sky coupling and spill over temperature per
+   *           channel, and compared with those obtained channel by channel (the difference must be 0).
+   *         - A skydip of the 3 mm window is computed for three water vapor columns and four air masses in one call, and
+   *           compared with the brightness temperatures and averages obtained point by point (the difference must be 0).
+   *         - The derivatives of the brightness temperature of a 183 GHz channel with respect to the water vapor column,
+   *           the sky coupling and the spill over temperature are compared with central finite differences.
    *
    *  The output of this test is the following:
    *
@@ -334,6 +350,196 @@ int main()
 
   }
 
+  // Streaming evaluation of the same band, from a lazy profile: the layer profiles are not stored
+
+  SkyStatus mySky_streamed(RefractiveIndexProfile(band, myProfile, true));
+  mySky_streamed.setUserWH2O(0.45,"mm");
+  vector<double> streamedTebb(mySky_streamed.getNumIndividualFrequencies());
+  vector<double> streamedPathLength(mySky_streamed.getNumIndividualFrequencies());
+  size_t numChunk = 0;
+  mySky_streamed.streamSpectrum([&](const SkyStatus::SpectrumChunk &chunk) {
+      numChunk++;
+      for(size_t i=0; i<chunk.numChan; i++){
+        cout << " SkyStatusTest: streamed Freq: " << chunk.frequency[i]*1.0e-9 << " GHz  /  T_EBB=" << chunk.tebbSky[i] << " K "
+             << " Total opacity: " << chunk.opacity[i] << " np  Path length: " << chunk.pathLength[i]*1.0e3 << " mm" << endl;
+      }
+    }, 2);
+  mySky_streamed.streamSpectrum(0, &streamedTebb[0], &streamedPathLength[0], 2);
+  cout << " SkyStatusTest: " << numChunk << " chunks of at most 2 channels" << endl;
+
+  double maxDiffTebb = 0.0;
+  double maxDiffPathLength = 0.0;
+  for(size_t i=0; i<mySky_1band_8channels.getNumChan(0); i++){
+    double pathLength = mySky_1band_8channels.getNonDispersiveDryPathLength(i).get("m")
+      + mySky_1band_8channels.getDispersiveDryPathLength(i).get("m")
+      + mySky_1band_8channels.getNonDispersiveH2OPathLength(i).get("m")
+      + mySky_1band_8channels.getDispersiveH2OPathLength(i).get("m");
+    maxDiffTebb = max(maxDiffTebb, fabs(streamedTebb[i] - mySky_1band_8channels.getTebbSky(i).get("K")));
+    maxDiffPathLength = max(maxDiffPathLength, fabs(streamedPathLength[i] - pathLength));
+  }
+  cout << " SkyStatusTest: largest difference with the stored profiles: " << maxDiffTebb << " K  "
+       << maxDiffPathLength*1.0e6 << " microns" << endl;
+
+  // Merging of the optically thin layers, for a band at 3 mm
+
+  SkyStatus mySky_merged(RefractiveIndexProfile(SpectralGrid(4, 0, Frequency(86.0,"GHz"), Frequency(2.0,"GHz")), myProfile));
+  mySky_merged.setUserWH2O(0.45,"mm");
+  vector<double> unmergedTebb;
+  for(size_t i=0; i<mySky_merged.getNumChan(0); i++){
+    unmergedTebb.push_back(mySky_merged.getTebbSky(i).get("K"));
+  }
+  SkyStatus::LayerMerging merging = mySky_merged.mergeThinLayers(Temperature(0.05,"K"), Length(0.02,"mm"));
+  cout << " SkyStatusTest: layers merged for errors below 0.05 K and 0.02 mm: " << merging.numLayerBefore << " -> "
+       << merging.numLayerAfter << " layers (estimated error of a group below " << merging.errorThreshold << " K)" << endl;
+  cout << " SkyStatusTest: largest errors: T_EBB " << merging.tebbError << " K  path length "
+       << merging.pathLengthError*1.0e6 << " microns  opacity " << merging.opacityError << " np" << endl;
+  for(size_t i=0; i<mySky_merged.getNumChan(0); i++){
+    cout << " SkyStatusTest: Freq: " << mySky_merged.getChanFreq(i).get("GHz") << " GHz  /  T_EBB=" << unmergedTebb[i]
+         << " K (original layers) " << mySky_merged.getTebbSky(i).get("K") << " K (merged layers)" << endl;
+  }
+  mySky_merged.setBasicAtmosphericParameters(Temperature(myProfile.getGroundTemperature().get("K") + 2.0,"K"));
+  cout << " SkyStatusTest: after a change of the ground temperature: " << mySky_merged.getNumLayer() << " layers" << endl;
+  mySky_merged.releaseMergedLayers();
+  cout << " SkyStatusTest: after releasing the merged layers: " << mySky_merged.getNumLayer() << " layers" << endl;
+
+  // Altitude sliding mode, for an observer rising from the site at 183 GHz
+
+  SpectralGrid band183(4, 0, Frequency(181.0,"GHz"), Frequency(2.0,"GHz"));
+  SkyStatus mySky_balloon(RefractiveIndexProfile(band183, myProfile));
+  mySky_balloon.setUserWH2O(0.45,"mm");
+  vector<double> siteTebb;
+  for(size_t i=0; i<mySky_balloon.getNumChan(0); i++){
+    siteTebb.push_back(mySky_balloon.getTebbSky(i).get("K"));
+  }
+  mySky_balloon.startAltitudeSliding();
+  double balloonAltitude[] = { 5300.0, 8000.0, 20000.0 };
+  for(size_t n=0; n<3; n++){
+    mySky_balloon.setObserverAltitude(Length(balloonAltitude[n],"m"));
+    AtmProfile balloonProfile(Length(balloonAltitude[n],"m"), mySky_balloon.getGroundPressure(), mySky_balloon.getGroundTemperature(),
+                              TLR, H, WVL, Pstep, PstepFact, topAtm, atmType);
+    SkyStatus mySky_built(RefractiveIndexProfile(band183, balloonProfile));
+    mySky_built.setUserWH2O(mySky_balloon.getUserWH2O());
+    cout << " SkyStatusTest: observer at " << balloonAltitude[n] << " m: " << mySky_balloon.getNumLayer() << " layers  P="
+         << mySky_balloon.getGroundPressure().get("mb") << " mb  T=" << mySky_balloon.getGroundTemperature().get("K")
+         << " K  water vapor column " << mySky_balloon.getUserWH2O().get("mm") << " mm" << endl;
+    for(size_t i=0; i<mySky_balloon.getNumChan(0); i++){
+      cout << " SkyStatusTest: Freq: " << mySky_balloon.getChanFreq(i).get("GHz") << " GHz  /  T_EBB="
+           << mySky_balloon.getTebbSky(i).get("K") << " K (sliding) " << mySky_built.getTebbSky(i).get("K")
+           << " K (profile built at this altitude)" << endl;
+    }
+  }
+  mySky_balloon.stopAltitudeSliding();
+  double maxDiffSite = 0.0;
+  for(size_t i=0; i<mySky_balloon.getNumChan(0); i++){
+    maxDiffSite = max(maxDiffSite, fabs(mySky_balloon.getTebbSky(i).get("K") - siteTebb[i]));
+  }
+  cout << " SkyStatusTest: back at the site: " << mySky_balloon.getNumLayer() << " layers, largest T_EBB difference "
+       << maxDiffSite << " K" << endl;
+
+  // The radiative transfer data kept by a sky status follow the changes of its profile and background
+
+  mySky_balloon.setBasicAtmosphericParameters(Temperature(275.0,"K"));
+  mySky_balloon.setSkyBackgroundTemperature(Temperature(10.0,"K"));
+  AtmProfile warmProfile(Alt, P, Temperature(275.0,"K"), TLR, H, WVL, Pstep, PstepFact, topAtm, atmType);
+  SkyStatus mySky_warm(RefractiveIndexProfile(band183, warmProfile));
+  mySky_warm.setUserWH2O(mySky_balloon.getUserWH2O());
+  mySky_warm.setSkyBackgroundTemperature(Temperature(10.0,"K"));
+  double maxDiffWarm = 0.0;
+  for(size_t i=0; i<mySky_balloon.getNumChan(0); i++){
+    maxDiffWarm = max(maxDiffWarm, fabs(mySky_balloon.getTebbSky(i).get("K") - mySky_warm.getTebbSky(i).get("K")));
+  }
+  cout << " SkyStatusTest: ground temperature raised to 275 K and sky background set to 10 K: T_EBB(" << mySky_balloon.getChanFreq(0).get("GHz")
+       << " GHz)=" << mySky_balloon.getTebbSky(size_t(0)).get("K") << " K, largest difference with a new sky status " << maxDiffWarm << " K" << endl;
+
+  // Whole spectra of two spectral windows at once, with a sky coupling and a spill over temperature per channel
+
+  SpectralGrid twoBands(4, 0, Frequency(181.0,"GHz"), Frequency(2.0,"GHz"));
+  twoBands.add(8, 0, Frequency(86.0,"GHz"), Frequency(0.5,"GHz"));
+  SkyStatus mySky_spectrum(RefractiveIndexProfile(twoBands, myProfile));
+  mySky_spectrum.setAirMass(1.3);
+  vector<size_t> spwids;
+  vector<double> spectrumCoupling, spectrumSpill;
+  for(size_t spwid=0; spwid<2; spwid++){
+    spwids.push_back(spwid);
+    for(size_t i=0; i<mySky_spectrum.getNumChan(spwid); i++){
+      spectrumCoupling.push_back(0.9 + 0.01*i);
+      spectrumSpill.push_back(260.0 + 2.0*i);
+    }
+  }
+  vector<double> tebbSpectrum(spectrumCoupling.size()), trjSpectrum(spectrumCoupling.size());
+  Length spectrumWH2O(1.2,"mm");
+  mySky_spectrum.getTebbSkySpectrum(spwids, spectrumWH2O, 1.3, &spectrumCoupling[0], &spectrumSpill[0], &tebbSpectrum[0]);
+  mySky_spectrum.getTrjSkySpectrum(spwids, spectrumWH2O, 1.3, &spectrumCoupling[0], &spectrumSpill[0], &trjSpectrum[0]);
+  double maxDiffSpectrum = 0.0;
+  size_t k = 0;
+  for(size_t spwid=0; spwid<2; spwid++){
+    for(size_t i=0; i<mySky_spectrum.getNumChan(spwid); i++, k++){
+      double tebb = mySky_spectrum.getTebbSky(spwid, i, spectrumWH2O, 1.3, spectrumCoupling[k], Temperature(spectrumSpill[k],"K")).get("K");
+      double trj = mySky_spectrum.getTrjSky(spwid, i, spectrumWH2O, 1.3, spectrumCoupling[k], Temperature(spectrumSpill[k],"K")).get("K");
+      maxDiffSpectrum = max(maxDiffSpectrum, max(fabs(tebbSpectrum[k] - tebb), fabs(trjSpectrum[k] - trj)));
+      if(i == 0){
+        cout << " SkyStatusTest: spectral window " << spwid << ", Freq: " << mySky_spectrum.getChanFreq(spwid, i).get("GHz") << " GHz  /  T_EBB="
+             << tebbSpectrum[k] << " K  T_RJ=" << trjSpectrum[k] << " K (sky coupling " << spectrumCoupling[k] << ", T_spill "
+             << spectrumSpill[k] << " K)" << endl;
+      }
+    }
+  }
+  vector<double> tebbSpectrum0(mySky_spectrum.getNumChan(0));
+  mySky_spectrum.getTebbSkySpectrum(0, &tebbSpectrum0[0]);
+  cout << " SkyStatusTest: spectra of all the channels at once: largest difference with the channel by channel temperatures "
+       << maxDiffSpectrum << " K; T_EBB(" << mySky_spectrum.getChanFreq(0).get("GHz") << " GHz) for the current conditions "
+       << tebbSpectrum0[0] << " K (channel by channel " << mySky_spectrum.getTebbSky(size_t(0)).get("K") << " K)" << endl;
+
+  // Skydip of the 3 mm window: a batch of water vapor columns and air masses in one call
+
+  vector<Length> skydipWH2O;
+  skydipWH2O.push_back(Length(0.5,"mm"));
+  skydipWH2O.push_back(Length(1.0,"mm"));
+  skydipWH2O.push_back(Length(2.0,"mm"));
+  double skydipAirmassValues[] = { 1.0, 1.5, 2.0, 3.0 };
+  vector<double> skydipAirmass(skydipAirmassValues, skydipAirmassValues + 4);
+  size_t numChan3mm = mySky_spectrum.getNumChan(1);
+  vector<double> skydipCube(skydipWH2O.size() * skydipAirmass.size() * numChan3mm);
+  vector<double> skydipAverage(skydipWH2O.size() * skydipAirmass.size());
+  mySky_spectrum.getTebbSkyCube(1, skydipWH2O, skydipAirmass, &spectrumCoupling[4], &spectrumSpill[4], &skydipCube[0]);
+  mySky_spectrum.getAverageTebbSkyCube(1, skydipWH2O, skydipAirmass, 0.95, Temperature(270.0,"K"), &skydipAverage[0]);
+  double maxDiffSkydip = 0.0;
+  for(size_t i=0; i<skydipWH2O.size(); i++){
+    for(size_t j=0; j<skydipAirmass.size(); j++){
+      for(size_t nc=0; nc<numChan3mm; nc++){
+        double tebb = mySky_spectrum.getTebbSky(1, nc, skydipWH2O[i], skydipAirmass[j], spectrumCoupling[4+nc], Temperature(spectrumSpill[4+nc],"K")).get("K");
+        maxDiffSkydip = max(maxDiffSkydip, fabs(skydipCube[(i*skydipAirmass.size()+j)*numChan3mm+nc] - tebb));
+      }
+      double average = mySky_spectrum.getAverageTebbSky(1, skydipWH2O[i], skydipAirmass[j], 0.95, Temperature(270.0,"K")).get("K");
+      maxDiffSkydip = max(maxDiffSkydip, fabs(skydipAverage[i*skydipAirmass.size()+j] - average));
+    }
+  }
+  for(size_t j=0; j<skydipAirmass.size(); j++){
+    cout << " SkyStatusTest: skydip at 3 mm, air mass " << skydipAirmass[j] << ": average T_EBB=" << skydipAverage[j] << " K / "
+         << skydipAverage[skydipAirmass.size()+j] << " K / " << skydipAverage[2*skydipAirmass.size()+j] << " K (0.5 / 1 / 2 mm)" << endl;
+  }
+  cout << " SkyStatusTest: skydip cube: largest difference with the point by point temperatures " << maxDiffSkydip << " K" << endl;
+
+  // Exact derivatives of the brightness temperature, against central finite differences
+
+  double dTebb_dWH2O, dTebb_dSkyCoupling, dTebb_dTspill;
+  Temperature tebbDerivatives = mySky_spectrum.getTebbSkyDerivatives(0, 1, spectrumWH2O, 1.3, 0.9, Temperature(260.0,"K"),
+                                                                     dTebb_dWH2O, dTebb_dSkyCoupling, dTebb_dTspill);
+  double hWH2O = 0.001, hCoupling = 0.001, hTspill = 0.1;
+  double fdWH2O = (mySky_spectrum.getTebbSky(0, 1, Length(spectrumWH2O.get("mm") + hWH2O,"mm"), 1.3, 0.9, Temperature(260.0,"K")).get("K")
+                   - mySky_spectrum.getTebbSky(0, 1, Length(spectrumWH2O.get("mm") - hWH2O,"mm"), 1.3, 0.9, Temperature(260.0,"K")).get("K"))
+                  / (2.0 * hWH2O);
+  double fdCoupling = (mySky_spectrum.getTebbSky(0, 1, spectrumWH2O, 1.3, 0.9 + hCoupling, Temperature(260.0,"K")).get("K")
+                       - mySky_spectrum.getTebbSky(0, 1, spectrumWH2O, 1.3, 0.9 - hCoupling, Temperature(260.0,"K")).get("K"))
+                      / (2.0 * hCoupling);
+  double fdTspill = (mySky_spectrum.getTebbSky(0, 1, spectrumWH2O, 1.3, 0.9, Temperature(260.0 + hTspill,"K")).get("K")
+                     - mySky_spectrum.getTebbSky(0, 1, spectrumWH2O, 1.3, 0.9, Temperature(260.0 - hTspill,"K")).get("K"))
+                    / (2.0 * hTspill);
+  cout << " SkyStatusTest: T_EBB(" << mySky_spectrum.getChanFreq(0, 1).get("GHz") << " GHz)=" << tebbDerivatives.get("K") << " K" << endl;
+  cout << " SkyStatusTest:   dT_EBB/dw=" << dTebb_dWH2O << " K/mm (finite differences " << fdWH2O << " K/mm)" << endl;
+  cout << " SkyStatusTest:   dT_EBB/d(sky coupling)=" << dTebb_dSkyCoupling << " K (finite differences " << fdCoupling << " K)" << endl;
+  cout << " SkyStatusTest:   dT_EBB/dT_spill=" << dTebb_dTspill << " (finite differences " << fdTspill << ")" << endl;
+
   return 0;
 
 }
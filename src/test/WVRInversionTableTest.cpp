@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+#include <cstdio>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+#include "ATMWVRInversionTable.h"
+
+#include <chrono>
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1WVRInversionTable.html">WVRInversionTable</a> Class
+   *
+   *   The test is structured as follows:
+   *         - The SkyStatus and 183 GHz WaterVaporRadiometer of AbInitioTest are built (Mauna Kea, 3 double
+   *           side band channels).
+   *         - A WVRInversionTable is built for them, down to 40 degrees of elevation. Its size and the accuracy
+   *           checked against the fit of SkyStatus::mkWaterVaporRetrieval_fromWVR() are printed.
+   *         - 1800 consecutive measurement sets of the Mauna Kea WVR data (1 Hz) are retrieved by
+   *           SkyStatus::WaterVaporRetrieval_fromWVR(), the reference, and by the table. The largest difference
+   *           and the times per measurement set are printed.
+   *         - Measurement sets at an elevation and of a water vapor column out of the table are not retrieved.
+   *         - The ground temperature of the SkyStatus is changed by less, then by more, than the threshold:
+   *           update() builds the table again only for the latter; a change of the sky couplings of the
+   *           WaterVaporRadiometer of the SkyStatus also builds it again, and so does a retrieval given the
+   *           SkyStatus after another change of the ground temperature.
+   */
+int main()
+{
+  #ifdef HAVE_WINDOWS
+  fprintf(stdout, "Skipping test under Windows.\n");
+  return 0;
+  #endif
+
+  AtmProfile myProfile(Length(4100,"m"), Pressure(623.0,"mb"), Temperature(268.15,"K"), -5.6, Humidity(11.30,"%"),
+                       Length(2.2,"km"), Pressure(5.0,"mb"), 1.1, Length(48.0,"km"), 1);
+
+  vector<size_t> WVR_signalId;
+  SpectralGrid alma_SpectralGrid(11, 6, Frequency(182.11,"GHz"), Frequency(0.04,"GHz"), Frequency(1.20,"GHz"), LSB, DSB);
+  WVR_signalId.push_back(0);
+  RefractiveIndexProfile alma_RefractiveIndexProfile(alma_SpectralGrid, myProfile);
+  WVR_signalId.push_back(alma_RefractiveIndexProfile.getNumSpectralWindow());
+  alma_RefractiveIndexProfile.addNewSpectralWindow(11, 6, Frequency(179.11,"GHz"), Frequency(0.09,"GHz"), Frequency(4.20,"GHz"), LSB, DSB);
+  WVR_signalId.push_back(alma_RefractiveIndexProfile.getNumSpectralWindow());
+  alma_RefractiveIndexProfile.addNewSpectralWindow(11, 6, Frequency(175.51,"GHz"), Frequency(0.10,"GHz"), Frequency(7.80,"GHz"), LSB, DSB);
+
+  SkyStatus skyAntenna1(alma_RefractiveIndexProfile);
+  vector<double> skycoupling183(WVR_signalId.size(), 0.8);
+  vector<Percent> signalgain183(WVR_signalId.size(), Percent(50.0,"%"));
+  skyAntenna1.setWaterVaporRadiometer(WaterVaporRadiometer(WVR_signalId, skycoupling183, signalgain183, Temperature(285.15,"K")));
+  skyAntenna1.setUserWH2O(Length(1.0,"mm"));
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  WVRInversionTable table(skyAntenna1, Length(4.0,"mm"), Length(0.05,"mm"), Angle(40.0,"deg"), 0.05);
+  double buildTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << " WVRInversionTableTest: table of " << table.getNumWH2O() << " water vapor columns by "
+       << table.getNumAirMass() << " air masses (up to " << table.getMaxAirMass() << "), built in "
+       << buildTime << " s" << endl;
+  cout << " WVRInversionTableTest: accuracy at " << table.getNumCheck() << " points: largest difference with the fit "
+       << table.getMaxError().get("mm") * 1000 << " microns, rms " << table.getRmsError().get("mm") * 1000
+       << " microns; largest error of the sky brightness temperatures " << table.getMaxTebbError().get("K") << " K" << endl;
+
+  // the Mauna Kea WVR data: time (s), elevation (deg) and the sky brightness temperatures of the channels (K)
+  vector<WVRMeasurement> RadiometerData;
+  FILE *fp = fopen("WVR_MAUNA_KEA/radiometer_data.dat", "r");
+  if(fp == 0) {
+    cout << " WVRInversionTableTest: ERROR: WVR_MAUNA_KEA/radiometer_data.dat not found" << endl;
+    return 1;
+  }
+  char aRow[81];
+  while(fgets(aRow, 80, fp) != 0) {
+    char *token = strtok(aRow, ",");
+    if(token == 0) continue;
+    Angle elevation(atof(strtok(0, ",")), "deg");
+    vector<Temperature> v_tsky;
+    while((token = strtok(0, ",\n")) != 0) v_tsky.push_back(Temperature(atof(token), "K"));
+    RadiometerData.push_back(WVRMeasurement(elevation, v_tsky));
+  }
+  fclose(fp);
+
+  size_t first = 9000;
+  size_t num = 1800;
+  vector<WVRMeasurement> referenceData(RadiometerData);
+  start = chrono::steady_clock::now();
+  skyAntenna1.WaterVaporRetrieval_fromWVR(referenceData, first, first + num);
+  double referenceTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  skyAntenna1.setUserWH2O(Length(1.0,"mm"));
+
+  vector<WVRMeasurement> tableData(RadiometerData);
+  size_t numOut = 0;
+  start = chrono::steady_clock::now();
+  for(size_t i = first; i < first + num; i++) {
+    if(!table.retrieve(tableData[i])) numOut++;
+  }
+  double tableTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  double maxDiff = 0.0;
+  double maxSigmaDiff = 0.0;
+  for(size_t i = first; i < first + num; i++) {
+    double diff = fabs(tableData[i].getretrievedWaterVaporColumn().get("mm") - referenceData[i].getretrievedWaterVaporColumn().get("mm"));
+    if(diff > maxDiff) maxDiff = diff;
+    diff = fabs(tableData[i].getSigmaFit().get("K") - referenceData[i].getSigmaFit().get("K"));
+    if(diff > maxSigmaDiff) maxSigmaDiff = diff;
+  }
+  cout << " WVRInversionTableTest: " << num << " measurement sets from the line " << first << " of the Mauna Kea data, "
+       << numOut << " out of the table" << endl;
+  cout << " WVRInversionTableTest:   largest difference with SkyStatus::WaterVaporRetrieval_fromWVR(): "
+       << maxDiff * 1000 << " microns (rms of the fit: " << maxSigmaDiff << " K)" << endl;
+  cout << " WVRInversionTableTest:   time per measurement set: " << referenceTime / num * 1.0e6
+       << " microseconds by the fit, " << tableTime / num * 1.0e6 << " microseconds by the table" << endl;
+
+  // elevations out of the table
+  WVRMeasurement low(Angle(30.0,"deg"), RadiometerData[first].getmeasuredSkyBrightness());
+  cout << " WVRInversionTableTest: at 30 degrees of elevation: " << (table.retrieve(low) ? "retrieved" : "out of the table")
+       << ", " << low.getretrievedWaterVaporColumn().get("mm") << " mm" << endl;
+
+  // a water vapor column out of the table
+  WVRStreamRetriever model(skyAntenna1);
+  vector<double> tebbWet(WVR_signalId.size());
+  model.getTebbSky(Length(6.0,"mm"), 1.0 / sin(3.1415926 / 4.0), &tebbWet[0], 0);
+  vector<Temperature> v_tebbWet;
+  for(size_t i = 0; i < tebbWet.size(); i++) v_tebbWet.push_back(Temperature(tebbWet[i],"K"));
+  WVRMeasurement wet(Angle(45.0,"deg"), v_tebbWet);
+  cout << " WVRInversionTableTest: 6 mm at 45 degrees of elevation: " << (table.retrieve(wet) ? "retrieved" : "out of the table")
+       << ", " << wet.getretrievedWaterVaporColumn().get("mm") << " mm" << endl;
+
+  skyAntenna1.setBasicAtmosphericParameters(Temperature(268.65,"K"));
+  bool rebuilt = table.update(skyAntenna1);
+  cout << " WVRInversionTableTest: ground temperature changed by 0.5 K: " << (rebuilt ? "built again" : "kept")
+       << " (" << table.getNumBuild() << " builds)" << endl;
+  skyAntenna1.setBasicAtmosphericParameters(Temperature(271.15,"K"));
+  rebuilt = table.update(skyAntenna1);
+  cout << " WVRInversionTableTest: ground temperature changed by 3 K: " << (rebuilt ? "built again" : "kept")
+       << " (" << table.getNumBuild() << " builds), largest difference with the fit "
+       << table.getMaxError().get("mm") * 1000 << " microns" << endl;
+  rebuilt = table.update(skyAntenna1);
+  cout << " WVRInversionTableTest: no change: " << (rebuilt ? "built again" : "kept") << " (" << table.getNumBuild()
+       << " builds)" << endl;
+  skyAntenna1.setWaterVaporRadiometer(WaterVaporRadiometer(WVR_signalId, vector<double>(WVR_signalId.size(), 0.9),
+                                                           signalgain183, Temperature(285.15,"K")));
+  rebuilt = table.update(skyAntenna1);
+  cout << " WVRInversionTableTest: sky couplings changed to 0.9: " << (rebuilt ? "built again" : "kept") << " ("
+       << table.getNumBuild() << " builds)" << endl;
+
+  // retrievals following the SkyStatus
+  skyAntenna1.setBasicAtmosphericParameters(Temperature(268.15,"K"));
+  WVRMeasurement measurement(RadiometerData[first]);
+  table.retrieve(skyAntenna1, measurement);
+  cout << " WVRInversionTableTest: ground temperature changed back, retrieval with the SkyStatus: "
+       << measurement.getretrievedWaterVaporColumn().get("mm") << " mm (" << table.getNumBuild() << " builds)" << endl;
+  table.retrieve(skyAntenna1, measurement);
+  cout << " WVRInversionTableTest: retrieval with the unchanged SkyStatus: " << measurement.getretrievedWaterVaporColumn().get("mm")
+       << " mm (" << table.getNumBuild() << " builds)" << endl;
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * ALMA - Atacama Large Millimeter Array
+ * (c) Instituto de Estructura de la Materia, 2011
+ * (in the framework of the ALMA collaboration).
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *******************************************************************************/
+
+#include <cstdio>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+#include "ATMWVRStreamRetriever.h"
+
+using namespace atm;
+  /** \brief A C++ main code to test the <a href="classatm_1_1WVRStreamRetriever.html">WVRStreamRetriever</a> Class
+   *
+   *   The test is structured as follows:
+   *         - The SkyStatus and 183 GHz WaterVaporRadiometer of AbInitioTest are built (Mauna Kea, 3 double
+   *           side band channels).
+   *         - 1800 consecutive measurement sets of the Mauna Kea WVR data (1 Hz) are retrieved by
+   *           SkyStatus::WaterVaporRetrieval_fromWVR(), the reference, and by a WVRStreamRetriever, without and
+   *           with the linear predictor. The numbers of evaluations of the model per measurement set, the
+   *           largest differences with the reference and the water vapor column of the SkyStatus (which the
+   *           retriever does not change) are printed.
+   *         - The stream is interrupted by a gap longer than the largest gap: the retrieval after it starts again
+   *           from the water vapor column of the SkyStatus.
+   */
+int main()
+{
+  #ifdef HAVE_WINDOWS
+  fprintf(stdout, "Skipping test under Windows.\n");
+  return 0;
+  #endif
+
+  AtmProfile myProfile(Length(4100,"m"), Pressure(623.0,"mb"), Temperature(268.15,"K"), -5.6, Humidity(11.30,"%"),
+                       Length(2.2,"km"), Pressure(5.0,"mb"), 1.1, Length(48.0,"km"), 1);
+
+  vector<size_t> WVR_signalId;
+  SpectralGrid alma_SpectralGrid(11, 6, Frequency(182.11,"GHz"), Frequency(0.04,"GHz"), Frequency(1.20,"GHz"), LSB, DSB);
+  WVR_signalId.push_back(0);
+  RefractiveIndexProfile alma_RefractiveIndexProfile(alma_SpectralGrid, myProfile);
+  WVR_signalId.push_back(alma_RefractiveIndexProfile.getNumSpectralWindow());
+  alma_RefractiveIndexProfile.addNewSpectralWindow(11, 6, Frequency(179.11,"GHz"), Frequency(0.09,"GHz"), Frequency(4.20,"GHz"), LSB, DSB);
+  WVR_signalId.push_back(alma_RefractiveIndexProfile.getNumSpectralWindow());
+  alma_RefractiveIndexProfile.addNewSpectralWindow(11, 6, Frequency(175.51,"GHz"), Frequency(0.10,"GHz"), Frequency(7.80,"GHz"), LSB, DSB);
+
+  SkyStatus skyAntenna1(alma_RefractiveIndexProfile);
+  vector<double> skycoupling183(WVR_signalId.size(), 0.8);
+  vector<Percent> signalgain183(WVR_signalId.size(), Percent(50.0,"%"));
+  skyAntenna1.setWaterVaporRadiometer(WaterVaporRadiometer(WVR_signalId, skycoupling183, signalgain183, Temperature(285.15,"K")));
+
+  // the Mauna Kea WVR data: time (s), elevation (deg) and the sky brightness temperatures of the channels (K)
+  vector<WVRMeasurement> RadiometerData;
+  vector<double> time;
+  FILE *fp = fopen("WVR_MAUNA_KEA/radiometer_data.dat", "r");
+  if(fp == 0) {
+    cout << " WVRStreamRetrieverTest: ERROR: WVR_MAUNA_KEA/radiometer_data.dat not found" << endl;
+    return 1;
+  }
+  char aRow[81];
+  while(fgets(aRow, 80, fp) != 0) {
+    char *token = strtok(aRow, ",");
+    if(token == 0) continue;
+    time.push_back(atof(token));
+    Angle elevation(atof(strtok(0, ",")), "deg");
+    vector<Temperature> v_tsky;
+    while((token = strtok(0, ",\n")) != 0) v_tsky.push_back(Temperature(atof(token), "K"));
+    RadiometerData.push_back(WVRMeasurement(elevation, v_tsky));
+  }
+  fclose(fp);
+
+  size_t first = 9000;
+  size_t num = 1800;
+  cout << " WVRStreamRetrieverTest: " << RadiometerData.size() << " WVR measurement sets read; " << num
+       << " retrieved from " << time[first] << " s" << endl;
+
+  vector<WVRMeasurement> referenceData(RadiometerData);
+  skyAntenna1.setUserWH2O(Length(1.0,"mm"));
+  skyAntenna1.WaterVaporRetrieval_fromWVR(referenceData, first, first + num);
+  skyAntenna1.setUserWH2O(Length(1.0,"mm"));
+
+  for(size_t predictor = 0; predictor < 2; predictor++) {
+    WVRStreamRetriever retriever(skyAntenna1);
+    retriever.setLinearPredictor(predictor == 1);
+    vector<WVRMeasurement> streamData(RadiometerData);
+    double maxDiff = 0.0;
+    double maxSigmaDiff = 0.0;
+    size_t numTwoEvaluations = 0;
+    for(size_t i = first; i < first + num; i++) {
+      retriever.retrieve(time[i], streamData[i]);
+      if(retriever.getNumEvaluation() <= 2) numTwoEvaluations++;
+      double diff = fabs(streamData[i].getretrievedWaterVaporColumn().get("mm") - referenceData[i].getretrievedWaterVaporColumn().get("mm"));
+      if(diff > maxDiff) maxDiff = diff;
+      diff = fabs(streamData[i].getSigmaFit().get("K") - referenceData[i].getSigmaFit().get("K"));
+      if(diff > maxSigmaDiff) maxSigmaDiff = diff;
+    }
+    cout << " WVRStreamRetrieverTest: " << (predictor == 1 ? "with" : "without") << " the linear predictor: "
+         << retriever.getNumSample() << " retrievals, " << retriever.getNumFailure() << " not converged, "
+         << (double) retriever.getTotalNumEvaluation() / retriever.getNumSample() << " evaluations per retrieval, "
+         << numTwoEvaluations << " in two evaluations at most" << endl;
+    cout << " WVRStreamRetrieverTest:   largest difference with SkyStatus::WaterVaporRetrieval_fromWVR(): "
+         << maxDiff * 1000 << " microns (rms of the fit: " << maxSigmaDiff << " K); last column "
+         << retriever.getWaterVaporColumn().get("mm") << " mm, damping " << retriever.getDamping() << endl;
+  }
+  cout << " WVRStreamRetrieverTest: water vapor column of the SkyStatus: " << skyAntenna1.getUserWH2O().get("mm") << " mm" << endl;
+
+  WVRStreamRetriever retriever(skyAntenna1);
+  WVRMeasurement measurement(RadiometerData[first]);
+  retriever.retrieve(time[first], measurement);
+  retriever.retrieve(time[first + 1], measurement);
+  size_t warm = retriever.getNumEvaluation();
+  retriever.retrieve(time[first + 1] + 60.0, measurement);
+  cout << " WVRStreamRetrieverTest: evaluations after 1 s: " << warm << ", after a gap of 60 s: "
+       << retriever.getNumEvaluation() << " (largest gap " << retriever.getMaxGap() << " s)" << endl;
+
+  return 0;
+}